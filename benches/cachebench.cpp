@@ -0,0 +1,392 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/* Looks up, opens and lists files in a host directory mounted with
+ * localDrive, to measure the drive cache's name lookups and its negative
+ * lookup cache, and to check that a file created on the host behind the
+ * drive's back is found.
+ *
+ * The drive and its cache are the real ones; the little of DOS they reach
+ * into is stubbed out below, with guest memory being a plain array. */
+
+#include "dosbox.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <utime.h>
+#include <vector>
+
+#include "cross.h"
+#include "dos/dos_mscdex.h"
+#include "dos_inc.h"
+#include "drives.h"
+#include "fs_utils.h"
+#include "inout.h"
+#include "mem.h"
+
+MachineType machine = MCH_VGA;
+DOS_Block dos;
+DOS_Drive *Drives[DOS_DRIVES] = {};
+DOS_File *Files[DOS_FILES] = {};
+
+// Enough conventional memory for the DTA
+static std::vector<Bit8u> memory(1024 * 1024);
+HostPt MemBase = memory.data();
+
+Bit8u mem_readb(PhysPt pt) { return host_readb(MemBase + pt); }
+Bit16u mem_readw(PhysPt pt) { return host_readw(MemBase + pt); }
+Bit32u mem_readd(PhysPt pt) { return host_readd(MemBase + pt); }
+void mem_writeb(PhysPt pt, Bit8u val) { host_writeb(MemBase + pt, val); }
+void mem_writew(PhysPt pt, Bit16u val) { host_writew(MemBase + pt, val); }
+void mem_writed(PhysPt pt, Bit32u val) { host_writed(MemBase + pt, val); }
+
+void MEM_BlockRead(PhysPt pt, void *data, Bitu size)
+{
+	memcpy(data, MemBase + pt, size);
+}
+
+void MEM_BlockWrite(PhysPt pt, const void *data, Bitu size)
+{
+	memcpy(MemBase + pt, data, size);
+}
+
+void DOS_SetError(Bit16u code)
+{
+	dos.errorcode = code;
+}
+
+void DOS_DTA::SetupSearch(Bit8u drive, Bit8u attr, char *pattern)
+{
+	SSET_BYTE(sDTA, sdrive, drive);
+	SSET_BYTE(sDTA, sattr, attr);
+	char name[11];
+	memset(name, ' ', sizeof(name));
+	const char *ext = strchr(pattern, '.');
+	const size_t name_len = ext ? static_cast<size_t>(ext - pattern)
+	                            : strlen(pattern);
+	memcpy(name, pattern, std::min<size_t>(name_len, 8));
+	if (ext)
+		memcpy(name + 8, ext + 1, std::min<size_t>(strlen(ext + 1), 3));
+	MEM_BlockWrite(pt + offsetof(sDTA, sname), name, sizeof(name));
+}
+
+void DOS_DTA::SetResult(const char *found_name, Bit32u found_size,
+                        Bit16u found_date, Bit16u found_time, Bit8u found_attr)
+{
+	MEM_BlockWrite(pt + offsetof(sDTA, name), found_name, strlen(found_name) + 1);
+	SSET_DWORD(sDTA, size, found_size);
+	SSET_WORD(sDTA, date, found_date);
+	SSET_WORD(sDTA, time, found_time);
+	SSET_BYTE(sDTA, attr, found_attr);
+}
+
+void DOS_DTA::GetResult(char *found_name, Bit32u &found_size, Bit16u &found_date,
+                        Bit16u &found_time, Bit8u &found_attr) const
+{
+	MEM_BlockRead(pt + offsetof(sDTA, name), found_name, DOS_NAMELENGTH_ASCII);
+	found_size = SGET_DWORD(sDTA, size);
+	found_date = SGET_WORD(sDTA, date);
+	found_time = SGET_WORD(sDTA, time);
+	found_attr = SGET_BYTE(sDTA, attr);
+}
+
+void DOS_DTA::GetSearchParams(Bit8u &attr, char *pattern) const
+{
+	attr = SGET_BYTE(sDTA, sattr);
+	char name[11];
+	MEM_BlockRead(pt + offsetof(sDTA, sname), name, sizeof(name));
+	memcpy(pattern, name, 8);
+	pattern[8] = '.';
+	memcpy(&pattern[9], &name[8], 3);
+	pattern[12] = 0;
+}
+
+uint16_t DOS_PackTime(const struct tm &datetime) noexcept
+{
+	return static_cast<uint16_t>((datetime.tm_hour << 11) |
+	                             (datetime.tm_min << 5) | (datetime.tm_sec / 2));
+}
+
+uint16_t DOS_PackDate(const struct tm &datetime) noexcept
+{
+	return static_cast<uint16_t>(((datetime.tm_year - 80) << 9) |
+	                             ((datetime.tm_mon + 1) << 5) | datetime.tm_mday);
+}
+
+// The CD-ROM drive living next to the local drive, which doesn't get used
+int MSCDEX_AddDrive(char, const char *, Bit8u &)
+{
+	return 1;
+}
+int MSCDEX_RemoveDrive(char)
+{
+	return 0;
+}
+bool MSCDEX_GetVolumeName(Bit8u, char *)
+{
+	return false;
+}
+bool MSCDEX_HasMediaChanged(Bit8u)
+{
+	return false;
+}
+void IO_WriteB(io_port_t, io_val_t) {}
+io_val_t IO_ReadB(io_port_t)
+{
+	return 0xff;
+}
+
+void GFX_ShowMsg(const char *format, ...)
+{
+	(void)format;
+}
+
+static std::string file_name(Bit32u n)
+{
+	return "DATA" + std::to_string(n) + ".DAT";
+}
+
+// Names of the kind programs probe for, a configuration or a driver
+static std::string missing_name(Bit32u n)
+{
+	return "MISS" + std::to_string(n) + ".CFG";
+}
+
+using bench_clock = std::chrono::steady_clock;
+
+static double seconds_since(bench_clock::time_point start)
+{
+	const std::chrono::duration<double> elapsed = bench_clock::now() - start;
+	return std::max(elapsed.count(), 1e-9);
+}
+
+static void report(const char *name, double seconds, Bit32u operations)
+{
+	printf("%-10s %8.3f s %11.0f ops/s\n", name, seconds, operations / seconds);
+}
+
+static bool open_and_close(localDrive &drive, const std::string &name)
+{
+	std::string dos_name = name;
+	DOS_File *file = nullptr;
+	if (!drive.FileOpen(&file, &dos_name[0], OPEN_READ))
+		return false;
+	file->AddRef();
+	file->Close();
+	delete file;
+	return true;
+}
+
+// Lists a directory of the drive the way DIR does, returning the number of
+// entries found
+static Bit32u count_entries(localDrive &drive, const std::string &dos_dir)
+{
+	DOS_DTA dta(RealMake(0x2000, 0x80));
+	char pattern[] = "*.*";
+	std::string search_dir = dos_dir;
+	dta.SetupSearch(0, DOS_ATTR_ARCHIVE | DOS_ATTR_DIRECTORY, pattern);
+	Bit32u found = 0;
+	for (bool more = drive.FindFirst(&search_dir[0], dta); more;
+	     more = drive.FindNext(dta))
+		++found;
+	return found;
+}
+
+static void usage()
+{
+	fprintf(stderr,
+	        "Usage:\n"
+	        "  dosbox-cachebench [-n FILES] [-r ROUNDS] [-t DIRS] [-p] [-w MS]\n"
+	        "                    [-d DIR] [-k]\n"
+	        "\n"
+	        "Creates a directory holding FILES empty files (2000 by\n"
+	        "default) and mounts it as a local drive. Then looks up every\n"
+	        "file and as many missing ones, opens them, and lists the\n"
+	        "directory, ROUNDS times each (20 by default), reporting the\n"
+	        "time taken by each step. Then mounts the directory again and\n"
+	        "lists DIRS subdirectories of 100 files each (100 by default)\n"
+	        "for the first time. Finally creates a file in the directory on the host after the\n"
+	        "drive found it missing, and fails unless the drive finds it\n"
+	        "afterwards.\n"
+	        "\n"
+	        "  -p  start the background pre-scan on the second mount, and\n"
+	        "      wait MS milliseconds (500 by default) before listing\n"
+	        "  -d  the directory to create, dosbox-cachebench.dir by\n"
+	        "      default; it is removed when done\n"
+	        "  -k  keep the directory, and use it as it is if it exists;\n"
+	        "      run again with the same options after dropping the\n"
+	        "      host's caches to read the directories from the disk\n");
+}
+
+int main(int argc, char *argv[])
+{
+	Bit32u files = 2000;
+	Bit32u rounds = 20;
+	Bit32u subdirs = 100;
+	Bit32u wait_ms = 500;
+	bool prescan = false;
+	bool keep = false;
+	std::string dir = "dosbox-cachebench.dir";
+	for (int arg = 1; arg < argc; ++arg) {
+		const bool has_value = arg + 1 < argc;
+		if (!strcmp(argv[arg], "-n") && has_value) {
+			files = strtoul(argv[++arg], nullptr, 10);
+		} else if (!strcmp(argv[arg], "-r") && has_value) {
+			rounds = strtoul(argv[++arg], nullptr, 10);
+		} else if (!strcmp(argv[arg], "-t") && has_value) {
+			subdirs = strtoul(argv[++arg], nullptr, 10);
+		} else if (!strcmp(argv[arg], "-p")) {
+			prescan = true;
+		} else if (!strcmp(argv[arg], "-w") && has_value) {
+			wait_ms = strtoul(argv[++arg], nullptr, 10);
+		} else if (!strcmp(argv[arg], "-k")) {
+			keep = true;
+		} else if (!strcmp(argv[arg], "-d") && has_value) {
+			dir = argv[++arg];
+		} else {
+			usage();
+			return 1;
+		}
+	}
+	if (!files || files > 9999 || !rounds || subdirs > 9999) {
+		usage();
+		return 1;
+	}
+
+	// A kept directory is used as it is, so that the host's caches can be
+	// dropped before the run
+	struct stat dir_stat;
+	const bool reuse = keep && stat(dir.c_str(), &dir_stat) == 0;
+	if (!reuse && create_dir(dir.c_str(), 0700) != 0) {
+		fprintf(stderr, "Can't create %s: %s\n", dir.c_str(), strerror(errno));
+		return 1;
+	}
+	const std::string base_dir = dir + CROSS_FILESPLIT;
+	// Created on the host at the end, left over if a kept run failed
+	const std::string late_name = missing_name(0);
+	const std::string late_path = base_dir + late_name;
+	remove(late_path.c_str());
+
+	constexpr Bit32u files_per_subdir = 100;
+	std::vector<std::string> created;
+	std::vector<std::string> created_dirs;
+	for (Bit32u n = 0; n < files && !reuse; ++n) {
+		created.push_back(base_dir + file_name(n));
+		FILE *f = fopen(created.back().c_str(), "wb");
+		if (f)
+			fclose(f);
+	}
+	for (Bit32u d = 0; d < subdirs && !reuse; ++d) {
+		created_dirs.push_back(base_dir + "SUB" + std::to_string(d));
+		create_dir(created_dirs.back().c_str(), 0700);
+		for (Bit32u n = 0; n < files_per_subdir; ++n) {
+			created.push_back(created_dirs.back() + CROSS_FILESPLIT +
+			                  file_name(n));
+			FILE *f = fopen(created.back().c_str(), "wb");
+			if (f)
+				fclose(f);
+		}
+	}
+	// Dates the directory back, as the negative lookup cache doesn't
+	// trust a directory changed in the last few seconds
+	const time_t past = time(nullptr) - 60;
+	struct utimbuf times = {past, past};
+	utime(dir.c_str(), &times);
+
+	bool failed = false;
+	std::unique_ptr<localDrive> drive(
+	        new localDrive(base_dir.c_str(), 512, 32, 32765, 16000, 0xf8));
+
+	auto start = bench_clock::now();
+	for (Bit32u r = 0; r < rounds; ++r)
+		for (Bit32u n = 0; n < files; ++n)
+			failed |= !drive->FileExists(file_name(n).c_str());
+	report("exists", seconds_since(start), rounds * files);
+
+	start = bench_clock::now();
+	for (Bit32u r = 0; r < rounds; ++r)
+		for (Bit32u n = 0; n < files; ++n)
+			failed |= drive->FileExists(missing_name(n).c_str());
+	report("missing", seconds_since(start), rounds * files);
+
+	start = bench_clock::now();
+	for (Bit32u r = 0; r < rounds; ++r)
+		for (Bit32u n = 0; n < files; ++n)
+			failed |= !open_and_close(*drive, file_name(n));
+	report("open", seconds_since(start), rounds * files);
+
+	start = bench_clock::now();
+	for (Bit32u r = 0; r < rounds; ++r)
+		for (Bit32u n = 0; n < files; ++n)
+			failed |= open_and_close(*drive, missing_name(n));
+	report("open miss", seconds_since(start), rounds * files);
+
+	start = bench_clock::now();
+	for (Bit32u r = 0; r < rounds; ++r)
+		failed |= count_entries(*drive, "") < files + subdirs;
+	report("list", seconds_since(start), rounds * files);
+
+	// The first listing of each subdirectory reads it from the host,
+	// unless the pre-scan got there first
+	drive.reset(new localDrive(base_dir.c_str(), 512, 32, 32765, 16000, 0xf8));
+	if (prescan) {
+		drive->dirCache.StartPrescan();
+		std::this_thread::sleep_for(std::chrono::milliseconds(wait_ms));
+	}
+	start = bench_clock::now();
+	for (Bit32u d = 0; d < subdirs; ++d)
+		failed |= count_entries(*drive, "SUB" + std::to_string(d)) < files_per_subdir;
+	report(prescan ? "prescanned" : "first list", seconds_since(start),
+	       subdirs * files_per_subdir);
+
+	// Another program creates a file the drive already found missing
+	FILE *f = fopen(late_path.c_str(), "wb");
+	if (f)
+		fclose(f);
+	if (!drive->FileExists(late_name.c_str()) || !open_and_close(*drive, late_name)) {
+		fprintf(stderr, "File created on the host not found\n");
+		failed = true;
+	}
+
+	drive.reset();
+	remove(late_path.c_str());
+	if (!keep) {
+		for (const auto &path : created)
+			remove(path.c_str());
+		for (const auto &path : created_dirs)
+			rmdir(path.c_str());
+		rmdir(dir.c_str());
+	}
+	if (failed) {
+		fprintf(stderr, "Lookups went wrong\n");
+		return 1;
+	}
+	return 0;
+}
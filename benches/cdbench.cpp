@@ -0,0 +1,412 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/* Reads the data track of a synthetic BIN/CUE image through the CD-ROM
+ * image interface, a sector at a time the way single-sector requests are
+ * served, in runs of sectors the way MSCDEX and the ISO drive ask for them,
+ * and over and over, out of order, from a working set that fits the
+ * sector cache, to measure each and to check the data read back.
+ *
+ * The image interface and its sector cache are the real ones; the mixer
+ * and the little of DOS the interface reaches into are stubbed out below,
+ * with guest memory being a plain array. */
+
+#include "dosbox.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "dos/cdrom.h"
+#include "dos/dos_mscdex.h"
+#include "dos_inc.h"
+#include "drives.h"
+#include "inout.h"
+#include "mem.h"
+#include "mixer.h"
+#include "setup.h"
+#include "timer.h"
+
+Config *control = nullptr;
+DOS_Block dos;
+DOS_Drive *Drives[DOS_DRIVES] = {};
+DOS_File *Files[DOS_FILES] = {};
+
+// Enough guest memory for the largest MSCDEX read
+static std::vector<Bit8u> memory(1024 * 1024);
+
+HostPt MEM_GetBlockWritePt(PhysPt pt, Bitu *size)
+{
+	*size = std::min<Bitu>(*size, memory.size() - pt);
+	return memory.data() + pt;
+}
+
+void MEM_BlockWrite(PhysPt pt, const void *data, Bitu size)
+{
+	memcpy(memory.data() + pt, data, size);
+}
+
+Bit16u mem_readw(PhysPt pt)
+{
+	return host_readw(memory.data() + pt);
+}
+
+void mem_writew(PhysPt pt, Bit16u val)
+{
+	host_writew(memory.data() + pt, val);
+}
+
+bool DOS_WriteFile(Bit16u, Bit8u *data, Bit16u *amount, bool)
+{
+	fwrite(data, 1, *amount, stderr);
+	return true;
+}
+
+void DOS_SetError(Bit16u code)
+{
+	dos.errorcode = code;
+}
+
+// The image is found on the host, and no local drives get mounted to look
+// for it on
+bool DOS_MakeName(const char *, char *, Bit8u *)
+{
+	return false;
+}
+
+void DOS_DTA::SetResult(const char *, Bit32u, Bit16u, Bit16u, Bit8u) {}
+void DOS_DTA::GetSearchParams(Bit8u &attr, char *pattern) const
+{
+	attr = 0;
+	pattern[0] = 0;
+}
+
+uint16_t DOS_PackTime(const struct tm &datetime) noexcept
+{
+	return static_cast<uint16_t>((datetime.tm_hour << 11) |
+	                             (datetime.tm_min << 5) | (datetime.tm_sec / 2));
+}
+
+uint16_t DOS_PackDate(const struct tm &datetime) noexcept
+{
+	return static_cast<uint16_t>(((datetime.tm_year - 80) << 9) |
+	                             ((datetime.tm_mon + 1) << 5) | datetime.tm_mday);
+}
+
+int MSCDEX_AddDrive(char, const char *, Bit8u &)
+{
+	return 1;
+}
+int MSCDEX_RemoveDrive(char)
+{
+	return 0;
+}
+bool MSCDEX_GetVolumeName(Bit8u, char *)
+{
+	return false;
+}
+bool MSCDEX_HasMediaChanged(Bit8u)
+{
+	return false;
+}
+void IO_WriteB(io_port_t, io_val_t) {}
+io_val_t IO_ReadB(io_port_t)
+{
+	return 0xff;
+}
+
+void GFX_ShowMsg(const char *format, ...)
+{
+	(void)format;
+}
+
+// No ticks run, so preloading progress is never reported
+void TIMER_AddTickHandler(TIMER_TickHandler) {}
+void TIMER_DelTickHandler(TIMER_TickHandler) {}
+
+// CD audio never plays, so its mixer channel only has to exist
+static MixerChannel cd_audio_channel(nullptr, 0, "CDAUDIO");
+
+MixerChannel::MixerChannel(MIXER_Handler _handler, Bitu, const char *_name)
+        : name(_name),
+          envelope(name),
+          handler(_handler)
+{}
+
+MixerChannel *MixerObject::Install(MIXER_Handler, Bitu, const char *)
+{
+	return &cd_audio_channel;
+}
+
+MixerObject::~MixerObject() {}
+
+void MixerChannel::Enable(bool should_enable)
+{
+	is_enabled = should_enable;
+}
+
+void MixerChannel::SetFreq(Bitu) {}
+void MixerChannel::SetVolume(float, float) {}
+void MixerChannel::SetScale(float, float) {}
+void MixerChannel::MapChannels(Bit8u, Bit8u) {}
+void MixerChannel::FillUp() {}
+void MixerChannel::AddSamples_m16(Bitu, const Bit16s *) {}
+void MixerChannel::AddSamples_s16(Bitu, const Bit16s *) {}
+void MixerChannel::AddSamples_m16_nonnative(Bitu, const Bit16s *) {}
+void MixerChannel::AddSamples_s16_nonnative(Bitu, const Bit16s *) {}
+
+void MIXER_LockAudioDevice() {}
+void MIXER_UnlockAudioDevice() {}
+
+void CDROM_Image_Init(Section *sec);
+
+constexpr uint32_t RAW_BYTES = BYTES_PER_RAW_REDBOOK_FRAME;
+constexpr uint32_t COOKED_BYTES = BYTES_PER_COOKED_REDBOOK_FRAME;
+
+// User data bytes depend on their position, so misplaced sectors show
+static Bit8u pattern_byte(Bit32u sector, Bit32u i)
+{
+	return static_cast<Bit8u>(((sector * COOKED_BYTES + i) * 2654435761u) >> 24);
+}
+
+static bool check_sectors(const Bit8u *data, Bit32u sector, Bit32u num)
+{
+	for (Bit32u s = 0; s < num; ++s)
+		for (Bit32u i = 0; i < COOKED_BYTES; ++i)
+			if (*data++ != pattern_byte(sector + s, i))
+				return false;
+	return true;
+}
+
+// A MODE1/2352 data track: sync and header, the user data, and room
+// for the error correction codes
+static bool write_image(const std::string &bin, const std::string &cue,
+                        Bit32u sectors)
+{
+	FILE *f = fopen(bin.c_str(), "wb");
+	if (!f)
+		return false;
+	std::vector<Bit8u> raw(RAW_BYTES);
+	bool written = true;
+	for (Bit32u s = 0; s < sectors && written; ++s) {
+		memset(raw.data(), 0, raw.size());
+		memset(raw.data() + 1, 0xff, 10);
+		raw[15] = 1;
+		for (Bit32u i = 0; i < COOKED_BYTES; ++i)
+			raw[16 + i] = pattern_byte(s, i);
+		written = fwrite(raw.data(), raw.size(), 1, f) == 1;
+	}
+	fclose(f);
+	if (!written)
+		return false;
+
+	f = fopen(cue.c_str(), "w");
+	if (!f)
+		return false;
+	const auto name = bin.substr(bin.find_last_of("/\\") + 1);
+	fprintf(f, "FILE \"%s\" BINARY\n", name.c_str());
+	fprintf(f, "  TRACK 01 MODE1/2352\n");
+	fprintf(f, "    INDEX 01 00:00:00\n");
+	return fclose(f) == 0;
+}
+
+using bench_clock = std::chrono::steady_clock;
+
+static double seconds_since(bench_clock::time_point start)
+{
+	const std::chrono::duration<double> elapsed = bench_clock::now() - start;
+	return std::max(elapsed.count(), 1e-9);
+}
+
+static void report(const char *name, double seconds, uint64_t sectors)
+{
+	printf("%-10s %8.3f s %9.2f MB/s\n", name, seconds,
+	       static_cast<double>(sectors) * COOKED_BYTES / (seconds * 1024 * 1024));
+}
+
+// Reads the sectors from first on, in requests of run sectors
+static bool read_runs(CDROM_Interface_Image &cd, Bit32u first, Bit32u sectors,
+                      Bit32u run, Bit32u rounds, const char *name)
+{
+	std::vector<Bit8u> buffer(run * COOKED_BYTES);
+	bool failed = false;
+	const auto start = bench_clock::now();
+	for (Bit32u r = 0; r < rounds; ++r) {
+		for (Bit32u s = first; s < first + sectors; s += run) {
+			const Bit32u num = std::min(run, first + sectors - s);
+			const bool read = run == 1
+			                          ? cd.ReadSector(buffer.data(), false, s)
+			                          : cd.ReadSectorsHost(buffer.data(), false,
+			                                               s, num) == num;
+			if (!read) {
+				failed = true;
+				break;
+			}
+			if (r == 0)
+				failed |= !check_sectors(buffer.data(), s, num);
+		}
+	}
+	report(name, seconds_since(start), static_cast<uint64_t>(sectors) * rounds);
+	return !failed;
+}
+
+// Reads the sectors a sector at a time, the even ones and then the odd ones,
+// so no read carries on from the one before as streaming reads would
+static bool read_scattered(CDROM_Interface_Image &cd, Bit32u first,
+                           Bit32u sectors, Bit32u rounds)
+{
+	std::vector<Bit8u> buffer(COOKED_BYTES);
+	const Bit32u half = (sectors + 1) / 2;
+	bool failed = false;
+	const auto start = bench_clock::now();
+	for (Bit32u r = 0; r < rounds && !failed; ++r) {
+		for (Bit32u i = 0; i < sectors; ++i) {
+			const Bit32u s = first + (i < half ? i * 2 : (i - half) * 2 + 1);
+			if (!cd.ReadSector(buffer.data(), false, s)) {
+				failed = true;
+				break;
+			}
+			if (r == 0)
+				failed |= !check_sectors(buffer.data(), s, 1);
+		}
+	}
+	report("cached", seconds_since(start), static_cast<uint64_t>(sectors) * rounds);
+	return !failed;
+}
+
+// Reads the sectors a run at a time into guest memory, as MSCDEX does
+static bool read_guest(CDROM_Interface_Image &cd, Bit32u sectors, Bit32u run,
+                       Bit32u rounds)
+{
+	bool failed = false;
+	const auto start = bench_clock::now();
+	for (Bit32u r = 0; r < rounds; ++r) {
+		for (Bit32u s = 0; s < sectors; s += run) {
+			const Bit32u num = std::min(run, sectors - s);
+			if (!cd.ReadSectors(0, false, s, static_cast<uint16_t>(num))) {
+				failed = true;
+				break;
+			}
+			if (r == 0)
+				failed |= !check_sectors(memory.data(), s, num);
+		}
+	}
+	report("mscdex", seconds_since(start), static_cast<uint64_t>(sectors) * rounds);
+	return !failed;
+}
+
+static void usage()
+{
+	fprintf(stderr,
+	        "Usage:\n"
+	        "  dosbox-cdbench [-s MBYTES] [-r ROUNDS] [-c KBYTES] [-f NAME]\n"
+	        "\n"
+	        "Writes a BIN/CUE image with a data track of MBYTES megabytes of\n"
+	        "user data (64 by default) and reads it ROUNDS times (4 by\n"
+	        "default) through the CD-ROM image interface: a sector at a time,\n"
+	        "in runs of 32 sectors, and in runs of 32 sectors into guest\n"
+	        "memory as MSCDEX does. Then reads a working set half the size\n"
+	        "of the sector cache a sector at a time, out of order as the\n"
+	        "cache only keeps reads that aren't sequential, ROUNDS * 64 times.\n"
+	        "Reports the time taken by each, and fails if any data read back\n"
+	        "differs from the image.\n"
+	        "\n"
+	        "  -c  the sector cache size in KB, as [dos] cdrom_cache\n"
+	        "      (1024 by default); 0 disables the cache\n"
+	        "  -f  the image to create, NAME.bin and NAME.cue, with NAME\n"
+	        "      dosbox-cdbench by default; they are removed when done\n");
+}
+
+int main(int argc, char *argv[])
+{
+	Bit32u mbytes = 64;
+	Bit32u rounds = 4;
+	int cache_kb = 1024;
+	std::string name = "dosbox-cdbench";
+	for (int arg = 1; arg < argc; ++arg) {
+		const bool has_value = arg + 1 < argc;
+		if (!strcmp(argv[arg], "-s") && has_value) {
+			mbytes = strtoul(argv[++arg], nullptr, 10);
+		} else if (!strcmp(argv[arg], "-r") && has_value) {
+			rounds = strtoul(argv[++arg], nullptr, 10);
+		} else if (!strcmp(argv[arg], "-c") && has_value) {
+			cache_kb = atoi(argv[++arg]);
+		} else if (!strcmp(argv[arg], "-f") && has_value) {
+			name = argv[++arg];
+		} else {
+			usage();
+			return 1;
+		}
+	}
+	if (!mbytes || mbytes > 512 || !rounds || cache_kb < 0 || cache_kb > 65536) {
+		usage();
+		return 1;
+	}
+	const Bit32u sectors = mbytes * 1024 * 1024 / COOKED_BYTES;
+
+	const std::string bin = name + ".bin";
+	const std::string cue = name + ".cue";
+	if (!write_image(bin, cue, sectors)) {
+		fprintf(stderr, "Can't write %s: %s\n", bin.c_str(), strerror(errno));
+		remove(bin.c_str());
+		remove(cue.c_str());
+		return 1;
+	}
+
+	Section_prop section("dos");
+	section.Add_int("cdrom_cache", Property::Changeable::WhenIdle, cache_kb);
+	section.Add_int("cdrom_preload_limit", Property::Changeable::WhenIdle, 0);
+	CDROM_Image_Init(&section);
+
+	bool failed = false;
+	{
+		CDROM_Interface_Image cd(0);
+		std::vector<char> path(cue.begin(), cue.end());
+		path.push_back('\0');
+		if (!cd.SetDevice(path.data())) {
+			fprintf(stderr, "Can't load %s\n", cue.c_str());
+			failed = true;
+		} else {
+			failed |= !read_runs(cd, 0, sectors, 1, rounds, "sector");
+			failed |= !read_runs(cd, 0, sectors, 32, rounds, "batched");
+			failed |= !read_guest(cd, sectors, 32, rounds);
+
+			const Bit32u working_set = std::min<Bit32u>(
+			        sectors, static_cast<Bit32u>(cache_kb) * 1024 /
+			                         COOKED_BYTES / 2);
+			if (working_set)
+				failed |= !read_scattered(cd, sectors - working_set,
+				                          working_set, rounds * 64);
+		}
+	}
+
+	remove(bin.c_str());
+	remove(cue.c_str());
+	if (failed) {
+		fprintf(stderr, "Data read back differs from the image\n");
+		return 1;
+	}
+	return 0;
+}
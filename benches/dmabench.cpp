@@ -0,0 +1,230 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/* Streams auto-initialised DMA buffers of the sizes Sound Blaster 16 games
+ * use through an 8-bit and a 16-bit DMA channel, as the Sound Blaster
+ * module does, to measure how fast DMA moves data to and from guest memory.
+ * Checks that what the channels read and write matches guest memory.
+ *
+ * The DMA, memory and paging modules are the real ones; the little of the
+ * CPU and I/O they reach into is stubbed out below. */
+
+#include "dosbox.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "control.h"
+#include "cpu.h"
+#include "cpu/lazyflags.h"
+#include "dma.h"
+#include "inout.h"
+#include "mem.h"
+#include "paging.h"
+#include "regs.h"
+#include "setup.h"
+
+Config *control = nullptr;
+MachineType machine = MCH_VGA;
+Segments Segs;
+CPU_Regs cpu_regs;
+CPUBlock cpu;
+Bit32s CPU_Cycles = 0;
+Bit32s CPU_CycleLeft = 0;
+Bitu CPU_ArchitectureType = CPU_ARCHTYPE_386FAST;
+CPU_Decoder *cpudecoder = nullptr;
+LazyFlags lflags;
+
+// Only real mode without paging is used, so the CPU never runs
+Bits CPU_Core_Normal_Run()
+{
+	return 0;
+}
+Bits CPU_Core_Full_Run()
+{
+	return 0;
+}
+Bits CPU_Core_Simple_Run()
+{
+	return 0;
+}
+void DOSBOX_RunMachine() {}
+void CPU_Exception(Bitu, Bitu) {}
+
+// Port 0x92, the A20 gate, is all the memory module registers
+IO_ReadHandleObject::~IO_ReadHandleObject() {}
+IO_WriteHandleObject::~IO_WriteHandleObject() {}
+void IO_ReadHandleObject::Install(io_port_t, IO_ReadHandler, Bitu, Bitu) {}
+void IO_WriteHandleObject::Install(io_port_t, IO_WriteHandler, Bitu, Bitu) {}
+void IO_WriteB(io_port_t, io_val_t) {}
+io_val_t IO_ReadB(io_port_t)
+{
+	return 0xff;
+}
+
+void GFX_ShowMsg(const char *format, ...)
+{
+	(void)format;
+}
+
+void MEM_Init(Section *sec);
+void PAGING_Init(Section *sec);
+
+// Each channel's buffer sits at the start of its DMA page, as drivers
+// allocate them so they don't cross one
+constexpr Bit8u page_8bit = 0x02;
+constexpr Bit8u page_16bit = 0x04;
+
+using bench_clock = std::chrono::steady_clock;
+
+static double seconds_since(bench_clock::time_point start)
+{
+	const std::chrono::duration<double> elapsed = bench_clock::now() - start;
+	return std::max(elapsed.count(), 1e-9);
+}
+
+// Sets the channel up as a game would, to loop over a buffer of the given
+// size in bytes
+static void program_channel(DmaChannel &chan, Bit8u page, Bitu bytes)
+{
+	chan.SetPage(page);
+	chan.baseaddr = 0;
+	chan.curraddr = 0;
+	chan.basecnt = static_cast<Bit16u>((bytes >> chan.DMA16) - 1);
+	chan.currcnt = chan.basecnt;
+	chan.autoinit = true;
+	chan.masked = false;
+}
+
+static bool check_transfers(DmaChannel &chan, Bit8u page, Bitu bytes)
+{
+	const PhysPt pt = static_cast<PhysPt>(page) << 16;
+	const Bitu units = bytes >> chan.DMA16;
+	std::vector<Bit8u> data(bytes);
+	std::vector<Bit8u> guest(bytes);
+
+	program_channel(chan, page, bytes);
+	for (Bitu i = 0; i < bytes; ++i)
+		mem_writeb(pt + i, static_cast<Bit8u>(i * 7 + page));
+	chan.Read(units, data.data());
+	MEM_BlockRead(pt, guest.data(), bytes);
+	if (data != guest)
+		return false;
+
+	for (Bitu i = 0; i < bytes; ++i)
+		data[i] = static_cast<Bit8u>(i * 13 + 5);
+	chan.Write(units, data.data());
+	MEM_BlockRead(pt, guest.data(), bytes);
+	return data == guest;
+}
+
+// Moves a buffer's worth per call, through the channel in either direction,
+// and returns the best time of the passes
+static double time_transfers(DmaChannel &chan, Bit8u page, Bitu bytes,
+                             Bitu total, int passes, bool write)
+{
+	const Bitu units = bytes >> chan.DMA16;
+	std::vector<Bit8u> data(bytes);
+	double best = 0.0;
+	for (int pass = 0; pass < passes; ++pass) {
+		program_channel(chan, page, bytes);
+		const auto start = bench_clock::now();
+		for (Bitu done = 0; done < total; done += bytes) {
+			if (write)
+				chan.Write(units, data.data());
+			else
+				chan.Read(units, data.data());
+		}
+		const double elapsed = seconds_since(start);
+		if (pass == 0 || elapsed < best)
+			best = elapsed;
+	}
+	return best;
+}
+
+static void usage()
+{
+	fprintf(stderr,
+	        "Usage:\n"
+	        "  dosbox-dmabench [-m MBYTES] [-n PASSES]\n"
+	        "\n"
+	        "Reads and writes MBYTES megabytes (256 by default) through an\n"
+	        "8-bit and a 16-bit DMA channel, looping over buffers of 256,\n"
+	        "1024, 4096 and 16384 bytes a buffer at a time. Reports the\n"
+	        "throughput of each from the best of PASSES runs (3 by default).\n"
+	        "Fails if the data moved doesn't match guest memory.\n");
+}
+
+int main(int argc, char *argv[])
+{
+	Bitu mbytes = 256;
+	int passes = 3;
+	for (int arg = 1; arg < argc; ++arg) {
+		const bool has_value = arg + 1 < argc;
+		if (!strcmp(argv[arg], "-m") && has_value) {
+			mbytes = strtoul(argv[++arg], nullptr, 10);
+		} else if (!strcmp(argv[arg], "-n") && has_value) {
+			passes = atoi(argv[++arg]);
+		} else {
+			usage();
+			return 1;
+		}
+	}
+	if (!mbytes || passes <= 0) {
+		usage();
+		return 1;
+	}
+	const Bitu total = mbytes * 1024 * 1024;
+
+	Section_prop section("dosbox");
+	section.Add_int("memsize", Property::Changeable::WhenIdle, 16);
+	MEM_Init(&section);
+	PAGING_Init(&section);
+
+	// Channels 1 and 5, the Sound Blaster 16's usual ones
+	DmaChannel chan8(1, false);
+	DmaChannel chan16(5, true);
+
+	bool failed = false;
+	for (const Bitu bytes : {256, 1024, 4096, 16384}) {
+		for (const bool dma16 : {false, true}) {
+			DmaChannel &chan = dma16 ? chan16 : chan8;
+			const Bit8u page = dma16 ? page_16bit : page_8bit;
+			if (!check_transfers(chan, page, bytes)) {
+				fprintf(stderr, "%d-bit DMA of %lu bytes doesn't match guest memory\n",
+				        dma16 ? 16 : 8, static_cast<unsigned long>(bytes));
+				failed = true;
+				continue;
+			}
+			const double read = time_transfers(chan, page, bytes, total,
+			                                   passes, false);
+			const double write = time_transfers(chan, page, bytes, total,
+			                                    passes, true);
+			printf("%2d-bit, %5lu byte buffer: read %8.1f MB/s, write %8.1f MB/s\n",
+			       dma16 ? 16 : 8, static_cast<unsigned long>(bytes),
+			       total / read / (1024 * 1024), total / write / (1024 * 1024));
+		}
+	}
+	return failed ? 1 : 0;
+}
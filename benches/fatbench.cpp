@@ -0,0 +1,471 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/* Writes, reads and seeks through files on a freshly formatted FAT16 hard
+ * disk image mounted with fatDrive, to measure how the FAT code scales with
+ * the size of the files and to check that the data comes back unchanged.
+ *
+ * The drive and the image disk are the real ones; the little of DOS and
+ * the BIOS they reach into is stubbed out below, with guest memory being a
+ * plain array. */
+
+#include "dosbox.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bios_disk.h"
+#include "callback.h"
+#include "dos_inc.h"
+#include "drives.h"
+#include "mapper.h"
+#include "mem.h"
+#include "regs.h"
+
+MachineType machine = MCH_VGA;
+DOS_Block dos;
+DOS_Drive *Drives[DOS_DRIVES] = {};
+Segments Segs;
+CPU_Regs cpu_regs;
+
+// Enough conventional memory for the drive's DTA
+static std::vector<Bit8u> memory(1024 * 1024);
+HostPt MemBase = memory.data();
+
+Bit8u mem_readb(PhysPt pt) { return host_readb(MemBase + pt); }
+Bit16u mem_readw(PhysPt pt) { return host_readw(MemBase + pt); }
+Bit32u mem_readd(PhysPt pt) { return host_readd(MemBase + pt); }
+void mem_writeb(PhysPt pt, Bit8u val) { host_writeb(MemBase + pt, val); }
+void mem_writew(PhysPt pt, Bit16u val) { host_writew(MemBase + pt, val); }
+void mem_writed(PhysPt pt, Bit32u val) { host_writed(MemBase + pt, val); }
+
+void MEM_BlockRead(PhysPt pt, void *data, Bitu size)
+{
+	memcpy(data, MemBase + pt, size);
+}
+
+void MEM_BlockWrite(PhysPt pt, const void *data, Bitu size)
+{
+	memcpy(MemBase + pt, data, size);
+}
+
+Bit16u DOS_GetMemory(Bit16u /*pages*/)
+{
+	return 0x1000;
+}
+
+void DOS_SetError(Bit16u code)
+{
+	dos.errorcode = code;
+}
+
+void DOS_DTA::SetupSearch(Bit8u drive, Bit8u attr, char *pattern)
+{
+	SSET_BYTE(sDTA, sdrive, drive);
+	SSET_BYTE(sDTA, sattr, attr);
+	char name[11];
+	memset(name, ' ', sizeof(name));
+	const char *ext = strchr(pattern, '.');
+	const size_t name_len = ext ? static_cast<size_t>(ext - pattern)
+	                            : strlen(pattern);
+	memcpy(name, pattern, std::min<size_t>(name_len, 8));
+	if (ext)
+		memcpy(name + 8, ext + 1, std::min<size_t>(strlen(ext + 1), 3));
+	MEM_BlockWrite(pt + offsetof(sDTA, sname), name, sizeof(name));
+}
+
+void DOS_DTA::SetResult(const char *found_name, Bit32u found_size,
+                        Bit16u found_date, Bit16u found_time, Bit8u found_attr)
+{
+	MEM_BlockWrite(pt + offsetof(sDTA, name), found_name, strlen(found_name) + 1);
+	SSET_DWORD(sDTA, size, found_size);
+	SSET_WORD(sDTA, date, found_date);
+	SSET_WORD(sDTA, time, found_time);
+	SSET_BYTE(sDTA, attr, found_attr);
+}
+
+void DOS_DTA::GetResult(char *found_name, Bit32u &found_size, Bit16u &found_date,
+                        Bit16u &found_time, Bit8u &found_attr) const
+{
+	MEM_BlockRead(pt + offsetof(sDTA, name), found_name, DOS_NAMELENGTH_ASCII);
+	found_size = SGET_DWORD(sDTA, size);
+	found_date = SGET_WORD(sDTA, date);
+	found_time = SGET_WORD(sDTA, time);
+	found_attr = SGET_BYTE(sDTA, attr);
+}
+
+void DOS_DTA::GetSearchParams(Bit8u &attr, char *pattern) const
+{
+	attr = SGET_BYTE(sDTA, sattr);
+	char name[11];
+	MEM_BlockRead(pt + offsetof(sDTA, sname), name, sizeof(name));
+	memcpy(pattern, name, 8);
+	pattern[8] = '.';
+	memcpy(&pattern[9], &name[8], 3);
+	pattern[12] = 0;
+}
+
+// The disk BIOS and the disk swapping key, neither of which gets used
+Bitu CALLBACK_Allocate()
+{
+	return 0;
+}
+bool CALLBACK_Setup(Bitu, CallBack_Handler, Bitu, const char *)
+{
+	return false;
+}
+void CALLBACK_SCF(bool) {}
+void CALLBACK_SIF(bool) {}
+void CMOS_SetRegister(Bitu, Bit8u) {}
+void MAPPER_AddHandler(MAPPER_Handler *, SDL_Scancode, uint32_t, const char *,
+                       const char *)
+{}
+
+void GFX_ShowMsg(const char *format, ...)
+{
+	(void)format;
+}
+
+constexpr Bit32u sector_size = 512;
+constexpr Bit32u heads = 16;
+constexpr Bit32u sectors_per_track = 63;
+constexpr Bit32u partition_start = sectors_per_track;
+
+// Writes an image of the given size holding a single empty FAT16 partition
+// with clusters of at least 2 kB
+static bool format_image(const char *path, Bit32u cylinders)
+{
+	const Bit32u total = cylinders * heads * sectors_per_track;
+	const Bit32u part_size = total - partition_start;
+	Bit32u sectors_per_cluster = 4;
+	while (part_size / sectors_per_cluster >= 65525)
+		sectors_per_cluster *= 2;
+	const Bit32u root_entries = 512;
+	const Bit32u fat_sectors = ((part_size / sectors_per_cluster + 2) * 2 +
+	                            sector_size - 1) / sector_size;
+
+	partTable mbr = {};
+	mbr.pentry[0].parttype = 0x06;
+	mbr.pentry[0].absSectStart = host_to_le(partition_start);
+	mbr.pentry[0].partSize = host_to_le(part_size);
+	mbr.magic1 = 0x55;
+	mbr.magic2 = 0xaa;
+
+	bootstrap boot = {};
+	boot.nearjmp[0] = 0xeb;
+	boot.nearjmp[1] = 0x3c;
+	boot.nearjmp[2] = 0x90;
+	memcpy(boot.oemname, "MSDOS5.0", 8);
+	boot.bytespersector = host_to_le(static_cast<Bit16u>(sector_size));
+	boot.sectorspercluster = static_cast<Bit8u>(sectors_per_cluster);
+	boot.reservedsectors = host_to_le(static_cast<Bit16u>(1));
+	boot.fatcopies = 2;
+	boot.rootdirentries = host_to_le(static_cast<Bit16u>(root_entries));
+	boot.mediadescriptor = 0xf8;
+	boot.sectorsperfat = host_to_le(static_cast<Bit16u>(fat_sectors));
+	boot.sectorspertrack = host_to_le(static_cast<Bit16u>(sectors_per_track));
+	boot.headcount = host_to_le(static_cast<Bit16u>(heads));
+	boot.hiddensectorcount = host_to_le(partition_start);
+	boot.totalsecdword = host_to_le(part_size);
+	boot.magic1 = 0x55;
+	boot.magic2 = 0xaa;
+
+	FILE *f = fopen(path, "wb");
+	if (!f) {
+		fprintf(stderr, "Can't create %s: %s\n", path, strerror(errno));
+		return false;
+	}
+	std::vector<Bit8u> image(static_cast<size_t>(total) * sector_size, 0);
+	memcpy(&image[0], &mbr, sizeof(mbr));
+	memcpy(&image[partition_start * sector_size], &boot, sizeof(boot));
+	const Bit8u fat_start[4] = {0xf8, 0xff, 0xff, 0xff};
+	for (Bit32u copy = 0; copy < 2; ++copy)
+		memcpy(&image[(partition_start + 1 + copy * fat_sectors) * sector_size],
+		       fat_start, sizeof(fat_start));
+	const bool written = fwrite(image.data(), image.size(), 1, f) == 1;
+	fclose(f);
+	return written;
+}
+
+// The byte at a position in file number n, so that misplaced data shows
+static Bit8u pattern_byte(Bit32u n, Bit32u pos)
+{
+	return static_cast<Bit8u>((pos * 2654435761u) >> 24) ^ static_cast<Bit8u>(n);
+}
+
+static void fill(std::vector<Bit8u> &buffer, Bit32u n, Bit32u pos)
+{
+	for (Bit32u i = 0; i < buffer.size(); ++i)
+		buffer[i] = pattern_byte(n, pos + i);
+}
+
+static bool check(const std::vector<Bit8u> &buffer, Bit16u size, Bit32u n, Bit32u pos)
+{
+	for (Bit32u i = 0; i < size; ++i)
+		if (buffer[i] != pattern_byte(n, pos + i))
+			return false;
+	return true;
+}
+
+static std::string file_name(Bit32u n)
+{
+	return "FILE" + std::to_string(n) + ".DAT";
+}
+
+using bench_clock = std::chrono::steady_clock;
+
+static double seconds_since(bench_clock::time_point start)
+{
+	const std::chrono::duration<double> elapsed = bench_clock::now() - start;
+	return std::max(elapsed.count(), 1e-9);
+}
+
+static void report(const char *name, double seconds, Bit32u bytes)
+{
+	printf("%-10s %8.3f s %9.2f MB/s\n", name, seconds,
+	       bytes / (seconds * 1024 * 1024));
+}
+
+// Reads and writes the raw sectors of the image through imageDisk, one at
+// a time and in runs, in order and at random
+static bool bench_sectors(const char *path, Bit32u total_sectors)
+{
+	FILE *f = fopen(path, "rb+");
+	if (!f) {
+		fprintf(stderr, "Can't open %s: %s\n", path, strerror(errno));
+		return false;
+	}
+	imageDisk disk(f, path, total_sectors / 2, true);
+	bool failed = false;
+	constexpr Bit32u run = 64;
+	std::vector<Bit8u> buffer(run * sector_size);
+	std::vector<Bit8u> sector(sector_size);
+
+	auto start = bench_clock::now();
+	for (Bit32u n = 0; n < total_sectors; ++n)
+		failed |= disk.Read_AbsoluteSector(n, sector.data()) != 0;
+	report("sectors", seconds_since(start), total_sectors * sector_size);
+
+	start = bench_clock::now();
+	for (Bit32u n = 0; n + run <= total_sectors; n += run)
+		failed |= disk.Read_AbsoluteSectors(n, run, buffer.data()) != 0;
+	report("runs", seconds_since(start), total_sectors / run * run * sector_size);
+
+	const Bit32u accesses = 65536;
+	srand(2);
+	start = bench_clock::now();
+	for (Bit32u i = 0; i < accesses; ++i) {
+		const Bit32u n = static_cast<Bit32u>(
+		        (static_cast<uint64_t>(rand()) * rand()) % total_sectors);
+		failed |= disk.Read_AbsoluteSector(n, sector.data()) != 0;
+	}
+	report("random rd", seconds_since(start), accesses * sector_size);
+
+	// Writes back what is there, in case the image is kept
+	start = bench_clock::now();
+	for (Bit32u i = 0; i < accesses; ++i) {
+		const Bit32u n = static_cast<Bit32u>(
+		        (static_cast<uint64_t>(rand()) * rand()) % total_sectors);
+		failed |= disk.Read_AbsoluteSector(n, sector.data()) != 0;
+		failed |= disk.Write_AbsoluteSector(n, sector.data()) != 0;
+	}
+	report("random rw", seconds_since(start), 2 * accesses * sector_size);
+
+	// A run reaching past the end of the image fails and comes back
+	// zeroed where there is no image
+	std::fill(buffer.begin(), buffer.end(), 0xff);
+	failed |= disk.Read_AbsoluteSectors(total_sectors - 1, 2, buffer.data()) != 0x04;
+	failed |= std::any_of(buffer.begin() + sector_size,
+	                      buffer.begin() + 2 * sector_size,
+	                      [](Bit8u b) { return b != 0; });
+	return !failed;
+}
+
+static void usage()
+{
+	fprintf(stderr,
+	        "Usage:\n"
+	        "  dosbox-fatbench [-s MBYTES] [-c CHUNK] [-f FILES] [-i IMAGE]\n"
+	        "\n"
+	        "Formats a FAT16 image, writes FILES files (2 by default) of\n"
+	        "MBYTES megabytes each (16 by default) to it in CHUNK byte\n"
+	        "writes (4096 by default) taking turns between the files, so\n"
+	        "that their clusters end up interleaved. Then reads the files\n"
+	        "back, reads them at random positions, truncates them to half\n"
+	        "their size and grows them again, reporting the time taken by\n"
+	        "each step. Finally reads and writes the image's sectors in\n"
+	        "order and at random. Fails if any data doesn't read back as\n"
+	        "written. The files can take up to 480 megabytes in all.\n"
+	        "\n"
+	        "  -i  the image to create, dosbox-fatbench.img by default;\n"
+	        "      it is removed when done\n");
+}
+
+int main(int argc, char *argv[])
+{
+	Bit32u mbytes = 16;
+	Bit32u chunk = 4096;
+	Bit32u files = 2;
+	const char *image_path = "dosbox-fatbench.img";
+	for (int arg = 1; arg < argc; ++arg) {
+		const bool has_value = arg + 1 < argc;
+		if (!strcmp(argv[arg], "-s") && has_value) {
+			mbytes = strtoul(argv[++arg], nullptr, 10);
+		} else if (!strcmp(argv[arg], "-c") && has_value) {
+			chunk = strtoul(argv[++arg], nullptr, 10);
+		} else if (!strcmp(argv[arg], "-f") && has_value) {
+			files = strtoul(argv[++arg], nullptr, 10);
+		} else if (!strcmp(argv[arg], "-i") && has_value) {
+			image_path = argv[++arg];
+		} else {
+			usage();
+			return 1;
+		}
+	}
+	if (!mbytes || !files || !chunk || chunk > 0xffff ||
+	    static_cast<uint64_t>(mbytes) * files > 480) {
+		usage();
+		return 1;
+	}
+	const Bit32u file_size = mbytes * 1024 * 1024;
+
+	// Room for the files plus some slack
+	const Bit32u cylinders = (mbytes * files + 16) * 1024 * 1024 /
+	                                 (heads * sectors_per_track * sector_size) + 1;
+	if (!format_image(image_path, cylinders))
+		return 1;
+	std::unique_ptr<fatDrive> drive(new fatDrive(image_path, sector_size,
+	                                             sectors_per_track, heads,
+	                                             cylinders, 0));
+	if (!drive->created_successfully) {
+		fprintf(stderr, "Can't mount %s\n", image_path);
+		remove(image_path);
+		return 1;
+	}
+
+	std::vector<DOS_File *> handles(files, nullptr);
+	for (Bit32u n = 0; n < files; ++n) {
+		std::string name = file_name(n);
+		if (!drive->FileCreate(&handles[n], &name[0], DOS_ATTR_ARCHIVE)) {
+			fprintf(stderr, "Can't create %s\n", name.c_str());
+			remove(image_path);
+			return 1;
+		}
+	}
+
+	bool failed = false;
+	std::vector<Bit8u> buffer(chunk);
+
+	auto start = bench_clock::now();
+	for (Bit32u pos = 0; pos < file_size; pos += chunk) {
+		for (Bit32u n = 0; n < files; ++n) {
+			Bit16u size = static_cast<Bit16u>(std::min(chunk, file_size - pos));
+			fill(buffer, n, pos);
+			handles[n]->Write(buffer.data(), &size);
+			failed |= (size != std::min(chunk, file_size - pos));
+		}
+	}
+	report("write", seconds_since(start), file_size * files);
+
+	start = bench_clock::now();
+	for (Bit32u n = 0; n < files; ++n) {
+		Bit32u pos = 0;
+		handles[n]->Seek(&pos, DOS_SEEK_SET);
+		for (; pos < file_size; pos += chunk) {
+			Bit16u size = static_cast<Bit16u>(chunk);
+			handles[n]->Read(buffer.data(), &size);
+			failed |= !check(buffer, size, n, pos);
+		}
+	}
+	report("read", seconds_since(start), file_size * files);
+
+	const Bit32u seeks = 4096;
+	srand(1);
+	start = bench_clock::now();
+	for (Bit32u i = 0; i < seeks; ++i) {
+		const Bit32u n = i % files;
+		const Bit32u pos = static_cast<Bit32u>(
+		        (static_cast<uint64_t>(rand()) * rand()) % (file_size - 16));
+		Bit32u seek_pos = pos;
+		handles[n]->Seek(&seek_pos, DOS_SEEK_SET);
+		Bit16u size = 16;
+		handles[n]->Read(buffer.data(), &size);
+		failed |= (size != 16) || !check(buffer, size, n, pos);
+	}
+	report("seek", seconds_since(start), seeks * 16);
+
+	start = bench_clock::now();
+	for (Bit32u n = 0; n < files; ++n) {
+		Bit32u pos = file_size / 2;
+		Bit16u size = 0;
+		handles[n]->Seek(&pos, DOS_SEEK_SET);
+		handles[n]->Write(buffer.data(), &size);
+	}
+	for (Bit32u pos = file_size / 2; pos < file_size; pos += chunk) {
+		for (Bit32u n = 0; n < files; ++n) {
+			Bit16u size = static_cast<Bit16u>(std::min(chunk, file_size - pos));
+			fill(buffer, n, pos);
+			handles[n]->Write(buffer.data(), &size);
+			failed |= (size != std::min(chunk, file_size - pos));
+		}
+	}
+	report("regrow", seconds_since(start), file_size / 2 * files);
+
+	for (Bit32u n = 0; n < files; ++n) {
+		handles[n]->Close();
+		delete handles[n];
+	}
+
+	// Reopen through the directory to check the sizes got written as well
+	for (Bit32u n = 0; n < files && !failed; ++n) {
+		std::string name = file_name(n);
+		DOS_File *file = nullptr;
+		if (!drive->FileOpen(&file, &name[0], OPEN_READ)) {
+			failed = true;
+			break;
+		}
+		Bit32u end = 0;
+		file->Seek(&end, DOS_SEEK_END);
+		failed |= (end != file_size);
+		for (Bit32u pos = 0; pos < end; pos += chunk) {
+			Bit32u seek_pos = pos;
+			file->Seek(&seek_pos, DOS_SEEK_SET);
+			Bit16u size = static_cast<Bit16u>(chunk);
+			file->Read(buffer.data(), &size);
+			failed |= !check(buffer, size, n, pos);
+		}
+		file->Close();
+		delete file;
+	}
+
+	drive.reset();
+	failed |= !bench_sectors(image_path, cylinders * heads * sectors_per_track);
+	remove(image_path);
+	if (failed)
+		printf("Data read back differs from what was written\n");
+	return failed ? 1 : 0;
+}
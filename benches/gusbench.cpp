@@ -0,0 +1,171 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/* Renders the GUS voices as the card does, all 32 of them by default, to
+ * measure how fast they go. The voices loop over random wave data while
+ * their volumes ramp, mixing 8- and 16-bit waves played slower and faster
+ * than the output rate.
+ *
+ * The voices are the real ones and need nothing else from the emulator. */
+
+#include "hardware/gus_voice.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+// The card's output rate falls as more voices are active, as in
+// Gus::ActivateVoices
+static int playback_rate(int num_voices)
+{
+	const int voices = std::max(num_voices, 14);
+	return static_cast<int>(round(1000000.0 / (1.619695497 * voices)));
+}
+
+using bench_clock = std::chrono::steady_clock;
+
+static double seconds_since(bench_clock::time_point start)
+{
+	const std::chrono::duration<double> elapsed = bench_clock::now() - start;
+	return std::max(elapsed.count(), 1e-9);
+}
+
+// Set up as the Gus class does
+static void populate_scalars(vol_scalars_array_t &vol_scalars,
+                             pan_scalars_array_t &pan_scalars)
+{
+	double scalar = 1.0;
+	for (auto v = vol_scalars.rbegin(); v != vol_scalars.rend(); ++v) {
+		*v = static_cast<float>(scalar);
+		scalar /= 1.002709201;
+	}
+	vol_scalars.front() = 0.0f;
+	for (int i = 0; i < PAN_POSITIONS; ++i) {
+		const auto norm = (i - 7.0) / (i < 7 ? 7 : 8);
+		const auto angle = (norm + 1) * M_PI / 4;
+		pan_scalars[i] = {static_cast<float>(cos(angle)),
+		                  static_cast<float>(sin(angle))};
+	}
+}
+
+// Each voice plays its own stretch of memory at its own rate, looping
+// forward or back and forth, while its volume sweeps a range
+static void start_voice(Voice &voice, int num)
+{
+	constexpr uint8_t bit16 = 0x04;
+	constexpr uint8_t loop = 0x08;
+	constexpr uint8_t bidirectional = 0x10;
+	voice.UpdateWaveState(static_cast<uint8_t>(
+	        (num % 2 ? bit16 : 0) | loop | (num % 3 ? 0 : bidirectional)));
+	voice.wave_ctrl.start = num * 16384 * WAVE_WIDTH;
+	voice.wave_ctrl.end = voice.wave_ctrl.start + (8000 + num * 97) * WAVE_WIDTH;
+	voice.wave_ctrl.pos = voice.wave_ctrl.start;
+	voice.WriteWaveRate(static_cast<uint16_t>(300 + num * 61));
+	voice.UpdateVolState(loop | bidirectional);
+	voice.vol_ctrl.start = 1500 * VOLUME_INC_SCALAR;
+	voice.vol_ctrl.end = 4000 * VOLUME_INC_SCALAR;
+	voice.vol_ctrl.pos = (1500 + num * 70) * VOLUME_INC_SCALAR;
+	voice.WriteVolRate(static_cast<uint16_t>(64 + num));
+	voice.WritePanPot(static_cast<uint8_t>(num % PAN_POSITIONS));
+}
+
+static void usage()
+{
+	fprintf(stderr,
+	        "Usage:\n"
+	        "  dosbox-gusbench [-s SECONDS] [-v VOICES] [-n PASSES]\n"
+	        "\n"
+	        "Renders SECONDS (60 by default) of audio from VOICES GUS voices\n"
+	        "(32 by default) at the card's rate for that many voices, in\n"
+	        "blocks of 48 frames as the card does. Reports the time taken\n"
+	        "and how many times faster than real time that is, from the\n"
+	        "best of PASSES runs (3 by default).\n");
+}
+
+int main(int argc, char *argv[])
+{
+	int seconds = 60;
+	int num_voices = 32;
+	int passes = 3;
+	for (int arg = 1; arg < argc; ++arg) {
+		const bool has_value = arg + 1 < argc;
+		if (!strcmp(argv[arg], "-s") && has_value) {
+			seconds = atoi(argv[++arg]);
+		} else if (!strcmp(argv[arg], "-v") && has_value) {
+			num_voices = atoi(argv[++arg]);
+		} else if (!strcmp(argv[arg], "-n") && has_value) {
+			passes = atoi(argv[++arg]);
+		} else {
+			usage();
+			return 1;
+		}
+	}
+	if (seconds <= 0 || num_voices <= 0 || num_voices > 32 || passes <= 0) {
+		usage();
+		return 1;
+	}
+
+	auto ram = std::make_unique<ram_array_t>();
+	std::mt19937 rng(1);
+	for (auto &b : *ram)
+		b = static_cast<uint8_t>(rng());
+	auto vol_scalars = std::make_unique<vol_scalars_array_t>();
+	pan_scalars_array_t pan_scalars = {};
+	populate_scalars(*vol_scalars, pan_scalars);
+
+	const long total_frames = static_cast<long>(playback_rate(num_voices)) *
+	                          seconds;
+	double best = 0.0;
+	float sum = 0.0f;
+	for (int pass = 0; pass < passes; ++pass) {
+		VoiceIrq irq;
+		std::vector<std::unique_ptr<Voice>> voices;
+		for (int i = 0; i < num_voices; ++i) {
+			const auto num = static_cast<uint8_t>(i);
+			voices.emplace_back(std::make_unique<Voice>(num, irq));
+			start_voice(*voices.back(), i);
+		}
+		accumulator_array_t accumulator = {};
+		const auto start = bench_clock::now();
+		for (long done = 0; done < total_frames; done += BUFFER_FRAMES) {
+			const int frames = static_cast<int>(
+			        std::min<long>(BUFFER_FRAMES, total_frames - done));
+			accumulator.fill(0.0f);
+			for (auto &voice : voices)
+				voice->GenerateSamples(accumulator, *ram, *vol_scalars,
+				                       pan_scalars, frames, true);
+			sum += accumulator[0];
+		}
+		const double elapsed = seconds_since(start);
+		if (pass == 0 || elapsed < best)
+			best = elapsed;
+	}
+
+	// The sum keeps the rendering from being optimised away
+	printf("%d voices, %d s of audio: %.3f s, %.1fx real time (%g)\n",
+	       num_voices, seconds, best, seconds / best, static_cast<double>(sum));
+	return 0;
+}
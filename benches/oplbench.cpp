@@ -0,0 +1,446 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/* Replays captured OPL register writes through each of the Adlib module's
+ * emulators as fast as they go, to compare their speed and to check that
+ * optimizing one of them doesn't change its output */
+
+#include "hardware/adlib.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// The threaded nuked handler positions its writes within the emulated tick
+// using the CPU core's cycle counts; the core isn't linked in here, and the
+// handlers never run threaded
+Bit32s CPU_Cycles = 0;
+Bit32s CPU_CycleLeft = 0;
+Bit32s CPU_CycleMax = 1;
+
+static const char *const all_emulators[] = {"fast", "compat", "mame",
+                                            "nuked", "nukedfast"};
+
+struct RegWrite {
+	uint64_t frame = 0; // applied before rendering this frame
+	uint16_t reg = 0;
+	uint8_t val = 0;
+};
+
+struct Capture {
+	std::string name = {};
+	OPL_Mode mode = OPL_opl2;
+	std::vector<RegWrite> writes = {};
+	uint64_t frames = 0;
+};
+
+static void usage()
+{
+	fprintf(stderr,
+	        "Usage:\n"
+	        "  dosbox-oplbench [-e EMU[,EMU...]] [-r RATE] [-n PASSES]\n"
+	        "                  [-t IMF_HZ] [-w HASHES | -c HASHES] CAPTURE...\n"
+	        "\n"
+	        "Replays DRO (version 2) or IMF captures through the OPL\n"
+	        "emulators at full speed and reports the frames rendered per\n"
+	        "second, from the best of PASSES runs (3 by default).\n"
+	        "\n"
+	        "  -e  emulators to run: fast, compat, mame, nuked and\n"
+	        "      nukedfast, all of them by default\n"
+	        "  -r  sample rate, 48000 by default\n"
+	        "  -t  IMF tick rate, 560 by default or 700 for .wlf files\n"
+	        "  -w  writes a hash of each emulator's output to HASHES\n"
+	        "  -c  checks each emulator's output against the hashes in\n"
+	        "      HASHES, failing on any difference\n");
+}
+
+static uint16_t read_le16(const uint8_t *p)
+{
+	return static_cast<uint16_t>(p[0] | p[1] << 8);
+}
+
+static uint32_t read_le32(const uint8_t *p)
+{
+	return static_cast<uint32_t>(p[0] | p[1] << 8 | p[2] << 16) |
+	       static_cast<uint32_t>(p[3]) << 24;
+}
+
+static bool read_file(const char *path, std::vector<uint8_t> &data)
+{
+	FILE *f = fopen(path, "rb");
+	if (!f) {
+		fprintf(stderr, "Can't open %s: %s\n", path, strerror(errno));
+		return false;
+	}
+	uint8_t buffer[64 * 1024];
+	size_t n;
+	while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0)
+		data.insert(data.end(), buffer, buffer + n);
+	fclose(f);
+	return true;
+}
+
+static void add_write(Capture &capture, uint64_t frame, uint16_t reg, uint8_t val)
+{
+	// An OPL2 only has the one bank of registers
+	if (capture.mode == OPL_opl2)
+		reg &= 0xff;
+	// Writes to the timers never reach the handlers
+	if (reg >= 0x02 && reg <= 0x04)
+		return;
+	capture.writes.push_back({frame, reg, val});
+}
+
+// The format written by the Adlib module's capture, see Adlib::Capture
+static bool parse_dro(const std::vector<uint8_t> &data, uint32_t rate, Capture &capture)
+{
+	constexpr size_t header_size = 0x1a;
+	if (data.size() < header_size || read_le16(&data[0x08]) != 2) {
+		fprintf(stderr, "%s: only version 2 DRO files are supported\n",
+		        capture.name.c_str());
+		return false;
+	}
+	const uint32_t commands = read_le32(&data[0x0c]);
+	const uint8_t hardware = data[0x14];
+	const uint8_t delay256 = data[0x17];
+	const uint8_t delay_shift8 = data[0x18];
+	const uint8_t table_size = data[0x19];
+	if (data[0x15] != 0 || data[0x16] != 0 || table_size > 128 ||
+	    data.size() < header_size + table_size) {
+		fprintf(stderr, "%s: unsupported DRO format\n", capture.name.c_str());
+		return false;
+	}
+	switch (hardware) {
+	case 0: capture.mode = OPL_opl2; break;
+	case 1: capture.mode = OPL_dualopl2; break;
+	default: capture.mode = OPL_opl3; break;
+	}
+	const uint8_t *table = &data[header_size];
+	const size_t start = header_size + table_size;
+	const size_t end = std::min(data.size(),
+	                            start + static_cast<size_t>(commands) * 2);
+
+	// Dual OPL2 plays on the two halves of an OPL3, as set up by the module
+	if (capture.mode == OPL_dualopl2)
+		add_write(capture, 0, 0x105, 1);
+
+	uint64_t ms = 0;
+	for (size_t i = start; i + 1 < end; i += 2) {
+		const uint8_t index = data[i];
+		const uint8_t val = data[i + 1];
+		if (index == delay256) {
+			ms += val + 1;
+		} else if (index == delay_shift8) {
+			ms += static_cast<uint64_t>(val + 1) << 8;
+		} else if ((index & 0x7f) < table_size) {
+			const uint16_t reg = table[index & 0x7f] |
+			                     ((index & 0x80) ? 0x100 : 0);
+			add_write(capture, ms * rate / 1000, reg, val);
+		}
+	}
+	capture.frames = ms * rate / 1000;
+	return true;
+}
+
+// Id Software's format for a single OPL2: register, value, then the delay
+// until the next write in ticks. Type 1 files start with the length of the
+// data, type 0 files with a zero write.
+static bool parse_imf(const std::vector<uint8_t> &data, uint32_t rate,
+                      uint32_t tick_rate, Capture &capture)
+{
+	if (data.size() < 4) {
+		fprintf(stderr, "%s: too short for an IMF file\n", capture.name.c_str());
+		return false;
+	}
+	size_t start = 0;
+	size_t end = data.size();
+	const uint16_t length = read_le16(&data[0]);
+	if (length) {
+		start = 2;
+		end = std::min(end, start + length);
+	}
+	capture.mode = OPL_opl2;
+	uint64_t ticks = 0;
+	for (size_t i = start; i + 3 < end; i += 4) {
+		add_write(capture, ticks * rate / tick_rate, data[i], data[i + 1]);
+		ticks += read_le16(&data[i + 2]);
+	}
+	capture.frames = ticks * rate / tick_rate;
+	return true;
+}
+
+static bool has_extension(const std::string &path, const char *ext)
+{
+	const size_t len = strlen(ext);
+	if (path.size() < len)
+		return false;
+	for (size_t i = 0; i < len; ++i)
+		if (tolower(path[path.size() - len + i]) != ext[i])
+			return false;
+	return true;
+}
+
+static bool load_capture(const char *path, uint32_t rate, uint32_t imf_rate,
+                         Capture &capture)
+{
+	std::vector<uint8_t> data;
+	if (!read_file(path, data))
+		return false;
+	capture.name = path;
+	const auto slash = capture.name.find_last_of("/\\");
+	if (slash != std::string::npos)
+		capture.name.erase(0, slash + 1);
+	if (data.size() >= 8 && !memcmp(data.data(), "DBRAWOPL", 8))
+		return parse_dro(data, rate, capture);
+	if (!imf_rate)
+		imf_rate = has_extension(path, ".wlf") ? 700 : 560;
+	return parse_imf(data, rate, imf_rate, capture);
+}
+
+// Keeps count of the frames rendered, and when hashing, a 64-bit FNV-1a
+// hash of the samples
+class BenchSink final : public Adlib::SampleSink {
+public:
+	explicit BenchSink(bool hashing_) : hashing(hashing_) {}
+
+	void AddSamples_m16(Bitu len, const Bit16s *data) override
+	{
+		Add(len, 1, data);
+	}
+	void AddSamples_s16(Bitu len, const Bit16s *data) override
+	{
+		Add(len, 2, data);
+	}
+	void AddSamples_m32(Bitu len, const Bit32s *data) override
+	{
+		Add(len, 1, data);
+	}
+	void AddSamples_s32(Bitu len, const Bit32s *data) override
+	{
+		Add(len, 2, data);
+	}
+
+	uint64_t frames = 0;
+	uint64_t hash = 0xcbf29ce484222325;
+
+private:
+	template <typename T>
+	void Add(Bitu len, int channels, const T *data)
+	{
+		frames += len;
+		if (!hashing)
+			return;
+		for (Bitu i = 0; i < len * channels; ++i) {
+			const auto sample = static_cast<uint32_t>(data[i]);
+			for (int b = 0; b < 32; b += 8) {
+				hash ^= (sample >> b) & 0xff;
+				hash *= 0x100000001b3;
+			}
+		}
+	}
+
+	const bool hashing;
+};
+
+// Renders in ticks of up to a millisecond, as the mixer asks for them
+static void replay(const std::string &emulator, const Capture &capture,
+                   uint32_t rate, BenchSink &sink)
+{
+	std::unique_ptr<Adlib::Handler> handler(
+	        Adlib::make_opl_handler(emulator, capture.mode, false));
+	handler->Init(rate);
+	// The compat emulator's rhythm noise comes from rand()
+	srand(1);
+	const uint64_t tick = std::max(1u, rate / 1000);
+	uint64_t pos = 0;
+	auto render_to = [&](uint64_t frame) {
+		while (pos < frame) {
+			const auto n = std::min(tick, frame - pos);
+			handler->Generate(sink, static_cast<Bitu>(n));
+			pos += n;
+		}
+	};
+	for (const auto &w : capture.writes) {
+		render_to(w.frame);
+		handler->WriteReg(w.reg, w.val);
+	}
+	render_to(capture.frames);
+}
+
+static std::vector<std::string> split(const std::string &list)
+{
+	std::vector<std::string> items;
+	size_t pos = 0;
+	while (pos <= list.size()) {
+		const auto comma = std::min(list.find(',', pos), list.size());
+		items.push_back(list.substr(pos, comma - pos));
+		pos = comma + 1;
+	}
+	return items;
+}
+
+static bool is_emulator(const std::string &name)
+{
+	for (const auto emulator : all_emulators)
+		if (name == emulator)
+			return true;
+	return false;
+}
+
+using hash_map = std::map<std::string, uint64_t>;
+
+static bool read_hashes(const char *path, hash_map &hashes)
+{
+	FILE *f = fopen(path, "r");
+	if (!f) {
+		fprintf(stderr, "Can't open %s: %s\n", path, strerror(errno));
+		return false;
+	}
+	char emulator[64], capture[1024];
+	unsigned long long hash;
+	while (fscanf(f, "%63s %llx %1023[^\n]", emulator, &hash, capture) == 3)
+		hashes[std::string(emulator) + ' ' + capture] = hash;
+	fclose(f);
+	return true;
+}
+
+static const char *mode_name(OPL_Mode mode)
+{
+	switch (mode) {
+	case OPL_opl2: return "OPL2";
+	case OPL_dualopl2: return "dual OPL2";
+	default: return "OPL3";
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	std::vector<std::string> emulators(std::begin(all_emulators),
+	                                   std::end(all_emulators));
+	uint32_t rate = 48000;
+	uint32_t imf_rate = 0;
+	int passes = 3;
+	const char *write_path = nullptr;
+	const char *check_path = nullptr;
+	int arg = 1;
+	for (; arg < argc && argv[arg][0] == '-'; ++arg) {
+		const bool has_value = arg + 1 < argc;
+		if (!strcmp(argv[arg], "-e") && has_value) {
+			emulators = split(argv[++arg]);
+		} else if (!strcmp(argv[arg], "-r") && has_value) {
+			rate = static_cast<uint32_t>(strtoul(argv[++arg], nullptr, 10));
+		} else if (!strcmp(argv[arg], "-n") && has_value) {
+			passes = atoi(argv[++arg]);
+		} else if (!strcmp(argv[arg], "-t") && has_value) {
+			imf_rate = static_cast<uint32_t>(strtoul(argv[++arg], nullptr, 10));
+		} else if (!strcmp(argv[arg], "-w") && has_value) {
+			write_path = argv[++arg];
+		} else if (!strcmp(argv[arg], "-c") && has_value) {
+			check_path = argv[++arg];
+		} else {
+			usage();
+			return 1;
+		}
+	}
+	const bool args_valid = std::all_of(emulators.begin(), emulators.end(),
+	                                    is_emulator);
+	if (arg == argc || !args_valid || rate < 1000 || rate > 192000 ||
+	    passes < 1 || (write_path && check_path)) {
+		usage();
+		return 1;
+	}
+
+	hash_map expected;
+	if (check_path && !read_hashes(check_path, expected))
+		return 1;
+	FILE *hash_file = nullptr;
+	if (write_path) {
+		hash_file = fopen(write_path, "w");
+		if (!hash_file) {
+			fprintf(stderr, "Can't create %s: %s\n", write_path,
+			        strerror(errno));
+			return 1;
+		}
+	}
+	const bool hashing = write_path || check_path;
+
+	bool failed = false;
+	for (; arg < argc; ++arg) {
+		Capture capture;
+		if (!load_capture(argv[arg], rate, imf_rate, capture)) {
+			failed = true;
+			continue;
+		}
+		printf("%s: %s, %.1f s, %zu writes\n", capture.name.c_str(),
+		       mode_name(capture.mode),
+		       static_cast<double>(capture.frames) / rate,
+		       capture.writes.size());
+
+		for (const auto &emulator : emulators) {
+			// The hashing pass is kept apart so it doesn't slow the
+			// timed ones down
+			double best = 0.0;
+			for (int pass = 0; pass < passes; ++pass) {
+				BenchSink sink(false);
+				const auto start = std::chrono::steady_clock::now();
+				replay(emulator, capture, rate, sink);
+				const std::chrono::duration<double> elapsed =
+				        std::chrono::steady_clock::now() - start;
+				if (!pass || elapsed.count() < best)
+					best = elapsed.count();
+			}
+			const double seconds = std::max(best, 1e-9);
+			printf("  %-10s %12.0f frames/s %9.1fx realtime",
+			       emulator.c_str(), capture.frames / seconds,
+			       capture.frames / (seconds * rate));
+			if (hashing) {
+				BenchSink sink(true);
+				replay(emulator, capture, rate, sink);
+				const auto key = emulator + ' ' + capture.name;
+				printf("  %016llx",
+				       static_cast<unsigned long long>(sink.hash));
+				if (hash_file)
+					fprintf(hash_file, "%s %016llx %s\n",
+					        emulator.c_str(),
+					        static_cast<unsigned long long>(sink.hash),
+					        capture.name.c_str());
+				if (check_path) {
+					const auto it = expected.find(key);
+					const bool match = it != expected.end() &&
+					                   it->second == sink.hash;
+					printf(match ? "  ok" : "  DIFFERS");
+					failed |= !match;
+				}
+			}
+			printf("\n");
+		}
+	}
+	if (hash_file)
+		fclose(hash_file);
+	return failed ? 1 : 0;
+}
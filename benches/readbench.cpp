@@ -0,0 +1,307 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/* Reads a host file into guest memory the two ways INT 21h/3Fh can, through
+ * the DOS copy buffer and MEM_BlockWrite, and straight into guest RAM the
+ * way DOS_ReadFileToMem does for files, to compare their speed and to check
+ * that the guest ends up with the same data.
+ *
+ * The memory and paging modules and the local file are the real ones; the
+ * little of DOS and the CPU they reach into is stubbed out below. */
+
+#include "dosbox.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+
+#include "control.h"
+#include "cpu.h"
+#include "cpu/lazyflags.h"
+#include "dos/dos_mscdex.h"
+#include "dos_inc.h"
+#include "drives.h"
+#include "inout.h"
+#include "mem.h"
+#include "paging.h"
+#include "regs.h"
+#include "setup.h"
+
+Config *control = nullptr;
+MachineType machine = MCH_VGA;
+DOS_Block dos;
+DOS_Drive *Drives[DOS_DRIVES] = {};
+DOS_File *Files[DOS_FILES] = {};
+Segments Segs;
+CPU_Regs cpu_regs;
+CPUBlock cpu;
+Bit32s CPU_Cycles = 0;
+Bit32s CPU_CycleLeft = 0;
+Bitu CPU_ArchitectureType = CPU_ARCHTYPE_386FAST;
+CPU_Decoder *cpudecoder = nullptr;
+LazyFlags lflags;
+
+// Only real mode without paging is used, so the CPU never runs
+Bits CPU_Core_Normal_Run()
+{
+	return 0;
+}
+Bits CPU_Core_Full_Run()
+{
+	return 0;
+}
+Bits CPU_Core_Simple_Run()
+{
+	return 0;
+}
+void DOSBOX_RunMachine() {}
+void CPU_Exception(Bitu, Bitu) {}
+
+void DOS_SetError(Bit16u code)
+{
+	dos.errorcode = code;
+}
+
+// The drive the local file belongs to, which doesn't get used
+void DOS_DTA::SetResult(const char *, Bit32u, Bit16u, Bit16u, Bit8u) {}
+void DOS_DTA::GetSearchParams(Bit8u &attr, char *pattern) const
+{
+	attr = 0;
+	pattern[0] = 0;
+}
+
+uint16_t DOS_PackTime(const struct tm &datetime) noexcept
+{
+	return static_cast<uint16_t>((datetime.tm_hour << 11) |
+	                             (datetime.tm_min << 5) | (datetime.tm_sec / 2));
+}
+
+uint16_t DOS_PackDate(const struct tm &datetime) noexcept
+{
+	return static_cast<uint16_t>(((datetime.tm_year - 80) << 9) |
+	                             ((datetime.tm_mon + 1) << 5) | datetime.tm_mday);
+}
+
+int MSCDEX_AddDrive(char, const char *, Bit8u &)
+{
+	return 1;
+}
+int MSCDEX_RemoveDrive(char)
+{
+	return 0;
+}
+bool MSCDEX_GetVolumeName(Bit8u, char *)
+{
+	return false;
+}
+bool MSCDEX_HasMediaChanged(Bit8u)
+{
+	return false;
+}
+
+// Port 0x92, the A20 gate, is all the memory module registers
+IO_ReadHandleObject::~IO_ReadHandleObject() {}
+IO_WriteHandleObject::~IO_WriteHandleObject() {}
+void IO_ReadHandleObject::Install(io_port_t, IO_ReadHandler, Bitu, Bitu) {}
+void IO_WriteHandleObject::Install(io_port_t, IO_WriteHandler, Bitu, Bitu) {}
+void IO_WriteB(io_port_t, io_val_t) {}
+io_val_t IO_ReadB(io_port_t)
+{
+	return 0xff;
+}
+
+void GFX_ShowMsg(const char *format, ...)
+{
+	(void)format;
+}
+
+void MEM_Init(Section *sec);
+void PAGING_Init(Section *sec);
+
+// The guest buffer, DS:DX, starts off a page boundary like most do
+constexpr PhysPt buffer_pt = 0x20010;
+
+static Bit8u pattern_byte(Bit32u pos)
+{
+	return static_cast<Bit8u>((pos * 2654435761u) >> 24);
+}
+
+static Bit8u copy_buffer[0x10000];
+
+// What INT 21h/3Fh did before, and still does for devices
+static bool read_buffered(DOS_File &file, PhysPt pt, Bit16u *amount)
+{
+	if (!file.Read(copy_buffer, amount))
+		return false;
+	MEM_BlockWrite(pt, copy_buffer, *amount);
+	return true;
+}
+
+// The loop DOS_ReadFileToMem runs for files
+static bool read_direct(DOS_File &file, PhysPt pt, Bit16u *amount)
+{
+	const Bit16u total = *amount;
+	Bit16u done = 0;
+	while (done < total) {
+		Bitu span = total - done;
+		HostPt host = MEM_GetBlockWritePt(pt + done, &span);
+		Bit16u toread = static_cast<Bit16u>(span);
+		if (!file.Read(host ? host : copy_buffer, &toread)) {
+			if (!done)
+				return false;
+			break;
+		}
+		if (!host)
+			MEM_BlockWrite(pt + done, copy_buffer, toread);
+		done += toread;
+		if (toread < span)
+			break;
+	}
+	*amount = done;
+	return true;
+}
+
+using read_function = bool (*)(DOS_File &, PhysPt, Bit16u *);
+
+using bench_clock = std::chrono::steady_clock;
+
+static double seconds_since(bench_clock::time_point start)
+{
+	const std::chrono::duration<double> elapsed = bench_clock::now() - start;
+	return std::max(elapsed.count(), 1e-9);
+}
+
+// Reads the whole file in chunks of the given size, checking what lands in
+// guest memory on the first round
+static bool read_file(DOS_File &file, read_function read, Bit16u chunk,
+                      Bit32u file_size, Bit32u rounds, const char *name)
+{
+	std::vector<Bit8u> check(chunk);
+	bool failed = false;
+	const auto start = bench_clock::now();
+	for (Bit32u r = 0; r < rounds; ++r) {
+		Bit32u pos = 0;
+		file.Seek(&pos, DOS_SEEK_SET);
+		while (pos < file_size) {
+			Bit16u amount = chunk;
+			if (!read(file, buffer_pt, &amount) ||
+			    amount != std::min<Bit32u>(chunk, file_size - pos)) {
+				failed = true;
+				break;
+			}
+			if (r == 0) {
+				MEM_BlockRead(buffer_pt, check.data(), amount);
+				for (Bit16u i = 0; i < amount; ++i)
+					failed |= check[i] != pattern_byte(pos + i);
+			}
+			pos += amount;
+		}
+	}
+	const double seconds = seconds_since(start);
+	printf("%-8s %5u %8.3f s %9.2f MB/s\n", name, chunk, seconds,
+	       static_cast<double>(file_size) * rounds / (seconds * 1024 * 1024));
+	return !failed;
+}
+
+static void usage()
+{
+	fprintf(stderr,
+	        "Usage:\n"
+	        "  dosbox-readbench [-s MBYTES] [-r ROUNDS] [-f FILE]\n"
+	        "\n"
+	        "Writes a file of MBYTES megabytes (16 by default) and reads it\n"
+	        "into conventional memory ROUNDS times (8 by default) in reads\n"
+	        "of 512, 4096, 32768 and 65535 bytes, both through the copy\n"
+	        "buffer and straight into guest memory, reporting the time taken\n"
+	        "by each. Fails if the data in guest memory doesn't match the\n"
+	        "file.\n"
+	        "\n"
+	        "  -f  the file to create, dosbox-readbench.dat by default;\n"
+	        "      it is removed when done\n");
+}
+
+int main(int argc, char *argv[])
+{
+	Bit32u mbytes = 16;
+	Bit32u rounds = 8;
+	const char *path = "dosbox-readbench.dat";
+	for (int arg = 1; arg < argc; ++arg) {
+		const bool has_value = arg + 1 < argc;
+		if (!strcmp(argv[arg], "-s") && has_value) {
+			mbytes = strtoul(argv[++arg], nullptr, 10);
+		} else if (!strcmp(argv[arg], "-r") && has_value) {
+			rounds = strtoul(argv[++arg], nullptr, 10);
+		} else if (!strcmp(argv[arg], "-f") && has_value) {
+			path = argv[++arg];
+		} else {
+			usage();
+			return 1;
+		}
+	}
+	if (!mbytes || mbytes > 1024 || !rounds) {
+		usage();
+		return 1;
+	}
+	const Bit32u file_size = mbytes * 1024 * 1024;
+
+	FILE *f = fopen(path, "wb");
+	if (!f) {
+		fprintf(stderr, "Can't create %s: %s\n", path, strerror(errno));
+		return 1;
+	}
+	std::vector<Bit8u> data(file_size);
+	for (Bit32u i = 0; i < file_size; ++i)
+		data[i] = pattern_byte(i);
+	const bool written = fwrite(data.data(), data.size(), 1, f) == 1;
+	fclose(f);
+	if (!written) {
+		fprintf(stderr, "Can't write %s\n", path);
+		remove(path);
+		return 1;
+	}
+
+	Section_prop section("dosbox");
+	section.Add_int("memsize", Property::Changeable::WhenIdle, 16);
+	MEM_Init(&section);
+	PAGING_Init(&section);
+
+	localFile file("DATA.DAT", fopen(path, "rb"), "");
+	file.AddRef();
+
+	bool failed = false;
+	for (const Bit16u chunk : {512, 4096, 32768, 65535}) {
+		failed |= !read_file(file, read_buffered, chunk, file_size, rounds, "buffered");
+		failed |= !read_file(file, read_direct, chunk, file_size, rounds, "direct");
+	}
+
+	file.Close();
+	remove(path);
+	if (failed) {
+		fprintf(stderr, "Data in guest memory differs from the file\n");
+		return 1;
+	}
+	return 0;
+}
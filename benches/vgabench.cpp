@@ -0,0 +1,471 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/* Draws frames of the standard VGA modes through the VGA module's line
+ * drawers as fast as they go, to compare their speed and to check that
+ * optimizing them doesn't change what ends up on screen.
+ *
+ * Only vga.cpp and vga_draw.cpp are linked in. The registers are loaded
+ * from the BIOS mode tables straight into the vga structure instead of
+ * going through the port handlers, the PIC is a plain event queue running
+ * on emulated time, and the renderer hashes the lines it gets. */
+
+#include "dosbox.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "pic.h"
+#include "render.h"
+#include "vga.h"
+
+MachineType machine = MCH_VGA;
+SVGACards svgaCard = SVGA_None;
+
+// The PIC only runs the events queued by the VGA module; emulated time is
+// kept in PIC_Ticks and the cycle counts, the way PIC_FullIndex expects it
+Bitu PIC_Ticks = 0;
+Bit32s CPU_Cycles = 0;
+Bit32s CPU_CycleLeft = 0;
+Bit32s CPU_CycleMax = 1000000;
+
+struct Event {
+	double time = 0.0;
+	uint64_t order = 0; // keeps events queued for the same time in order
+	PIC_EventHandler handler = nullptr;
+	Bitu val = 0;
+};
+
+static std::vector<Event> events = {};
+static uint64_t events_queued = 0;
+
+static void set_time(double time)
+{
+	const double ticks = floor(time);
+	PIC_Ticks = static_cast<Bitu>(ticks);
+	CPU_Cycles = 0;
+	CPU_CycleLeft = CPU_CycleMax -
+	                static_cast<Bit32s>((time - ticks) * CPU_CycleMax);
+}
+
+void PIC_AddEvent(PIC_EventHandler handler, float delay, Bitu val)
+{
+	const Event event = {PIC_FullIndex() + delay, events_queued++, handler, val};
+	const auto pos = std::upper_bound(events.begin(), events.end(), event,
+	                                  [](const Event &a, const Event &b) {
+		                                  return a.time < b.time ||
+		                                         (a.time == b.time &&
+		                                          a.order < b.order);
+	                                  });
+	events.insert(pos, event);
+}
+
+void PIC_RemoveEvents(PIC_EventHandler handler)
+{
+	events.erase(std::remove_if(events.begin(), events.end(),
+	                            [handler](const Event &e) {
+		                            return e.handler == handler;
+	                            }),
+	             events.end());
+}
+
+void PIC_ActivateIRQ(Bitu /*irq*/) {}
+void PIC_DeActivateIRQ(Bitu /*irq*/) {}
+
+static void run_until(double time)
+{
+	while (!events.empty() && events.front().time <= time) {
+		const Event event = events.front();
+		events.erase(events.begin());
+		set_time(event.time);
+		event.handler(event.val);
+	}
+	set_time(time);
+}
+
+// The renderer keeps count of the frames and lines it gets, and when
+// hashing, a 64-bit FNV-1a hash of the lines' pixels
+struct Screen {
+	bool active = false; // the size has been set
+	bool updating = false;
+	bool hashing = false;
+	uint64_t frames = 0;
+	uint64_t lines = 0;
+	uint64_t hash = 0xcbf29ce484222325;
+};
+
+static Screen screen = {};
+
+static void hash_line(const void *src)
+{
+	++screen.lines;
+	if (!screen.hashing)
+		return;
+	const auto data = static_cast<const uint8_t *>(src);
+	for (Bitu i = 0; i < vga.draw.line_length; ++i) {
+		screen.hash ^= data[i];
+		screen.hash *= 0x100000001b3;
+	}
+}
+
+ScalerLineHandler_t RENDER_DrawLine = hash_line;
+
+void RENDER_SetSize(Bitu /*width*/, Bitu /*height*/, unsigned /*bpp*/,
+                    float /*fps*/, double /*ratio*/, bool /*dblw*/, bool /*dblh*/)
+{
+	screen.active = true;
+}
+
+// Like the real renderer, nothing gets drawn before the size is known
+bool RENDER_StartUpdate()
+{
+	if (screen.updating || !screen.active)
+		return false;
+	screen.updating = true;
+	return true;
+}
+
+void RENDER_EndUpdate(bool abort)
+{
+	if (screen.updating && !abort)
+		++screen.frames;
+	screen.updating = false;
+}
+
+void VGA_Init(Section *sec);
+
+// Frame tracing is linked in with vga_draw.cpp but never started
+void GFX_ShowMsg(const char *, ...) {}
+
+// The rest of the card isn't emulated here; vga.cpp's VGA_Init calls these
+// to set up the port handlers, the memory and the SVGA chipsets
+void VGA_SetupMemory(Section * /*sec*/) {}
+void VGA_SetupMisc() {}
+void VGA_SetupDAC() {}
+void VGA_SetupGFX() {}
+void VGA_SetupSEQ() {}
+void VGA_SetupAttr() {}
+void VGA_SetupOther() {}
+void VGA_SetupXGA() {}
+void VGA_SetupHandlers() {}
+void VGA_ATTR_SetEGAMonitorPalette(EGAMonitorMode /*m*/) {}
+void SVGA_Setup_S3Trio() {}
+void SVGA_Setup_TsengET4K() {}
+void SVGA_Setup_TsengET3K() {}
+void SVGA_Setup_ParadisePVGA1A() {}
+
+// Register values for the modes as the IBM VGA BIOS sets them; 80x50 is
+// mode 03h with the 8x8 font loaded
+struct Mode {
+	const char *name;
+	VGAModes mode;
+	Bit8u misc_output;
+	Bit8u clocking_mode;
+	Bit8u attr_mode_control;
+	Bit8u crtc[0x19];
+};
+
+static const Mode modes[] = {
+        {"text80x25", M_TEXT, 0x67, 0x00, 0x0c,
+         {0x5f, 0x4f, 0x50, 0x82, 0x55, 0x81, 0xbf, 0x1f, 0x00,
+          0x4f, 0x0d, 0x0e, 0x00, 0x00, 0x00, 0x00, 0x9c, 0x8e,
+          0x8f, 0x28, 0x1f, 0x96, 0xb9, 0xa3, 0xff}},
+        {"text80x25-8dot", M_TEXT, 0x63, 0x01, 0x0c,
+         {0x5f, 0x4f, 0x50, 0x82, 0x55, 0x81, 0xbf, 0x1f, 0x00,
+          0x4f, 0x0d, 0x0e, 0x00, 0x00, 0x00, 0x00, 0x9c, 0x8e,
+          0x8f, 0x28, 0x1f, 0x96, 0xb9, 0xa3, 0xff}},
+        {"text80x50", M_TEXT, 0x67, 0x00, 0x0c,
+         {0x5f, 0x4f, 0x50, 0x82, 0x55, 0x81, 0xbf, 0x1f, 0x00,
+          0x47, 0x06, 0x07, 0x00, 0x00, 0x00, 0x00, 0x9c, 0x8e,
+          0x8f, 0x28, 0x07, 0x96, 0xb9, 0xa3, 0xff}},
+        {"vga320x200", M_VGA, 0x63, 0x01, 0x41,
+         {0x5f, 0x4f, 0x50, 0x82, 0x54, 0x80, 0xbf, 0x1f, 0x00,
+          0x41, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x9c, 0x8e,
+          0x8f, 0x28, 0x40, 0x96, 0xb9, 0xa3, 0xff}},
+        {"ega640x480", M_EGA, 0xe3, 0x01, 0x01,
+         {0x5f, 0x4f, 0x50, 0x82, 0x54, 0x80, 0x0b, 0x3e, 0x00,
+          0x40, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xea, 0x8c,
+          0xdf, 0x28, 0x00, 0xe7, 0x04, 0xe3, 0xff}},
+};
+
+// Fills video memory, the font and the palette with the same pseudo-random
+// contents on every run
+static void fill_memory()
+{
+	uint32_t seed = 1;
+	auto next = [&seed]() {
+		seed = seed * 1103515245 + 12345;
+		return static_cast<Bit8u>(seed >> 16);
+	};
+	for (Bit32u i = 0; i < vga.vmemsize; ++i)
+		vga.mem.linear[i] = next();
+	for (Bit32u i = 0; i < vga.vmemsize * 2; ++i)
+		vga.fastmem[i] = next() & 0xf;
+	for (auto &row : vga.draw.font)
+		row = next();
+	for (Bitu i = 0; i < 256; ++i)
+		vga.dac.xlat16[i] = static_cast<Bit16u>(next() | next() << 8);
+}
+
+static std::vector<Bit8u> memory = {};
+static std::vector<Bit8u> fast_memory = {};
+
+static void set_mode(const Mode &mode)
+{
+	events.clear();
+	vga.mode = mode.mode;
+	vga.misc_output = mode.misc_output;
+	vga.seq.clocking_mode = mode.clocking_mode;
+	vga.attr.mode_control = mode.attr_mode_control;
+	vga.attr.disabled = 0;
+	memcpy(&vga.crtc.horizontal_total, mode.crtc, sizeof(mode.crtc));
+
+	// What the CRTC port handlers derive from the registers
+	vga.config.scan_len = vga.crtc.offset;
+	vga.config.line_compare = vga.crtc.line_compare |
+	                          ((vga.crtc.overflow & 0x10) << 4) |
+	                          ((vga.crtc.maximum_scan_line & 0x40) << 3);
+	vga.config.display_start = vga.config.real_start = 0;
+	vga.config.hlines_skip = vga.crtc.preset_row_scan & 0x1f;
+	vga.draw.cursor.enabled = !(vga.crtc.cursor_start & 0x20);
+	vga.draw.cursor.sline = vga.crtc.cursor_start & 0x1f;
+	vga.draw.cursor.eline = vga.crtc.cursor_end & 0x1f;
+	vga.draw.cursor.address = (12 * 80 + 40) * 2;
+	vga.draw.font_tables[0] = vga.draw.font_tables[1] = vga.draw.font;
+	vga.draw.cursor.count = 0;
+	vga.draw.panning = vga.draw.bytes_skip = 0;
+	vga.draw.whole_frame = {};
+	vga.tandy.draw_base = vga.mem.linear;
+	VGA_SetBlinking(vga.attr.mode_control & 0x08);
+
+	// Starts the vertical timer at time 0, with the first frame skipped
+	// while the renderer gets set up
+	vga.draw.delay.vtotal = 0.0;
+	vga.draw.width = 0;
+	screen.active = screen.updating = false;
+	set_time(0.0);
+	VGA_SetupDrawing(0);
+}
+
+static Bit16u raster_colour = 0;
+
+// Changes a palette entry halfway down the screen every frame, like a
+// program doing copper bars would. The writes start halfway through the
+// run, once the VGA module has gone over to drawing whole frames, so the
+// switch back to per-line drawing gets drawn as well.
+static void raster_write(Bitu /*val*/)
+{
+	PIC_AddEvent(raster_write, static_cast<float>(vga.draw.delay.vtotal));
+	VGA_NoteDisplayRegisterWrite();
+	vga.dac.xlat16[1] = raster_colour++;
+}
+
+static void draw_frames(const Mode &mode, bool raster, Bitu frames)
+{
+	const Bit16u colour = vga.dac.xlat16[1];
+	set_mode(mode);
+	raster_colour = 0;
+	if (raster)
+		PIC_AddEvent(raster_write,
+		             static_cast<float>((frames / 2) * vga.draw.delay.vtotal +
+		                                vga.draw.delay.vdend / 2));
+	run_until(frames * vga.draw.delay.vtotal);
+	VGA_KillDrawing();
+	vga.dac.xlat16[1] = colour;
+}
+
+static void usage()
+{
+	fprintf(stderr,
+	        "Usage:\n"
+	        "  dosbox-vgabench [-m MODE[,MODE...]] [-f FRAMES] [-n PASSES]\n"
+	        "                  [-w HASHES | -c HASHES]\n"
+	        "\n"
+	        "Draws FRAMES frames (600 by default) of each mode at full\n"
+	        "speed and reports the frames drawn per second, from the best\n"
+	        "of PASSES runs (3 by default). Each mode is drawn once as is and\n"
+	        "once with a palette write halfway down every frame from the\n"
+	        "middle of the run on, the latter shown as MODE+raster.\n"
+	        "\n"
+	        "  -m  modes to draw:");
+	for (const auto &mode : modes)
+		fprintf(stderr, " %s", mode.name);
+	fprintf(stderr,
+	        "\n"
+	        "      all of them by default\n"
+	        "  -w  writes a hash of each mode's frames to HASHES\n"
+	        "  -c  checks each mode's frames against the hashes in HASHES,\n"
+	        "      failing on any difference\n");
+}
+
+static const Mode *find_mode(const std::string &name)
+{
+	for (const auto &mode : modes)
+		if (name == mode.name)
+			return &mode;
+	return nullptr;
+}
+
+static std::vector<std::string> split(const std::string &list)
+{
+	std::vector<std::string> items;
+	size_t pos = 0;
+	while (pos <= list.size()) {
+		const auto comma = std::min(list.find(',', pos), list.size());
+		items.push_back(list.substr(pos, comma - pos));
+		pos = comma + 1;
+	}
+	return items;
+}
+
+using hash_map = std::map<std::string, uint64_t>;
+
+static bool read_hashes(const char *path, hash_map &hashes)
+{
+	FILE *f = fopen(path, "r");
+	if (!f) {
+		fprintf(stderr, "Can't open %s: %s\n", path, strerror(errno));
+		return false;
+	}
+	char name[64];
+	unsigned long long hash;
+	while (fscanf(f, "%63s %llx", name, &hash) == 2)
+		hashes[name] = hash;
+	fclose(f);
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	std::vector<const Mode *> selected = {};
+	for (const auto &mode : modes)
+		selected.push_back(&mode);
+	Bitu frames = 600;
+	int passes = 3;
+	const char *write_path = nullptr;
+	const char *check_path = nullptr;
+	for (int arg = 1; arg < argc; ++arg) {
+		const bool has_value = arg + 1 < argc;
+		bool valid = has_value;
+		if (!strcmp(argv[arg], "-m") && has_value) {
+			selected.clear();
+			for (const auto &name : split(argv[++arg])) {
+				const Mode *mode = find_mode(name);
+				valid &= (mode != nullptr);
+				selected.push_back(mode);
+			}
+		} else if (!strcmp(argv[arg], "-f") && has_value) {
+			frames = strtoul(argv[++arg], nullptr, 10);
+		} else if (!strcmp(argv[arg], "-n") && has_value) {
+			passes = atoi(argv[++arg]);
+		} else if (!strcmp(argv[arg], "-w") && has_value) {
+			write_path = argv[++arg];
+		} else if (!strcmp(argv[arg], "-c") && has_value) {
+			check_path = argv[++arg];
+		} else {
+			valid = false;
+		}
+		if (!valid) {
+			usage();
+			return 1;
+		}
+	}
+	if (!frames || passes < 1 || (write_path && check_path)) {
+		usage();
+		return 1;
+	}
+
+	hash_map expected;
+	if (check_path && !read_hashes(check_path, expected))
+		return 1;
+	FILE *hash_file = nullptr;
+	if (write_path) {
+		hash_file = fopen(write_path, "w");
+		if (!hash_file) {
+			fprintf(stderr, "Can't create %s: %s\n", write_path,
+			        strerror(errno));
+			return 1;
+		}
+	}
+	const bool hashing = write_path || check_path;
+
+	VGA_Init(nullptr);
+	memory.resize(vga.vmemsize + 2048);
+	fast_memory.resize(vga.vmemsize * 2 + 4096);
+	vga.mem.linear = memory.data();
+	vga.fastmem = fast_memory.data();
+	fill_memory();
+
+	bool failed = false;
+	for (const auto mode : selected) {
+		for (const bool raster : {false, true}) {
+			const std::string name = std::string(mode->name) +
+			                         (raster ? "+raster" : "");
+			// The hashing pass is kept apart so it doesn't slow the
+			// timed ones down
+			double best = 0.0;
+			for (int pass = 0; pass < passes; ++pass) {
+				screen = {};
+				const auto start = std::chrono::steady_clock::now();
+				draw_frames(*mode, raster, frames);
+				const std::chrono::duration<double> elapsed =
+				        std::chrono::steady_clock::now() - start;
+				if (!pass || elapsed.count() < best)
+					best = elapsed.count();
+			}
+			const double seconds = std::max(best, 1e-9);
+			const double fps = 1000.0 / vga.draw.delay.vtotal;
+			printf("%-22s %4ux%-4u %9.0f frames/s %8.1fx realtime",
+			       name.c_str(), static_cast<unsigned>(vga.draw.width),
+			       static_cast<unsigned>(vga.draw.height),
+			       screen.frames / seconds,
+			       screen.frames / (seconds * fps));
+			if (hashing) {
+				screen = {};
+				screen.hashing = true;
+				draw_frames(*mode, raster, frames);
+				printf("  %016llx",
+				       static_cast<unsigned long long>(screen.hash));
+				if (hash_file)
+					fprintf(hash_file, "%s %016llx\n", name.c_str(),
+					        static_cast<unsigned long long>(screen.hash));
+				if (check_path) {
+					const auto it = expected.find(name);
+					const bool match = it != expected.end() &&
+					                   it->second == screen.hash;
+					printf(match ? "  ok" : "  DIFFERS");
+					failed |= !match;
+				}
+			}
+			printf("\n");
+		}
+	}
+	if (hash_file)
+		fclose(hash_file);
+	return failed ? 1 : 0;
+}
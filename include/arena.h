@@ -0,0 +1,76 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOSBOX_ARENA_H
+#define DOSBOX_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/*
+Arena allocator
+---------------
+Hands out memory from large blocks, for many small objects that usually
+die together. Freed allocations are kept on per-size free lists and reused
+by later allocations of the same rounded size, while Clear() returns all
+blocks at once. Objects placed in the arena are not destroyed by it.
+*/
+
+class Arena {
+public:
+	// Every allocation is aligned to, and a multiple of, this size
+	static constexpr size_t granularity = alignof(std::max_align_t);
+
+	explicit Arena(size_t block_size = 64 * 1024);
+
+	Arena(const Arena &) = delete;            // prevent copying
+	Arena &operator=(const Arena &) = delete; // prevent assignment
+
+	void *Allocate(size_t size);
+	void Free(void *ptr, size_t size);
+
+	// Stores a copy of the NUL-terminated string
+	char *CopyString(const char *str);
+	void FreeString(char *str);
+
+	// Releases all blocks, invalidating every allocation
+	void Clear();
+
+	size_t GetUsedBytes() const { return used_bytes; }
+	size_t GetReservedBytes() const { return reserved_bytes; }
+
+private:
+	static size_t RoundUp(size_t size)
+	{
+		return (size + granularity - 1) & ~(granularity - 1);
+	}
+
+	size_t block_size;
+	std::vector<std::unique_ptr<uint8_t[]>> blocks = {};
+	uint8_t *pos = nullptr;
+	uint8_t *end = nullptr;
+	std::vector<void *> free_lists = {}; // indexed by size / granularity
+	size_t used_bytes = 0;
+	size_t reserved_bytes = 0;
+};
+
+#endif
@@ -22,6 +22,9 @@
 #include <memory>
 #include <stdio.h>
 #include <array>
+#include <string>
+#include "compressed_image.h"
+#include "disk_delta.h"
 #ifndef DOSBOX_MEM_H
 #include "mem.h"
 #endif
@@ -51,11 +54,25 @@ public:
 	Bit8u Write_Sector(Bit32u head,Bit32u cylinder,Bit32u sector,void * data);
 	Bit8u Read_AbsoluteSector(Bit32u sectnum, void * data);
 	Bit8u Write_AbsoluteSector(Bit32u sectnum, void * data);
+	/* Multi-sector transfers of consecutive sectors */
+	Bit8u Read_Sectors(Bit32u head,Bit32u cylinder,Bit32u sector,Bit32u count,void * data);
+	Bit8u Write_Sectors(Bit32u head,Bit32u cylinder,Bit32u sector,Bit32u count,void * data);
+	Bit8u Read_AbsoluteSectors(Bit32u sectnum, Bit32u count, void * data);
+	Bit8u Write_AbsoluteSectors(Bit32u sectnum, Bit32u count, void * data);
 
 	void Set_Geometry(Bit32u setHeads, Bit32u setCyl, Bit32u setSect, Bit32u setSectSize);
 	void Get_Geometry(Bit32u * getHeads, Bit32u *getCyl, Bit32u *getSect, Bit32u *getSectSize);
 	Bit8u GetBiosType(void);
 	Bit32u getSectSize(void);
+	Bit32u GetWriteCount(void) const { return write_count; }
+
+	/* Redirects all writes into a copy-on-write delta file, leaving the
+	 * image file itself untouched */
+	bool AttachDelta(const std::string &path);
+
+	/* Size of the disk in bytes, reaching up to the last sector in the
+	 * delta file if that lies beyond the end of the image */
+	uint64_t GetSize();
 
 	imageDisk(FILE *img_file, const char *img_name, uint32_t img_size_k, bool is_hdd);
 	imageDisk(const imageDisk&) = delete; // prevent copy
@@ -63,12 +80,15 @@ public:
 
 	virtual ~imageDisk()
 	{
+		UnmapImage();
 		if (diskimg != nullptr)
 			fclose(diskimg);
 	}
 
 	bool hardDrive;
 	bool active;
+	/* False if the image can't be used, e.g. a damaged compressed image */
+	bool created_successfully;
 	FILE *diskimg;
 	char diskname[512];
 	Bit8u floppytype;
@@ -76,10 +96,31 @@ public:
 	Bit32u sector_size;
 	Bit32u heads,cylinders,sectors;
 private:
-	Bit32u current_fpos;
+	Bit8u Read_ImageSectors(Bit32u sectnum, Bit32u count, void * data);
+	void MapImage();
+	void UnmapImage();
+
+	/* The image is accessed through a memory mapping when the host
+	 * supports it, and through stdio otherwise */
+	Bit8u *mapped_image;
+	size_t mapped_size;
+	bool mapped_writable;
+#if defined(WIN32)
+	void *mapping_handle;
+#endif
+	std::unique_ptr<CompressedImage> compressed;
+	std::unique_ptr<DiskDelta> delta;
+
+	uint64_t current_fpos;
+	Bit32u write_count;
+	bool write_refused;
 	enum { NONE,READ,WRITE } last_action;
 };
 
+/* Size of the disk contained in the image file, which is not the size of
+ * the file for compressed images */
+uint64_t get_disk_image_size(FILE *img_file);
+
 void updateDPT(void);
 void incrementFDD(void);
 
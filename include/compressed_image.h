@@ -0,0 +1,131 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOSBOX_COMPRESSED_IMAGE_H
+#define DOSBOX_COMPRESSED_IMAGE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+Block-compressed disk images
+----------------------------
+The image is split into fixed-size chunks that are compressed independently
+with an LZ4-compatible block codec, so any sector can be read by
+decompressing only the chunk that holds it.
+
+File layout, all values little-endian:
+  header  "DBXCIMG1", version (32-bit), chunk size (32-bit),
+          uncompressed image size (64-bit), chunk count (32-bit),
+          reserved (32-bit)                                    - 32 bytes
+  index   per chunk: file offset (64-bit), stored size (32-bit),
+          flags (32-bit, bit 0 set if the chunk is stored raw)   - 16 bytes
+  data    the chunks, in order
+
+Decompressed chunks are kept in a small LRU cache. When the reads move
+sequentially from one chunk to the next, the following chunks are fetched
+with the same file read and decompressed ahead of time.
+*/
+
+// Compresses src into dst using the LZ4 block format. Returns the
+// compressed size, or 0 if it wouldn't fit into dst_capacity.
+size_t lz4_compress_block(const uint8_t *src, size_t src_size, uint8_t *dst,
+                          size_t dst_capacity);
+
+// Decompresses an LZ4 block into dst. Returns the decompressed size, or
+// -1 if the block is malformed or doesn't fit into dst_capacity.
+int64_t lz4_decompress_block(const uint8_t *src, size_t src_size,
+                             uint8_t *dst, size_t dst_capacity);
+
+class CompressedImage {
+public:
+	static constexpr uint32_t version = 1;
+	static constexpr size_t header_size = 32;
+	static constexpr size_t index_entry_size = 16;
+	static constexpr uint32_t default_chunk_size = 64 * 1024;
+
+	// Returns true if the file starts with a compressed image header
+	static bool IsCompressedImage(FILE *file);
+
+	// Writes the raw image read from src as a compressed image into dst.
+	static bool Create(FILE *src, FILE *dst, uint32_t chunk_size,
+	                   std::string &error);
+
+	// Reads the header and the index; check IsOpen() for success. The
+	// file stays owned by the caller and must outlive this object.
+	explicit CompressedImage(FILE *file, size_t cache_size = 4 * 1024 * 1024);
+
+	CompressedImage(const CompressedImage &) = delete; // prevent copying
+	CompressedImage &operator=(const CompressedImage &) = delete; // prevent assignment
+
+	bool IsOpen() const { return is_open; }
+	uint64_t GetSize() const { return image_size; }
+	uint32_t GetChunkSize() const { return chunk_size; }
+
+	// Reads the uncompressed bytes at offset; bytes beyond the end of
+	// the image read as zero. Returns false on I/O or data errors.
+	bool Read(uint64_t offset, size_t length, uint8_t *data);
+
+	uint64_t GetCacheHits() const { return cache_hits; }
+	uint64_t GetCacheMisses() const { return cache_misses; }
+	uint64_t GetReadAheadChunks() const { return read_ahead_chunks; }
+
+	// Number of chunks fetched ahead on sequential reads
+	static constexpr uint32_t read_ahead = 4;
+
+private:
+	struct Chunk {
+		uint64_t offset;
+		uint32_t stored_size;
+		bool raw;
+	};
+
+	struct CachedChunk {
+		std::vector<uint8_t> data;
+		std::list<uint32_t>::iterator lru_pos;
+	};
+
+	const std::vector<uint8_t> *GetChunk(uint32_t chunk);
+	bool FetchChunks(uint32_t first, uint32_t count);
+	bool Decompress(uint32_t chunk, const uint8_t *stored);
+	uint32_t GetChunkLength(uint32_t chunk) const;
+
+	FILE *file;
+	bool is_open = false;
+	uint64_t image_size = 0;
+	uint32_t chunk_size = 0;
+	std::vector<Chunk> index = {};
+
+	std::unordered_map<uint32_t, CachedChunk> cache = {};
+	std::list<uint32_t> lru = {}; // most recently used first
+	size_t cache_capacity = 0;    // in chunks
+	uint32_t last_chunk = UINT32_MAX;
+	std::vector<uint8_t> read_buffer = {};
+
+	uint64_t cache_hits = 0;
+	uint64_t cache_misses = 0;
+	uint64_t read_ahead_chunks = 0;
+};
+
+#endif
@@ -21,6 +21,7 @@
 
 #include "dosbox.h"
 
+#include <cstdint>
 #include <cstdio>
 #include <string>
 #include <ctime>
@@ -82,6 +83,10 @@ constexpr auto localtime_r = ::localtime_r;
 
 #endif
 
+// fseek and ftell with 64-bit offsets, as long is only 32 bits on Windows
+int fseek64(FILE *stream, int64_t offset, int origin);
+int64_t ftell64(FILE *stream);
+
 } // namespace cross
 
 void CROSS_DetermineConfigPaths();
@@ -122,6 +127,8 @@ typedef struct dir_struct {
 #endif
 
 dir_information* open_directory(const char* dirname);
+// Reentrant variant of open_directory, filling in the caller's dir
+dir_information* open_directory(const char* dirname, dir_information* dir);
 bool read_directory_first(dir_information* dirp, char* entry_name, bool& is_directory);
 bool read_directory_next(dir_information* dirp, char* entry_name, bool& is_directory);
 void close_directory(dir_information* dirp);
@@ -0,0 +1,96 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOSBOX_DECODE_AHEAD_H
+#define DOSBOX_DECODE_AHEAD_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "../src/libs/readerwriterqueue/readerwritercircularbuffer.h"
+
+/*
+Background decoding of audio streams
+------------------------------------
+Runs a decoder on a thread of its own, keeping a fixed number of chunks of
+decoded 16-bit frames ready. The consumer, typically a mixer callback, only
+copies frames out and never waits for the decoder.
+
+Chunks travel between the two threads through a pair of lock-free
+single-producer, single-consumer rings: decoded chunks go to the consumer,
+and emptied ones come back to be refilled, so nothing is allocated while
+playing.
+*/
+
+class DecodeAhead {
+public:
+	// Decodes up to frames into buffer, returning the number of frames
+	// decoded, or 0 at the end of the stream
+	using decode_f = std::function<uint32_t(int16_t *buffer, uint32_t frames)>;
+
+	// Starts decoding right away; chunk_frames * num_chunks frames are
+	// kept ready
+	DecodeAhead(decode_f decode, uint8_t channels, uint32_t chunk_frames,
+	            uint32_t num_chunks);
+	~DecodeAhead();
+
+	DecodeAhead(const DecodeAhead &) = delete;            // prevent copying
+	DecodeAhead &operator=(const DecodeAhead &) = delete; // prevent assignment
+
+	// Copies up to frames decoded frames into buffer, returning how many
+	// were available. Called from a single consumer thread.
+	uint32_t Read(int16_t *buffer, uint32_t frames);
+
+	// The stream ended and all of it was read
+	bool IsAtEnd() const;
+
+	// Reads left short because the decoder fell behind; waiting for the
+	// first chunk doesn't count
+	uint32_t GetUnderruns() const { return underruns; }
+
+private:
+	struct Chunk {
+		std::vector<int16_t> samples = {};
+		uint32_t frames = 0;
+	};
+
+	void Run();
+
+	decode_f decode;
+	const uint8_t channels;
+	std::vector<Chunk> chunks;
+	moodycamel::BlockingReaderWriterCircularBuffer<Chunk *> decoded;
+	moodycamel::BlockingReaderWriterCircularBuffer<Chunk *> emptied;
+
+	// Consumer side
+	Chunk *current = nullptr;
+	uint32_t read_pos = 0; // in frames, within current
+	bool started = false;
+	uint32_t underruns = 0;
+
+	std::atomic<bool> finished{false};
+	std::atomic<bool> stopping{false};
+	std::thread thread; // started last
+};
+
+#endif
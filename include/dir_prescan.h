@@ -0,0 +1,90 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOSBOX_DIR_PRESCAN_H
+#define DOSBOX_DIR_PRESCAN_H
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/*
+Background directory pre-scan
+-----------------------------
+Lists a host directory tree breadth-first on a thread of its own, so the
+drive cache can take a directory's entries from memory instead of reading
+the host directory when the guest first looks into it. The files are
+stat'ed along the way, so that their sizes and dates come from the host's
+caches when the guest lists them.
+
+Directory paths are host paths ending with the path separator, as the
+drive cache uses them. Each listing can be taken only once: afterwards the
+cache owns the directory, and keeps it up to date itself. A directory the
+cache claimed before the scan reached it is skipped, as the cache may have
+changed it since.
+*/
+
+class DirPrescan {
+public:
+	struct Entry {
+		std::string name;
+		bool is_dir;
+	};
+	using Listing = std::vector<Entry>;
+
+	// Limits keeping the scan of huge trees in check
+	static constexpr size_t max_entries = 200 * 1000;
+	static constexpr int max_depth = 16;
+
+	// Starts scanning below base_dir right away
+	explicit DirPrescan(const std::string &base_dir);
+	~DirPrescan();
+
+	DirPrescan(const DirPrescan &) = delete;            // prevent copying
+	DirPrescan &operator=(const DirPrescan &) = delete; // prevent assignment
+
+	// True if the listing of dir is waiting to be taken
+	bool Contains(const std::string &dir);
+
+	// Hands over the listing of dir, if it was scanned already, and
+	// claims the directory in any case.
+	bool Take(const std::string &dir, Listing &listing);
+
+	bool IsDone() const { return done; }
+	size_t GetScannedEntries() const { return scanned_entries; }
+
+private:
+	void Run(std::string base_dir);
+
+	std::mutex mutex = {};
+	std::unordered_map<std::string, Listing> listings = {};
+	std::unordered_set<std::string> claimed = {};
+
+	std::atomic<bool> stop{false};
+	std::atomic<bool> done{false};
+	std::atomic<size_t> scanned_entries{0};
+	std::thread thread; // started last
+};
+
+#endif
@@ -0,0 +1,101 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOSBOX_DISK_DELTA_H
+#define DOSBOX_DISK_DELTA_H
+
+#include "dosbox.h"
+
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+
+/*
+Copy-on-write delta for disk images
+-----------------------------------
+Keeps the sectors written to a disk image in a separate file, so the image
+itself is never modified and can be shared read-only, e.g. by several
+instances at once. Only modified sectors take space in the delta file.
+
+The file starts with a 32-byte header: the "DBXDELTA" magic, the format
+version and the sector size, both as little-endian 32-bit values, then the
+size and modification time of the base image file, both as little-endian
+64-bit values. A delta is refused for a base image that doesn't match
+them, as its sectors would land on top of the wrong data. The header is
+followed by records made of the little-endian 32-bit sector number and the
+sector data. A sector is appended on its first write and overwritten in
+place afterwards; the index of sector numbers to record offsets is rebuilt
+when the file is opened. The file is locked while open, so a second mount
+of the same delta file fails instead of corrupting it.
+*/
+
+class DiskDelta {
+public:
+	// Identifies the image file the delta applies to
+	struct BaseImage {
+		uint64_t size = 0;
+		int64_t mtime = 0;
+	};
+
+	// Opens the delta file at path, creating it for the base image if it
+	// doesn't exist yet. Check IsOpen() for success; GetError() then
+	// describes the problem.
+	DiskDelta(const std::string &path, uint32_t sector_size, const BaseImage &base);
+	~DiskDelta();
+
+	DiskDelta(const DiskDelta &) = delete;            // prevent copying
+	DiskDelta &operator=(const DiskDelta &) = delete; // prevent assignment
+
+	bool IsOpen() const { return file != nullptr; }
+	const std::string &GetError() const { return error; }
+
+	// Number of sectors held in the delta
+	size_t GetSectorCount() const { return index.size(); }
+
+	bool Contains(uint32_t sector) const { return index.count(sector) > 0; }
+
+	// One past the highest sector held, 0 for an empty delta
+	uint64_t GetSectorLimit() const { return sector_limit; }
+
+	// Reads the sector into data if the delta holds it, returns false
+	// (leaving data untouched) otherwise.
+	bool Read(uint32_t sector, void *data);
+
+	bool Write(uint32_t sector, const void *data);
+
+	// Hands the writes made so far to the host, so they survive a crash
+	bool Flush();
+
+	static constexpr uint32_t version = 2;
+	static constexpr int64_t header_size = 32;
+
+private:
+	bool Lock();
+	bool LoadIndex(const BaseImage &base);
+
+	FILE *file = nullptr;
+	std::string error = {};
+	std::unordered_map<uint32_t, int64_t> index = {}; // sector -> data offset
+	uint32_t sector_size = 0;
+	uint64_t sector_limit = 0;
+	int64_t end_pos = 0;
+};
+
+#endif
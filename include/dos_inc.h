@@ -111,6 +111,7 @@ enum { HAND_NONE=0,HAND_FILE,HAND_DEVICE};
 /* Routines for File Class */
 void DOS_SetupFiles (void);
 bool DOS_ReadFile(Bit16u handle,Bit8u * data,Bit16u * amount, bool fcb = false);
+bool DOS_ReadFileToMem(Bit16u handle, PhysPt pt, Bit16u *amount);
 bool DOS_WriteFile(Bit16u handle,Bit8u * data,Bit16u * amount,bool fcb = false);
 bool DOS_SeekFile(Bit16u handle,Bit32u * pos,Bit32u type,bool fcb = false);
 bool DOS_CloseFile(Bit16u handle,bool fcb = false,Bit8u * refcnt = NULL);
@@ -730,6 +731,7 @@ struct DOS_Block {
 	bool echo;          // if set to true dev_con::read will echo input 
 	bool direct_output;
 	bool internal_output;
+	bool file_read_ahead;
 	struct  {
 		RealPt mediaid;
 		RealPt tempdta;
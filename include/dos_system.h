@@ -21,11 +21,16 @@
 
 #include "dosbox.h"
 
+#include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
+#include "arena.h"
 #include "cross.h"
 #include "mem.h"
+#include "missing_path_cache.h"
+#include "read_ahead.h"
 #include "support.h"
 
 #define DOS_NAMELENGTH 12
@@ -140,6 +145,13 @@ private:
 	Bitu devnum;
 };
 
+// Shared by the handles of a host file while it's read ahead, so that
+// those reading ahead notice writes through the others
+struct HostFileWrites {
+	unsigned read_aheads = 0; // handles reading the file ahead
+	uint64_t count = 0;       // writes made meanwhile
+};
+
 class localFile : public DOS_File {
 public:
 	localFile(const char *name, FILE *handle, const char *basedir);
@@ -154,10 +166,19 @@ public:
 	void Flush();
 	void SetFlagReadOnlyMedium() { read_only_medium = true; }
 	const char *GetBaseDir() const { return basedir; }
+	void SetHostFileWrites(std::shared_ptr<HostFileWrites> writes);
+	void EnableReadAhead(const char *path, std::shared_ptr<ReadAheadWorker> worker);
 	FILE *fhandle = nullptr; // todo handle this properly
 private:
 	const char *basedir;
 	long stream_pos = 0;
+	// Reads go through read_ahead when set, at read_ahead_pos, and
+	// fhandle's position is only updated on seeks
+	std::unique_ptr<ReadAhead> read_ahead = {};
+	long read_ahead_pos = 0;
+	std::shared_ptr<HostFileWrites> host_writes = {};
+	uint64_t read_ahead_writes = 0; // host_writes->count when last read
+	void CountWrite();
 	bool ftell_and_check();
 	void fseek_and_check(int whence);
 	bool fseek_to_and_check(long pos, int whence);
@@ -171,6 +192,8 @@ private:
 #define MAX_OPENDIRS 2048
 //Can be high as it's only storage (16 bit variable)
 
+class DirPrescan;
+
 class DOS_Drive_Cache {
 public:
 	enum TDirSort { NOSORT, ALPHABETICAL, DIRALPHABETICAL, ALPHABETICALREV, DIRALPHABETICALREV };
@@ -200,13 +223,25 @@ public:
 	void  DeleteEntry          (const char* path, bool ignoreLastDir = false);
 	void  EmptyCache           (void);
 
+	// Lists the whole tree on a background thread, for the directories
+	// to be cached in without reading the host directory
+	void  StartPrescan         (void);
+
+	// Negative lookup cache: paths probed on the host and found missing.
+	// Forgotten whenever cached entries are added or removed, on rescan,
+	// or once the host directory changes; expanded is the path as found
+	// on the host.
+	bool  IsKnownMissing       (const char* path);
+	void  AddMissing           (const char* path, const char* expanded);
+
 	void SetLabel(const char *name, bool cdrom, bool allowupdate);
 	const char *GetLabel() const { return label; }
 
+	// Entries live in the arenas of their drive cache, see NewFileInfo
 	class CFileInfo {
 	public:
-		CFileInfo(void)
-		        : orgname{0},
+		CFileInfo(char *name)
+		        : orgname(name),
 		          shortname{0},
 		          isOverlayDir(false),
 		          isDir(false),
@@ -214,19 +249,11 @@ public:
 		          nextEntry(0),
 		          shortNr(0),
 		          fileList(0),
-		          longNameList(0)
+		          longNameList(0),
+		          nameIndex(nullptr)
 		{}
 
-		virtual ~CFileInfo()
-		{
-			for (auto p : fileList) {
-				delete p;
-			}
-			fileList.clear();
-			longNameList.clear();
-		}
-
-		char        orgname[CROSS_LEN];
+		char       *orgname;
 		char        shortname[DOS_NAMELENGTH_ASCII];
 		bool        isOverlayDir;
 		bool        isDir;
@@ -236,11 +263,23 @@ public:
 		// contents
 		std::vector<CFileInfo*> fileList;
 		std::vector<CFileInfo*> longNameList;
+
+		// Hashed lookups into fileList, only created for directories
+		struct NameIndex {
+			std::unordered_map<std::string, CFileInfo*> longNames;
+			std::unordered_map<std::string, CFileInfo*> wineNames;
+			bool wineNamesValid = false;
+		};
+		std::unique_ptr<NameIndex> nameIndex;
 	};
 
 private:
+	CFileInfo* NewFileInfo(Arena& arena, const char* name);
+	void FreeFileInfo(Arena& arena, CFileInfo* info, bool recycle);
 	void ClearFileInfo(CFileInfo *dir);
 	void DeleteFileInfo(CFileInfo *dir);
+	void DeleteSearch(Bit16u id);
+	void LogMemoryUsage(void);
 
 	bool		RemoveTrailingDot	(char* shortname);
 	Bits		GetLongName		(CFileInfo* info, char* shortname, const size_t shortname_len);
@@ -251,12 +290,19 @@ private:
 	bool		IsCachedIn		(CFileInfo* dir);
 	CFileInfo*	FindDirInfo		(const char* path, char* expandedPath);
 	bool		RemoveSpaces		(char* str);
+	CFileInfo::NameIndex& GetNameIndex	(CFileInfo* dir);
+	Bits		FindShortName		(CFileInfo* dir, const char* shortname);
+	CFileInfo*	FindWineName		(CFileInfo* dir, const char* shortname);
 	bool		OpenDir			(CFileInfo* dir, const char* path, Bit16u& id);
 	void		CreateEntry		(CFileInfo* dir, const char* name, bool is_directory);
 	void		CopyEntry		(CFileInfo* dir, CFileInfo* from);
 	Bit16u		GetFreeID		(CFileInfo* dir);
 	void		Clear			(void);
 
+	Arena		entries;	// the directory tree and its names
+	Arena		searches;	// copies used by FindFirst/FindNext
+	size_t		entryCount;
+
 	CFileInfo*	dirBase;
 	char		dirPath				[CROSS_LEN];
 	char		basePath			[CROSS_LEN];
@@ -272,6 +318,9 @@ private:
 
 	char		label				[CROSS_LEN];
 	bool		updatelabel;
+
+	MissingPathCache missingPaths;
+	std::unique_ptr<DirPrescan> prescan;
 };
 
 class DOS_Drive {
@@ -22,12 +22,14 @@
 #include "dosbox.h"
 
 #include <memory>
+#include <unordered_map>
 #include <unordered_set>
 #include <string>
 #include <vector>
 
 #include "dos_inc.h"
 #include "dos_system.h"
+#include "overlay_journal.h"
 
 bool WildFileCmp(const char * file, const char * wild);
 void Set_Label(char const * const input, char * const output, bool cdrom);
@@ -56,6 +58,7 @@ private:
 class localDrive : public DOS_Drive {
 public:
 	localDrive(const char * startdir,Bit16u _bytes_sector,Bit8u _sectors_cluster,Bit16u _total_clusters,Bit16u _free_clusters,Bit8u _mediaid);
+	~localDrive();
 	virtual bool FileOpen(DOS_File * * file,char * name,Bit32u flags);
 	virtual FILE *GetSystemFilePtr(char const * const name, char const * const type);
 	virtual bool GetSystemFilename(char* sysName, char const * const dosName);
@@ -86,6 +89,13 @@ protected:
 private:
 	bool IsFirstEncounter(const std::string& filename);
 	std::unordered_set<std::string> write_protected_files;
+
+	// Files read ahead share the drive's worker thread, and all handles
+	// of a host file share its write count while it's read ahead
+	std::shared_ptr<ReadAheadWorker> GetReadAheadWorker();
+	std::shared_ptr<HostFileWrites> GetHostFileWrites(const std::string &path);
+	std::shared_ptr<ReadAheadWorker> read_ahead_worker = {};
+	std::unordered_map<std::string, std::weak_ptr<HostFileWrites>> host_file_writes = {};
 	struct {
 		Bit16u bytes_sector;
 		Bit8u sectors_cluster;
@@ -153,9 +163,51 @@ struct partTable {
 #endif
 //Forward
 class imageDisk;
+/* Cluster chain of a file as runs of contiguous clusters, built on first use
+ * so that seeking does not have to follow the FAT from the first cluster.
+ * Clusters linked to or cut from the end of the chain are added or removed
+ * in place. */
+struct fatChainIndex {
+	struct Run {
+		Bit32u logical; // index of the first cluster of the run in the chain
+		Bit32u cluster; // first cluster of the run on disk
+		Bit32u count;
+	};
+	std::vector<Run> runs = {};
+	Bit32u firstCluster = 0;
+	Bit32u generation = 0;
+	bool valid = false;
+
+	Bit32u Length() const
+	{
+		return runs.empty() ? 0 : runs.back().logical + runs.back().count;
+	}
+	Bit32u LastCluster() const
+	{
+		return runs.back().cluster + runs.back().count - 1;
+	}
+	void Append(Bit32u cluster)
+	{
+		if (!runs.empty() && cluster == LastCluster() + 1)
+			runs.back().count++;
+		else
+			runs.push_back({Length(), cluster, 1});
+	}
+	void Truncate(Bit32u length)
+	{
+		while (!runs.empty() && runs.back().logical >= length)
+			runs.pop_back();
+		if (!runs.empty() && Length() > length)
+			runs.back().count = length - runs.back().logical;
+	}
+};
+
 class fatDrive : public DOS_Drive {
 public:
-	fatDrive(const char * sysFilename, Bit32u bytesector, Bit32u cylsector, Bit32u headscyl, Bit32u cylinders, Bit32u startSector);
+	fatDrive(const char * sysFilename, Bit32u bytesector, Bit32u cylsector, Bit32u headscyl, Bit32u cylinders, Bit32u startSector, const char * deltaFilename = nullptr);
+	/* Mounts an image that is already open, e.g. from detecting its
+	 * geometry, with any delta file attached */
+	fatDrive(std::unique_ptr<imageDisk> disk, const char * sysFilename, Bit32u bytesector, Bit32u cylsector, Bit32u headscyl, Bit32u cylinders, Bit32u startSector);
 	fatDrive(const fatDrive&) = delete; // prevent copying
 	fatDrive& operator= (const fatDrive&) = delete; // prevent assignment
 	virtual bool FileOpen(DOS_File * * file,char * name,Bit32u flags);
@@ -179,13 +231,15 @@ public:
 public:
 	Bit8u readSector(Bit32u sectnum, void * data);
 	Bit8u writeSector(Bit32u sectnum, void * data);
-	Bit32u getAbsoluteSectFromBytePos(Bit32u startClustNum, Bit32u bytePos);
+	Bit8u readSectors(Bit32u sectnum, Bit32u count, void * data);
+	Bit8u writeSectors(Bit32u sectnum, Bit32u count, void * data);
+	Bit32u getAbsoluteSectFromBytePos(Bit32u startClustNum, Bit32u bytePos, fatChainIndex *index = nullptr);
 	Bit32u getSectorSize(void);
 	Bit32u getClusterSize(void);
-	Bit32u getAbsoluteSectFromChain(Bit32u startClustNum, Bit32u logicalSector);
+	Bit32u getAbsoluteSectFromChain(Bit32u startClustNum, Bit32u logicalSector, fatChainIndex *index = nullptr);
 	bool allocateCluster(Bit32u useCluster, Bit32u prevCluster);
-	Bit32u appendCluster(Bit32u startCluster);
-	void deleteClustChain(Bit32u startCluster, Bit32u bytePos);
+	Bit32u appendCluster(Bit32u startCluster, fatChainIndex *index = nullptr);
+	void deleteClustChain(Bit32u startCluster, Bit32u bytePos, fatChainIndex *index = nullptr);
 	Bit32u getFirstFreeClust(void);
 	bool directoryBrowse(Bit32u dirClustNumber, direntry *useEntry, Bit32s entNum, Bit32s start=0);
 	bool directoryChange(Bit32u dirClustNumber, direntry *useEntry, Bit32s entNum);
@@ -195,6 +249,13 @@ private:
 	Bit32u getClusterValue(Bit32u clustNum);
 	void setClusterValue(Bit32u clustNum, Bit32u clustValue);
 	Bit32u getClustFirstSect(Bit32u clustNum);
+	bool isEndOfChain(Bit32u clustValue) const;
+	void buildChainIndex(Bit32u startClustNum, fatChainIndex &index);
+	bool extendChainIndex(fatChainIndex &index);
+	bool syncChainIndex(Bit32u startClustNum, fatChainIndex &index);
+	static std::unique_ptr<imageDisk> OpenImage(const char *sysFilename, const char *deltaFilename);
+	void loadFatCache(void);
+	void syncFatCache(void);
 	bool FindNextInternal(Bit32u dirClustNumber, DOS_DTA & dta, direntry *foundEntry);
 	bool getDirClustNum(char * dir, Bit32u * clustNum, bool parDir);
 	bool getFileDirEntry(char const * const filename, direntry * useEntry, Bit32u * dirClust, Bit32u * subEntry);
@@ -212,8 +273,21 @@ private:
 
 	Bit32u cwdDirCluster;
 
-	Bit8u fatSectBuffer[1024];
+	/* Two sectors, as FAT12 entries can straddle a sector boundary */
+	std::vector<Bit8u> fatSectBuffer;
 	Bit32u curFatSect;
+
+	/* Copy of the first FAT, written through on every change. Empty
+	 * if the FAT is too large to be kept in memory. */
+	std::vector<Bit8u> fatCache;
+	/* Number of disk writes the cached FAT data is known to be in sync with */
+	Bit32u knownDiskWrites;
+	/* Incremented on FAT changes chain indexes can't follow, i.e. freed
+	 * clusters and reloads; appended clusters are picked up by the
+	 * indexes themselves */
+	Bit32u fatGeneration;
+	/* No cluster below this one is free */
+	Bit32u freeClustHint;
 };
 
 class cdromDrive : public localDrive
@@ -316,7 +390,8 @@ struct isoDirEntry {
 
 class isoDrive : public DOS_Drive {
 public:
-	isoDrive(char driveLetter, const char* device_name, Bit8u mediaid, int &error);
+	isoDrive(char driveLetter, const char* device_name, Bit8u mediaid, int &error,
+	         bool preload = false);
 	~isoDrive();
 	virtual bool FileOpen(DOS_File **file, char *name, Bit32u flags);
 	virtual bool FileCreate(DOS_File **file, char *name, Bit16u attributes);
@@ -337,6 +412,7 @@ public:
 	virtual bool isRemovable(void);
 	virtual Bits UnMount(void);
 	bool readSector(Bit8u *buffer, Bit32u sector);
+	uint32_t readSectors(uint8_t *buffer, uint32_t sector, uint32_t count);
 	virtual const char *GetLabel() { return discLabel; }
 	virtual void Activate(void);
 private:
@@ -368,6 +444,7 @@ private:
 
 	bool iso;
 	bool dataCD;
+	bool preload; // the data tracks into memory, each time it's activated
 	isoDirEntry rootEntry;
 	Bit8u mediaid;
 	char fileName[CROSS_LEN];
@@ -443,9 +520,11 @@ private:
 	void remove_DOSdir_from_cache(const char* name);
 	void update_cache(bool read_directory_contents = false);
 
-	std::vector<std::string> deleted_files_in_base; //Set is probably better, or some other solution (involving the disk).
-	std::vector<std::string> deleted_paths_in_base; //Currently only used to hide the overlay folder.
+	std::unordered_set<std::string> deleted_files_in_base;
+	std::unordered_set<std::string> deleted_paths_in_base;
 	std::string overlap_folder;
+	std::unique_ptr<OverlayJournal> journal; //Persists the deletions made with create_on_disk
+	void record_in_journal(bool add, OverlayJournal::Kind kind, const char* name);
 	void add_deleted_file(const char* name, bool create_on_disk);
 	void remove_deleted_file(const char* name, bool create_on_disk);
 	bool is_deleted_file(const char* name);
@@ -456,14 +535,11 @@ private:
 
 	bool is_dir_only_in_overlay(const char* name); //cached
 
-
-	void remove_special_file_from_disk(const char* dosname, const char* operation);
-	void add_special_file_to_disk(const char* dosname, const char* operation);
-	std::string create_filename_of_special_operation(const char* dosname, const char* operation);
 	void convert_overlay_to_DOSname_in_base(char* dirname );
 	//For caching the update_cache routine.
 	std::vector<std::string> DOSnames_cache; //Also set is probably better.
 	std::vector<std::string> DOSdirs_cache; //Can not blindly change its type. it is important that subdirs come after the parent directory.
+	std::unordered_set<std::string> DOSdirs_lookup; //Same contents as DOSdirs_cache, for is_dir_only_in_overlay
 	const std::string special_prefix;
 };
 
@@ -0,0 +1,92 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOSBOX_FILE_PRELOADER_H
+#define DOSBOX_FILE_PRELOADER_H
+
+#include <atomic>
+#include <cstdio>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+/*
+File preloader
+--------------
+Loads the start of a read-only file into memory on a background thread,
+up to a size limit. Reads are served from memory as soon as the range they
+need is resident; until then the caller reads the file itself.
+
+The file is loaded front to back in chunks, so the resident part is always
+a prefix of the file and a single counter tells what can be served.
+*/
+
+class FilePreloader {
+public:
+	static constexpr uint32_t default_chunk = 1024 * 1024;
+
+	// Starts loading up to limit bytes of the file; check IsOpen() for
+	// success, which also needs the memory to be available
+	FilePreloader(const char *path, uint64_t limit,
+	              uint32_t chunk = default_chunk);
+	~FilePreloader();
+
+	FilePreloader(const FilePreloader &) = delete;            // prevent copying
+	FilePreloader &operator=(const FilePreloader &) = delete; // prevent assignment
+
+	bool IsOpen() const { return file != nullptr; }
+
+	// Copies the range into data if it's resident, returning false
+	// otherwise
+	bool Read(uint64_t offset, uint8_t *data, uint32_t size);
+
+	// Points at the range if it's resident, where it then stays for the
+	// preloader's lifetime; returns nullptr otherwise
+	const uint8_t *Lookup(uint64_t offset, uint32_t size);
+
+	// Bytes loaded so far, out of the number that will be. Safe to poll
+	// from any thread; loading ended early if it's finished short of the
+	// total.
+	uint64_t GetResident() const { return resident.load(std::memory_order_acquire); }
+	uint64_t GetTotal() const { return total; }
+	bool IsFinished() const { return finished.load(std::memory_order_acquire); }
+
+	// Reads served from memory, and those that weren't
+	uint64_t GetHits() const { return hits; }
+	uint64_t GetMisses() const { return misses; }
+
+private:
+	void Run();
+
+	FILE *file = nullptr;
+	std::unique_ptr<uint8_t[]> data = {}; // allocated up front, uninitialised
+	const uint32_t chunk_size;
+	uint64_t total = 0;
+	std::thread thread = {};
+
+	std::atomic<uint64_t> resident{0}; // publishes the loaded prefix
+	std::atomic<bool> stopping{false};
+	std::atomic<bool> finished{false};
+
+	uint64_t hits = 0;
+	uint64_t misses = 0;
+};
+
+#endif
@@ -0,0 +1,148 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOSBOX_FRAME_TRACE_H
+#define DOSBOX_FRAME_TRACE_H
+
+#include "dosbox.h"
+
+#include <array>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/*
+Frame pacing and latency tracing
+--------------------------------
+Records host timestamps at a few points of the video pipeline: the
+emulated vertical retrace, the start and end of the render update, the
+presentation of the frame on the host, and the arrival of keyboard and
+mouse events.
+
+The time between related points is aggregated into latency histograms,
+which are logged when tracing stops. The raw events can also be written
+either as CSV (one "event,timestamp_us" row per event) or, if the file
+name ends in ".json", in the Chrome trace event format that can be
+loaded into chrome://tracing or Perfetto.
+
+Tracing is disabled by default and costs a single branch per trace point.
+*/
+
+enum class FrameEvent : uint8_t {
+	VerticalRetrace,
+	RenderStart,
+	RenderEnd,
+	Present,
+	Input,
+};
+
+const char *to_string(FrameEvent event);
+
+// Histogram of durations in microseconds, using power-of-two buckets:
+// bucket 0 holds durations below 2 us, bucket n holds [2^n, 2^(n+1)) us.
+class LatencyHistogram {
+public:
+	static constexpr size_t num_buckets = 32;
+
+	void Add(int64_t duration_us);
+
+	uint64_t GetCount() const { return count; }
+	int64_t GetMin() const { return count ? min : 0; }
+	int64_t GetMax() const { return max; }
+	double GetMean() const;
+
+	// Returns the upper bound of the bucket containing the given
+	// percentile (0.0 to 100.0) of the recorded durations.
+	int64_t GetPercentile(double percentile) const;
+
+	const std::array<uint64_t, num_buckets> &GetBuckets() const
+	{
+		return buckets;
+	}
+
+private:
+	std::array<uint64_t, num_buckets> buckets = {};
+	uint64_t count = 0;
+	int64_t sum = 0;
+	int64_t min = 0;
+	int64_t max = 0;
+};
+
+class FrameTracer {
+public:
+	struct Sample {
+		int64_t timestamp_us;
+		FrameEvent event;
+	};
+
+	// Limits memory use of long sessions; events beyond this are still
+	// aggregated into the histograms, only the raw log stops growing.
+	static constexpr size_t max_samples = 1 << 20;
+
+	void Record(FrameEvent event, int64_t timestamp_us);
+
+	bool WriteCsv(FILE *file) const;
+	bool WriteChromeTrace(FILE *file) const;
+	void LogSummary() const;
+
+	const std::vector<Sample> &GetSamples() const { return samples; }
+
+	// Time between two consecutive vertical retraces
+	const LatencyHistogram &GetRetraceInterval() const { return retrace_interval; }
+	// Time between two consecutive presents
+	const LatencyHistogram &GetPresentInterval() const { return present_interval; }
+	// Time between a render update starting and ending
+	const LatencyHistogram &GetRenderTime() const { return render_time; }
+	// Time between a vertical retrace and the following present
+	const LatencyHistogram &GetFrameLatency() const { return frame_latency; }
+	// Time between the first unpresented input event and the next present
+	const LatencyHistogram &GetInputLatency() const { return input_latency; }
+
+private:
+	std::vector<Sample> samples = {};
+	LatencyHistogram retrace_interval = {};
+	LatencyHistogram present_interval = {};
+	LatencyHistogram render_time = {};
+	LatencyHistogram frame_latency = {};
+	LatencyHistogram input_latency = {};
+	int64_t last_retrace = -1;
+	int64_t last_present = -1;
+	int64_t render_start = -1;
+	int64_t pending_retrace = -1;
+	int64_t pending_input = -1;
+};
+
+extern bool frame_trace_enabled;
+
+// Starts tracing; an empty path only collects the histograms.
+void FRAMETRACE_Start(const std::string &path);
+
+// Stops tracing, logs the histograms and writes the trace file.
+void FRAMETRACE_Stop();
+
+void FRAMETRACE_Record(FrameEvent event);
+
+static inline void FRAMETRACE_Mark(FrameEvent event)
+{
+	if (GCC_UNLIKELY(frame_trace_enabled))
+		FRAMETRACE_Record(event);
+}
+
+#endif
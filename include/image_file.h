@@ -0,0 +1,67 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOSBOX_IMAGE_FILE_H
+#define DOSBOX_IMAGE_FILE_H
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+/*
+Raw image file
+--------------
+Reads a raw CD image, such as a BIN file, holding both data and audio
+tracks. Data sectors are read on the emulation thread while an audio track
+of the same file may be decoding on a thread of its own, so each side reads
+through a stream of its own and neither moves the other's position. The
+audio stream is opened when audio is first read.
+*/
+
+class ImageFile {
+public:
+	explicit ImageFile(const std::string &path);
+
+	ImageFile(const ImageFile &) = delete;            // prevent copying
+	ImageFile &operator=(const ImageFile &) = delete; // prevent assignment
+
+	bool IsOpen() const { return size >= 0; }
+
+	// Size of the file in bytes, or -1 if it couldn't be opened
+	int64_t GetSize() const { return size; }
+
+	// Reads bytes at offset for data sectors, returning false unless all
+	// of them were read
+	bool Read(uint8_t *buffer, uint64_t offset, uint32_t bytes);
+
+	// Reads bytes at offset for audio playback, returning the number
+	// read, which is short at the end of the file
+	uint32_t ReadAudio(uint8_t *buffer, uint64_t offset, uint32_t bytes);
+
+private:
+	static bool Seek(std::ifstream &stream, uint64_t offset);
+
+	const std::string path;
+	std::ifstream data_stream;
+	std::ifstream audio_stream = {};
+	int64_t size = -1;
+};
+
+#endif
@@ -129,6 +129,12 @@ static inline uint32_t phys_readd(PhysPt addr)
 void MEM_BlockWrite(PhysPt pt, const void *data, Bitu size);
 void MEM_BlockRead(PhysPt pt, void *data, Bitu size);
 void MEM_BlockCopy(PhysPt dest, PhysPt src, Bitu size);
+
+// Returns the host address of the guest memory at pt when it can be written
+// directly, shortening size to the span that is contiguous on the host.
+// Returns nullptr for spans needing their page handlers (ROM, MMIO, pages
+// holding dynamic code or not mapped yet), which go through MEM_BlockWrite.
+HostPt MEM_GetBlockWritePt(PhysPt pt, Bitu *size);
 void MEM_StrCopy(PhysPt pt, char *data, Bitu size);
 
 void mem_memcpy(PhysPt dest, PhysPt src, Bitu size);
@@ -0,0 +1,77 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOSBOX_MISSING_PATH_CACHE_H
+#define DOSBOX_MISSING_PATH_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+/*
+Missing path cache
+------------------
+Remembers paths that were probed on the host and found missing, grouped by
+the directory they are in. Each group keeps the modification time of its
+host directory from when the paths were added; once the directory changes,
+for example because another program created a file in it, the group is
+forgotten and the paths get probed again.
+
+Modification times only have a resolution of a second on many filesystems,
+so nothing is remembered for a directory changed within the last few
+seconds: a file created in the same second would go unnoticed otherwise.
+*/
+
+class MissingPathCache {
+public:
+	// Limits the number of paths remembered
+	static constexpr size_t max_paths = 4096;
+
+	// Seconds a directory has to be left unchanged before missing paths
+	// in it get remembered
+	static constexpr int64_t settle_time = 2;
+
+	// Whether the path was found missing, and its directory on the host
+	// hasn't changed since
+	bool Contains(const std::string &path);
+
+	// Remembers the path as missing; host_path is the same path after
+	// mapping it to the names on the host
+	void Add(const std::string &path, const std::string &host_path);
+
+	void Clear();
+
+	bool IsEmpty() const { return num_paths == 0; }
+	size_t GetSize() const { return num_paths; }
+
+private:
+	struct Directory {
+		std::string host_dir;
+		int64_t stamp;
+		std::unordered_set<std::string> names;
+	};
+
+	std::unordered_map<std::string, Directory> directories = {};
+	size_t num_paths = 0;
+};
+
+#endif
@@ -0,0 +1,100 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOSBOX_OVERLAY_JOURNAL_H
+#define DOSBOX_OVERLAY_JOURNAL_H
+
+#include <cstdio>
+#include <string>
+#include <unordered_set>
+
+/*
+Metadata journal for overlay drives
+-----------------------------------
+Remembers the files and directories of the base drive that were deleted
+through an overlay, in a single text file kept in the overlay directory.
+Each change appends one line: "+DEL NAME" or "-DEL NAME" for files, and
+"+RMD NAME" or "-RMD NAME" for directories, NAME being the DOS path. The
+first line identifies the format.
+
+The journal is replayed when opened. Once most of its lines are outdated,
+it is rewritten with only the current entries, into a new file that then
+replaces the old one. A line cut short by a crash is ignored.
+*/
+
+class OverlayJournal {
+public:
+	enum class Kind { File, Dir };
+
+	// Replays the journal at path if it exists. The file is only created
+	// once something is written. Check GetError() for problems.
+	explicit OverlayJournal(const std::string &path);
+	~OverlayJournal();
+
+	OverlayJournal(const OverlayJournal &) = delete; // prevent copying
+	OverlayJournal &operator=(const OverlayJournal &) = delete; // prevent assignment
+
+	const std::string &GetError() const { return error; }
+
+	const std::unordered_set<std::string> &GetFiles() const { return files; }
+	const std::unordered_set<std::string> &GetDirs() const { return dirs; }
+
+	bool Contains(Kind kind, const std::string &name) const
+	{
+		return Entries(kind).count(name) > 0;
+	}
+
+	// Record a change, returning false if it couldn't be written
+	bool Add(Kind kind, const std::string &name);
+	bool Remove(Kind kind, const std::string &name);
+
+	// Rewrites the journal with only the current entries
+	bool Compact();
+
+	// Lines in the journal, outdated ones included
+	size_t GetRecordCount() const { return records; }
+
+	static constexpr size_t min_compact_records = 256;
+
+private:
+	const std::unordered_set<std::string> &Entries(Kind kind) const
+	{
+		return kind == Kind::File ? files : dirs;
+	}
+	std::unordered_set<std::string> &Entries(Kind kind)
+	{
+		return kind == Kind::File ? files : dirs;
+	}
+
+	void Load();
+	bool Append(char sign, Kind kind, const std::string &name);
+	bool Open();
+
+	std::string path;
+	std::string error = {};
+	FILE *file = nullptr; // opened for appending on the first change
+	std::unordered_set<std::string> files = {};
+	std::unordered_set<std::string> dirs = {};
+	size_t records = 0;
+	bool torn = false;    // the last line was cut short
+	bool foreign = false; // the file isn't a journal
+};
+
+#endif
@@ -0,0 +1,136 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOSBOX_READ_AHEAD_H
+#define DOSBOX_READ_AHEAD_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+Asynchronous read-ahead for host files
+--------------------------------------
+Serves reads of a file from a window of its data kept in memory. Once the
+reads are sequential, the window following the current one is fetched by
+a background I/O thread, so a program streaming a file finds the next
+data ready instead of waiting for the host disk. The thread is a
+ReadAheadWorker shared by the files of one owner, such as a drive, which
+shuts it down when done; files still open then read synchronously.
+
+The file is read through a handle of its own, which makes this suitable
+for files opened read-only: changes made through other handles are only
+seen after Invalidate().
+*/
+
+class ReadAhead;
+
+class ReadAheadWorker {
+public:
+	ReadAheadWorker();
+	~ReadAheadWorker();
+
+	ReadAheadWorker(const ReadAheadWorker &) = delete; // prevent copying
+	ReadAheadWorker &operator=(const ReadAheadWorker &) = delete; // prevent assignment
+
+	// Finishes the read in flight and stops the thread
+	void Shutdown();
+
+private:
+	friend class ReadAhead;
+
+	bool Schedule(ReadAhead *file);
+	void Unschedule(ReadAhead *file);
+	void Run();
+
+	std::mutex mutex = {};
+	std::condition_variable work_available = {};
+	std::condition_variable work_done = {};
+	std::deque<ReadAhead *> queue = {};
+	bool quit = false;
+	std::thread thread; // started last
+};
+
+class ReadAhead {
+public:
+	static constexpr size_t default_window = 64 * 1024;
+
+	// Opens the file for reading, to be read ahead by the worker; check
+	// IsOpen() for success
+	ReadAhead(const char *path, std::shared_ptr<ReadAheadWorker> worker,
+	          size_t window = default_window);
+	~ReadAhead();
+
+	ReadAhead(const ReadAhead &) = delete;            // prevent copying
+	ReadAhead &operator=(const ReadAhead &) = delete; // prevent assignment
+
+	bool IsOpen() const { return file != nullptr; }
+
+	// Reads up to size bytes at offset, returning the number of bytes
+	// read, which is short only at the end of the file or on errors.
+	size_t Read(uint64_t offset, uint8_t *data, size_t size);
+
+	// Drops the buffered data, e.g. after the file was written to
+	void Invalidate();
+
+	// Reads served from memory, and those that had to wait for the host
+	uint64_t GetHits() const { return hits; }
+	uint64_t GetMisses() const { return misses; }
+	uint64_t GetPrefetches() const { return prefetches; }
+
+private:
+	friend class ReadAheadWorker;
+
+	struct Window {
+		std::vector<uint8_t> data = {};
+		uint64_t offset = 0;
+		size_t length = 0;
+
+		bool Contains(uint64_t pos) const
+		{
+			return pos >= offset && pos - offset < length;
+		}
+	};
+
+	size_t ReadFile(uint64_t offset, uint8_t *data, size_t size);
+	void Cancel(std::unique_lock<std::mutex> &lock); // of the worker
+
+	std::shared_ptr<ReadAheadWorker> worker;
+	FILE *file = nullptr;
+	size_t window_size;
+
+	// Guarded by the worker's mutex
+	Window current = {};
+	Window pending = {};   // filled by the worker
+	bool queued = false;   // waiting for the worker
+	bool in_flight = false; // being read by the worker
+
+	uint64_t next_offset = 0; // where a sequential read would continue
+	uint64_t hits = 0;
+	uint64_t misses = 0;
+	uint64_t prefetches = 0;
+};
+
+#endif
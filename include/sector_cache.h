@@ -0,0 +1,97 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOSBOX_SECTOR_CACHE_H
+#define DOSBOX_SECTOR_CACHE_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+/*
+Sector cache
+------------
+Keeps the most recently used sectors of a read-only medium in memory, up
+to a fixed number of them; the least recently used sector makes room for
+a new one once the cache is full. The storage is allocated up front.
+
+Only short reads that don't carry on from the previous one are worth
+caching: those are the directory and index lookups programs repeat, while
+longer and sequential reads stream data that would push them out.
+*/
+
+class SectorCache {
+public:
+	// A capacity of 0 disables the cache
+	SectorCache(uint32_t capacity, uint32_t sector_size);
+
+	SectorCache(const SectorCache &) = delete;            // prevent copying
+	SectorCache &operator=(const SectorCache &) = delete; // prevent assignment
+
+	uint32_t GetCapacity() const { return capacity; }
+	uint32_t GetSectorSize() const { return sector_size; }
+
+	bool Contains(uint32_t sector) const { return index.count(sector) > 0; }
+
+	// Copies the sector into data if cached, returning false otherwise
+	bool Read(uint32_t sector, uint8_t *data);
+
+	// Caches the sector's data, replacing the least recently used sector
+	// when full
+	void Write(uint32_t sector, const uint8_t *data);
+
+	// Notes a read of num sectors from the medium, returning whether they
+	// should be cached
+	bool Admits(uint32_t sector, uint32_t num);
+
+	// Reads of more sectors than this aren't cached
+	static constexpr uint32_t max_admitted_sectors = 4;
+
+	void Clear();
+
+	uint64_t GetHits() const { return hits; }
+	uint64_t GetMisses() const { return misses; }
+
+private:
+	static constexpr uint32_t none = UINT32_MAX;
+
+	struct Slot {
+		uint32_t sector = 0;
+		uint32_t prev = none; // more recently used
+		uint32_t next = none; // less recently used
+	};
+
+	void Unlink(uint32_t slot);
+	void PushFront(uint32_t slot);
+
+	const uint32_t capacity;
+	const uint32_t sector_size;
+	std::vector<uint8_t> data;
+	std::vector<Slot> slots;
+	std::unordered_map<uint32_t, uint32_t> index = {}; // sector -> slot
+	uint32_t used = 0;
+	uint32_t head = none; // most recently used
+	uint32_t tail = none; // least recently used
+	uint32_t next_sector = none; // following the previous read
+	uint64_t hits = 0;
+	uint64_t misses = 0;
+};
+
+#endif
@@ -0,0 +1,121 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOSBOX_THREADED_SYNTH_H
+#define DOSBOX_THREADED_SYNTH_H
+
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include "../src/libs/readerwriterqueue/readerwritercircularbuffer.h"
+
+/*
+Threaded sound chip rendering
+-----------------------------
+Moves the rendering of a sound chip off the emulation thread. Register
+writes are queued along with their position within the current emulated
+tick. At the end of each tick, the tick's writes and its number of frames
+go to a worker thread, which renders the frames and applies each write at
+its position among them.
+
+Meanwhile the emulation reads back the frames rendered for earlier ticks:
+the output runs a fixed latency behind, which starts out as silence, so it
+only waits for the worker if that falls behind by more than the latency.
+
+Jobs travel between the threads through a pair of lock-free rings, and
+the rendered frames through a ring sized for the latency plus the longest
+tick rendered in one go, so nothing is allocated while running.
+*/
+
+class ThreadedSynth {
+public:
+	// Applies a register write to the chip
+	using write_f = std::function<void(uint16_t reg, uint8_t val)>;
+
+	// Renders frames of interleaved stereo samples into buffer
+	using render_f = std::function<void(int16_t *buffer, uint32_t frames)>;
+
+	// Both callbacks are only called from the worker thread
+	ThreadedSynth(write_f write, render_f render, uint32_t latency_frames,
+	              uint32_t max_tick_frames);
+	~ThreadedSynth();
+
+	ThreadedSynth(const ThreadedSynth &) = delete;            // prevent copying
+	ThreadedSynth &operator=(const ThreadedSynth &) = delete; // prevent assignment
+
+	// Queues a write at the given position within the current tick,
+	// from 0 for its start to 1 for its end
+	void Write(float tick_index, uint16_t reg, uint8_t val);
+
+	// Ends the current tick, spanning the given number of frames, and
+	// copies as many frames of output into buffer. Ticks longer than
+	// max_tick_frames are rendered in parts.
+	void EndTick(uint32_t frames, int16_t *buffer);
+
+	// Ticks that had to wait for the worker
+	uint32_t GetWaits() const { return waits; }
+
+private:
+	struct RegWrite {
+		float index = 0.0f;
+		uint16_t reg = 0;
+		uint8_t val = 0;
+	};
+
+	// A tick, or the part of one starting at its start frame
+	struct Job {
+		std::vector<RegWrite> writes = {};
+		uint32_t tick_frames = 0;
+		uint32_t start = 0;
+		uint32_t frames = 0;
+	};
+
+	bool Submit(Job *job, int16_t *buffer);
+	void Run();
+	void Render(const Job &job);
+	void RenderFrames(uint32_t frames);
+	Job *TakeFreeJob();
+
+	write_f write;
+	render_f render;
+	const uint32_t max_tick_frames;
+	const uint32_t ring_frames;
+	std::vector<int16_t> ring;
+	std::vector<Job> jobs;
+	moodycamel::BlockingReaderWriterCircularBuffer<Job *> pending;
+	moodycamel::BlockingReaderWriterCircularBuffer<Job *> rendered;
+
+	// Emulation side
+	std::vector<Job *> free_jobs = {};
+	Job *current = nullptr;
+	uint32_t silence_left = 0;
+	uint32_t available = 0; // rendered frames not read yet
+	uint32_t read_pos = 0;
+	uint32_t waits = 0;
+
+	// Worker side
+	uint32_t write_pos = 0;
+
+	std::thread thread; // started last
+};
+
+#endif
@@ -162,6 +162,14 @@ typedef struct {
 		Bit8u enabled;
 	} cursor;
 	Drawmode mode;
+	struct {
+		bool active;       // frames are drawn in a single pass
+		bool raster_write; // display registers written during active display
+		bool frame_pending; // a whole-frame draw is scheduled for this frame
+		Bitu clean_frames; // consecutive frames without raster writes
+		Bitu frames_whole;
+		Bitu frames_per_line;
+	} whole_frame;
 	bool vret_triggered;
 	bool vga_override;
 } VGA_Draw;
@@ -454,6 +462,7 @@ void VGA_SetCGA2Table(Bit8u val0,Bit8u val1);
 void VGA_SetCGA4Table(Bit8u val0,Bit8u val1,Bit8u val2,Bit8u val3);
 void VGA_ActivateHardwareCursor(void);
 void VGA_KillDrawing(void);
+void VGA_NoteDisplayRegisterWrite(void);
 
 void VGA_SetOverride(bool vga_override);
 
@@ -525,6 +534,7 @@ extern Bit32u CGA_4_Table[256];
 extern Bit32u CGA_4_HiRes_Table[256];
 extern Bit32u CGA_16_Table[256];
 extern Bit32u TXT_Font_Table[16];
+extern Bit64u TXT_Font_Table16[16];
 extern Bit32u TXT_FG_Table[16];
 extern Bit32u TXT_BG_Table[16];
 extern Bit32u Expand16Table[4][16];
@@ -0,0 +1,80 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOSBOX_WORK_QUEUE_H
+#define DOSBOX_WORK_QUEUE_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+/*
+Background work queue
+---------------------
+Runs jobs one after the other, in the order they were added, on a single
+worker thread. However many jobs get queued at once, such as a scan for
+each track of a CD image, only one of them runs at a time.
+
+The worker is started with the first job. Jobs still waiting when the
+queue is destroyed are dropped, and a running one is waited for.
+*/
+
+class WorkQueue {
+public:
+	using job_f = std::function<void()>;
+	using Id = uint64_t;
+
+	WorkQueue() = default;
+	~WorkQueue();
+
+	WorkQueue(const WorkQueue &) = delete;            // prevent copying
+	WorkQueue &operator=(const WorkQueue &) = delete; // prevent assignment
+
+	// Queues the job, returning an id for Remove; never 0
+	Id Add(job_f job);
+
+	// Drops the job if it hasn't started, or waits for it to finish if
+	// it's running. Jobs wanting to stop early have to be told so before.
+	void Remove(Id id);
+
+	// Number of jobs waiting to run
+	size_t GetQueued();
+
+private:
+	struct Job {
+		Id id;
+		job_f run;
+	};
+
+	void Run();
+
+	std::mutex mutex = {};
+	std::condition_variable changed = {};
+	std::deque<Job> jobs = {};
+	Id last_id = 0;
+	Id running = 0;
+	bool stop = false;
+	std::thread thread = {};
+};
+
+#endif
@@ -24,6 +24,7 @@
 
 #include "dosbox.h"
 
+#include <atomic>
 #include <cstring>
 #include <fstream>
 #include <iostream>
@@ -31,14 +32,20 @@
 #include <memory>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include <SDL.h>
 #include <SDL_thread.h>
 
 #include "support.h"
+#include "decode_ahead.h"
+#include "file_preloader.h"
+#include "image_file.h"
 #include "mem.h"
 #include "mixer.h"
+#include "sector_cache.h"
+#include "work_queue.h"
 #include "../libs/decoders/SDL_sound.h"
 
 // CDROM data and audio format constants
@@ -159,6 +166,12 @@ private:
 		virtual Bit8u    getChannels() = 0;
 		virtual int      getLength() = 0;
 		virtual void setAudioPosition(uint32_t pos) = 0;
+		// Points at the bytes when they're already in memory
+		virtual const uint8_t *residentData(MAYBE_UNUSED const uint32_t offset,
+		                                    MAYBE_UNUSED const uint32_t bytes)
+		{
+			return nullptr;
+		}
 		const Bit16u chunkSize = 0;
 	};
 
@@ -182,8 +195,21 @@ private:
 		int             getLength();
 		void setAudioPosition(uint32_t pos) { audio_pos = pos; }
 
+		// Starts loading up to limit bytes of the file into memory,
+		// returning the number that will be loaded
+		uint64_t        preload(uint64_t limit);
+		bool            isPreloading() const { return preloader != nullptr; }
+		const uint8_t  *residentData(const uint32_t offset, const uint32_t bytes);
+
+		// Logs how far preloading has got, from the emulation thread;
+		// returns true once it has ended and been reported
+		bool            reportPreloadProgress();
+
 	private:
-		std::ifstream   *file;
+		ImageFile       file;
+		std::string     filename;
+		std::unique_ptr<FilePreloader> preloader = nullptr;
+		unsigned        preloadReported = 0; // quarters of the load
 	};
 
 	class AudioFile : public TrackFile {
@@ -208,7 +234,16 @@ private:
 		// areas of this class.
 		void setAudioPosition(MAYBE_UNUSED uint32_t pos) {}
 	private:
+		void startSeekPointScan(const char *filename);
+		void useScannedSeekPoints();
+
 		Sound_Sample *sample = nullptr;
+
+		// Seek points for the codec, listed in the background
+		WorkQueue::Id seek_point_scan = 0;
+		std::atomic<bool> seek_points_ready = {false};
+		SDL_atomic_t cancel_seek_point_scan = {};
+		std::vector<Sound_SeekPoint> seek_points = {};
 	};
 
 public:
@@ -242,7 +277,9 @@ public:
 	bool	ReadSectors             (PhysPt buffer, const bool raw, const uint32_t sector, const uint16_t num);
 	bool	LoadUnloadMedia         (bool unload);
 	bool	ReadSector              (uint8_t *buffer, const bool raw, const uint32_t sector);
+	uint32_t ReadSectorsHost        (uint8_t *buffer, const bool raw, const uint32_t sector, const uint32_t num);
 	bool	HasDataTrack            (void);
+	void	PreloadDataTracks       (void);
 	static CDROM_Interface_Image* images[26];
 
 private:
@@ -250,6 +287,7 @@ private:
 		// Objects, pointers, and then scalars; in descending size-order.
 		MixerObject              mixerChannel       = {};
 		std::weak_ptr<TrackFile> trackFile          = {};
+		std::unique_ptr<DecodeAhead> decoder        = nullptr;
 		SDL_mutex                *mutex             = nullptr;
 		MixerChannel             *channel           = nullptr;
 		CDROM_Interface_Image    *cd                = nullptr;
@@ -269,7 +307,13 @@ private:
 	                 const uint16_t sectorSize,
 	                 const bool mode2);
 	std::vector<Track>::iterator GetTrack(const uint32_t sector);
+	uint32_t ReadTrackSectors(uint8_t *buffer,
+	                          const bool raw,
+	                          const uint32_t sector,
+	                          uint32_t num);
 	static void CDAudioCallBack (Bitu desired_frames);
+	static void StopDecoder     (void);
+	static void ReportPreloading(void);
 
 	// Private functions for cue sheet processing
 	bool  LoadCueSheet(char *cuefile);
@@ -285,8 +329,13 @@ private:
 	// member variables
 	std::vector<Track>   tracks;
 	std::vector<uint8_t> readBuffer;
+	std::vector<uint8_t> trackReadBuffer;
+	SectorCache          sectorCache;
 	std::string          mcn;
 	static int           refCount;
+
+	// Files still being preloaded, polled on each tick to report progress
+	static std::vector<BinaryFile *> preloadingFiles;
 };
 
 #endif
@@ -23,6 +23,7 @@
 
 #include "cdrom.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cctype>
 #include <chrono>
@@ -46,6 +47,8 @@
 #include "setup.h"
 #include "string_utils.h"
 #include "support.h"
+#include "timer.h"
+#include "../libs/decoders/seek_point_table.h"
 
 using namespace std;
 
@@ -58,6 +61,9 @@ using track_iter       = vector<CDROM_Interface_Image::Track>::iterator;
 using track_const_iter = vector<CDROM_Interface_Image::Track>::const_iterator;
 using tracks_size_t    = vector<CDROM_Interface_Image::Track>::size_type;
 
+// Seek point scans of the audio tracks of all images, run one at a time
+static WorkQueue seek_point_scans;
+
 // Report bad seeks that would go beyond the end of the track
 bool CDROM_Interface_Image::TrackFile::offsetInsideTrack(const uint32_t offset)
 {
@@ -97,21 +103,30 @@ uint32_t CDROM_Interface_Image::TrackFile::adjustOverRead(const uint32_t offset,
 
 CDROM_Interface_Image::BinaryFile::BinaryFile(const char *filename, bool &error)
         : TrackFile(BYTES_PER_RAW_REDBOOK_FRAME),
-          file(nullptr)
+          file(filename),
+          filename(filename)
 {
-	file = new ifstream(filename, ios::in | ios::binary);
-	// If new fails, an exception is generated and scope leaves this constructor
-	error = file->fail();
+	error = !file.IsOpen();
+	if (error)
+		return;
+
+	// Taken once, as the data and audio reads ask for it from different
+	// threads
+	length_redbook_bytes = static_cast<int>(file.GetSize());
+	assertm(length_redbook_bytes >= 0, "Track length could not be determined");
+	assertm(static_cast<uint32_t>(length_redbook_bytes) <= MAX_REDBOOK_BYTES,
+	        "Track length exceeds the maximum CDROM size");
+#ifdef DEBUG
+	LOG_MSG("CDROM: Length of image is %d bytes", length_redbook_bytes);
+#endif
 }
 
 CDROM_Interface_Image::BinaryFile::~BinaryFile()
 {
-	// Guard: only cleanup if needed
-	if (file == nullptr)
-		return;
-
-	delete file;
-	file = nullptr;
+	auto &files = preloadingFiles;
+	files.erase(std::remove(files.begin(), files.end(), this), files.end());
+	if (preloader && files.empty())
+		TIMER_DelTickHandler(&CDROM_Interface_Image::ReportPreloading);
 }
 
 bool CDROM_Interface_Image::BinaryFile::read(uint8_t *buffer,
@@ -119,7 +134,7 @@ bool CDROM_Interface_Image::BinaryFile::read(uint8_t *buffer,
                                              const uint32_t requested_bytes)
 {
 	// Check for logic bugs and illegal values
-	assertm(file && buffer, "The file and/or buffer pointer is invalid");
+	assertm(buffer, "The buffer pointer is invalid");
 	assertm(offset <= MAX_REDBOOK_BYTES, "Requested offset exceeds CDROM size");
 	assertm(requested_bytes <= MAX_REDBOOK_BYTES, "Requested bytes exceeds CDROM size");
 
@@ -127,34 +142,71 @@ bool CDROM_Interface_Image::BinaryFile::read(uint8_t *buffer,
 	if (adjusted_bytes == 0) // no work to do!
 		return true;
 
-	// Reposition if needed
-	if (!seek(offset))
-		return false;
+	// Serve it from memory if that part of the image is already loaded
+	if (preloader && preloader->Read(offset, buffer, adjusted_bytes))
+		return true;
 
-	file->read((char *)buffer, adjusted_bytes);
-	return !file->fail();
+	return file.Read(buffer, offset, adjusted_bytes);
 }
 
-int CDROM_Interface_Image::BinaryFile::getLength()
+uint64_t CDROM_Interface_Image::BinaryFile::preload(const uint64_t limit)
 {
-	// Return our cached result if we've already been asked before
-	if (length_redbook_bytes < 0 && file) {
-		file->seekg(0, ios::end);
-		/**
-		 *  All read(..) operations involve an absolute position and
-		 *  this function isn't called in other threads, therefore
-		 *  we don't need to restore the original file position.
-		 */
-		length_redbook_bytes = static_cast<int>(file->tellg());
+	if (preloader || !limit)
+		return 0;
+
+	preloader = std::make_unique<FilePreloader>(filename.c_str(), limit);
+	if (!preloader->IsOpen()) {
+		LOG_MSG("CDROM: Could not preload %s", filename.c_str());
+		preloader.reset();
+		return 0;
+	}
 
-		assertm(length_redbook_bytes >= 0,
-		        "Track length could not be determined");
-		assertm(static_cast<uint32_t>(length_redbook_bytes) <= MAX_REDBOOK_BYTES,
-		        "Track length exceeds the maximum CDROM size");
-#ifdef DEBUG
-		LOG_MSG("CDROM: Length of image is %d bytes", length_redbook_bytes);
-#endif
+	// The loading thread only publishes its progress; it's logged from
+	// the emulation thread's ticks
+	if (preloadingFiles.empty())
+		TIMER_AddTickHandler(&CDROM_Interface_Image::ReportPreloading);
+	preloadingFiles.push_back(this);
+	return preloader->GetTotal();
+}
+
+bool CDROM_Interface_Image::BinaryFile::reportPreloadProgress()
+{
+	if (!preloader)
+		return true;
+
+	// Read finished first, so the resident count is final once it's set
+	const bool finished = preloader->IsFinished();
+	const uint64_t done = preloader->GetResident();
+	const uint64_t total = preloader->GetTotal();
+	if (finished && done < total) {
+		LOG_MSG("CDROM: Preloading %s stopped at %u MB",
+		        filename.c_str(), static_cast<unsigned>(done >> 20));
+		return true;
+	}
+	if (finished) {
+		LOG_MSG("CDROM: Preloaded %u MB of %s into memory",
+		        static_cast<unsigned>(total >> 20), filename.c_str());
+		return true;
+	}
+
+	// Report every quarter of the way
+	const auto quarter = static_cast<unsigned>(done * 4 / total);
+	if (quarter > preloadReported) {
+		preloadReported = quarter;
+		LOG_MSG("CDROM: Preloading %s, %u%% done", filename.c_str(),
+		        quarter * 25);
 	}
+	return false;
+}
+
+const uint8_t *CDROM_Interface_Image::BinaryFile::residentData(const uint32_t offset,
+                                                               const uint32_t bytes)
+{
+	return preloader ? preloader->Lookup(offset, bytes) : nullptr;
+}
+
+int CDROM_Interface_Image::BinaryFile::getLength()
+{
 	return length_redbook_bytes;
 }
 
@@ -167,48 +219,31 @@ Bit16u CDROM_Interface_Image::BinaryFile::getEndian()
 bool CDROM_Interface_Image::BinaryFile::seek(const uint32_t offset)
 {
 	// Check for logic bugs and illegal values
-	assertm(file, "The file pointer needs to be valid, but is the nullptr");
 	assertm(offset <= MAX_REDBOOK_BYTES, "Requested offset exceeds CDROM size");
 
-	if (!offsetInsideTrack(offset))
-		return false;
-
-	if (static_cast<uint32_t>(file->tellg()) == offset)
-		return true;
-
-	file->seekg(offset, ios::beg);
-
-	// If the first seek attempt failed, then try harder
-	if (file->fail()) {
-		file->clear();                 // clear fail and eof bits
-		file->seekg(0, std::ios::beg); // "I have returned."
-		file->seekg(offset, ios::beg); // "It will be done."
-	}
-	return !file->fail();
+	// Reads give their own offset, so only its validity matters here
+	return offsetInsideTrack(offset);
 }
 
 uint32_t CDROM_Interface_Image::BinaryFile::decode(int16_t *buffer,
                                                    const uint32_t desired_track_frames)
 {
 	// Guard against logic bugs and illegal values
-	assertm(buffer && file, "The file pointer or buffer are invalid");
+	assertm(buffer, "The buffer pointer is invalid");
 	assertm(desired_track_frames <= MAX_REDBOOK_FRAMES,
 	        "Requested number of frames exceeds the maximum for a CDROM");
 	assertm(audio_pos < MAX_REDBOOK_BYTES,
 	        "Tried to decode audio before the playback position was set");
 
-	// Reposition against our last audio position if needed
-	if (static_cast<uint32_t>(file->tellg()) != audio_pos)
-		if (!seek(audio_pos))
-			return 0;
+	// Reaching the end of the track is the normal end of decoding
+	if (static_cast<int>(audio_pos) >= getLength())
+		return 0;
 
-	file->read((char*)buffer, desired_track_frames * BYTES_PER_REDBOOK_PCM_FRAME);
-	/**
-	 *  Note: gcount returns a signed type, but according to specification:
-	 *  "Except in the constructors of std::strstreambuf, negative values of
-	 *  std::streamsize are never used."; so we store it as unsigned.
-	 */
-	const uint32_t bytes_read = static_cast<uint32_t>(file->gcount());
+	// Runs on the decoder thread, so it reads through the audio stream
+	// while data sectors may be read from the same file
+	const uint32_t bytes_read = file.ReadAudio(
+	        reinterpret_cast<uint8_t *>(buffer), audio_pos,
+	        desired_track_frames * BYTES_PER_REDBOOK_PCM_FRAME);
 
 	// decoding is an audio-task, so update our audio position
 	audio_pos += bytes_read;
@@ -229,6 +264,7 @@ CDROM_Interface_Image::AudioFile::AudioFile(const char *filename, bool &error)
 		LOG_MSG("CDROM: Loaded %s [%d Hz, %d-channel, %2.1f minutes]",
 		        filename_only.c_str(), getRate(), getChannels(),
 		        getLength() / static_cast<double>(REDBOOK_PCM_BYTES_PER_MIN));
+		startSeekPointScan(filename);
 	} else {
 		LOG_MSG("CDROM: Failed adding '%s' as CDDA track!", filename_only.c_str());
 		error = true;
@@ -241,10 +277,55 @@ CDROM_Interface_Image::AudioFile::~AudioFile()
 	if (sample == nullptr)
 		return;
 
+	if (seek_point_scan) {
+		SDL_AtomicSet(&cancel_seek_point_scan, 1);
+		seek_point_scans.Remove(seek_point_scan);
+	}
 	Sound_FreeSample(sample);
 	sample = nullptr;
 }
 
+/**
+ *  Codecs like FLAC, Vorbis, and Opus otherwise search the file on every
+ *  seek, so we list their seek points once, in the background so the
+ *  mount isn't held up. Tracks are scanned one at a time, as each scan
+ *  reads its whole file. The list is kept in a file, so later mounts of
+ *  the same track get it straight away.
+ */
+void CDROM_Interface_Image::AudioFile::startSeekPointScan(const char *filename)
+{
+	if (!Sound_CanScanSeekPoints(sample))
+		return;
+
+	const std::string path = filename;
+	seek_point_scan = seek_point_scans.Add([this, path]() {
+		// The scan reads through its own handle, leaving the sample's to us
+		SDL_RWops *rw = SDL_RWFromFile(path.c_str(), "rb");
+		if (!rw)
+			return;
+		seek_points = load_or_scan_seek_points(sample, rw,
+		                                       &cancel_seek_point_scan);
+		SDL_RWclose(rw);
+		seek_points_ready = true;
+	});
+}
+
+// Hands the seek points to the codec once the scan is done. Binding them
+// changes the decoder's state, so this is done where we seek.
+void CDROM_Interface_Image::AudioFile::useScannedSeekPoints()
+{
+	if (!seek_points_ready)
+		return;
+	seek_points_ready = false;
+
+	if (!seek_points.empty()) {
+		Sound_SetSeekPoints(sample, seek_points.data(),
+		                    static_cast<uint32_t>(seek_points.size()));
+		// the codec keeps its own copy
+		seek_points = std::vector<Sound_SeekPoint>();
+	}
+}
+
 /**
  *  Seek takes in a Redbook CD-DA byte offset relative to the track's start
  *  time and returns true if the seek succeeded.
@@ -289,6 +370,7 @@ bool CDROM_Interface_Image::AudioFile::seek(const uint32_t requested_pos)
 #endif
 
 	// Perform the seek and update our position
+	useScannedSeekPoints();
 	const bool result = Sound_Seek(sample, pos_in_ms);
 	audio_pos = result ? requested_pos : std::numeric_limits<uint32_t>::max();
 
@@ -475,14 +557,27 @@ int CDROM_Interface_Image::AudioFile::getLength()
 	return length_redbook_bytes;
 }
 
+// Audio decoded ahead of the mixer while playing, in chunks of PCM frames
+constexpr uint32_t DECODE_AHEAD_MS = 300;
+constexpr uint32_t DECODE_CHUNK_FRAMES = 2048;
+
+// Cooked sectors kept in memory per image, set from the configuration
+static uint32_t cache_sectors = 0;
+
+// Ceiling on the data track bytes preloaded per image, from the configuration
+static uint64_t preload_limit = 0;
+
 // initialize static members
 int CDROM_Interface_Image::refCount = 0;
 CDROM_Interface_Image* CDROM_Interface_Image::images[26] = {};
 CDROM_Interface_Image::imagePlayer CDROM_Interface_Image::player;
+std::vector<CDROM_Interface_Image::BinaryFile *> CDROM_Interface_Image::preloadingFiles = {};
 
 CDROM_Interface_Image::CDROM_Interface_Image(uint8_t sub_unit)
         : tracks{},
           readBuffer{},
+          trackReadBuffer{},
+          sectorCache(cache_sectors, BYTES_PER_COOKED_REDBOOK_FRAME),
           mcn("")
 {
 	images[sub_unit] = this;
@@ -508,6 +603,7 @@ CDROM_Interface_Image::~CDROM_Interface_Image()
 	// Stop playback before wiping out the CD Player
 	if (refCount == 0 && player.cd) {
 		StopAudio();
+		StopDecoder();
 		SDL_DestroyMutex(player.mutex);
 		player.mutex = nullptr;
 #ifdef DEBUG
@@ -515,12 +611,14 @@ CDROM_Interface_Image::~CDROM_Interface_Image()
 #endif
 	}
 	if (player.cd == this) {
+		StopDecoder();
 		player.cd = nullptr;
 	}
 }
 
 bool CDROM_Interface_Image::SetDevice(char* path)
 {
+	sectorCache.Clear();
 	const bool result = LoadCueSheet(path) || LoadIsoFile(path);
 	if (!result) {
 		// print error message on dosbox console
@@ -719,6 +817,9 @@ bool CDROM_Interface_Image::PlayAudioSector(const uint32_t start, uint32_t len)
 	if (start < track->start)
 		len -= (track->start - start);
 
+	// The decoder of the previous request may still be using the track
+	StopDecoder();
+
 	// Seek to the calculated byte offset, bounded to the valid byte offsets
 	const uint32_t offset = (track->skip
 	                        + clamp(start - static_cast<uint32_t>(track->start),
@@ -741,6 +842,15 @@ bool CDROM_Interface_Image::PlayAudioSector(const uint32_t start, uint32_t len)
 	const uint8_t track_channels = track_file->getChannels();
 	const uint32_t track_rate = track_file->getRate();
 
+	// Decode on a thread of its own, so the mixer callback only copies
+	const uint32_t decode_ahead_frames = track_rate * DECODE_AHEAD_MS / 1000;
+	auto decoder = std::make_unique<DecodeAhead>(
+	        [track_file](int16_t *buffer, uint32_t frames) {
+		        return track_file->decode(buffer, frames);
+	        },
+	        track_channels, DECODE_CHUNK_FRAMES,
+	        ceil_udivide(decode_ahead_frames, DECODE_CHUNK_FRAMES));
+
 	/**
 	 *  Guard: Before we update our player object with new track details, we
 	 *  lock access to it to prevent the Callback (which runs in a separate
@@ -755,6 +865,7 @@ bool CDROM_Interface_Image::PlayAudioSector(const uint32_t start, uint32_t len)
 	// Update our player with properties about this playback sequence
 	player.cd = this;
 	player.trackFile = track_file;
+	player.decoder = std::move(decoder);
 	player.startSector = start;
 	player.totalRedbookFrames = len;
 	player.isPlaying = true;
@@ -817,6 +928,22 @@ bool CDROM_Interface_Image::PlayAudioSector(const uint32_t start, uint32_t len)
 	return true;
 }
 
+void CDROM_Interface_Image::StopDecoder(void)
+{
+	std::unique_ptr<DecodeAhead> decoder;
+	// Take it out of the callback's reach first, as stopping waits for
+	// the chunk being decoded
+	if (player.mutex && SDL_LockMutex(player.mutex) == 0) {
+		decoder = std::move(player.decoder);
+		SDL_UnlockMutex(player.mutex);
+	} else {
+		decoder = std::move(player.decoder);
+	}
+	if (decoder && decoder->GetUnderruns())
+		LOG_MSG("CDROM: Audio decoding fell behind playback %u times",
+		        decoder->GetUnderruns());
+}
+
 bool CDROM_Interface_Image::PauseAudio(bool resume)
 {
 	player.isPaused = !resume;
@@ -877,29 +1004,39 @@ bool CDROM_Interface_Image::ReadSectors(PhysPt buffer,
 {
 	const uint16_t sectorSize = (raw ? BYTES_PER_RAW_REDBOOK_FRAME
 	                                 : BYTES_PER_COOKED_REDBOOK_FRAME);
-	const uint32_t requested_bytes = num * sectorSize;
-
-	// Resize our underlying vector if it's not big enough
-	if (readBuffer.size() < requested_bytes)
-		readBuffer.resize(requested_bytes);
-
-	// Setup state-tracking variables to be used in the read-loop
-	bool success = true; //Gobliiins reads 0 sectors
-	uint32_t bytes_read = 0;
-	uint32_t current_sector = sector;
-	uint8_t* buffer_position = readBuffer.data();
-
-	// Read until we have enough or fail
-	while (bytes_read < requested_bytes) {
-		success = ReadSector(buffer_position, raw, current_sector);
-		if (!success)
+
+	// Read the sectors straight into guest memory where it's plain RAM,
+	// and those straddling other pages through our buffer. If the read
+	// fails, the sectors it didn't get are zeroed: a direct read can leave
+	// part of the failed sector and the ones after it in guest memory.
+	uint32_t sectors_read = 0;
+	while (sectors_read < num) {
+		const PhysPt dest = buffer + sectors_read * sectorSize;
+		Bitu span = (num - sectors_read) * sectorSize;
+		const HostPt host = MEM_GetBlockWritePt(dest, &span);
+		uint32_t n = 0;
+		if (host && span >= sectorSize) {
+			n = ReadSectorsHost(host, raw, sector + sectors_read,
+			                    static_cast<uint32_t>(span / sectorSize));
+		} else {
+			if (readBuffer.size() < sectorSize)
+				readBuffer.resize(sectorSize);
+			n = ReadSectorsHost(readBuffer.data(), raw,
+			                    sector + sectors_read, 1);
+			MEM_BlockWrite(dest, readBuffer.data(), n * sectorSize);
+		}
+		if (n == 0)
 			break;
-		current_sector++;
-		bytes_read += sectorSize;
-		buffer_position += sectorSize;
+		sectors_read += n;
 	}
-	// Write only the successfully read bytes
-	MEM_BlockWrite(buffer, readBuffer.data(), bytes_read);
+	// Gobliiins reads 0 sectors, which succeeds
+	const bool success = (sectors_read == num);
+	if (!success) {
+		readBuffer.assign(sectorSize, 0);
+		for (uint32_t i = sectors_read; i < num; ++i)
+			MEM_BlockWrite(buffer + i * sectorSize, readBuffer.data(), sectorSize);
+	}
+	MAYBE_UNUSED const uint32_t bytes_read = sectors_read * sectorSize;
 #ifdef DEBUG
 	LOG_MSG("CDROM: Read %u %s sectors at sector %u: "
 	        "%s after %u sectors (%u bytes)",
@@ -915,6 +1052,102 @@ bool CDROM_Interface_Image::LoadUnloadMedia(bool /*unload*/)
 	return true;
 }
 
+uint32_t CDROM_Interface_Image::ReadSectorsHost(uint8_t *buffer,
+                                                const bool raw,
+                                                const uint32_t sector,
+                                                const uint32_t num)
+{
+	const uint16_t length = (raw ? BYTES_PER_RAW_REDBOOK_FRAME
+	                             : BYTES_PER_COOKED_REDBOOK_FRAME);
+	const bool cached = !raw && sectorCache.GetCapacity();
+	const bool admitted = cached && sectorCache.Admits(sector, num);
+	uint32_t done = 0;
+	while (done < num) {
+		if (cached && sectorCache.Read(sector + done, buffer + done * length)) {
+			++done;
+			continue;
+		}
+		// Read the run of sectors up to the next cached one in one go
+		uint32_t run = 1;
+		while (done + run < num && !(cached && sectorCache.Contains(sector + done + run)))
+			++run;
+		const uint32_t n = ReadTrackSectors(buffer + done * length, raw,
+		                                    sector + done, run);
+		if (n == 0)
+			break;
+		for (uint32_t i = 0; admitted && i < n; ++i)
+			sectorCache.Write(sector + done + i, buffer + (done + i) * length);
+		done += n;
+	}
+	return done;
+}
+
+uint32_t CDROM_Interface_Image::ReadTrackSectors(uint8_t *buffer,
+                                                 const bool raw,
+                                                 const uint32_t sector,
+                                                 uint32_t num)
+{
+	track_const_iter track = GetTrack(sector);
+
+	// Guard: Bail if the requested sector fell outside our tracks
+	if (track == tracks.end() || track->file == nullptr) {
+#ifdef DEBUG
+		LOG_MSG("CDROM: ReadSector at %u => resulted "
+		        "in an invalid track or track->file",
+		        sector);
+#endif
+		return 0;
+	}
+	if (track->sectorSize != BYTES_PER_RAW_REDBOOK_FRAME && raw) {
+		return 0;
+	}
+
+	// Stop at the end of the track, the next one is read separately
+	const uint32_t track_end = track->start + track->length;
+	if (sector < track_end)
+		num = std::min(num, track_end - sector);
+
+	const uint32_t offset = track->skip + (sector - track->start) * track->sectorSize;
+	const uint16_t length = (raw ? BYTES_PER_RAW_REDBOOK_FRAME : BYTES_PER_COOKED_REDBOOK_FRAME);
+
+	// Where the requested data starts within each stored sector
+	uint32_t header = 0;
+	if (track->sectorSize == BYTES_PER_RAW_REDBOOK_FRAME && !track->mode2 && !raw)
+		header = 16;
+	if (track->mode2 && !raw)
+		header = 24;
+
+#if 0 // Excessively verbose.. only enable if needed
+#ifdef DEBUG
+	LOG_MSG("CDROM: ReadSector track %2d, desired raw %s, sector %ld, "
+	        "count %u, length=%d",
+	        track->number,
+	        raw ? "true":"false",
+	        sector,
+	        num,
+	        length);
+#endif
+#endif
+	// Sectors stored as requested are read straight into the buffer
+	if (header == 0 && track->sectorSize == length)
+		return track->file->read(buffer, offset, num * length) ? num : 0;
+
+	// Otherwise pick out the data from the whole span, taken from memory
+	// when the image is preloaded and read from the file once if not
+	const uint32_t span = (num - 1) * track->sectorSize + header + length;
+	const uint8_t *stored = track->file->residentData(offset, span);
+	if (!stored) {
+		if (trackReadBuffer.size() < span)
+			trackReadBuffer.resize(span);
+		if (!track->file->read(trackReadBuffer.data(), offset, span))
+			return 0;
+		stored = trackReadBuffer.data();
+	}
+	for (uint32_t i = 0; i < num; ++i)
+		memcpy(buffer + i * length, stored + i * track->sectorSize + header, length);
+	return num;
+}
+
 track_iter CDROM_Interface_Image::GetTrack(const uint32_t sector)
 {
 	// Guard if we have no tracks or the sector is beyond the lead-out
@@ -927,20 +1160,16 @@ track_iter CDROM_Interface_Image::GetTrack(const uint32_t sector)
 	}
 
 	/**
-	 *  Walk the tracks checking if the desired sector falls inside of a given
-	 *  track's range, which starts at the end of the prior track and goes to
-	 *  the current track's (start + length).
+	 *  A track's range starts at the end of the prior track and goes to the
+	 *  current track's (start + length), so the ranges are back to back and
+	 *  the track we want is the first one ending after the sector.
 	 */
-	track_iter track = tracks.begin();
-	uint32_t lower_bound = track->start;
-	while (track != tracks.end()) {
-		const uint32_t upper_bound = track->start + track->length;
-		if (lower_bound <= sector && sector < upper_bound) {
-			break;
-		}
-		++track;
-		lower_bound = upper_bound;
-	}
+	if (sector < tracks.front().start)
+		return tracks.end();
+	track_iter track = std::upper_bound(tracks.begin(), tracks.end(), sector,
+	                                    [](const uint32_t s, const Track &t) {
+		                                    return s < t.start + t.length;
+	                                    });
 #ifdef DEBUG
 	if (track != tracks.end() && track->number != 1) {
 		if (sector < track->start) {
@@ -965,37 +1194,7 @@ track_iter CDROM_Interface_Image::GetTrack(const uint32_t sector)
 
 bool CDROM_Interface_Image::ReadSector(uint8_t *buffer, const bool raw, const uint32_t sector)
 {
-	track_const_iter track = GetTrack(sector);
-
-	// Guard: Bail if the requested sector fell outside our tracks
-	if (track == tracks.end() || track->file == nullptr) {
-#ifdef DEBUG
-		LOG_MSG("CDROM: ReadSector at %u => resulted "
-		        "in an invalid track or track->file",
-		        sector);
-#endif
-		return false;
-	}
-	uint32_t offset = track->skip + (sector - track->start) * track->sectorSize;
-	const uint16_t length = (raw ? BYTES_PER_RAW_REDBOOK_FRAME : BYTES_PER_COOKED_REDBOOK_FRAME);
-	if (track->sectorSize != BYTES_PER_RAW_REDBOOK_FRAME && raw) {
-		return false;
-	}
-	if (track->sectorSize == BYTES_PER_RAW_REDBOOK_FRAME && !track->mode2 && !raw)
-		offset += 16;
-	if (track->mode2 && !raw)
-		offset += 24;
-
-#if 0 // Excessively verbose.. only enable if needed
-#ifdef DEBUG
-	LOG_MSG("CDROM: ReadSector track %2d, desired raw %s, sector %ld, length=%d",
-	        track->number,
-	        raw ? "true":"false",
-	        sector,
-	        length);
-#endif
-#endif
-	return track->file->read(buffer, offset, length);
+	return ReadSectorsHost(buffer, raw, sector, 1) == 1;
 }
 
 
@@ -1035,8 +1234,14 @@ void CDROM_Interface_Image::CDAudioCallBack(Bitu desired_track_frames)
 		return;
 	}
 
-	const uint32_t decoded_track_frames = track_file->decode(player.buffer,
-	                                                         static_cast<uint32_t>(desired_track_frames));
+	// The decoder goes away when playback is restarted
+	if (!player.decoder) {
+		SDL_UnlockMutex(player.mutex);
+		return;
+	}
+
+	const uint32_t decoded_track_frames = player.decoder->Read(player.buffer,
+	                                                           static_cast<uint32_t>(desired_track_frames));
 	player.playedTrackFrames += decoded_track_frames;
 
 	/**
@@ -1053,7 +1258,7 @@ void CDROM_Interface_Image::CDAudioCallBack(Bitu desired_track_frames)
 #endif
 		player.cd->StopAudio();
 
-	} else if (decoded_track_frames == 0) {
+	} else if (player.decoder->IsAtEnd()) {
 		// Our track has run dry but we still have more music left to play!
 		const double percent_played = static_cast<double>(
 		                              player.playedTrackFrames)
@@ -1393,6 +1598,31 @@ bool CDROM_Interface_Image::HasDataTrack(void)
 }
 
 
+void CDROM_Interface_Image::PreloadDataTracks(void)
+{
+	// Tracks can share a file, which is then loaded only once
+	uint64_t budget = preload_limit;
+	for (const auto &track : tracks) {
+		if (track.attr != 0x40 || !budget)
+			continue;
+		auto file = dynamic_cast<BinaryFile *>(track.file.get());
+		if (file && !file->isPreloading())
+			budget -= file->preload(budget);
+	}
+}
+
+void CDROM_Interface_Image::ReportPreloading()
+{
+	auto &files = preloadingFiles;
+	files.erase(std::remove_if(files.begin(), files.end(),
+	                           [](BinaryFile *file) {
+		                           return file->reportPreloadProgress();
+	                           }),
+	            files.end());
+	if (files.empty())
+		TIMER_DelTickHandler(&CDROM_Interface_Image::ReportPreloading);
+}
+
 bool CDROM_Interface_Image::GetRealFileName(string &filename, string &pathname)
 {
 	// check if file exists
@@ -1477,6 +1707,12 @@ void CDROM_Image_Destroy(Section*) {
 void CDROM_Image_Init(Section* sec) {
 	if (sec != nullptr) {
 		sec->AddDestroyFunction(CDROM_Image_Destroy, false);
+		const auto section = static_cast<Section_prop *>(sec);
+		const int cache_kb = section->Get_int("cdrom_cache");
+		cache_sectors = static_cast<uint32_t>(cache_kb) * 1024 /
+		                BYTES_PER_COOKED_REDBOOK_FRAME;
+		const int preload_mb = section->Get_int("cdrom_preload_limit");
+		preload_limit = static_cast<uint64_t>(preload_mb) * 1024 * 1024;
 	}
 	Sound_Init();
 }
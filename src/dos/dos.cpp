@@ -691,8 +691,7 @@ static Bitu DOS_21Handler(void) {
 		{ 
 			Bit16u toread=DOS_GetAmount();
 			dos.echo=true;
-			if (DOS_ReadFile(reg_bx,dos_copybuf,&toread)) {
-				MEM_BlockWrite(SegPhys(ds)+reg_dx,dos_copybuf,toread);
+			if (DOS_ReadFileToMem(reg_bx,SegPhys(ds)+reg_dx,&toread)) {
 				reg_ax=toread;
 				CALLBACK_SCF(false);
 			} else {
@@ -1350,6 +1349,7 @@ public:
 		dos.internal_output=false;
 
 		const Section_prop* section = static_cast<Section_prop*>(configuration);
+		dos.file_read_ahead = section->Get_bool("file_read_ahead");
 		char *args = const_cast<char *>(section->Get_string("ver"));
 		const char* word = StripWord(args);
 		const auto new_version = DOS_ParseVersion(word, args);
@@ -405,6 +405,42 @@ bool DOS_ReadFile(Bit16u entry,Bit8u * data,Bit16u * amount,bool fcb) {
 	return ret;
 }
 
+bool DOS_ReadFileToMem(Bit16u entry, PhysPt pt, Bit16u *amount)
+{
+	const Bit32u handle = RealHandle(entry);
+	// Devices return what they have in one go, so they get a single read
+	if (handle >= DOS_FILES || !Files[handle] || !Files[handle]->IsOpen() ||
+	    (Files[handle]->GetInformation() & 0x8000)) {
+		if (!DOS_ReadFile(entry, dos_copybuf, amount))
+			return false;
+		MEM_BlockWrite(pt, dos_copybuf, *amount);
+		return true;
+	}
+
+	// Read straight into guest memory where it's plain RAM, and through
+	// the copy buffer elsewhere
+	const Bit16u total = *amount;
+	Bit16u done = 0;
+	while (done < total) {
+		Bitu span = total - done;
+		HostPt host = MEM_GetBlockWritePt(pt + done, &span);
+		Bit16u toread = static_cast<Bit16u>(span);
+		const bool ret = Files[handle]->Read(host ? host : dos_copybuf, &toread);
+		if (!ret) {
+			if (!done)
+				return false;
+			break;
+		}
+		if (!host)
+			MEM_BlockWrite(pt + done, dos_copybuf, toread);
+		done += toread;
+		if (toread < span)
+			break; // end of file
+	}
+	*amount = done;
+	return true;
+}
+
 bool DOS_WriteFile(Bit16u entry,Bit8u * data,Bit16u * amount,bool fcb) {
 	Bit32u handle = fcb?entry:RealHandle(entry);
 	if (handle>=DOS_FILES) {
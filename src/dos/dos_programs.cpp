@@ -189,6 +189,7 @@ public:
 		}
 		bool path_relative_to_last_config = false;
 		if (cmd->FindExist("-pr",true)) path_relative_to_last_config = true;
+		const bool prescan = cmd->FindExist("-prescan", true);
 
 		/* Check for unmounting */
 		if (cmd->FindString("-u",umount,false)) {
@@ -435,6 +436,9 @@ public:
 			newdrive->dirCache.SetLabel(label.c_str(),iscdrom,true);
 		}
 		if (type == "floppy") incrementFDD();
+		/* Floppies are rescanned on each search, overlays merge two trees */
+		if (prescan && (type == "dir" || type == "cdrom"))
+			newdrive->dirCache.StartPrescan();
 		return;
 showusage:
 	WriteOut(MSG_Get("SHELL_CMD_MOUNT_HELP_LONG"));
@@ -542,8 +546,8 @@ private:
 
 			// get file size
 			fseek(tmpfile,0L, SEEK_END);
-			*ksize = (ftell(tmpfile) / 1024);
 			*bsize = ftell(tmpfile);
+			*ksize = (Bit32u)(get_disk_image_size(tmpfile) / 1024);
 			fclose(tmpfile);
 
 			tmpfile = ldp->GetSystemFilePtr(fullname, "rb+");
@@ -580,8 +584,8 @@ private:
 //				if (tryload) error = 2;
 				WriteOut(MSG_Get("PROGRAM_BOOT_WRITE_PROTECTED"));
 				fseek(tmpfile,0L, SEEK_END);
-				*ksize = (ftell(tmpfile) / 1024);
 				*bsize = ftell(tmpfile);
+				*ksize = (Bit32u)(get_disk_image_size(tmpfile) / 1024);
 				return tmpfile;
 			}
 			// Give the delayed errormessages from the mounted variant (or from above)
@@ -590,8 +594,8 @@ private:
 			return NULL;
 		}
 		fseek(tmpfile,0L, SEEK_END);
-		*ksize = (ftell(tmpfile) / 1024);
 		*bsize = ftell(tmpfile);
+		*ksize = (Bit32u)(get_disk_image_size(tmpfile) / 1024);
 		return tmpfile;
 	}
 
@@ -679,6 +683,11 @@ public:
 				FILE *usefile = getFSFile(temp_line.c_str(), &floppysize, &rombytesize);
 				if (usefile != NULL) {
 					diskSwap[i].reset(new imageDisk(usefile, temp_line.c_str(), floppysize, false));
+					if (!diskSwap[i]->created_successfully) {
+						diskSwap[i].reset();
+						WriteOut(MSG_Get("PROGRAM_BOOT_IMAGE_NOT_OPEN"), temp_line.c_str());
+						return;
+					}
 					if (usefile_1==NULL) {
 						usefile_1=usefile;
 						rombytesize_1=rombytesize;
@@ -1225,8 +1234,11 @@ public:
 
 		std::string type   = "hdd";
 		std::string fstype = "fat";
+		std::string delta_path = "";
 		cmd->FindString("-t",type,true);
 		cmd->FindString("-fs",fstype,true);
+		cmd->FindString("-delta",delta_path,true);
+		const bool preload = cmd->FindExist("-preload", true);
 
 		// Types 'cdrom' and 'iso' are synonyms. Name 'cdrom' is easier
 		// to remember and makes more sense, while name 'iso' is
@@ -1375,23 +1387,41 @@ public:
 		if (paths.size() == 1)
 			temp_line = paths[0];
 
+		if (!delta_path.empty() && (fstype == "iso" || paths.size() > 1)) {
+			WriteOut(MSG_Get("PROGRAM_IMGMOUNT_DELTA_SINGLE_IMAGE"));
+			return;
+		}
+		const char *delta_file = delta_path.empty() ? nullptr : delta_path.c_str();
+
 		if (fstype=="fat") {
+			/* The image opened for detecting the geometry gets
+			 * mounted as well */
+			std::unique_ptr<imageDisk> detected_disk = nullptr;
 			if (imgsizedetect) {
-				FILE * diskfile = fopen_wrap(temp_line.c_str(), "rb+");
+				FILE * diskfile = fopen_wrap(temp_line.c_str(), delta_file ? "rb" : "rb+");
 				if (!diskfile) {
 					WriteOut(MSG_Get("PROGRAM_IMGMOUNT_INVALID_IMAGE"));
 					return;
 				}
-				fseek(diskfile, 0L, SEEK_END);
-				Bit32u fcsize = (Bit32u)(ftell(diskfile) / 512L);
+				/* Detect through the delta file, as the partition
+				 * table may have been written to it */
+				detected_disk.reset(new imageDisk(diskfile, temp_line.c_str(), 0, true));
+				if (!detected_disk->created_successfully) {
+					WriteOut(MSG_Get("PROGRAM_IMGMOUNT_INVALID_IMAGE"));
+					return;
+				}
+				if (delta_file && !detected_disk->AttachDelta(delta_file)) {
+					WriteOut(MSG_Get("PROGRAM_IMGMOUNT_CANT_CREATE"));
+					return;
+				}
+				const uint64_t image_size = detected_disk->GetSize();
+				Bit32u fcsize = (Bit32u)(image_size / 512L);
 				Bit8u buf[512];
-				fseek(diskfile, 0L, SEEK_SET);
-				if (fread(buf,sizeof(Bit8u),512,diskfile)<512) {
-					fclose(diskfile);
+				if (image_size < 512) {
 					WriteOut(MSG_Get("PROGRAM_IMGMOUNT_INVALID_IMAGE"));
 					return;
 				}
-				fclose(diskfile);
+				detected_disk->Read_AbsoluteSector(0, buf);
 				if ((buf[510]!=0x55) || (buf[511]!=0xaa)) {
 					WriteOut(MSG_Get("PROGRAM_IMGMOUNT_INVALID_GEOMETRY"));
 					return;
@@ -1416,8 +1446,11 @@ public:
 			std::vector<DOS_Drive*>::size_type ct;
 
 			for (i = 0; i < paths.size(); i++) {
-				std::unique_ptr<fatDrive> newDrive(
-					new fatDrive(paths[i].c_str(),sizes[0],sizes[1],sizes[2],sizes[3],0));
+				std::unique_ptr<fatDrive> newDrive;
+				if (detected_disk && paths[i] == temp_line)
+					newDrive.reset(new fatDrive(std::move(detected_disk), paths[i].c_str(),sizes[0],sizes[1],sizes[2],sizes[3],0));
+				else
+					newDrive.reset(new fatDrive(paths[i].c_str(),sizes[0],sizes[1],sizes[2],sizes[3],0,delta_file));
 
 				if (newDrive->created_successfully) {
 					imgDisks.push_back(static_cast<DOS_Drive*>(newDrive.release()));
@@ -1482,7 +1515,8 @@ public:
 			std::vector<DOS_Drive*>::size_type ct;
 			for (i = 0; i < paths.size(); i++) {
 				int error = -1;
-				DOS_Drive* newDrive = new isoDrive(drive, paths[i].c_str(), mediaid, error);
+				DOS_Drive* newDrive = new isoDrive(drive, paths[i].c_str(), mediaid,
+				                                  error, preload);
 				isoDisks.push_back(newDrive);
 				switch (error) {
 					case 0  :	break;
@@ -1523,13 +1557,12 @@ public:
 			WriteOut(MSG_Get("PROGRAM_MOUNT_STATUS_2"), drive, tmp.c_str());
 
 		} else if (fstype == "none") {
-			FILE *newDisk = fopen_wrap(temp_line.c_str(), "rb+");
+			FILE *newDisk = fopen_wrap(temp_line.c_str(), delta_file ? "rb" : "rb+");
 			if (!newDisk) {
 				WriteOut(MSG_Get("PROGRAM_IMGMOUNT_INVALID_IMAGE"));
 				return;
 			}
-			fseek(newDisk,0L, SEEK_END);
-			Bit32u imagesize = (ftell(newDisk) / 1024);
+			Bit32u imagesize = (Bit32u)(get_disk_image_size(newDisk) / 1024);
 			const bool hdd = (imagesize > 2880);
 			//Seems to make sense to require a valid geometry..
 			if (hdd && sizes[0] == 0 && sizes[1] == 0 && sizes[2] == 0 && sizes[3] == 0) {
@@ -1539,8 +1572,18 @@ public:
 			}
 
 			imageDisk * newImage = new imageDisk(newDisk, temp_line.c_str(), imagesize, hdd);
+			if (!newImage->created_successfully) {
+				delete newImage;
+				WriteOut(MSG_Get("PROGRAM_IMGMOUNT_INVALID_IMAGE"));
+				return;
+			}
 
 			if (hdd) newImage->Set_Geometry(sizes[2],sizes[3],sizes[1],sizes[0]);
+			if (delta_file && !newImage->AttachDelta(delta_file)) {
+				delete newImage;
+				WriteOut(MSG_Get("PROGRAM_IMGMOUNT_CANT_CREATE"));
+				return;
+			}
 			imageDiskList[drive - '0'].reset(newImage);
 			updateDPT();
 			WriteOut(MSG_Get("PROGRAM_IMGMOUNT_MOUNT_NUMBER"),drive - '0',temp_line.c_str());
@@ -1795,9 +1838,11 @@ void DOS_SetupPrograms(void) {
 	        "Mount a CD-ROM, floppy, or disk image to a drive letter.\n"
 	        "\n"
 	        "Usage:\n"
-	        "  \033[32;1mimgmount\033[0m \033[37;1mDRIVE\033[0m \033[36;1mCDROM-SET\033[0m [CDROM-SET2 [..]] [-fs iso] -t cdrom|iso \n"
+	        "  \033[32;1mimgmount\033[0m \033[37;1mDRIVE\033[0m \033[36;1mCDROM-SET\033[0m [CDROM-SET2 [..]] [-fs iso] -t cdrom|iso\n"
+	        "        [-preload]\n"
 	        "  \033[32;1mimgmount\033[0m \033[37;1mDRIVE\033[0m \033[36;1mIMAGEFILE\033[0m [IMAGEFILE2 [..]] [-fs fat] -t hdd|floppy\n"
 	        "  \033[32;1mimgmount\033[0m \033[37;1mDRIVE\033[0m \033[36;1mBOOTIMAGE\033[0m [-fs fat|none] -t hdd -size GEOMETRY\n"
+	        "  \033[32;1mimgmount\033[0m \033[37;1mDRIVE\033[0m \033[36;1mIMAGEFILE\033[0m -delta DELTAFILE [..]\n"
 	        "  \033[32;1mimgmount\033[0m -u \033[37;1mDRIVE\033[0m  (unmounts the DRIVE's image)\n"
 		"\n"
 	        "Where:\n"
@@ -1806,8 +1851,13 @@ void DOS_SetupPrograms(void) {
 	        "  \033[36;1mIMAGEFILE\033[0m is a hard drive or floppy image in FAT16 or FAT12 format\n"
 	        "  \033[36;1mBOOTIMAGE\033[0m is a bootable disk image with specified -size GEOMETRY:\n"
 	        "            bytes-per-sector,sectors-per-head,heads,cylinders\n"
+	        "  \033[36;1mDELTAFILE\033[0m keeps all changes to the image, which itself stays unmodified\n"
+	        "Images compressed with dosbox-imgpack can be used like raw images. They are\n"
+	        "read-only unless a DELTAFILE is given.\n"
 	        "Notes:\n"
 	        "  - Ctrl+F4 swaps & mounts the next CDROM-SET or IMAGEFILE, if provided.\n"
+	        "  - '-preload' loads the data tracks of a CDROM-SET into memory in the\n"
+	        "    background, up to the 'cdrom_preload_limit' setting.\n"
 		"\n"
 	        "Examples:\n"
 #if defined(WIN32)
@@ -1839,6 +1889,7 @@ void DOS_SetupPrograms(void) {
 	        "\n"
 	        "Usage:\n"
 	        "  \033[32;1mmount\033[0m \033[37;1mDRIVE\033[0m \033[36;1mDIRECTORY\033[0m [-t TYPE] [-freesize SIZE] [-label LABEL]\n"
+	        "        [-prescan]\n"
 	        "  \033[32;1mmount\033[0m -u \033[37;1mDRIVE\033[0m  (unmounts the DRIVE's directory)\n"
 	        "\n"
 	        "Where:\n"
@@ -1850,6 +1901,8 @@ void DOS_SetupPrograms(void) {
 	        "\n"
 	        "Notes:\n"
 	        "  - '-t overlay' redirects writes for mounted drive to another directory.\n"
+	        "  - '-prescan' reads the directory tree in the background, speeding up the\n"
+	        "    first access to large trees.\n"
 	        "  - Additional options are described in the manual (README file, chapter 4).\n"
 	        "\n"
 	        "Examples:\n"
@@ -1893,6 +1946,7 @@ void DOS_SetupPrograms(void) {
 	MSG_Add("PROGRAM_IMGMOUNT_MOUNT_NUMBER","Drive number %d mounted as %s\n");
 	MSG_Add("PROGRAM_IMGMOUNT_NON_LOCAL_DRIVE", "The image must be on a host or local drive.\n");
 	MSG_Add("PROGRAM_IMGMOUNT_MULTIPLE_NON_CUEISO_FILES", "Using multiple files is only supported for cue/iso images.\n");
+	MSG_Add("PROGRAM_IMGMOUNT_DELTA_SINGLE_IMAGE", "A delta file can only be used with a single floppy or hard disk image.\n");
 
 	MSG_Add("PROGRAM_KEYB_INFO","Codepage %i has been loaded\n");
 	MSG_Add("PROGRAM_KEYB_INFO_LAYOUT","Codepage %i has been loaded for layout %s\n");
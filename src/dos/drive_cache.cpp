@@ -21,9 +21,12 @@
 #include <algorithm>
 #include <cassert>
 #include <iterator>
+#include <new>
+#include <string>
 #include <vector>
 
 #include "cross.h"
+#include "dir_prescan.h"
 #include "dos_inc.h"
 #include "drives.h"
 #include "string_utils.h"
@@ -31,6 +34,23 @@
 
 int fileInfoCounter = 0;
 
+// Host file names are case-insensitive on Windows
+static std::string name_key(const char *name)
+{
+	std::string key(name);
+#if defined(WIN32)
+	for (auto &c : key)
+		c = static_cast<char>(tolower(c));
+#endif
+	return key;
+}
+
+static bool CompareShortnames(DOS_Drive_Cache::CFileInfo *const &a,
+                              DOS_Drive_Cache::CFileInfo *const &b)
+{
+	return strcmp(a->shortname, b->shortname) < 0;
+}
+
 bool SortByName(DOS_Drive_Cache::CFileInfo* const &a, DOS_Drive_Cache::CFileInfo* const &b) {
 	return strcmp(a->shortname,b->shortname)<0;
 }
@@ -52,7 +72,10 @@ bool SortByDirNameRev(DOS_Drive_Cache::CFileInfo* const &a, DOS_Drive_Cache::CFi
 }
 
 DOS_Drive_Cache::DOS_Drive_Cache(void)
-	: dirBase(new CFileInfo),
+	: entries(),
+	  searches(),
+	  entryCount(0),
+	  dirBase(nullptr),
 	  dirPath{0},
 	  basePath{0},
 	  sortDirType(DIRALPHABETICAL),
@@ -64,12 +87,17 @@ DOS_Drive_Cache::DOS_Drive_Cache(void)
 	  dirFindFirst{nullptr},
 	  nextFreeFindFirst(0),
 	  label{0},
-	  updatelabel(true)
+	  updatelabel(true),
+	  prescan(nullptr)
 {
+	dirBase = NewFileInfo(entries, "");
 }
 
 DOS_Drive_Cache::DOS_Drive_Cache(const char* path)
-	: dirBase(new CFileInfo),
+	: entries(),
+	  searches(),
+	  entryCount(0),
+	  dirBase(nullptr),
 	  dirPath{0},
 	  basePath{0},
 	  sortDirType(DIRALPHABETICAL),
@@ -81,36 +109,57 @@ DOS_Drive_Cache::DOS_Drive_Cache(const char* path)
 	  dirFindFirst{nullptr},
 	  nextFreeFindFirst(0),
 	  label{0},
-	  updatelabel(true)
+	  updatelabel(true),
+	  prescan(nullptr)
 {
+	dirBase = NewFileInfo(entries, "");
 	SetBaseDir(path);
 }
 
 DOS_Drive_Cache::~DOS_Drive_Cache(void) {
+	LogMemoryUsage();
 	Clear();
-	for (Bit32u i=0; i<MAX_OPENDIRS; i++) {
-		DeleteFileInfo(dirFindFirst[i]);
-		dirFindFirst[i] = nullptr;
-	}
+	for (Bit16u i=0; i<MAX_OPENDIRS; i++)
+		DeleteSearch(i);
 }
 
 void DOS_Drive_Cache::Clear(void) {
-	DeleteFileInfo(dirBase);
+	// The arena goes away as a whole, only the lists need destroying
+	if (dirBase)
+		FreeFileInfo(entries, dirBase, false);
+	entries.Clear();
+	entryCount = 0;
 	dirBase = nullptr;
 	nextFreeFindFirst	= 0;
 	for (Bit32u i=0; i<MAX_OPENDIRS; i++)
 		dirSearch[i] = nullptr;
+	missingPaths.Clear();
 }
 
 void DOS_Drive_Cache::EmptyCache(void) {
 	// Empty Cache and reinit
+	LogMemoryUsage();
 	Clear();
-	dirBase		= new CFileInfo;
+	// The listings may be outdated by now, e.g. after a CD-ROM change
+	prescan.reset();
+	dirBase		= NewFileInfo(entries, "");
 	save_dir	= nullptr;
 	srchNr		= 0;
 	if (basePath[0] != 0) SetBaseDir(basePath);
 }
 
+void DOS_Drive_Cache::StartPrescan(void) {
+	if (basePath[0] == 0 || prescan)
+		return;
+	std::string base = basePath;
+	if (base.back() != CROSS_FILESPLIT)
+		base += CROSS_FILESPLIT;
+	prescan = std::make_unique<DirPrescan>(base);
+	// The base directory is cached in already
+	DirPrescan::Listing listing;
+	prescan->Take(base, listing);
+}
+
 void DOS_Drive_Cache::SetLabel(const char* vname,bool cdrom,bool allowupdate) {
 /* allowupdate defaults to true. if mount sets a label then allowupdate is 
  * false and will this function return at once after the first call.
@@ -208,6 +257,9 @@ void DOS_Drive_Cache::AddEntry(const char* path, bool checkExists) {
 	char file	[CROSS_LEN];
 	char expand	[CROSS_LEN];
 
+	if (!missingPaths.IsEmpty())
+		missingPaths.Clear();
+
 	CFileInfo* dir = FindDirInfo(path,expand);
 	const char* pos = strrchr(path,CROSS_FILESPLIT);
 
@@ -240,6 +292,9 @@ void DOS_Drive_Cache::AddEntryDirOverlay(const char* path, bool checkExists) {
 	char expand	[CROSS_LEN];
 	char dironly[CROSS_LEN + 1];
 
+	if (!missingPaths.IsEmpty())
+		missingPaths.Clear();
+
 	//When adding a directory, the directory we want to operate inside in is the above it. (which can go wrong if the directory already exists.)
 	safe_strcpy(dironly, path);
 	char* post = strrchr(dironly,CROSS_FILESPLIT);
@@ -348,7 +403,27 @@ void DOS_Drive_Cache::CacheOut(const char* path, bool ignoreLastDir) {
 	// clear lists
 	dir->fileList.clear();
 	dir->longNameList.clear();
+	dir->nameIndex.reset();
 	save_dir = nullptr;
+	if (!missingPaths.IsEmpty())
+		missingPaths.Clear();
+}
+
+bool DOS_Drive_Cache::IsKnownMissing(const char* path) {
+	return missingPaths.Contains(path);
+}
+
+void DOS_Drive_Cache::AddMissing(const char* path, const char* expanded) {
+	missingPaths.Add(path, expanded);
+}
+
+DOS_Drive_Cache::CFileInfo::NameIndex& DOS_Drive_Cache::GetNameIndex(CFileInfo* dir) {
+	if (!dir->nameIndex) {
+		dir->nameIndex = std::make_unique<CFileInfo::NameIndex>();
+		for (auto info : dir->fileList)
+			dir->nameIndex->longNames.emplace(name_key(info->orgname), info);
+	}
+	return *dir->nameIndex;
 }
 
 bool DOS_Drive_Cache::IsCachedIn(CFileInfo* curDir) {
@@ -367,22 +442,16 @@ bool DOS_Drive_Cache::GetShortName(const char* fullname, char* shortname) {
 	else
 		return false;
 
-	std::vector<CFileInfo*>::size_type filelist_size = curDir->longNameList.size();
-	if (GCC_UNLIKELY(filelist_size<=0))
+	if (GCC_UNLIKELY(curDir->longNameList.empty()))
 		return false;
 
-	// The orgname part of the list is not sorted (shortname is)! So we can only walk through it.
-	for(Bitu i = 0; i < filelist_size; i++) {
-#if defined (WIN32)
-		if (strcasecmp(pos,curDir->longNameList[i]->orgname) == 0) {
-#else
-		if (strcmp(pos,curDir->longNameList[i]->orgname) == 0) {
-#endif
-			safe_strncpy(shortname, curDir->longNameList[i]->shortname, DOS_NAMELENGTH_ASCII);
-			return true;
-		}
-	}
-	return false;
+	// Only the entries with a generated short name are of interest
+	const auto &longNames = GetNameIndex(curDir).longNames;
+	const auto it = longNames.find(name_key(pos));
+	if (it == longNames.end() || it->second->shortNr == 0)
+		return false;
+	safe_strncpy(shortname, it->second->shortname, DOS_NAMELENGTH_ASCII);
+	return true;
 }
 
 int DOS_Drive_Cache::CompareShortname(const char* compareName, const char* shortName) {
@@ -466,13 +535,13 @@ bool DOS_Drive_Cache::RemoveTrailingDot(char* shortname) {
 
 
 // From the Wine project
-static Bits wine_hash_short_file_name( char* name, char* buffer )
+static Bits wine_hash_short_file_name( const char* name, char* buffer )
 {
 	static const char hash_chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ012345";
 	static const char invalid_chars[] = { '*','?','<','>','|','"','+','=',',',';','[',']',' ','\345','~','.',0 };
-	char* p;
-	char* ext;
-	char* end = name + strlen(name);
+	const char* p;
+	const char* ext;
+	const char* end = name + strlen(name);
 	char* dst;
 	unsigned short hash;
 	int i;
@@ -512,6 +581,38 @@ static Bits wine_hash_short_file_name( char* name, char* buffer )
 }
 #endif
 
+Bits DOS_Drive_Cache::FindShortName(CFileInfo* curDir, const char* shortName) {
+	// fileList is kept sorted by short name
+	Bits low	= 0;
+	Bits high	= (Bits)(curDir->fileList.size()) - 1;
+	while (low<=high) {
+		const Bits mid = (low+high)/2;
+		const int res = strcmp(shortName,curDir->fileList[mid]->shortname);
+		if (res>0)	low  = mid+1; else
+		if (res<0)	high = mid-1; else
+		return mid;
+	}
+	return -1;
+}
+
+#ifdef WINE_DRIVE_SUPPORT
+DOS_Drive_Cache::CFileInfo* DOS_Drive_Cache::FindWineName(CFileInfo* curDir, const char* shortName) {
+	auto &index = GetNameIndex(curDir);
+	if (!index.wineNamesValid) {
+		// Hash every name once instead of on each lookup
+		char buff[CROSS_LEN];
+		for (auto info : curDir->fileList) {
+			const Bits len = wine_hash_short_file_name(info->orgname, buff);
+			buff[len] = 0;
+			index.wineNames.emplace(buff, info);
+		}
+		index.wineNamesValid = true;
+	}
+	const auto it = index.wineNames.find(shortName);
+	return (it != index.wineNames.end()) ? it->second : nullptr;
+}
+#endif
+
 Bits DOS_Drive_Cache::GetLongName(CFileInfo* curDir, char* shortName, const size_t shortName_len) {
 	std::vector<CFileInfo*>::size_type filelist_size = curDir->fileList.size();
 	if (GCC_UNLIKELY(filelist_size<=0)) return -1;
@@ -519,31 +620,20 @@ Bits DOS_Drive_Cache::GetLongName(CFileInfo* curDir, char* shortName, const size
 	// Remove dot, if no extension...
 	RemoveTrailingDot(shortName);
 	// Search long name and return array number of element
-	Bits low	= 0;
-	Bits high	= (Bits)(filelist_size-1);
-	Bits mid,res;
-	while (low<=high) {
-		mid = (low+high)/2;
-		res = strcmp(shortName,curDir->fileList[mid]->shortname);
-		if (res>0)	low  = mid+1; else
-		if (res<0)	high = mid-1; else
-		{	// Found
-			safe_strncpy(shortName, curDir->fileList[mid]->orgname, shortName_len);
-			return mid;
-		};
+	Bits index = FindShortName(curDir, shortName);
+	if (index >= 0) {
+		safe_strncpy(shortName, curDir->fileList[index]->orgname, shortName_len);
+		return index;
 	}
 #ifdef WINE_DRIVE_SUPPORT
 	if (strlen(shortName) < 8 || shortName[4] != '~' || shortName[5] == '.' || shortName[6] == '.' || shortName[7] == '.') return -1; // not available
 	// else it's most likely a Wine style short name ABCD~###, # = not dot  (length at least 8) 
-	// The above test is rather strict as the following loop can be really slow if filelist_size is large.
-	char buff[CROSS_LEN];
-	for (Bitu i = 0; i < filelist_size; i++) {
-		res = wine_hash_short_file_name(curDir->fileList[i]->orgname,buff);
-		buff[res] = 0;
-		if (!strcmp(shortName,buff)) {	
+	if (CFileInfo* info = FindWineName(curDir, shortName)) {
+		index = FindShortName(curDir, info->shortname);
+		if (index >= 0) {
 			// Found
-			safe_strncpy(shortName, curDir->fileList[i]->orgname, shortName_len);
-			return (Bits)i;
+			safe_strncpy(shortName, info->orgname, shortName_len);
+			return index;
 		}
 	}
 #endif
@@ -639,28 +729,8 @@ void DOS_Drive_Cache::CreateShortName(CFileInfo* curDir, CFileInfo* info) {
 		}
 
 		// keep list sorted for CreateShortNameID to work correctly
-		if (curDir->longNameList.size()>0) {
-			if (!(strcmp(info->shortname,curDir->longNameList.back()->shortname)<0)) {
-				// append at end of list
-				curDir->longNameList.push_back(info);
-			} else {
-				// look for position where to insert this element
-				bool found=false;
-				std::vector<CFileInfo*>::iterator it;
-				for (it=curDir->longNameList.begin(); it!=curDir->longNameList.end(); ++it) {
-					if (strcmp(info->shortname,(*it)->shortname)<0) {
-						found = true;
-						break;
-					}
-				}
-				// Put it in longname list...
-				if (found) curDir->longNameList.insert(it,info);
-				else curDir->longNameList.push_back(info);
-			}
-		} else {
-			// empty file list, append
-			curDir->longNameList.push_back(info);
-		}
+		auto &list = curDir->longNameList;
+		list.insert(std::upper_bound(list.begin(), list.end(), info, CompareShortnames), info);
 	} else {
 		safe_strcpy(info->shortname, tmpName);
 	}
@@ -727,7 +797,6 @@ DOS_Drive_Cache::CFileInfo* DOS_Drive_Cache::FindDirInfo(const char* path, char*
 		// Follow Directory
 		if ((nextDir>=0) && curDir->fileList[nextDir]->isDir) {
 			curDir = curDir->fileList[nextDir];
-			safe_strcpy(curDir->orgname, dir);
 			if (!IsCachedIn(curDir)) {
 				if (OpenDir(curDir,expandedPath,id)) {
 					char buffer[CROSS_LEN];
@@ -779,9 +848,10 @@ bool DOS_Drive_Cache::OpenDir(CFileInfo* dir, const char* expand, Bit16u& id) {
 	}
 	// open dir
 	if (dirSearch[id]) {
-		// open dir
-		dir_information* dirp = open_directory(expandcopy);
-		if (dirp || dir->isOverlayDir) { 
+		// open dir, unless the pre-scan has seen it already
+		const bool prescanned = prescan && prescan->Contains(expandcopy);
+		dir_information* dirp = prescanned ? nullptr : open_directory(expandcopy);
+		if (prescanned || dirp || dir->isOverlayDir) { 
 			// Reset it..
 			if (dirp) close_directory(dirp);
 			safe_strcpy(dirPath, expandcopy);
@@ -796,44 +866,34 @@ bool DOS_Drive_Cache::OpenDir(CFileInfo* dir, const char* expand, Bit16u& id) {
 }
 
 void DOS_Drive_Cache::CreateEntry(CFileInfo* dir, const char* name, bool is_directory) {
-	CFileInfo* info = new CFileInfo;
-	safe_strcpy(info->orgname, name);
+	CFileInfo* info = NewFileInfo(entries, name);
 	info->shortNr = 0;
 	info->isDir = is_directory;
 
 	// Check for long filenames...
 	CreateShortName(dir, info);		
 
-	bool found = false;
-
 	// keep list sorted (so GetLongName works correctly, used by CreateShortName in this routine)
-	if (dir->fileList.size()>0) {
-		if (!(strcmp(info->shortname,dir->fileList.back()->shortname)<0)) {
-			// append at end of list
-			dir->fileList.push_back(info);
-		} else {
-			// look for position where to insert this element
-			std::vector<CFileInfo*>::iterator it;
-			for (it=dir->fileList.begin(); it!=dir->fileList.end(); ++it) {
-				if (strcmp(info->shortname,(*it)->shortname)<0) {
-					found = true;
-					break;
-				}
-			}
-			// Put file in lists
-			if (found) dir->fileList.insert(it,info);
-			else dir->fileList.push_back(info);
+	auto &list = dir->fileList;
+	list.insert(std::upper_bound(list.begin(), list.end(), info, CompareShortnames), info);
+
+	if (dir->nameIndex) {
+		dir->nameIndex->longNames.emplace(name_key(info->orgname), info);
+#ifdef WINE_DRIVE_SUPPORT
+		if (dir->nameIndex->wineNamesValid) {
+			char buff[CROSS_LEN];
+			const Bits len = wine_hash_short_file_name(info->orgname, buff);
+			buff[len] = 0;
+			dir->nameIndex->wineNames.emplace(buff, info);
 		}
-	} else {
-		// empty file list, append
-		dir->fileList.push_back(info);
+#endif
 	}
 }
 
 void DOS_Drive_Cache::CopyEntry(CFileInfo* dir, CFileInfo* from) {
-	CFileInfo* info = new CFileInfo;
+	// FindNext only reports short names, so the long one isn't copied
+	CFileInfo* info = NewFileInfo(searches, nullptr);
 	// just copy things into new fileinfo
-	safe_strcpy(info->orgname, from->orgname);
 	safe_strcpy(info->shortname, from->shortname);
 	info->shortNr = from->shortNr;
 	info->isDir = from->isDir;
@@ -846,7 +906,11 @@ bool DOS_Drive_Cache::ReadDir(Bit16u id, char* &result) {
 	if (id >= MAX_OPENDIRS)
 		return false;
 
-	if (!IsCachedIn(dirSearch[id])) {
+	DirPrescan::Listing listing;
+	if (!IsCachedIn(dirSearch[id]) && prescan && prescan->Take(dirPath, listing)) {
+		for (const auto &entry : listing)
+			CreateEntry(dirSearch[id], entry.name.c_str(), entry.is_dir);
+	} else if (!IsCachedIn(dirSearch[id])) {
 		// Try to open directory
 		dir_information* dirp = open_directory(dirPath);
 		if (!dirp) {
@@ -926,15 +990,14 @@ bool DOS_Drive_Cache::FindFirst(char* path, Bit16u& id) {
 		// Clear the internal list then.
 		dirFindFirstID = 0;
 		this->nextFreeFindFirst = 1; //the next free one after this search
-		for(Bitu n=0; n<MAX_OPENDIRS;n++) {	
+		for(Bit16u n=0; n<MAX_OPENDIRS;n++) {	
 	     	// Clear and reuse slot
-			DeleteFileInfo(dirFindFirst[n]);
-			dirFindFirst[n] = nullptr;
+			DeleteSearch(n);
 		}
 	   
 	}
 	assert(dirFindFirst[dirFindFirstID] == nullptr);
-	dirFindFirst[dirFindFirstID] = new CFileInfo();
+	dirFindFirst[dirFindFirstID] = NewFileInfo(searches, nullptr);
 	dirFindFirst[dirFindFirstID]->nextEntry = 0;
 
 	// Copy entries to use with FindNext
@@ -964,8 +1027,7 @@ bool DOS_Drive_Cache::FindNext(Bit16u id, char* &result) {
 	}
 	if (!SetResult(dirFindFirst[id], result, dirFindFirst[id]->nextEntry)) {
 		// free slot
-		DeleteFileInfo(dirFindFirst[id]);
-		dirFindFirst[id] = nullptr;
+		DeleteSearch(id);
 		return false;
 	}
 	return true;
@@ -985,6 +1047,44 @@ void DOS_Drive_Cache::ClearFileInfo(CFileInfo *dir) {
 void DOS_Drive_Cache::DeleteFileInfo(CFileInfo *dir) {
 	if (dir) {
 		ClearFileInfo(dir);
-		delete dir;
+		FreeFileInfo(entries, dir, true);
+	}
+}
+
+DOS_Drive_Cache::CFileInfo* DOS_Drive_Cache::NewFileInfo(Arena& arena, const char* name) {
+	// Search copies carry no name, tree entries get a compact copy
+	char* orgname = name ? arena.CopyString(name) : nullptr;
+	if (&arena == &entries)
+		entryCount++;
+	return new (arena.Allocate(sizeof(CFileInfo))) CFileInfo(orgname);
+}
+
+void DOS_Drive_Cache::FreeFileInfo(Arena& arena, CFileInfo* info, bool recycle) {
+	for (auto child : info->fileList)
+		FreeFileInfo(arena, child, recycle);
+	char* orgname = info->orgname;
+	info->~CFileInfo();
+	if (recycle) {
+		// Keep the memory for the next entries of this arena
+		arena.FreeString(orgname);
+		arena.Free(info, sizeof(CFileInfo));
+		if (&arena == &entries)
+			entryCount--;
 	}
 }
+
+void DOS_Drive_Cache::DeleteSearch(Bit16u id) {
+	if (dirFindFirst[id]) {
+		FreeFileInfo(searches, dirFindFirst[id], true);
+		dirFindFirst[id] = nullptr;
+	}
+}
+
+void DOS_Drive_Cache::LogMemoryUsage(void) {
+	if (!entryCount)
+		return;
+	LOG(LOG_DOSMISC,LOG_NORMAL)("DIRCACHE: %u entries of %s use %u KB, %u bytes per entry",
+	    static_cast<unsigned>(entryCount), basePath,
+	    static_cast<unsigned>(entries.GetReservedBytes() / 1024),
+	    static_cast<unsigned>(entries.GetReservedBytes() / entryCount));
+}
@@ -23,6 +23,8 @@
 #include <string.h>
 #include <time.h>
 
+#include <algorithm>
+
 #include "bios_disk.h"
 #include "bios.h"
 #include "cross.h"
@@ -38,6 +40,9 @@
 #define FAT16		   1
 #define FAT32		   2
 
+/* Largest FAT that is kept in memory as a whole */
+#define MAX_FAT_CACHE_SIZE (4 * 1024 * 1024)
+
 class fatFile : public DOS_File {
 public:
 	fatFile(const char* name, Bit32u startCluster, Bit32u fileLen, fatDrive *useDrive);
@@ -62,6 +67,7 @@ public:
 
 	bool loadedSector;
 	fatDrive *myDrive;
+	fatChainIndex chainIndex;
 };
 
 
@@ -96,7 +102,8 @@ fatFile::fatFile(const char* /*name*/,
 	  dirCluster(0),
 	  dirIndex(0),
 	  loadedSector(false),
-	  myDrive(useDrive)
+	  myDrive(useDrive),
+	  chainIndex()
 {
 	Bit32u seekto = 0;
 	open = true;
@@ -117,7 +124,7 @@ bool fatFile::Read(Bit8u * data, Bit16u *size) {
 	}
 
 	if (!loadedSector) {
-		currentSector = myDrive->getAbsoluteSectFromBytePos(firstCluster, seekpos);
+		currentSector = myDrive->getAbsoluteSectFromBytePos(firstCluster, seekpos, &chainIndex);
 		if(currentSector == 0) {
 			/* EOC reached before EOF */
 			*size = 0;
@@ -139,7 +146,7 @@ bool fatFile::Read(Bit8u * data, Bit16u *size) {
 		data[sizecount++] = sectorBuffer[curSectOff++];
 		seekpos++;
 		if(curSectOff >= myDrive->getSectorSize()) {
-			currentSector = myDrive->getAbsoluteSectFromBytePos(firstCluster, seekpos);
+			currentSector = myDrive->getAbsoluteSectFromBytePos(firstCluster, seekpos, &chainIndex);
 			if(currentSector == 0) {
 				/* EOC reached before EOF */
 				//LOG_MSG("EOC reached before EOF, seekpos %d, filelen %d", seekpos, filelength);
@@ -171,8 +178,10 @@ bool fatFile::Write(Bit8u * data, Bit16u *size) {
 
 	if(seekpos < filelength && *size == 0) {
 		/* Truncate file to current position */
-		myDrive->deleteClustChain(firstCluster, seekpos);
+		myDrive->deleteClustChain(firstCluster, seekpos, &chainIndex);
 		filelength = seekpos;
+		/* The loaded sector may be in a cluster that was just freed */
+		loadedSector = false;
 		goto finalizeWrite;
 	}
 
@@ -187,7 +196,7 @@ bool fatFile::Write(Bit8u * data, Bit16u *size) {
 		}
 		filelength = ((filelength - 1) / clustSize + 1) * clustSize;
 		while(filelength < seekpos) {
-			if(myDrive->appendCluster(firstCluster) == 0) goto finalizeWrite; // out of space
+			if(myDrive->appendCluster(firstCluster, &chainIndex) == 0) goto finalizeWrite; // out of space
 			filelength += clustSize;
 		}
 		if(filelength > seekpos) filelength = seekpos;
@@ -201,17 +210,17 @@ bool fatFile::Write(Bit8u * data, Bit16u *size) {
 				firstCluster = myDrive->getFirstFreeClust();
 				if(firstCluster == 0) goto finalizeWrite; // out of space
 				myDrive->allocateCluster(firstCluster, 0);
-				currentSector = myDrive->getAbsoluteSectFromBytePos(firstCluster, seekpos);
+				currentSector = myDrive->getAbsoluteSectFromBytePos(firstCluster, seekpos, &chainIndex);
 				myDrive->readSector(currentSector, sectorBuffer);
 				loadedSector = true;
 			}
 			if (!loadedSector) {
-				currentSector = myDrive->getAbsoluteSectFromBytePos(firstCluster, seekpos);
+				currentSector = myDrive->getAbsoluteSectFromBytePos(firstCluster, seekpos, &chainIndex);
 				if(currentSector == 0) {
 					/* EOC reached before EOF - try to increase file allocation */
-					myDrive->appendCluster(firstCluster);
+					myDrive->appendCluster(firstCluster, &chainIndex);
 					/* Try getting sector again */
-					currentSector = myDrive->getAbsoluteSectFromBytePos(firstCluster, seekpos);
+					currentSector = myDrive->getAbsoluteSectFromBytePos(firstCluster, seekpos, &chainIndex);
 					if(currentSector == 0) {
 						/* No can do. lets give up and go home.  We must be out of room */
 						goto finalizeWrite;
@@ -228,7 +237,7 @@ bool fatFile::Write(Bit8u * data, Bit16u *size) {
 		if(curSectOff >= myDrive->getSectorSize()) {
 			if(loadedSector) myDrive->writeSector(currentSector, sectorBuffer);
 
-			currentSector = myDrive->getAbsoluteSectFromBytePos(firstCluster, seekpos);
+			currentSector = myDrive->getAbsoluteSectFromBytePos(firstCluster, seekpos, &chainIndex);
 			if(currentSector == 0) loadedSector = false;
 			else {
 				curSectOff = 0;
@@ -269,7 +278,7 @@ bool fatFile::Seek(Bit32u *pos, Bit32u type) {
 
 	if(seekto<0) seekto = 0;
 	seekpos = (Bit32u)seekto;
-	currentSector = myDrive->getAbsoluteSectFromBytePos(firstCluster, seekpos);
+	currentSector = myDrive->getAbsoluteSectFromBytePos(firstCluster, seekpos, &chainIndex);
 	if (currentSector == 0) {
 		/* not within file size, thus no sector is available */
 		loadedSector = false;
@@ -301,11 +310,38 @@ Bit32u fatDrive::getClustFirstSect(Bit32u clustNum) {
 	return ((clustNum - 2) * bootbuffer.sectorspercluster) + firstDataSector;
 }
 
+void fatDrive::loadFatCache(void) {
+	const Bit32u fatSize = bootbuffer.sectorsperfat * bootbuffer.bytespersector;
+	knownDiskWrites = loadedDisk->GetWriteCount();
+	curFatSect = 0xffffffff;
+	fatGeneration++;
+	freeClustHint = 2;
+	if (fatSize > MAX_FAT_CACHE_SIZE) {
+		std::vector<Bit8u>().swap(fatCache);
+		return;
+	}
+	fatCache.assign(fatSize, 0);
+	/* A FAT that failed to load would show its clusters as free, so fall
+	 * back to reading the entries through the sector buffer instead */
+	if (readSectors(bootbuffer.reservedsectors + partSectOff, bootbuffer.sectorsperfat, fatCache.data()) != 0) {
+		LOG_MSG("Couldn't read the FAT of the disk image, reading it a sector at a time.");
+		std::vector<Bit8u>().swap(fatCache);
+	}
+}
+
+/* Reloads the FAT if the disk was written to by someone else, e.g. through
+ * INT 13h, as our cached FAT entries and chain indexes may be stale now */
+void fatDrive::syncFatCache(void) {
+	if (loadedDisk && GCC_UNLIKELY(knownDiskWrites != loadedDisk->GetWriteCount()))
+		loadFatCache();
+}
+
 Bit32u fatDrive::getClusterValue(Bit32u clustNum) {
 	Bit32u fatoffset=0;
 	Bit32u fatsectnum;
 	Bit32u fatentoff;
 	Bit32u clustValue=0;
+	Bit8u *fatEntry;
 
 	switch(fattype) {
 		case FAT12:
@@ -321,17 +357,23 @@ Bit32u fatDrive::getClusterValue(Bit32u clustNum) {
 	fatsectnum = bootbuffer.reservedsectors + (fatoffset / bootbuffer.bytespersector) + partSectOff;
 	fatentoff = fatoffset % bootbuffer.bytespersector;
 
-	if(curFatSect != fatsectnum) {
-		/* Load two sectors at once for FAT12 */
-		readSector(fatsectnum, &fatSectBuffer[0]);
-		if (fattype==FAT12)
-			readSector(fatsectnum+1, &fatSectBuffer[512]);
-		curFatSect = fatsectnum;
+	syncFatCache();
+	if (fatoffset + 1 < fatCache.size()) {
+		fatEntry = &fatCache[fatoffset];
+	} else {
+		if(curFatSect != fatsectnum) {
+			/* Load two sectors at once for FAT12 */
+			readSector(fatsectnum, &fatSectBuffer[0]);
+			if (fattype==FAT12)
+				readSector(fatsectnum+1, &fatSectBuffer[bootbuffer.bytespersector]);
+			curFatSect = fatsectnum;
+		}
+		fatEntry = &fatSectBuffer[fatentoff];
 	}
 
 	switch(fattype) {
 		case FAT12:
-			clustValue = var_read((Bit16u *)&fatSectBuffer[fatentoff]);
+			clustValue = var_read((Bit16u *)fatEntry);
 			if(clustNum & 0x1) {
 				clustValue >>= 4;
 			} else {
@@ -339,10 +381,10 @@ Bit32u fatDrive::getClusterValue(Bit32u clustNum) {
 			}
 			break;
 		case FAT16:
-			clustValue = var_read((Bit16u *)&fatSectBuffer[fatentoff]);
+			clustValue = var_read((Bit16u *)fatEntry);
 			break;
 		case FAT32:
-			clustValue = var_read((Bit32u *)&fatSectBuffer[fatentoff]);
+			clustValue = var_read((Bit32u *)fatEntry);
 			break;
 	}
 
@@ -353,6 +395,7 @@ void fatDrive::setClusterValue(Bit32u clustNum, Bit32u clustValue) {
 	Bit32u fatoffset=0;
 	Bit32u fatsectnum;
 	Bit32u fatentoff;
+	Bit8u *fatSect;
 
 	switch(fattype) {
 		case FAT12:
@@ -368,17 +411,23 @@ void fatDrive::setClusterValue(Bit32u clustNum, Bit32u clustValue) {
 	fatsectnum = bootbuffer.reservedsectors + (fatoffset / bootbuffer.bytespersector) + partSectOff;
 	fatentoff = fatoffset % bootbuffer.bytespersector;
 
-	if(curFatSect != fatsectnum) {
-		/* Load two sectors at once for FAT12 */
-		readSector(fatsectnum, &fatSectBuffer[0]);
-		if (fattype==FAT12)
-			readSector(fatsectnum+1, &fatSectBuffer[512]);
-		curFatSect = fatsectnum;
+	syncFatCache();
+	if (fatoffset + 1 < fatCache.size()) {
+		fatSect = &fatCache[fatoffset - fatentoff];
+	} else {
+		if(curFatSect != fatsectnum) {
+			/* Load two sectors at once for FAT12 */
+			readSector(fatsectnum, &fatSectBuffer[0]);
+			if (fattype==FAT12)
+				readSector(fatsectnum+1, &fatSectBuffer[bootbuffer.bytespersector]);
+			curFatSect = fatsectnum;
+		}
+		fatSect = &fatSectBuffer[0];
 	}
 
 	switch(fattype) {
 		case FAT12: {
-			Bit16u tmpValue = var_read((Bit16u *)&fatSectBuffer[fatentoff]);
+			Bit16u tmpValue = var_read((Bit16u *)&fatSect[fatentoff]);
 			if(clustNum & 0x1) {
 				clustValue &= 0xfff;
 				clustValue <<= 4;
@@ -390,23 +439,25 @@ void fatDrive::setClusterValue(Bit32u clustNum, Bit32u clustValue) {
 				tmpValue &= 0xf000;
 				tmpValue |= (Bit16u)clustValue;
 			}
-			var_write((Bit16u *)&fatSectBuffer[fatentoff], tmpValue);
+			var_write((Bit16u *)&fatSect[fatentoff], tmpValue);
 			break;
 			}
 		case FAT16:
-			var_write((Bit16u *)&fatSectBuffer[fatentoff], (Bit16u)clustValue);
+			var_write((Bit16u *)&fatSect[fatentoff], (Bit16u)clustValue);
 			break;
 		case FAT32:
-			var_write((Bit32u *)&fatSectBuffer[fatentoff], clustValue);
+			var_write((Bit32u *)&fatSect[fatentoff], clustValue);
 			break;
 	}
 	for(int fc=0;fc<bootbuffer.fatcopies;fc++) {
-		writeSector(fatsectnum + (fc * bootbuffer.sectorsperfat), &fatSectBuffer[0]);
+		writeSector(fatsectnum + (fc * bootbuffer.sectorsperfat), &fatSect[0]);
 		if (fattype==FAT12) {
-			if (fatentoff>=511)
-				writeSector(fatsectnum+1+(fc * bootbuffer.sectorsperfat), &fatSectBuffer[512]);
+			if (fatentoff >= bootbuffer.bytespersector - 1u)
+				writeSector(fatsectnum+1+(fc * bootbuffer.sectorsperfat), &fatSect[bootbuffer.bytespersector]);
 		}
 	}
+	if (!clustValue && clustNum < freeClustHint)
+		freeClustHint = clustNum;
 }
 
 bool fatDrive::getEntryName(char *fullname, char *entname) {
@@ -536,15 +587,49 @@ Bit8u fatDrive::writeSector(Bit32u sectnum, void * data) {
 		return 0;
 	}
 
+	/* Our own writes don't invalidate the cached FAT data */
+	const bool inSync = (knownDiskWrites == loadedDisk->GetWriteCount());
+	Bit8u ret;
 	if (absolute) {
-		return loadedDisk->Write_AbsoluteSector(sectnum, data);
+		ret = loadedDisk->Write_AbsoluteSector(sectnum, data);
+	} else {
+		Bit32u cylindersize = bootbuffer.headcount * bootbuffer.sectorspertrack;
+		Bit32u cylinder = sectnum / cylindersize;
+		sectnum %= cylindersize;
+		Bit32u head = sectnum / bootbuffer.sectorspertrack;
+		Bit32u sector = sectnum % bootbuffer.sectorspertrack + 1L;
+		ret = loadedDisk->Write_Sector(head, cylinder, sector, data);
+	}
+	if (inSync)
+		knownDiskWrites = loadedDisk->GetWriteCount();
+	return ret;
+}
+
+Bit8u fatDrive::readSectors(Bit32u sectnum, Bit32u count, void * data) {
+	if (loadedDisk && absolute)
+		return loadedDisk->Read_AbsoluteSectors(sectnum, count, data);
+	Bit8u *buffer = static_cast<Bit8u *>(data);
+	for (Bit32u i = 0; i < count; i++) {
+		const Bit8u ret = readSector(sectnum + i, buffer + i * bootbuffer.bytespersector);
+		if (ret) return ret;
 	}
-	Bit32u cylindersize = bootbuffer.headcount * bootbuffer.sectorspertrack;
-	Bit32u cylinder = sectnum / cylindersize;
-	sectnum %= cylindersize;
-	Bit32u head = sectnum / bootbuffer.sectorspertrack;
-	Bit32u sector = sectnum % bootbuffer.sectorspertrack + 1L;
-	return loadedDisk->Write_Sector(head, cylinder, sector, data);
+	return 0;
+}
+
+Bit8u fatDrive::writeSectors(Bit32u sectnum, Bit32u count, void * data) {
+	if (loadedDisk && absolute) {
+		const bool inSync = (knownDiskWrites == loadedDisk->GetWriteCount());
+		const Bit8u ret = loadedDisk->Write_AbsoluteSectors(sectnum, count, data);
+		if (inSync)
+			knownDiskWrites = loadedDisk->GetWriteCount();
+		return ret;
+	}
+	Bit8u *buffer = static_cast<Bit8u *>(data);
+	for (Bit32u i = 0; i < count; i++) {
+		const Bit8u ret = writeSector(sectnum + i, buffer + i * bootbuffer.bytespersector);
+		if (ret) return ret;
+	}
+	return 0;
 }
 
 Bit32u fatDrive::getSectorSize(void) {
@@ -555,32 +640,85 @@ Bit32u fatDrive::getClusterSize(void) {
 	return bootbuffer.sectorspercluster * bootbuffer.bytespersector;
 }
 
-Bit32u fatDrive::getAbsoluteSectFromBytePos(Bit32u startClustNum, Bit32u bytePos) {
-	return  getAbsoluteSectFromChain(startClustNum, bytePos / bootbuffer.bytespersector);
+Bit32u fatDrive::getAbsoluteSectFromBytePos(Bit32u startClustNum, Bit32u bytePos, fatChainIndex *index) {
+	return  getAbsoluteSectFromChain(startClustNum, bytePos / bootbuffer.bytespersector, index);
+}
+
+bool fatDrive::isEndOfChain(Bit32u clustValue) const {
+	switch(fattype) {
+		case FAT12: return clustValue >= 0xff8;
+		case FAT16: return clustValue >= 0xfff8;
+		case FAT32: return clustValue >= 0xfffffff8;
+	}
+	return true;
+}
+
+void fatDrive::buildChainIndex(Bit32u startClustNum, fatChainIndex &index) {
+	index.runs.clear();
+	index.runs.push_back({0, startClustNum, 1});
+	index.firstCluster = startClustNum;
+	index.generation = fatGeneration;
+	index.valid = true;
+	extendChainIndex(index);
+}
+
+/* Follows the FAT from the last indexed cluster, picking up clusters that
+ * were appended to the chain since, e.g. through another handle to the
+ * same file. Returns whether the chain got longer. */
+bool fatDrive::extendChainIndex(fatChainIndex &index) {
+	Bit32u currentClust = index.LastCluster();
+	Bit32u length = index.Length();
+	bool extended = false;
+	/* The length limit protects against cycles in a damaged FAT */
+	while (length <= CountOfClusters) {
+		const Bit32u nextClust = getClusterValue(currentClust);
+		if (isEndOfChain(nextClust) || nextClust < 2) break;
+		index.Append(nextClust);
+		currentClust = nextClust;
+		length++;
+		extended = true;
+	}
+	return extended;
+}
+
+/* Rebuilds the index if it is for another chain or clusters were freed
+ * since it was built */
+bool fatDrive::syncChainIndex(Bit32u startClustNum, fatChainIndex &index) {
+	syncFatCache();
+	if (index.valid && index.firstCluster == startClustNum &&
+	    index.generation == fatGeneration)
+		return false;
+	buildChainIndex(startClustNum, index);
+	return true;
 }
 
-Bit32u fatDrive::getAbsoluteSectFromChain(Bit32u startClustNum, Bit32u logicalSector) {
+Bit32u fatDrive::getAbsoluteSectFromChain(Bit32u startClustNum, Bit32u logicalSector, fatChainIndex *index) {
 	Bit32s skipClust = logicalSector / bootbuffer.sectorspercluster;
 	Bit32u sectClust = logicalSector % bootbuffer.sectorspercluster;
 
+	if (index && startClustNum >= 2) {
+		const Bit32u logicalClust = (Bit32u)skipClust;
+		const bool rebuilt = syncChainIndex(startClustNum, *index);
+		if (logicalClust >= index->Length() && (rebuilt || !extendChainIndex(*index)))
+			return 0;
+		auto run = std::upper_bound(index->runs.begin(), index->runs.end(), logicalClust,
+		                            [](Bit32u clust, const fatChainIndex::Run &r) {
+			                            return clust < r.logical;
+		                            });
+		--run; // the first run always starts at 0
+		if (logicalClust >= run->logical + run->count) {
+			/* End of cluster chain reached before end of logical sector seek */
+			return 0;
+		}
+		return getClustFirstSect(run->cluster + (logicalClust - run->logical)) + sectClust;
+	}
+
 	Bit32u currentClust = startClustNum;
 	Bit32u testvalue;
 
 	while(skipClust!=0) {
-		bool isEOF = false;
 		testvalue = getClusterValue(currentClust);
-		switch(fattype) {
-			case FAT12:
-				if(testvalue >= 0xff8) isEOF = true;
-				break;
-			case FAT16:
-				if(testvalue >= 0xfff8) isEOF = true;
-				break;
-			case FAT32:
-				if(testvalue >= 0xfffffff8) isEOF = true;
-				break;
-		}
-		if((isEOF) && (skipClust>=1)) {
+		if(isEndOfChain(testvalue)) {
 			//LOG_MSG("End of cluster chain reached before end of logical sector seek!");
 			if (skipClust == 1 && fattype == FAT12) {
 				//break;
@@ -595,7 +733,12 @@ Bit32u fatDrive::getAbsoluteSectFromChain(Bit32u startClustNum, Bit32u logicalSe
 	return (getClustFirstSect(currentClust) + sectClust);
 }
 
-void fatDrive::deleteClustChain(Bit32u startCluster, Bit32u bytePos) {
+void fatDrive::deleteClustChain(Bit32u startCluster, Bit32u bytePos, fatChainIndex *index) {
+	syncFatCache();
+	/* Only an index that was current before the cut can be trimmed */
+	const bool trimIndex = index && index->valid &&
+	                       index->firstCluster == startCluster &&
+	                       index->generation == fatGeneration;
 	Bit32u clustSize = getClusterSize();
 	Bit32u endClust = (bytePos + clustSize - 1) / clustSize;
 	Bit32u countClust = 1;
@@ -641,13 +784,27 @@ void fatDrive::deleteClustChain(Bit32u startCluster, Bit32u bytePos) {
 		currentClust = testvalue;
 		countClust++;
 	}
+	fatGeneration++;
+	if (trimIndex) {
+		index->Truncate(endClust);
+		index->generation = fatGeneration;
+		index->valid = index->Length() > 0;
+	}
 }
 
-Bit32u fatDrive::appendCluster(Bit32u startCluster) {
+Bit32u fatDrive::appendCluster(Bit32u startCluster, fatChainIndex *index) {
 	Bit32u testvalue;
 	Bit32u currentClust = startCluster;
 	bool isEOF = false;
-	
+
+	if (index && startCluster >= 2) {
+		/* The index knows the tail, no need to walk the chain */
+		if (!syncChainIndex(startCluster, *index))
+			extendChainIndex(*index);
+		currentClust = index->LastCluster();
+		isEOF = true;
+	}
+
 	while(!isEOF) {
 		testvalue = getClusterValue(currentClust);
 		switch(fattype) {
@@ -673,6 +830,9 @@ Bit32u fatDrive::appendCluster(Bit32u startCluster) {
 
 	zeroOutCluster(newClust);
 
+	if (index && startCluster >= 2)
+		index->Append(newClust);
+
 	return newClust;
 }
 
@@ -704,13 +864,44 @@ bool fatDrive::allocateCluster(Bit32u useCluster, Bit32u prevCluster) {
 	return true;
 }
 
+/* Opens the image, with writes going to the delta file if one is given.
+ * Returns nullptr if either can't be used. */
+std::unique_ptr<imageDisk> fatDrive::OpenImage(const char *sysFilename,
+                                               const char *deltaFilename)
+{
+	/* With a delta file the image is only read from and can be shared */
+	FILE *diskfile = fopen_wrap(sysFilename, deltaFilename ? "rb" : "rb+");
+	if (!diskfile)
+		return nullptr;
+	const Bit32u filesize = (Bit32u)(get_disk_image_size(diskfile) / 1024L);
+	std::unique_ptr<imageDisk> disk(
+	        new imageDisk(diskfile, sysFilename, filesize, filesize > 2880));
+	if (!disk->created_successfully)
+		return nullptr;
+	if (deltaFilename && !disk->AttachDelta(deltaFilename))
+		return nullptr;
+	return disk;
+}
+
 fatDrive::fatDrive(const char *sysFilename,
+                   Bit32u bytesector,
+                   Bit32u cylsector,
+                   Bit32u headscyl,
+                   Bit32u cylinders,
+                   Bit32u startSector,
+                   const char *deltaFilename)
+	: fatDrive(OpenImage(sysFilename, deltaFilename), sysFilename,
+	           bytesector, cylsector, headscyl, cylinders, startSector)
+{}
+
+fatDrive::fatDrive(std::unique_ptr<imageDisk> disk,
+                   const char *sysFilename,
                    Bit32u bytesector,
                    Bit32u cylsector,
                    Bit32u headscyl,
                    Bit32u cylinders,
                    Bit32u startSector)
-	: loadedDisk(nullptr),
+	: loadedDisk(std::move(disk)),
 	  created_successfully(true),
 	  bootbuffer{{0}, {0}, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, {0}, 0, 0},
 	  absolute(false),
@@ -720,12 +911,13 @@ fatDrive::fatDrive(const char *sysFilename,
 	  firstDataSector(0),
 	  firstRootDirSect(0),
 	  cwdDirCluster(0),
-	  fatSectBuffer{0},
-	  curFatSect(0)
+	  fatSectBuffer(),
+	  curFatSect(0),
+	  fatCache(),
+	  knownDiskWrites(0),
+	  fatGeneration(0),
+	  freeClustHint(2)
 {
-	FILE *diskfile;
-	Bit32u filesize;
-	bool is_hdd;
 	struct partTable mbrData;
 	
 	if(imgDTASeg == 0) {
@@ -734,21 +926,18 @@ fatDrive::fatDrive(const char *sysFilename,
 		imgDTA    = new DOS_DTA(imgDTAPtr);
 	}
 
-	diskfile = fopen_wrap(sysFilename, "rb+");
-	if (!diskfile) {
+	if (!loadedDisk) {
 		created_successfully = false;
 		return;
 	}
-	fseek(diskfile, 0L, SEEK_END);
-	filesize = (Bit32u)ftell(diskfile) / 1024L;
-	is_hdd = (filesize > 2880);
+	const bool is_hdd = loadedDisk->hardDrive;
 
-	/* Load disk image */
-	loadedDisk.reset(new imageDisk(diskfile, sysFilename, filesize, is_hdd));
-
-	if(is_hdd) {
+	if (is_hdd) {
 		/* Set user specified harddrive parameters */
 		loadedDisk->Set_Geometry(headscyl, cylinders,cylsector, bytesector);
+	}
+
+	if(is_hdd) {
 
 		loadedDisk->Read_Sector(0,0,1,&mbrData);
 
@@ -901,8 +1090,9 @@ fatDrive::fatDrive(const char *sysFilename,
 	/* There is no cluster 0, this means we are in the root directory */
 	cwdDirCluster = 0;
 
-	memset(fatSectBuffer,0,1024);
+	fatSectBuffer.assign(2 * bootbuffer.bytespersector, 0);
 	curFatSect = 0xffffffff;
+	loadFatCache();
 
 	safe_strcpy(info, "fatDrive ");
 	safe_strcat(info, sysFilename);
@@ -945,12 +1135,16 @@ bool fatDrive::AllocationInfo(Bit16u *_bytes_sector, Bit8u *_sectors_cluster, Bi
 }
 
 Bit32u fatDrive::getFirstFreeClust(void) {
-	Bit32u i;
-	for(i=0;i<CountOfClusters;i++) {
-		if(!getClusterValue(i+2)) return (i+2);
+	syncFatCache();
+	for (Bit32u clust = std::max<Bit32u>(freeClustHint, 2); clust < CountOfClusters + 2; clust++) {
+		if (!getClusterValue(clust)) {
+			freeClustHint = clust;
+			return clust;
+		}
 	}
 
 	/* No free cluster found */
+	freeClustHint = CountOfClusters + 2;
 	return 0;
 }
 
@@ -1361,14 +1555,8 @@ bool fatDrive::addDirectoryEntry(Bit32u dirClustNumber, direntry useEntry) {
 }
 
 void fatDrive::zeroOutCluster(Bit32u clustNumber) {
-	Bit8u secBuffer[512];
-
-	memset(&secBuffer[0], 0, 512);
-
-	int i;
-	for(i=0;i<bootbuffer.sectorspercluster;i++) {
-		writeSector(getAbsoluteSectFromChain(clustNumber,i), &secBuffer[0]);
-	}
+	std::vector<Bit8u> clustBuffer(getClusterSize(), 0);
+	writeSectors(getClustFirstSect(clustNumber), bootbuffer.sectorspercluster, clustBuffer.data());
 }
 
 bool fatDrive::MakeDir(char *dir) {
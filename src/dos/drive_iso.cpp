@@ -18,6 +18,7 @@
 
 #include "drives.h"
 
+#include <algorithm>
 #include <cctype>
 #include <cstring>
 
@@ -71,41 +72,38 @@ bool isoFile::Read(Bit8u *data, Bit16u *size) {
 	if (filePos + *size > fileEnd)
 		*size = (Bit16u)(fileEnd - filePos);
 
+	static_assert(ISO_FRAMESIZE <= UINT16_MAX, "");
 	uint16_t nowSize = 0;
-	uint32_t sector = filePos / ISO_FRAMESIZE;
-
-	if (static_cast<int>(sector) != cachedSector) {
-		if (drive->readSector(buffer, sector)) {
-			cachedSector = static_cast<int>(sector);
-		} else {
-			*size = 0;
-			cachedSector = -1;
+	while (nowSize < *size) {
+		const uint32_t sector = filePos / ISO_FRAMESIZE;
+		const auto sectorPos = static_cast<uint16_t>(filePos % ISO_FRAMESIZE);
+		const uint16_t remSize = *size - nowSize;
+
+		// Whole sectors go straight to the caller, in a single read
+		if (sectorPos == 0 && remSize >= ISO_FRAMESIZE) {
+			const uint32_t count = remSize / ISO_FRAMESIZE;
+			const uint32_t done = drive->readSectors(&data[nowSize], sector, count);
+			nowSize += static_cast<uint16_t>(done * ISO_FRAMESIZE);
+			filePos += done * ISO_FRAMESIZE;
+			if (done < count)
+				break;
+			continue;
 		}
-	}
-
-	static_assert(ISO_FRAMESIZE <= UINT16_MAX, "");
-	auto sectorPos = static_cast<uint16_t>(filePos % ISO_FRAMESIZE);
 
-	while (nowSize < *size) {
-		Bit16u remSector = ISO_FRAMESIZE - sectorPos;
-		Bit16u remSize = *size - nowSize;
-		if(remSector < remSize) {
-			memcpy(&data[nowSize], &buffer[sectorPos], remSector);
-			nowSize += remSector;
-			sectorPos = 0;
-			sector++;
-			cachedSector++;
+		// The partial sectors at either end go through our buffer
+		if (static_cast<int>(sector) != cachedSector) {
 			if (!drive->readSector(buffer, sector)) {
-				*size = nowSize;
 				cachedSector = -1;
+				break;
 			}
-		} else {
-			memcpy(&data[nowSize], &buffer[sectorPos], remSize);
-			nowSize += remSize;
+			cachedSector = static_cast<int>(sector);
 		}
+		const uint16_t n = std::min<uint16_t>(remSize, ISO_FRAMESIZE - sectorPos);
+		memcpy(&data[nowSize], &buffer[sectorPos], n);
+		nowSize += n;
+		filePos += n;
 	}
 	*size = nowSize;
-	filePos += *size;
 	return true;
 }
 
@@ -143,10 +141,12 @@ Bit16u isoFile::GetInformation(void) {
 	return 0x40;		// read-only drive
 }
 
-isoDrive::isoDrive(char driveLetter, const char *fileName, Bit8u mediaid, int &error)
+isoDrive::isoDrive(char driveLetter, const char *fileName, Bit8u mediaid,
+                   int &error, bool preload)
         : nextFreeDirIterator(0),
           iso(false),
           dataCD(false),
+          preload(preload),
           rootEntry{},
           mediaid(0),
           subUnit(0),
@@ -199,9 +199,14 @@ int isoDrive::UpdateMscdex(char drive_letter, const char *path, uint8_t &sub_uni
 			return 3;
 		}
 		MSCDEX_ReplaceDrive(cdrom, sub_unit);
+		if (preload)
+			CDROM_Interface_Image::images[sub_unit]->PreloadDataTracks();
 		return 0;
 	} else {
-		return MSCDEX_AddDrive(drive_letter, path, sub_unit);
+		const int result = MSCDEX_AddDrive(drive_letter, path, sub_unit);
+		if (preload && result == 0)
+			CDROM_Interface_Image::images[sub_unit]->PreloadDataTracks();
+		return result;
 	}
 }
 
@@ -479,6 +484,11 @@ inline bool isoDrive :: readSector(Bit8u *buffer, Bit32u sector) {
 	return CDROM_Interface_Image::images[subUnit]->ReadSector(buffer, false, sector);
 }
 
+uint32_t isoDrive::readSectors(uint8_t *buffer, uint32_t sector, uint32_t count)
+{
+	return CDROM_Interface_Image::images[subUnit]->ReadSectorsHost(buffer, false, sector, count);
+}
+
 int isoDrive :: readDirEntry(isoDirEntry *de, Bit8u *data) {
 	// copy data into isoDirEntry struct, data[0] = length of DirEntry
 //	if (data[0] > sizeof(isoDirEntry)) return -1;//check disabled as isoDirentry is currently 258 bytes large. So it always fits
@@ -68,11 +68,15 @@ bool localDrive::FileCreate(DOS_File * * file,char * name,Bit16u /*attributes*/)
 		LOG_MSG("Warning: file creation failed: %s",newname);
 		return false;
 	}
+	const std::string host_path = temp_name;
    
 	if (!existing_file) dirCache.AddEntry(newname, true);
 	/* Make the 16 bit device information */
-	*file = new localFile(name, hand, basedir);
-	(*file)->flags=OPEN_READWRITE;
+	auto local_file = new localFile(name, hand, basedir);
+	local_file->flags = OPEN_READWRITE;
+	if (dos.file_read_ahead)
+		local_file->SetHostFileWrites(GetHostFileWrites(host_path));
+	*file = local_file;
 
 	return true;
 }
@@ -125,6 +129,12 @@ bool localDrive::FileOpen(DOS_File **file, char *name, Bit32u flags)
 	safe_strcpy(newname, basedir);
 	safe_strcat(newname, name);
 	CROSS_FILENAME(newname);
+	if (dirCache.IsKnownMissing(newname)) {
+		DOS_SetError(DOSERR_INVALID_HANDLE);
+		return false;
+	}
+	char dosname[CROSS_LEN];
+	safe_strcpy(dosname, newname);
 	dirCache.ExpandName(newname);
 
 	// If the file's already open then flush it before continuing
@@ -134,6 +144,11 @@ bool localDrive::FileOpen(DOS_File **file, char *name, Bit32u flags)
 		open_file->Flush();
 
 	FILE* fhandle = fopen(newname, type);
+	if (!fhandle && errno == ENOENT) {
+		dirCache.AddMissing(dosname, newname);
+		DOS_SetError(DOSERR_INVALID_HANDLE);
+		return false;
+	}
 
 #ifdef DEBUG
 	std::string open_msg;
@@ -190,8 +205,15 @@ bool localDrive::FileOpen(DOS_File **file, char *name, Bit32u flags)
 #endif
 
 	if (fhandle) {
-		*file = new localFile(name, fhandle, basedir);
-		(*file)->flags = flags;  // for the inheritance flag and maybe check for others.
+		auto local_file = new localFile(name, fhandle, basedir);
+		local_file->flags = flags;  // for the inheritance flag and maybe check for others.
+		if (dos.file_read_ahead) {
+			local_file->SetHostFileWrites(GetHostFileWrites(newname));
+			const auto mode = flags & 0xf;
+			if (mode == OPEN_READ || mode == OPEN_READ_NO_MOD)
+				local_file->EnableReadAhead(newname, GetReadAheadWorker());
+		}
+		*file = local_file;
 	} else {
 		// Otherwise we really can't open the file.
 		DOS_SetError(DOSERR_INVALID_HANDLE);
@@ -460,9 +482,17 @@ bool localDrive::FileExists(const char* name) {
 	safe_strcpy(newname, basedir);
 	safe_strcat(newname, name);
 	CROSS_FILENAME(newname);
-	dirCache.ExpandName(newname);
+	// Programs often probe for the same missing files over and over
+	if (dirCache.IsKnownMissing(newname))
+		return false;
+	char expanded[CROSS_LEN];
+	safe_strcpy(expanded, dirCache.GetExpandName(newname));
 	struct stat temp_stat;
-	if (stat(newname,&temp_stat)!=0) return false;
+	if (stat(expanded,&temp_stat)!=0) {
+		if (errno == ENOENT)
+			dirCache.AddMissing(newname, expanded);
+		return false;
+	}
 	if (temp_stat.st_mode & S_IFDIR) return false;
 	return true;
 }
@@ -505,6 +535,34 @@ Bits localDrive::UnMount(void) {
 	return 0; 
 }
 
+localDrive::~localDrive()
+{
+	// Files left open on the drive read synchronously from here on
+	if (read_ahead_worker)
+		read_ahead_worker->Shutdown();
+}
+
+std::shared_ptr<ReadAheadWorker> localDrive::GetReadAheadWorker()
+{
+	if (!read_ahead_worker)
+		read_ahead_worker = std::make_shared<ReadAheadWorker>();
+	return read_ahead_worker;
+}
+
+std::shared_ptr<HostFileWrites> localDrive::GetHostFileWrites(const std::string &path)
+{
+	auto writes = host_file_writes[path].lock();
+	if (writes)
+		return writes;
+
+	// Drop the entries of files no longer open
+	for (auto it = host_file_writes.begin(); it != host_file_writes.end();)
+		it = it->second.expired() ? host_file_writes.erase(it) : std::next(it);
+	writes = std::make_shared<HostFileWrites>();
+	host_file_writes[path] = writes;
+	return writes;
+}
+
 localDrive::localDrive(const char * startdir,
                        Bit16u _bytes_sector,
                        Bit8u _sectors_cluster,
@@ -573,7 +631,18 @@ bool localFile::Read(uint8_t *data, uint16_t *size)
 
 	last_action = READ;
 	const auto requested = *size;
-	const auto actual = static_cast<uint16_t>(fread(data, 1, requested, fhandle));
+	uint16_t actual;
+	if (read_ahead) {
+		// Another handle wrote to the file since we last read it
+		if (read_ahead_writes != host_writes->count) {
+			read_ahead->Invalidate();
+			read_ahead_writes = host_writes->count;
+		}
+		actual = static_cast<uint16_t>(read_ahead->Read(read_ahead_pos, data, requested));
+		read_ahead_pos += actual;
+	} else {
+		actual = static_cast<uint16_t>(fread(data, 1, requested, fhandle));
+	}
 	*size = actual; // always save the actual
 
 	// if (actual != requested)
@@ -620,6 +689,7 @@ bool localFile::Write(uint8_t *data, uint16_t *size)
 			return false;
 		}
 		// Truncation succeeded if we made it here
+		CountWrite();
 		return true;
 	}
 
@@ -630,9 +700,20 @@ bool localFile::Write(uint8_t *data, uint16_t *size)
 		DEBUG_LOG_MSG("FS: Only wrote %u of %u requested bytes to file %s",
 		              actual, requested, name.c_str());
 	*size = actual; // always save the actual
+	CountWrite();
 	return true;    // always return true, even if partially written
 }
 
+// Handles reading the file ahead drop what they hold once they see the
+// count change, and need the new data flushed to read it
+void localFile::CountWrite()
+{
+	if (!host_writes || !host_writes->read_aheads)
+		return;
+	fflush(fhandle);
+	++host_writes->count;
+}
+
 bool localFile::Seek(uint32_t *pos_addr, uint32_t type)
 {
 	int seektype;
@@ -645,6 +726,10 @@ bool localFile::Seek(uint32_t *pos_addr, uint32_t type)
 		return false;//ERROR
 	}
 
+	// Reads ahead leave the handle behind the file position
+	if (read_ahead)
+		static_cast<void>(fseek_to_and_check(read_ahead_pos, SEEK_SET));
+
 	// The inbound position is actually an int32_t being passed through a
 	// uint32_t* pointer (pos_addr), so reinterpret the underlying memory as
 	// such to prevent rollover into the unsigned range.
@@ -671,6 +756,7 @@ bool localFile::Seek(uint32_t *pos_addr, uint32_t type)
 	assert(stream_pos >= std::numeric_limits<int32_t>::min() &&
 	       stream_pos <= std::numeric_limits<int32_t>::max());
 	*reinterpret_cast<int32_t *>(pos_addr) = static_cast<int32_t>(stream_pos);
+	read_ahead_pos = stream_pos;
 
 	last_action = NONE;
 	return true;
@@ -682,6 +768,15 @@ bool localFile::Close() {
 		if (fhandle) fclose(fhandle);
 		fhandle = 0;
 		open = false;
+		if (read_ahead) {
+			DEBUG_LOG_MSG("FS: Read ahead %s: %llu hits, %llu misses, %llu prefetches",
+			              name.c_str(),
+			              static_cast<unsigned long long>(read_ahead->GetHits()),
+			              static_cast<unsigned long long>(read_ahead->GetMisses()),
+			              static_cast<unsigned long long>(read_ahead->GetPrefetches()));
+			read_ahead.reset();
+			--host_writes->read_aheads;
+		}
 	};
 
 	if (newtime) {
@@ -760,6 +855,23 @@ bool localFile::UpdateDateTimeFromHost()
 	return true;
 }
 
+void localFile::SetHostFileWrites(std::shared_ptr<HostFileWrites> writes)
+{
+	host_writes = std::move(writes);
+}
+
+void localFile::EnableReadAhead(const char *path, std::shared_ptr<ReadAheadWorker> worker)
+{
+	assert(host_writes);
+	auto reader = std::make_unique<ReadAhead>(path, std::move(worker));
+	if (!reader->IsOpen() || !ftell_and_check())
+		return;
+	read_ahead = std::move(reader);
+	read_ahead_pos = stream_pos;
+	read_ahead_writes = host_writes->count;
+	++host_writes->read_aheads;
+}
+
 void localFile::Flush()
 {
 	if (last_action != WRITE)
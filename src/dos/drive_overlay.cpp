@@ -320,8 +320,10 @@ Overlay_Drive::Overlay_Drive(const char *startdir,
           deleted_files_in_base{},
           deleted_paths_in_base{},
           overlap_folder(),
+          journal(nullptr),
           DOSnames_cache{},
           DOSdirs_cache{},
+          DOSdirs_lookup{},
           special_prefix("DBOVERLAY")
 {
 	//Currently this flag does nothing, as the current behavior is to not reread due to caching everything.
@@ -355,6 +357,11 @@ Overlay_Drive::Overlay_Drive(const char *startdir,
 	//add_deleted_path(dirname); //update_cache will add the overlap_folder
 	overlap_folder = dirname;
 
+	const std::string journal_path = std::string(overlaydir) + special_prefix + "_JOURNAL";
+	journal = std::make_unique<OverlayJournal>(journal_path);
+	if (!journal->GetError().empty())
+		LOG_MSG("Overlay: can't use %s: %s", journal_path.c_str(), journal->GetError().c_str());
+
 	update_cache(true);
 }
 
@@ -563,10 +570,14 @@ void Overlay_Drive::update_cache(bool read_directory_contents) {
 		//Clear all lists
 		DOSnames_cache.clear();
 		DOSdirs_cache.clear();
+		DOSdirs_lookup.clear();
 		deleted_files_in_base.clear();
 		deleted_paths_in_base.clear();
 		//Ensure hiding of the folder that contains the overlay, if it is part of the base folder.
 		add_deleted_path(overlap_folder.c_str(), false);
+		//Deletions made in earlier sessions
+		for (const auto &name : journal->GetFiles()) add_deleted_file(name.c_str(), false);
+		for (const auto &name : journal->GetDirs()) add_deleted_path(name.c_str(), false);
 	}
 
 	//Needs later to support stored renames and removals of files existing in the localDrive plane.
@@ -698,6 +709,8 @@ void Overlay_Drive::update_cache(bool read_directory_contents) {
 			//Specials look like this DBOVERLAY_YYY_FILENAME.EXT or DIRNAME[\/]DBOVERLAY_YYY_FILENAME.EXT where 
 			//YYY is the operation involved. Currently only DEL is supported.
 			//DEL = file marked as deleted, (but exists in localDrive!)
+			//These marker files were used before the journal; they are moved into it.
+			std::string marker = std::string(overlaydir) + (*i);
 			std::string name(*i);
 			std::string special_dir("");
 			std::string special_file("");
@@ -720,13 +733,14 @@ void Overlay_Drive::update_cache(bool read_directory_contents) {
 				//CROSS_DOSFILENAME for strings:
 				while ( (s = name.find('/')) != std::string::npos) name.replace(s,1,"\\");
 				
-				add_deleted_file(name.c_str(),false);
+				add_deleted_file(name.c_str(),true);
+				unlink(marker.c_str());
 			} else if (special_operation == "RMD") {
 				name = special_dir + special_file;
 				//CROSS_DOSFILENAME for strings:
 				while ( (s = name.find('/')) != std::string::npos) name.replace(s,1,"\\");
-				add_deleted_path(name.c_str(),false);
-
+				add_deleted_path(name.c_str(),true);
+				unlink(marker.c_str());
 			} else {
 				if (logoverlay) LOG_MSG("unsupported operation %s on %s",special_operation.c_str(),(*i).c_str());
 			}
@@ -948,77 +962,37 @@ bool Overlay_Drive::GetFileAttr(char * name,Bit16u * attr) {
 
 
 void Overlay_Drive::add_deleted_file(const char* name,bool create_on_disk) {
+	if (!name || !*name) return;
 	if (logoverlay) LOG_MSG("add del file %s",name);
-	if (!is_deleted_file(name)) {
-		deleted_files_in_base.push_back(name);
-		if (create_on_disk) add_special_file_to_disk(name, "DEL");
-
-	}
-}
-
-void Overlay_Drive::add_special_file_to_disk(const char* dosname, const char* operation) {
-	std::string name = create_filename_of_special_operation(dosname, operation);
-	char overlayname[CROSS_LEN];
-	safe_strcpy(overlayname, overlaydir);
-	safe_strcat(overlayname, name.c_str());
-	CROSS_FILENAME(overlayname);
-	FILE* f = fopen_wrap(overlayname,"wb+");
-	if (!f) {
-		Sync_leading_dirs(dosname);
-		f = fopen_wrap(overlayname,"wb+");
-	}
-	if (!f) E_Exit("Failed creation of %s",overlayname);
-	char buf[5] = {'e','m','p','t','y'};
-	fwrite(buf,5,1,f);
-	fclose(f);
-}
-
-void Overlay_Drive::remove_special_file_from_disk(const char* dosname, const char* operation) {
-	std::string name = create_filename_of_special_operation(dosname,operation);
-	char overlayname[CROSS_LEN];
-	safe_strcpy(overlayname, overlaydir);
-	safe_strcat(overlayname, name.c_str());
-	CROSS_FILENAME(overlayname);
-	if(unlink(overlayname) != 0) E_Exit("Failed removal of %s",overlayname);
+	deleted_files_in_base.insert(name);
+	if (create_on_disk) record_in_journal(true, OverlayJournal::Kind::File, name);
 }
 
-std::string Overlay_Drive::create_filename_of_special_operation(const char* dosname, const char* operation) {
-	std::string res(dosname);
-	std::string::size_type s = res.rfind('\\'); //CHECK DOS or host endings.... on update_cache
-	if (s == std::string::npos) s = 0; else s++;
-	std::string oper = special_prefix + "_" + operation + "_";
-	res.insert(s,oper);
-	return res;
+void Overlay_Drive::record_in_journal(bool add, OverlayJournal::Kind kind, const char* name) {
+	const bool ok = add ? journal->Add(kind, name) : journal->Remove(kind, name);
+	if (!ok) E_Exit("Overlay: failed updating the journal in %s: %s",overlaydir,journal->GetError().c_str());
 }
 
-
 bool Overlay_Drive::is_dir_only_in_overlay(const char* name) {
 	if (!name || !*name) return false;
-	if (DOSdirs_cache.empty()) return false;
-	for(std::vector<std::string>::iterator it = DOSdirs_cache.begin(); it != DOSdirs_cache.end(); ++it) {
-		if (*it == name) return true;
-	}
-	return false;
+	return DOSdirs_lookup.count(name) > 0;
 }
 
 bool Overlay_Drive::is_deleted_file(const char* name) {
 	if (!name || !*name) return false;
-	if (deleted_files_in_base.empty()) return false;
-	for(std::vector<std::string>::iterator it = deleted_files_in_base.begin(); it != deleted_files_in_base.end(); ++it) {
-		if (*it == name) return true;
-	}
-	return false;
+	return deleted_files_in_base.count(name) > 0;
 }
 
 void Overlay_Drive::add_DOSdir_to_cache(const char* name) {
 	if (!name || !*name ) return; //Skip empty file.
 	LOG_MSG("Adding name to overlay_only_dir_cache %s",name);
-	if (!is_dir_only_in_overlay(name)) {
+	if (DOSdirs_lookup.insert(name).second) {
 		DOSdirs_cache.push_back(name); 
 	}
 }
 
 void Overlay_Drive::remove_DOSdir_from_cache(const char* name) {
+	if (!DOSdirs_lookup.erase(name)) return;
 	for(std::vector<std::string>::iterator it = DOSdirs_cache.begin(); it != DOSdirs_cache.end(); ++it) {
 		if ( *it == name) {
 			DOSdirs_cache.erase(it);
@@ -1028,48 +1002,37 @@ void Overlay_Drive::remove_DOSdir_from_cache(const char* name) {
 }
 
 void Overlay_Drive::remove_deleted_file(const char* name,bool create_on_disk) {
-	for(std::vector<std::string>::iterator it = deleted_files_in_base.begin(); it != deleted_files_in_base.end(); ++it) {
-		if (*it == name) {
-			deleted_files_in_base.erase(it);
-			if (create_on_disk) remove_special_file_from_disk(name, "DEL");
-			return;
-		}
-	}
+	deleted_files_in_base.erase(name);
+	if (create_on_disk) record_in_journal(false, OverlayJournal::Kind::File, name);
 }
 void Overlay_Drive::add_deleted_path(const char* name, bool create_on_disk) {
 	if (!name || !*name ) return; //Skip empty file.
 	if (logoverlay) LOG_MSG("add del path %s",name);
+	if (create_on_disk) record_in_journal(true, OverlayJournal::Kind::Dir, name);
 	if (!is_deleted_path(name)) {
-		deleted_paths_in_base.push_back(name);
+		deleted_paths_in_base.insert(name);
 		//Add it to deleted files as well, so it gets skipped in FindNext. 
 		//Maybe revise that.
-		if (create_on_disk) add_special_file_to_disk(name,"RMD");
 		add_deleted_file(name,false);
 	}
 }
 bool Overlay_Drive::is_deleted_path(const char* name) {
 	if (!name || !*name) return false;
 	if (deleted_paths_in_base.empty()) return false;
+	//The path itself or one of its leading directories
 	std::string sname(name);
-	std::string::size_type namelen = sname.length();;
-	for(std::vector<std::string>::iterator it = deleted_paths_in_base.begin(); it != deleted_paths_in_base.end(); ++it) {
-		std::string::size_type blockedlen = (*it).length();
-		if (namelen < blockedlen) continue;
-		//See if input starts with name. 
-		std::string::size_type n = sname.find(*it);
-		if (n == 0 && ((namelen == blockedlen) || *(name + blockedlen) == '\\' )) return true;
+	std::string::size_type end = sname.length();
+	while (end != std::string::npos && end != 0) {
+		if (deleted_paths_in_base.count(sname.substr(0, end))) return true;
+		end = sname.rfind('\\', end - 1);
 	}
 	return false;
 }
 
 void Overlay_Drive::remove_deleted_path(const char* name, bool create_on_disk) {
-	for(std::vector<std::string>::iterator it = deleted_paths_in_base.begin(); it != deleted_paths_in_base.end(); ++it) {
-		if (*it == name) {
-			deleted_paths_in_base.erase(it);
-			remove_deleted_file(name,false); //Rethink maybe.
-			if (create_on_disk) remove_special_file_from_disk(name,"RMD");
-			break;
-		}
+	if (create_on_disk) record_in_journal(false, OverlayJournal::Kind::Dir, name);
+	if (deleted_paths_in_base.erase(name)) {
+		remove_deleted_file(name,false); //Rethink maybe.
 	}
 }
 bool Overlay_Drive::check_if_leading_is_deleted(const char* name){
@@ -722,12 +722,19 @@ void DOSBOX_Init(void) {
 	Pstring->Set_help("Type of OPL emulation. On 'auto' the mode is determined by 'sbtype'.\n"
 	                  "All OPL modes are AdLib-compatible, except for 'cms'.");
 
-	const char* oplemus[] = {"default", "compat", "fast", "mame", "nuked", 0};
+	const char* oplemus[] = {"default", "compat", "fast", "mame", "nuked", "nukedfast", 0};
 	Pstring = secprop->Add_string("oplemu", Property::Changeable::WhenIdle, "default");
 	Pstring->Set_values(oplemus);
 	Pstring->Set_help(
 	        "Provider for the OPL emulation. 'compat' provides better quality,\n"
-	        "'nuked' is the default and most accurate (but the most CPU-intensive).");
+	        "'nuked' is the default and most accurate (but the most CPU-intensive).\n"
+	        "'nukedfast' renders exactly the same output as 'nuked', using less CPU.");
+
+	Pbool = secprop->Add_bool("oplthread", Property::Changeable::WhenIdle, false);
+	Pbool->Set_help(
+	        "Render the 'nuked' and 'nukedfast' OPL emulation on a separate thread,\n"
+	        "applying register writes at their exact sample positions.\n"
+	        "Delays the OPL output by 2 ms and needs a spare CPU core.");
 
 	// Configure Gravis UltraSound emulation
 	GUS_AddConfigSection(control);
@@ -879,6 +886,23 @@ void DOSBOX_Init(void) {
 	                  "A single number is treated as the major version.\n"
 	                  "Common settings are 3.3, 5.0, 6.22, and 7.1.");
 
+	Pbool = secprop->Add_bool("file_read_ahead", when_idle, false);
+	Pbool->Set_help("Read files opened read-only on mounted directories ahead of\n"
+	                "the program on a background thread (disabled by default).\n"
+	                "Helps games streaming video or audio from slow host disks.");
+
+	Pint = secprop->Add_int("cdrom_cache", when_idle, 1024);
+	Pint->SetMinMax(0, 65536);
+	Pint->Set_help("Size in KB of the sector cache kept for each CD-ROM image mounted\n"
+	               "with imgmount (1024 by default); 0 disables it. Applies to CD images\n"
+	               "only: directories mounted as CD-ROM drives aren't cached.\n"
+	               "Shared by MSCDEX and the CD-ROM drive of the image.");
+
+	Pint = secprop->Add_int("cdrom_preload_limit", when_idle, 1024);
+	Pint->SetMinMax(0, 4096);
+	Pint->Set_help("Most MB of data tracks loaded into memory for each CD-ROM image\n"
+	               "mounted with 'imgmount -preload' (1024 by default).");
+
 	secprop->AddInitFunction(&DOS_KeyboardLayout_Init,true);
 	Pstring = secprop->Add_string("keyboardlayout",Property::Changeable::WhenIdle, "auto");
 	Pstring->Set_help("Language code of the keyboard layout (or none).");
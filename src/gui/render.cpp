@@ -31,6 +31,7 @@
 #include "render.h"
 #include "setup.h"
 #include "control.h"
+#include "frame_trace.h"
 #include "mapper.h"
 #include "cross.h"
 #include "hardware.h"
@@ -198,6 +199,7 @@ bool RENDER_StartUpdate(void) {
 		}
 	}
 	render.updating = true;
+	FRAMETRACE_Mark(FrameEvent::RenderStart);
 	return true;
 }
 
@@ -212,6 +214,7 @@ extern Bitu PIC_Ticks;
 void RENDER_EndUpdate( bool abort ) {
 	if (GCC_UNLIKELY(!render.updating))
 		return;
+	FRAMETRACE_Mark(FrameEvent::RenderEnd);
 	RENDER_DrawLine = RENDER_EmptyLineHandler;
 	if (GCC_UNLIKELY(CaptureState & (CAPTURE_IMAGE|CAPTURE_VIDEO))) {
 		Bitu pitch, flags;
@@ -46,6 +46,7 @@
 #include "cpu.h"
 #include "cross.h"
 #include "debug.h"
+#include "frame_trace.h"
 #include "fs_utils.h"
 #include "gui_msgs.h"
 #include "joystick.h"
@@ -1558,13 +1559,36 @@ void GFX_EndUpdate( const Bit16u *changedLines ) {
 	switch (sdl.desktop.type) {
 	case SCREEN_TEXTURE:
 		assert(sdl.texture.input_surface);
-		SDL_UpdateTexture(sdl.texture.texture,
-		                  nullptr, // update entire texture
-		                  sdl.texture.input_surface->pixels,
-		                  sdl.texture.input_surface->pitch);
+		if (changedLines) {
+			// Upload only the line spans rewritten by the scaler; the
+			// input surface keeps the unchanged lines between frames.
+			const auto surface = sdl.texture.input_surface;
+			int y = 0;
+			size_t index = 0;
+			while (y < sdl.draw.height) {
+				if (!(index & 1)) {
+					y += changedLines[index];
+				} else {
+					const SDL_Rect rect = {0, y, sdl.draw.width,
+					                       changedLines[index]};
+					const auto pixels = static_cast<uint8_t *>(surface->pixels) +
+					                    y * surface->pitch;
+					SDL_UpdateTexture(sdl.texture.texture, &rect,
+					                  pixels, surface->pitch);
+					y += changedLines[index];
+				}
+				index++;
+			}
+		} else {
+			SDL_UpdateTexture(sdl.texture.texture,
+			                  nullptr, // update entire texture
+			                  sdl.texture.input_surface->pixels,
+			                  sdl.texture.input_surface->pitch);
+		}
 		SDL_RenderClear(sdl.renderer);
 		SDL_RenderCopy(sdl.renderer, sdl.texture.texture, NULL, &sdl.clip);
 		SDL_RenderPresent(sdl.renderer);
+		FRAMETRACE_Mark(FrameEvent::Present);
 		break;
 #if C_OPENGL
 	case SCREEN_OPENGL:
@@ -1618,6 +1642,7 @@ void GFX_EndUpdate( const Bit16u *changedLines ) {
 			glCallList(sdl.opengl.displaylist);
 		}
 		SDL_GL_SwapWindow(sdl.window);
+		FRAMETRACE_Mark(FrameEvent::Present);
 		break;
 #endif
 	case SCREEN_SURFACE:
@@ -1642,6 +1667,7 @@ void GFX_EndUpdate( const Bit16u *changedLines ) {
 				SDL_UpdateWindowSurfaceRects(sdl.window,
 				                             sdl.updateRects,
 				                             rect_count);
+			FRAMETRACE_Mark(FrameEvent::Present);
 		}
 		break;
 	}
@@ -1731,6 +1757,7 @@ static void GUI_ShutDown(Section *)
 	if (mouse_is_captured)
 		GFX_ToggleMouseCapture();
 	CleanupSDLResources();
+	FRAMETRACE_Stop();
 }
 
 static void SetPriority(PRIORITY_LEVELS level)
@@ -2216,6 +2243,12 @@ static void GUI_StartUp(Section *sec)
 	if (screensaver == "block")
 		SDL_DisableScreenSaver();
 
+	const std::string frame_trace = section->Get_string("frame_trace");
+	if (frame_trace == "on")
+		FRAMETRACE_Start("");
+	else if (frame_trace != "off" && !frame_trace.empty())
+		FRAMETRACE_Start(frame_trace);
+
 	sdl.texture.texture = 0;
 	sdl.texture.pixelFormat = 0;
 	sdl.render_driver = section->Get_string("texture_renderer");
@@ -2561,6 +2594,16 @@ bool GFX_Events()
 	}
 #endif
 	while (SDL_PollEvent(&event)) {
+		switch (event.type) {
+		case SDL_KEYDOWN:
+		case SDL_KEYUP:
+		case SDL_MOUSEMOTION:
+		case SDL_MOUSEBUTTONDOWN:
+		case SDL_MOUSEBUTTONUP:
+			FRAMETRACE_Mark(FrameEvent::Input);
+			break;
+		default: break;
+		}
 		switch (event.type) {
 		case SDL_WINDOWEVENT:
 			switch (event.window.event) {
@@ -2993,6 +3036,15 @@ void Config_Add_SDL() {
 	        "while the emulator is running).");
 	const char *ssopts[] = {"auto", "allow", "block", 0};
 	pstring->Set_values(ssopts);
+
+	pstring = sdl_sec->Add_string("frame_trace", on_start, "off");
+	pstring->Set_help(
+	        "Measure frame pacing and latency between the emulated vertical\n"
+	        "retrace, rendering, presenting the frame and input events.\n"
+	        "  off:    Disabled (default).\n"
+	        "  on:     Log latency statistics on exit.\n"
+	        "  <file>: Also write all events to the given file on exit,\n"
+	        "          in Chrome trace format if it ends in .json, or as CSV.");
 }
 
 static void show_warning(char const * const message) {
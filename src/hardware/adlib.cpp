@@ -28,188 +28,6 @@
 #include "support.h"
 #include "mapper.h"
 #include "mem.h"
-#include "dbopl.h"
-#include "../libs/nuked/opl3.h"
-
-#include "mame/emu.h"
-#include "mame/fmopl.h"
-#include "mame/ymf262.h"
-
-
-#define OPL2_INTERNAL_FREQ    3600000   // The OPL2 operates at 3.6MHz
-#define OPL3_INTERNAL_FREQ    14400000  // The OPL3 operates at 14.4MHz
-
-namespace OPL2 {
-	#include "opl.cpp"
-
-	struct Handler : public Adlib::Handler {
-		virtual void WriteReg( Bit32u reg, Bit8u val ) {
-			adlib_write(reg,val);
-		}
-		virtual Bit32u WriteAddr( Bit32u /*port*/, Bit8u val ) {
-			return val;
-		}
-
-		virtual void Generate( MixerChannel* chan, Bitu samples ) {
-			Bit16s buf[1024];
-			while( samples > 0 ) {
-				Bitu todo = samples > 1024 ? 1024 : samples;
-				samples -= todo;
-				adlib_getsample(buf, todo);
-				chan->AddSamples_m16( todo, buf );
-			}
-		}
-		virtual void Init( Bitu rate ) {
-			adlib_init(rate);
-		}
-		~Handler() {
-		}
-	};
-}
-
-namespace OPL3 {
-	#define OPLTYPE_IS_OPL3
-	#include "opl.cpp"
-
-	struct Handler : public Adlib::Handler {
-		virtual void WriteReg( Bit32u reg, Bit8u val ) {
-			adlib_write(reg,val);
-		}
-		virtual Bit32u WriteAddr( Bit32u port, Bit8u val ) {
-			adlib_write_index(port, val);
-			return opl_index;
-		}
-		virtual void Generate( MixerChannel* chan, Bitu samples ) {
-			Bit16s buf[1024*2];
-			while( samples > 0 ) {
-				Bitu todo = samples > 1024 ? 1024 : samples;
-				samples -= todo;
-				adlib_getsample(buf, todo);
-				chan->AddSamples_s16( todo, buf );
-			}
-		}
-		virtual void Init( Bitu rate ) {
-			adlib_init(rate);
-		}
-		~Handler() {
-		}
-	};
-}
-
-namespace MAMEOPL2 {
-
-struct Handler : public Adlib::Handler {
-	void *chip = nullptr;
-
-	virtual void WriteReg(Bit32u reg, Bit8u val) {
-		ym3812_write(chip, 0, reg);
-		ym3812_write(chip, 1, val);
-	}
-	virtual Bit32u WriteAddr(Bit32u /*port*/, Bit8u val) {
-		return val;
-	}
-	virtual void Generate(MixerChannel* chan, Bitu samples) {
-		Bit16s buf[1024 * 2];
-		while (samples > 0) {
-			Bitu todo = samples > 1024 ? 1024 : samples;
-			samples -= todo;
-			ym3812_update_one(chip, buf, todo);
-			chan->AddSamples_m16(todo, buf);
-		}
-	}
-	virtual void Init(Bitu rate) {
-		chip = ym3812_init(0, OPL2_INTERNAL_FREQ, rate);
-	}
-	~Handler() {
-		ym3812_shutdown(chip);
-	}
-};
-
-}
-
-
-namespace MAMEOPL3 {
-
-struct Handler : public Adlib::Handler {
-	void *chip = nullptr;
-
-	virtual void WriteReg(Bit32u reg, Bit8u val) {
-		ymf262_write(chip, 0, reg);
-		ymf262_write(chip, 1, val);
-	}
-	virtual Bit32u WriteAddr(Bit32u /*port*/, Bit8u val) {
-		return val;
-	}
-	virtual void Generate(MixerChannel* chan, Bitu samples) {
-		//We generate data for 4 channels, but only the first 2 are connected on a pc
-		Bit16s buf[4][1024];
-		Bit16s result[1024][2];
-		Bit16s* buffers[4] = { buf[0], buf[1], buf[2], buf[3] };
-
-		while (samples > 0) {
-			Bitu todo = samples > 1024 ? 1024 : samples;
-			samples -= todo;
-			ymf262_update_one(chip, buffers, todo);
-			//Interleave the samples before mixing
-			for (Bitu i = 0; i < todo; i++) {
-				result[i][0] = buf[0][i];
-				result[i][1] = buf[1][i];
-			}
-			chan->AddSamples_s16(todo, result[0]);
-		}
-	}
-	virtual void Init(Bitu rate) {
-		chip = ymf262_init(0, OPL3_INTERNAL_FREQ, rate);
-	}
-	~Handler() {
-		ymf262_shutdown(chip);
-	}
-};
-
-}
-
-namespace NukedOPL {
-
-struct Handler : public Adlib::Handler {
-	opl3_chip chip = {};
-	Bit8u newm = 0;
-
-	void WriteReg(Bit32u reg, Bit8u val) override
-	{
-		OPL3_WriteRegBuffered(&chip, (Bit16u)reg, val);
-		if (reg == 0x105)
-			newm = reg & 0x01;
-	}
-
-	Bit32u WriteAddr(Bit32u port, Bit8u val) override
-	{
-		Bit16u addr;
-		addr = val;
-		if ((port & 2) && (addr == 0x05 || newm)) {
-			addr |= 0x100;
-		}
-		return addr;
-	}
-
-	void Generate(MixerChannel *chan, Bitu samples) override
-	{
-		int16_t buf[1024 * 2];
-		while (samples > 0) {
-			uint32_t todo = samples > 1024 ? 1024 : samples;
-			OPL3_GenerateStream(&chip, buf, todo);
-			chan->AddSamples_s16(todo, buf);
-			samples -= todo;
-		}
-	}
-
-	void Init(Bitu rate) override
-	{
-		newm = 0;
-		OPL3_Reset(&chip, rate);
-	}
-};
-
-} // namespace NukedOPL
 
 /*
 	Main Adlib implementation
@@ -740,8 +558,35 @@ void Module::Init( Mode m ) {
 
 static Adlib::Module* module = 0;
 
+//Passes the generated samples on to the mixer channel
+class MixerSink final : public Adlib::SampleSink {
+public:
+	explicit MixerSink(MixerChannel *chan_) : chan(chan_) {}
+
+	void AddSamples_m16(Bitu len, const Bit16s *data) override
+	{
+		chan->AddSamples_m16(len, data);
+	}
+	void AddSamples_s16(Bitu len, const Bit16s *data) override
+	{
+		chan->AddSamples_s16(len, data);
+	}
+	void AddSamples_m32(Bitu len, const Bit32s *data) override
+	{
+		chan->AddSamples_m32(len, data);
+	}
+	void AddSamples_s32(Bitu len, const Bit32s *data) override
+	{
+		chan->AddSamples_s32(len, data);
+	}
+
+private:
+	MixerChannel *chan;
+};
+
 static void OPL_CallBack(Bitu len) {
-	module->handler->Generate( module->mixerChan, len );
+	MixerSink sink(module->mixerChan);
+	module->handler->Generate( sink, len );
 	//Disable the sound generation after 30 seconds of silence
 	if ((PIC_Ticks - module->lastUsed) > 30000) {
 		Bitu i;
@@ -820,29 +665,6 @@ static void OPL_SaveRawEvent(bool pressed) {
 
 namespace Adlib {
 
-static Handler * make_opl_handler(const std::string &oplemu, OPL_Mode mode)
-{
-	if (oplemu == "fast") {
-		return new DBOPL::Handler();
-	}
-	if (oplemu == "compat") {
-		if (mode == OPL_opl2)
-			return new OPL2::Handler();
-		else
-			return new OPL3::Handler();
-	}
-	if (oplemu == "mame") {
-		if (mode == OPL_opl2)
-			return new MAMEOPL2::Handler();
-		else
-			return new MAMEOPL3::Handler();
-	}
-	if (oplemu == "nuked") {
-		return new NukedOPL::Handler();
-	}
-	return new NukedOPL::Handler();
-}
-
 Module::Module(Section *configuration)
 	: Module_base(configuration),
 	  mixerObject(),
@@ -863,7 +685,8 @@ Module::Module(Section *configuration)
 	//Used to be 2.0, which was measured to be too high. Exact value depends on card/clone.
 	mixerChan->SetScale( 1.5f );  
 
-	handler = make_opl_handler(section->Get_string("oplemu"), oplmode);
+	handler = make_opl_handler(section->Get_string("oplemu"), oplmode,
+	                           section->Get_bool("oplthread"));
 	handler->Init(mixerChan->GetSampleRate());
 
 	bool single = false;
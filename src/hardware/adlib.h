@@ -28,6 +28,7 @@
 #include "hardware.h"
 
 #include <cmath>
+#include <string>
 
 namespace Adlib {
 
@@ -131,6 +132,17 @@ typedef enum {
 	MODE_OPL3GOLD
 } Mode;
 
+//Receives the samples a handler generates, in the handler's own format:
+//the mixer channel when emulating, or a plain buffer when benchmarking
+class SampleSink {
+public:
+	virtual void AddSamples_m16(Bitu len, const Bit16s *data) = 0;
+	virtual void AddSamples_s16(Bitu len, const Bit16s *data) = 0;
+	virtual void AddSamples_m32(Bitu len, const Bit32s *data) = 0;
+	virtual void AddSamples_s32(Bitu len, const Bit32s *data) = 0;
+	virtual ~SampleSink() = default;
+};
+
 class Handler {
 public:
 	//Write an address to a chip, returns the address the chip sets
@@ -138,12 +150,16 @@ public:
 	//Write to a specific register in the chip
 	virtual void WriteReg( Bit32u addr, Bit8u val ) = 0;
 	//Generate a certain amount of samples
-	virtual void Generate( MixerChannel* chan, Bitu samples ) = 0;
+	virtual void Generate( SampleSink &sink, Bitu samples ) = 0;
 	//Initialize at a specific sample rate and mode
 	virtual void Init( Bitu rate ) = 0;
 	virtual ~Handler() = default;
 };
 
+//Create the handler for an oplemu setting, the threaded one renders nuked
+//on a separate thread
+Handler *make_opl_handler(const std::string &oplemu, OPL_Mode mode, bool threaded);
+
 //The cache for 2 chips or an opl3
 typedef Bit8u RegisterCache[512];
 
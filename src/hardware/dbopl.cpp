@@ -1530,16 +1530,16 @@ void Handler::WriteReg( Bit32u addr, Bit8u val ) {
 	chip.WriteReg( addr, val );
 }
 
-void Handler::Generate( MixerChannel* chan, Bitu samples ) {
+void Handler::Generate( Adlib::SampleSink &sink, Bitu samples ) {
 	Bit32s buffer[ 512 * 2 ];
 	if ( GCC_UNLIKELY(samples > 512) )
 		samples = 512;
 	if ( !chip.opl3Active ) {
 		chip.GenerateBlock2( samples, buffer );
-		chan->AddSamples_m32( samples, buffer );
+		sink.AddSamples_m32( samples, buffer );
 	} else {
 		chip.GenerateBlock3( samples, buffer );
-		chan->AddSamples_s32( samples, buffer );
+		sink.AddSamples_s32( samples, buffer );
 	}
 }
 
@@ -18,6 +18,9 @@
 
 
 #include <string.h>
+
+#include <algorithm>
+
 #include "dosbox.h"
 #include "mem.h"
 #include "inout.h"
@@ -41,16 +44,22 @@ static void UpdateEMSMapping(void) {
 	}
 }
 
-/* read a block from physical memory */
-static void DMA_BlockRead(PhysPt spage,PhysPt offset,void * data,Bitu size,Bit8u dma16) {
-	Bit8u * write=(Bit8u *) data;
-	Bitu highpart_addr_page = spage>>12;
+/* Walk the pages a transfer touches, handing each contiguous span within a
+ * page to copy() along with its host address in memory. The DMA address
+ * only wraps at page boundaries, so the page mapping is looked up once per
+ * page rather than for every byte. 16-bit transfers move whole words, so
+ * they're simply twice as many bytes. */
+template <typename Copy>
+static void DMA_WalkBlock(PhysPt spage,PhysPt offset,Bitu size,Bit8u dma16,const char *dir,Copy copy) {
+	const Bitu highpart_addr_page = spage>>12;
+	const Bitu mem_pages = MEM_TotalPages();
 	size <<= dma16;
 	offset <<= dma16;
-	Bit32u dma_wrap = ((0xffff<<dma16)+dma16) | dma_wrapping;
-	for ( ; size ; size--, offset++) {
+	const Bit32u dma_wrap = ((0xffff<<dma16)+dma16) | dma_wrapping;
+	Bitu done = 0;
+	while (done < size) {
 		if (offset>(dma_wrapping<<dma16)) {
-			LOG_MSG("DMA segbound wrapping (read): %x:%x size %" sBitfs(x) " [%x] wrap %x",spage,offset,size,dma16,dma_wrapping);
+			LOG_MSG("DMA segbound wrapping (%s): %x:%x size %" sBitfs(x) " [%x] wrap %x",dir,spage,offset,size-done,dma16,dma_wrapping);
 		}
 		offset &= dma_wrap;
 		Bitu page = highpart_addr_page+(offset >> 12);
@@ -58,29 +67,30 @@ static void DMA_BlockRead(PhysPt spage,PhysPt offset,void * data,Bitu size,Bit8u
 		if (page < EMM_PAGEFRAME4K) page = paging.firstmb[page];
 		else if (page < EMM_PAGEFRAME4K+0x10) page = ems_board_mapping[page];
 		else if (page < LINK_START) page = paging.firstmb[page];
-		*write++=phys_readb(page*4096 + (offset & 4095));
+		const Bitu page_offset = offset & 4095;
+		const Bitu todo = std::min(size - done, 4096 - page_offset);
+		/* pages past the end of memory aren't backed by anything */
+		copy(page < mem_pages ? MemBase + page*4096 + page_offset : nullptr, done, todo);
+		done += todo;
+		offset += (PhysPt)todo;
 	}
 }
 
+/* read a block from physical memory */
+static void DMA_BlockRead(PhysPt spage,PhysPt offset,void * data,Bitu size,Bit8u dma16) {
+	Bit8u * write=(Bit8u *) data;
+	DMA_WalkBlock(spage,offset,size,dma16,"read",[write](HostPt mem,Bitu pos,Bitu len) {
+		if (mem) memcpy(write+pos,mem,len);
+		else memset(write+pos,0xff,len);
+	});
+}
+
 /* write a block into physical memory */
 static void DMA_BlockWrite(PhysPt spage,PhysPt offset,void * data,Bitu size,Bit8u dma16) {
-	Bit8u * read=(Bit8u *) data;
-	Bitu highpart_addr_page = spage>>12;
-	size <<= dma16;
-	offset <<= dma16;
-	Bit32u dma_wrap = ((0xffff<<dma16)+dma16) | dma_wrapping;
-	for ( ; size ; size--, offset++) {
-		if (offset>(dma_wrapping<<dma16)) {
-			LOG_MSG("DMA segbound wrapping (write): %x:%x size %" sBitfs(x) " [%x] wrap %x",spage,offset,size,dma16,dma_wrapping);
-		}
-		offset &= dma_wrap;
-		Bitu page = highpart_addr_page+(offset >> 12);
-		/* care for EMS pageframe etc. */
-		if (page < EMM_PAGEFRAME4K) page = paging.firstmb[page];
-		else if (page < EMM_PAGEFRAME4K+0x10) page = ems_board_mapping[page];
-		else if (page < LINK_START) page = paging.firstmb[page];
-		phys_writeb(page*4096 + (offset & 4095), *read++);
-	}
+	const Bit8u * read=(const Bit8u *) data;
+	DMA_WalkBlock(spage,offset,size,dma16,"write",[read](HostPt mem,Bitu pos,Bitu len) {
+		if (mem) memcpy(mem,read+pos,len);
+	});
 }
 
 DmaChannel * GetDMAChannel(Bit8u chan) {
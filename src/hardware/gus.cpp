@@ -21,6 +21,7 @@
 
 #include "dosbox.h"
 
+#include <algorithm>
 #include <array>
 #include <iomanip>
 #include <memory>
@@ -29,6 +30,7 @@
 
 #include "control.h"
 #include "dma.h"
+#include "gus_voice.h"
 #include "hardware.h"
 #include "mixer.h"
 #include "pic.h"
@@ -44,15 +46,6 @@
 // AdLib emulation state constant
 constexpr uint8_t ADLIB_CMD_DEFAULT = 85u;
 
-// Amplitude level constants
-constexpr float AUDIO_SAMPLE_MAX = static_cast<float>(MAX_AUDIO);
-constexpr float AUDIO_SAMPLE_MIN = static_cast<float>(MIN_AUDIO);
-
-// Buffer and memory constants
-constexpr int BUFFER_FRAMES = 48;
-constexpr int BUFFER_SAMPLES = BUFFER_FRAMES * 2; // 2 samples/frame (left & right)
-constexpr uint32_t RAM_SIZE = 1024 * 1024;        // 1 MiB
-
 // DMA transfer size and rate constants
 constexpr uint32_t BYTES_PER_DMA_XFER = 8 * 1024;         // 8 KiB per transfer
 constexpr uint32_t ISA_BUS_THROUGHPUT = 32 * 1024 * 1024; // 32 MiB/s
@@ -62,7 +55,6 @@ constexpr float MS_PER_DMA_XFER = 1000.0f / DMA_TRANSFERS_PER_S;
 // Voice-channel and state related constants
 constexpr uint8_t MAX_VOICES = 32u;
 constexpr uint8_t MIN_VOICES = 14u;
-constexpr uint8_t VOICE_DEFAULT_STATE = 3u;
 
 // DMA and IRQ extents and quantities
 constexpr uint8_t MIN_DMA_ADDRESS = 0u;
@@ -72,124 +64,24 @@ constexpr uint8_t MAX_IRQ_ADDRESS = 15u;
 constexpr uint8_t DMA_IRQ_ADDRESSES = 8u; // number of IRQ and DMA channels
 constexpr uint16_t DMA_TC_STATUS_BITMASK = 0b100000000; // Status in 9th bit
 
-// Pan position constants
-constexpr uint8_t PAN_DEFAULT_POSITION = 7u;
-constexpr uint8_t PAN_POSITIONS = 16u;  // 0: -45-deg, 7: centre, 15: +45-deg
-
 // Timer delay constants
 constexpr float TIMER_1_DEFAULT_DELAY = 0.080f;
 constexpr float TIMER_2_DEFAULT_DELAY = 0.320f;
 
 // Volume scaling and dampening constants
-constexpr auto DELTA_DB = 0.002709201;     // 0.0235 dB increments
-constexpr int16_t VOLUME_INC_SCALAR = 512; // Volume index increment scalar
-constexpr uint16_t VOLUME_LEVELS = 4096u;
-
-// Interwave addressing constant
-constexpr int16_t WAVE_WIDTH = 1 << 9; // Wave interpolation width (9 bits)
+constexpr auto DELTA_DB = 0.002709201; // 0.0235 dB increments
 
 // IO address quantities
 constexpr uint8_t READ_HANDLERS = 8u;
 constexpr uint8_t WRITE_HANDLERS = 9u;
 
-// A group of parameters defining the Gus's voice IRQ control that's also shared
-// (as a reference) into each instantiated voice.
-struct VoiceIrq {
-	uint32_t vol_state = 0u;
-	uint32_t wave_state = 0u;
-	uint8_t status = 0u;
-};
-
-// A group of parameters used in the Voice class to track the Wave and Volume
-// controls.
-struct VoiceCtrl {
-	uint32_t &irq_state;
-	int32_t start = 0;
-	int32_t end = 0;
-	int32_t pos = 0;
-	int32_t inc = 0;
-	uint16_t rate = 0;
-	uint8_t state = VOICE_DEFAULT_STATE;
-};
-
 // Collection types involving constant quantities
-using accumulator_array_t = std::array<float, BUFFER_SAMPLES>;
 using address_array_t = std::array<uint8_t, DMA_IRQ_ADDRESSES>;
 using autoexec_array_t = std::array<AutoexecObject, 2>;
-using pan_scalars_array_t = std::array<AudioFrame, PAN_POSITIONS>;
-using ram_array_t = std::array<uint8_t, RAM_SIZE>;
 using read_io_array_t = std::array<IO_ReadHandleObject, READ_HANDLERS>;
-using vol_scalars_array_t = std::array<float, VOLUME_LEVELS>;
 using write_io_array_t = std::array<IO_WriteHandleObject, WRITE_HANDLERS>;
 using mixer_channel_ptr_t = std::unique_ptr<MixerChannel, decltype(&MIXER_DelChannel)>;
 
-// A Voice is used by the Gus class and instantiates 32 of these.
-// Each voice represents a single "mono" stream of audio having its own
-// characteristics defined by the running program, such as:
-//   - being 8bit or 16bit
-//   - having a "position" along a left-right axis (panned)
-//   - having its volume reduced by some amount (native-level down to 0)
-//   - having start, stop, loop, and loop-backward controls
-//   - informing the GUS DSP as to when an IRQ is needed to keep it playing
-//
-class Voice {
-public:
-	Voice(uint8_t num, VoiceIrq &irq) noexcept;
-	void GenerateSamples(accumulator_array_t &stream,
-	                     const ram_array_t &ram,
-	                     const vol_scalars_array_t &vol_scalars,
-	                     const pan_scalars_array_t &pan_scalars,
-	                     const int requested_frames,
-	                     const bool dac_enabled);
-
-	uint8_t ReadVolState() const noexcept;
-	uint8_t ReadWaveState() const noexcept;
-	void ResetCtrls() noexcept;
-	void WritePanPot(uint8_t pos) noexcept;
-	void WriteVolRate(uint16_t rate) noexcept;
-	void WriteWaveRate(uint16_t rate) noexcept;
-	bool UpdateVolState(uint8_t state) noexcept;
-	bool UpdateWaveState(uint8_t state) noexcept;
-
-	VoiceCtrl vol_ctrl;
-	VoiceCtrl wave_ctrl;
-
-	uint32_t generated_8bit_ms = 0u;
-	uint32_t generated_16bit_ms = 0u;
-
-private:
-	Voice() = delete;
-	Voice(const Voice &) = delete;            // prevent copying
-	Voice &operator=(const Voice &) = delete; // prevent assignment
-	bool CheckWaveRolloverCondition() noexcept;
-	bool Is8Bit() const noexcept;
-	float GetVolScalar(const vol_scalars_array_t &vol_scalars);
-	float GetSample(const ram_array_t &ram) noexcept;
-	int32_t PopWavePos() noexcept;
-	float PopVolScalar(const vol_scalars_array_t &vol_scalars);
-	float Read8BitSample(const ram_array_t &ram, const int32_t addr) const noexcept;
-	float Read16BitSample(const ram_array_t &ram, const int32_t addr) const noexcept;
-	uint8_t ReadCtrlState(const VoiceCtrl &ctrl) const noexcept;
-	void IncrementCtrlPos(VoiceCtrl &ctrl, bool skip_loop) noexcept;
-	bool UpdateCtrlState(VoiceCtrl &ctrl, uint8_t state) noexcept;
-
-	// Control states
-	enum CTRL : uint8_t {
-		RESET = 0x01,
-		STOPPED = 0x02,
-		DISABLED = RESET | STOPPED,
-		BIT16 = 0x04,
-		LOOP = 0x08,
-		BIDIRECTIONAL = 0x10,
-		RAISEIRQ = 0x20,
-		DECREASING = 0x40,
-	};
-
-	uint32_t irq_mask = 0u;
-	uint8_t &shared_irq_status;
-	uint8_t pan_position = PAN_DEFAULT_POSITION;
-};
-
 static void GUS_TimerEvent(Bitu t);
 static void GUS_DMA_Event(Bitu val);
 
@@ -327,267 +219,6 @@ uint8_t adlib_commandreg = ADLIB_CMD_DEFAULT;
 
 static std::unique_ptr<Gus> gus = nullptr;
 
-Voice::Voice(uint8_t num, VoiceIrq &irq) noexcept
-        : vol_ctrl{irq.vol_state},
-          wave_ctrl{irq.wave_state},
-          irq_mask(1 << num),
-          shared_irq_status(irq.status)
-{}
-
-/*
-Gravis SDK, Section 3.11. Rollover feature:
-	Each voice has a 'rollover' feature that allows an application to be notified
-	when a voice's playback position passes over a particular place in DRAM.  This
-	is very useful for getting seamless digital audio playback.  Basically, the GF1
-	will generate an IRQ when a voice's current position is  equal to the end
-	position.  However, instead of stopping or looping back to the start position,
-	the voice will continue playing in the same direction.  This means that there
-	will be no pause (or gap) in the playback.
-
-	Note that this feature is enabled/disabled through the voice's VOLUME control
-	register (since there are no more bits available in the voice control
-	registers).   A voice's loop enable bit takes precedence over the rollover. This
-	means that if a voice's loop enable is on, it will loop when it hits the end
-	position, regardless of the state of the rollover enable.
----
-Joh Campbell, maintainer of DOSox-X:
-	Despite the confusing description above, that means that looping takes
-	precedence over rollover. If not looping, then rollover means to fire the IRQ
-	but keep moving. If looping, then fire IRQ and carry out loop behavior. Gravis
-	Ultrasound Windows 3.1 drivers expect this behavior, else Windows WAVE output
-	will not work correctly.
-*/
-bool Voice::CheckWaveRolloverCondition() noexcept
-{
-	return (vol_ctrl.state & CTRL::BIT16) && !(wave_ctrl.state & CTRL::LOOP);
-}
-
-void Voice::IncrementCtrlPos(VoiceCtrl &ctrl, bool dont_loop_or_restart) noexcept
-{
-	if (ctrl.state & CTRL::DISABLED)
-		return;
-	int32_t remaining = 0;
-	if (ctrl.state & CTRL::DECREASING) {
-		ctrl.pos -= ctrl.inc;
-		remaining = ctrl.start - ctrl.pos;
-	} else {
-		ctrl.pos += ctrl.inc;
-		remaining = ctrl.pos - ctrl.end;
-	}
-	// Not yet reaching a boundary
-	if (remaining < 0)
-		return;
-
-	// Generate an IRQ if requested
-	if (ctrl.state & CTRL::RAISEIRQ) {
-		ctrl.irq_state |= irq_mask;
-	}
-
-	// Allow the current position to move beyond its limit
-	if (dont_loop_or_restart)
-		return;
-
-	// Should we loop?
-	if (ctrl.state & CTRL::LOOP) {
-		/* Bi-directional looping */
-		if (ctrl.state & CTRL::BIDIRECTIONAL)
-			ctrl.state ^= CTRL::DECREASING;
-		ctrl.pos = (ctrl.state & CTRL::DECREASING)
-		                   ? ctrl.end - remaining
-		                   : ctrl.start + remaining;
-	}
-	// Otherwise, restart the position back to its start or end
-	else {
-		ctrl.state |= 1; // Stop the voice
-		ctrl.pos = (ctrl.state & CTRL::DECREASING) ? ctrl.start : ctrl.end;
-	}
-	return;
-}
-
-bool Voice::Is8Bit() const noexcept
-{
-	return !(wave_ctrl.state & CTRL::BIT16);
-}
-
-float Voice::GetSample(const ram_array_t &ram) noexcept
-{
-	const int32_t pos = PopWavePos();
-	const auto addr = pos / WAVE_WIDTH;
-	const auto fraction = pos & (WAVE_WIDTH - 1);
-	const bool should_interpolate = wave_ctrl.inc < WAVE_WIDTH && fraction;
-	float sample = Is8Bit() ? Read8BitSample(ram, addr)
-	                        : Read16BitSample(ram, addr);
-	if (should_interpolate) {
-		const auto next_addr = addr + 1;
-		const float next_sample = Is8Bit() ? Read8BitSample(ram, next_addr)
-		                                   : Read16BitSample(ram, next_addr);
-		constexpr float WAVE_WIDTH_INV = 1.0f / WAVE_WIDTH;
-		sample += (next_sample - sample) *
-		          static_cast<float>(fraction) * WAVE_WIDTH_INV;
-	}
-	assert(sample >= AUDIO_SAMPLE_MIN && sample <= AUDIO_SAMPLE_MAX);
-	return sample;
-}
-
-void Voice::GenerateSamples(accumulator_array_t &stream,
-                            const ram_array_t &ram,
-                            const vol_scalars_array_t &vol_scalars,
-                            const pan_scalars_array_t &pan_scalars,
-                            const int requested_frames,
-                            const bool dac_enabled)
-{
-	if (vol_ctrl.state & wave_ctrl.state & CTRL::DISABLED)
-		return;
-
-	// Setup our iterators and pan percents
-	auto v = stream.begin();
-	const auto last_v = v + static_cast<size_t>(requested_frames) * 2;
-	assert(last_v <= stream.end());
-	const auto pan_scalar = pan_scalars.at(pan_position);
-
-	// Add the samples to the stream, angled in L-R space
-	while (v < last_v) {
-		float sample = GetSample(ram);
-		sample *= PopVolScalar(vol_scalars);
-		if (dac_enabled) {
-			*v++ += sample * pan_scalar.left;
-			*v++ += sample * pan_scalar.right;
-		}
-	}
-	// Keep track of how many ms this voice has generated
-	Is8Bit() ? generated_8bit_ms++ : generated_16bit_ms++;
-}
-
-// Returns the current wave position and increments the position
-// to the next wave position.
-int32_t Voice::PopWavePos() noexcept
-{
-	const int32_t current_pos = wave_ctrl.pos;
-	IncrementCtrlPos(wave_ctrl, CheckWaveRolloverCondition());
-	return current_pos;
-}
-
-// Returns the current vol scalar and increments the volume control's position.
-float Voice::PopVolScalar(const vol_scalars_array_t &vol_scalars)
-{
-	// transform the current position into an index into the volume array
-	const auto i = ceil_sdivide(vol_ctrl.pos, VOLUME_INC_SCALAR);
-	IncrementCtrlPos(vol_ctrl, false); // don't check wave rollover
-	return vol_scalars.at(static_cast<size_t>(i));
-}
-
-// Read an 8-bit sample scaled into the 16-bit range, returned as a float
-float Voice::Read8BitSample(const ram_array_t &ram, const int32_t addr) const noexcept
-{
-	const auto i = static_cast<size_t>(addr) & 0xfffffu;
-	constexpr auto bits_in_16 = std::numeric_limits<int16_t>::digits;
-	constexpr auto bits_in_8 = std::numeric_limits<int8_t>::digits;
-	constexpr float to_16bit_range = 1 << (bits_in_16 - bits_in_8);
-	return static_cast<int8_t>(ram.at(i)) * to_16bit_range;
-}
-
-// Read a 16-bit sample returned as a float
-float Voice::Read16BitSample(const ram_array_t &ram, const int32_t addr) const noexcept
-{
-	// Calculate offset of the 16-bit sample
-	const auto lower = addr & 0b1100'0000'0000'0000'0000;
-	const auto upper = addr & 0b0001'1111'1111'1111'1111;
-	const auto i = static_cast<size_t>(lower | (upper << 1));
-	return static_cast<int16_t>(host_readw(&ram.at(i)));
-}
-
-uint8_t Voice::ReadCtrlState(const VoiceCtrl &ctrl) const noexcept
-{
-	uint8_t state = ctrl.state;
-	if (ctrl.irq_state & irq_mask)
-		state |= 0x80;
-	return state;
-}
-
-uint8_t Voice::ReadVolState() const noexcept
-{
-	return ReadCtrlState(vol_ctrl);
-}
-
-uint8_t Voice::ReadWaveState() const noexcept
-{
-	return ReadCtrlState(wave_ctrl);
-}
-
-void Voice::ResetCtrls() noexcept
-{
-	vol_ctrl.pos = 0u;
-	UpdateVolState(0x1);
-	UpdateWaveState(0x1);
-	WritePanPot(PAN_DEFAULT_POSITION);
-}
-
-bool Voice::UpdateCtrlState(VoiceCtrl &ctrl, uint8_t state) noexcept
-{
-	const uint32_t orig_irq_state = ctrl.irq_state;
-	// Manually set the irq
-	if ((state & 0xa0) == 0xa0)
-		ctrl.irq_state |= irq_mask;
-	else
-		ctrl.irq_state &= ~irq_mask;
-
-	// Always update the state
-	ctrl.state = state & 0x7f;
-
-	// Indicate if the IRQ state changed
-	return orig_irq_state != ctrl.irq_state;
-}
-
-bool Voice::UpdateVolState(uint8_t state) noexcept
-{
-	return UpdateCtrlState(vol_ctrl, state);
-}
-
-bool Voice::UpdateWaveState(uint8_t state) noexcept
-{
-	return UpdateCtrlState(wave_ctrl, state);
-}
-
-void Voice::WritePanPot(uint8_t pos) noexcept
-{
-	constexpr uint8_t max_pos = PAN_POSITIONS - 1;
-	pan_position = std::min(pos, max_pos);
-}
-
-// Four volume-index-rate "banks" are available that define the number of
-// volume indexes that will be incremented (or decremented, depending on the
-// volume_ctrl value) each step, for a given voice.  The banks are:
-//
-// - 0 to 63, which defines single index increments,
-// - 64 to 127 defines fractional index increments by 1/8th,
-// - 128 to 191 defines fractional index increments by 1/64ths, and
-// - 192 to 255 defines fractional index increments by 1/512ths.
-//
-// To ensure the smallest increment (1/512) effects an index change, we
-// normalize all the volume index variables (including this) by multiplying by
-// VOLUME_INC_SCALAR (or 512). Note that "index" qualifies all these variables
-// because they are merely indexes into the vol_scalars[] array. The actual
-// volume scalar value (a floating point fraction between 0.0 and 1.0) is never
-// actually operated on, and is simply looked up from the final index position
-// at the time of sample population.
-void Voice::WriteVolRate(uint16_t val) noexcept
-{
-	vol_ctrl.rate = val;
-	constexpr uint8_t bank_lengths = 63u;
-	const int pos_in_bank = val & bank_lengths;
-	const int decimator = 1 << (3 * (val >> 6));
-	vol_ctrl.inc = ceil_sdivide(pos_in_bank * VOLUME_INC_SCALAR, decimator);
-
-	// Sanity check the bounds of the incrementer
-	assert(vol_ctrl.inc >= 0 && vol_ctrl.inc <= bank_lengths * VOLUME_INC_SCALAR);
-}
-
-void Voice::WriteWaveRate(uint16_t val) noexcept
-{
-	wave_ctrl.rate = val;
-	wave_ctrl.inc = ceil_udivide(val, 2u);
-}
-
 Gus::Gus(uint16_t port, uint8_t dma, uint8_t irq, const std::string &ultradir)
         : soft_limiter("GUS", mixer_level),
           port_base(port - 0x200u),
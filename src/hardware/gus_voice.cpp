@@ -0,0 +1,356 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2020-2021  The DOSBox Staging Team
+ *  Copyright (C) 2002-2021  The DOSBox Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "gus_voice.h"
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+#include "mem.h"
+#include "support.h"
+
+Voice::Voice(uint8_t num, VoiceIrq &irq) noexcept
+        : vol_ctrl{irq.vol_state},
+          wave_ctrl{irq.wave_state},
+          irq_mask(1 << num),
+          shared_irq_status(irq.status)
+{}
+
+/*
+Gravis SDK, Section 3.11. Rollover feature:
+	Each voice has a 'rollover' feature that allows an application to be notified
+	when a voice's playback position passes over a particular place in DRAM.  This
+	is very useful for getting seamless digital audio playback.  Basically, the GF1
+	will generate an IRQ when a voice's current position is  equal to the end
+	position.  However, instead of stopping or looping back to the start position,
+	the voice will continue playing in the same direction.  This means that there
+	will be no pause (or gap) in the playback.
+
+	Note that this feature is enabled/disabled through the voice's VOLUME control
+	register (since there are no more bits available in the voice control
+	registers).   A voice's loop enable bit takes precedence over the rollover. This
+	means that if a voice's loop enable is on, it will loop when it hits the end
+	position, regardless of the state of the rollover enable.
+---
+Joh Campbell, maintainer of DOSox-X:
+	Despite the confusing description above, that means that looping takes
+	precedence over rollover. If not looping, then rollover means to fire the IRQ
+	but keep moving. If looping, then fire IRQ and carry out loop behavior. Gravis
+	Ultrasound Windows 3.1 drivers expect this behavior, else Windows WAVE output
+	will not work correctly.
+*/
+bool Voice::CheckWaveRolloverCondition() noexcept
+{
+	return (vol_ctrl.state & CTRL::BIT16) && !(wave_ctrl.state & CTRL::LOOP);
+}
+
+void Voice::IncrementCtrlPos(VoiceCtrl &ctrl, bool dont_loop_or_restart) noexcept
+{
+	if (ctrl.state & CTRL::DISABLED)
+		return;
+	int32_t remaining = 0;
+	if (ctrl.state & CTRL::DECREASING) {
+		ctrl.pos -= ctrl.inc;
+		remaining = ctrl.start - ctrl.pos;
+	} else {
+		ctrl.pos += ctrl.inc;
+		remaining = ctrl.pos - ctrl.end;
+	}
+	// Not yet reaching a boundary
+	if (remaining < 0)
+		return;
+
+	// Generate an IRQ if requested
+	if (ctrl.state & CTRL::RAISEIRQ) {
+		ctrl.irq_state |= irq_mask;
+	}
+
+	// Allow the current position to move beyond its limit
+	if (dont_loop_or_restart)
+		return;
+
+	// Should we loop?
+	if (ctrl.state & CTRL::LOOP) {
+		/* Bi-directional looping */
+		if (ctrl.state & CTRL::BIDIRECTIONAL)
+			ctrl.state ^= CTRL::DECREASING;
+		ctrl.pos = (ctrl.state & CTRL::DECREASING)
+		                   ? ctrl.end - remaining
+		                   : ctrl.start + remaining;
+	}
+	// Otherwise, restart the position back to its start or end
+	else {
+		ctrl.state |= 1; // Stop the voice
+		ctrl.pos = (ctrl.state & CTRL::DECREASING) ? ctrl.start : ctrl.end;
+	}
+	return;
+}
+
+bool Voice::Is8Bit() const noexcept
+{
+	return !(wave_ctrl.state & CTRL::BIT16);
+}
+
+// Fills positions with the control's position at each of the frames,
+// stepping it once per frame as IncrementCtrlPos does. The positions move
+// linearly between the boundaries, so only the steps reaching one go
+// through IncrementCtrlPos while the spans in between are filled in one go.
+void Voice::PopCtrlPositions(VoiceCtrl &ctrl, int32_t *positions,
+                             const int frames, bool dont_loop_or_restart) noexcept
+{
+	assert(ctrl.inc >= 0);
+	int i = 0;
+	while (i < frames) {
+		if (ctrl.state & CTRL::DISABLED) {
+			std::fill(positions + i, positions + frames, ctrl.pos);
+			return;
+		}
+		const bool decreasing = ctrl.state & CTRL::DECREASING;
+		const int32_t step = decreasing ? -ctrl.inc : ctrl.inc;
+
+		// Count the steps falling short of the boundary
+		const int64_t distance = decreasing
+		                                 ? static_cast<int64_t>(ctrl.pos) - ctrl.start
+		                                 : static_cast<int64_t>(ctrl.end) - ctrl.pos;
+		int64_t free_steps = 0;
+		if (distance > 0)
+			free_steps = ctrl.inc ? (distance - 1) / ctrl.inc : frames;
+
+		// Rolling over only raises the IRQ, so the position moves on
+		// linearly for the rest of the frames
+		const int span = dont_loop_or_restart
+		                         ? frames - i
+		                         : static_cast<int>(std::min<int64_t>(
+		                                   free_steps, frames - i));
+		const int32_t pos = ctrl.pos;
+		for (int j = 0; j < span; ++j)
+			positions[i + j] = pos + j * step;
+		ctrl.pos = pos + span * step;
+		i += span;
+
+		if (dont_loop_or_restart) {
+			if (free_steps < span && (ctrl.state & CTRL::RAISEIRQ))
+				ctrl.irq_state |= irq_mask;
+			return;
+		}
+		if (i < frames) {
+			positions[i++] = ctrl.pos;
+			IncrementCtrlPos(ctrl, false);
+		}
+	}
+}
+
+// Reads the wave at each of the positions, interpolating between adjacent
+// samples when the wave plays slower than the output rate. The samples are
+// gathered first so the interpolation runs as a plain loop the compiler can
+// vectorize; interpolating by a zero fraction gives back the sample itself,
+// so that loop is the same for every position.
+template <typename SampleReader>
+void Voice::ReadWave(const SampleReader &read_sample,
+                     const int32_t *positions,
+                     float *samples,
+                     const int frames) const noexcept
+{
+	// Gather the samples around each position
+	std::array<float, BUFFER_FRAMES> curr_samples;
+	std::array<float, BUFFER_FRAMES> next_samples;
+	for (int i = 0; i < frames; ++i) {
+		const auto addr = positions[i] / WAVE_WIDTH;
+		curr_samples[i] = read_sample(addr);
+		next_samples[i] = read_sample(addr + 1);
+	}
+	// Then interpolate between them
+	constexpr float WAVE_WIDTH_INV = 1.0f / WAVE_WIDTH;
+	const int32_t fraction_mask = wave_ctrl.inc < WAVE_WIDTH ? WAVE_WIDTH - 1 : 0;
+	for (int i = 0; i < frames; ++i) {
+		const auto fraction = positions[i] & fraction_mask;
+		const float sample = curr_samples[i];
+		samples[i] = sample + (next_samples[i] - sample) *
+		                              static_cast<float>(fraction) * WAVE_WIDTH_INV;
+		assert(samples[i] >= AUDIO_SAMPLE_MIN && samples[i] <= AUDIO_SAMPLE_MAX);
+	}
+}
+
+void Voice::GenerateSamples(accumulator_array_t &stream,
+                            const ram_array_t &ram,
+                            const vol_scalars_array_t &vol_scalars,
+                            const pan_scalars_array_t &pan_scalars,
+                            const int requested_frames,
+                            const bool dac_enabled)
+{
+	if (vol_ctrl.state & wave_ctrl.state & CTRL::DISABLED)
+		return;
+
+	assert(requested_frames <= BUFFER_FRAMES);
+	const int frames = requested_frames;
+
+	// Step the wave and volume controls through the whole block first
+	std::array<int32_t, BUFFER_FRAMES> wave_positions;
+	std::array<int32_t, BUFFER_FRAMES> vol_positions;
+	PopCtrlPositions(wave_ctrl, wave_positions.data(), frames,
+	                 CheckWaveRolloverCondition());
+	PopCtrlPositions(vol_ctrl, vol_positions.data(), frames, false);
+
+	// Then render the samples for all of them
+	std::array<float, BUFFER_FRAMES> samples;
+	if (Is8Bit())
+		ReadWave([&](int32_t addr) { return Read8BitSample(ram, addr); },
+		         wave_positions.data(), samples.data(), frames);
+	else
+		ReadWave([&](int32_t addr) { return Read16BitSample(ram, addr); },
+		         wave_positions.data(), samples.data(), frames);
+
+	// Transform the volume positions into indexes into the volume array,
+	// clamped in case a loop overshot the array
+	constexpr int max_vol_index = VOLUME_LEVELS - 1;
+	std::array<int32_t, BUFFER_FRAMES> vol_indexes;
+	for (int i = 0; i < frames; ++i) {
+		const auto vol_index = ceil_sdivide(vol_positions[i], VOLUME_INC_SCALAR);
+		vol_indexes[i] = std::min(std::max(vol_index, 0), max_vol_index);
+	}
+	for (int i = 0; i < frames; ++i)
+		samples[i] *= vol_scalars[static_cast<size_t>(vol_indexes[i])];
+
+	// Add the samples to the stream, angled in L-R space
+	if (dac_enabled) {
+		const auto pan_scalar = pan_scalars.at(pan_position);
+		float *v = stream.data();
+		for (int i = 0; i < frames; ++i) {
+			v[i * 2] += samples[i] * pan_scalar.left;
+			v[i * 2 + 1] += samples[i] * pan_scalar.right;
+		}
+	}
+	// Keep track of how many ms this voice has generated
+	Is8Bit() ? generated_8bit_ms++ : generated_16bit_ms++;
+}
+
+// Read an 8-bit sample scaled into the 16-bit range, returned as a float
+float Voice::Read8BitSample(const ram_array_t &ram, const int32_t addr) const noexcept
+{
+	const auto i = static_cast<size_t>(addr) & 0xfffffu;
+	constexpr auto bits_in_16 = std::numeric_limits<int16_t>::digits;
+	constexpr auto bits_in_8 = std::numeric_limits<int8_t>::digits;
+	constexpr float to_16bit_range = 1 << (bits_in_16 - bits_in_8);
+	return static_cast<int8_t>(ram[i]) * to_16bit_range;
+}
+
+// Read a 16-bit sample returned as a float
+float Voice::Read16BitSample(const ram_array_t &ram, const int32_t addr) const noexcept
+{
+	// Calculate offset of the 16-bit sample
+	const auto lower = addr & 0b1100'0000'0000'0000'0000;
+	const auto upper = addr & 0b0001'1111'1111'1111'1111;
+	const auto i = static_cast<size_t>(lower | (upper << 1));
+	return static_cast<int16_t>(host_readw(&ram[i]));
+}
+
+uint8_t Voice::ReadCtrlState(const VoiceCtrl &ctrl) const noexcept
+{
+	uint8_t state = ctrl.state;
+	if (ctrl.irq_state & irq_mask)
+		state |= 0x80;
+	return state;
+}
+
+uint8_t Voice::ReadVolState() const noexcept
+{
+	return ReadCtrlState(vol_ctrl);
+}
+
+uint8_t Voice::ReadWaveState() const noexcept
+{
+	return ReadCtrlState(wave_ctrl);
+}
+
+void Voice::ResetCtrls() noexcept
+{
+	vol_ctrl.pos = 0u;
+	UpdateVolState(0x1);
+	UpdateWaveState(0x1);
+	WritePanPot(PAN_DEFAULT_POSITION);
+}
+
+bool Voice::UpdateCtrlState(VoiceCtrl &ctrl, uint8_t state) noexcept
+{
+	const uint32_t orig_irq_state = ctrl.irq_state;
+	// Manually set the irq
+	if ((state & 0xa0) == 0xa0)
+		ctrl.irq_state |= irq_mask;
+	else
+		ctrl.irq_state &= ~irq_mask;
+
+	// Always update the state
+	ctrl.state = state & 0x7f;
+
+	// Indicate if the IRQ state changed
+	return orig_irq_state != ctrl.irq_state;
+}
+
+bool Voice::UpdateVolState(uint8_t state) noexcept
+{
+	return UpdateCtrlState(vol_ctrl, state);
+}
+
+bool Voice::UpdateWaveState(uint8_t state) noexcept
+{
+	return UpdateCtrlState(wave_ctrl, state);
+}
+
+void Voice::WritePanPot(uint8_t pos) noexcept
+{
+	constexpr uint8_t max_pos = PAN_POSITIONS - 1;
+	pan_position = std::min(pos, max_pos);
+}
+
+// Four volume-index-rate "banks" are available that define the number of
+// volume indexes that will be incremented (or decremented, depending on the
+// volume_ctrl value) each step, for a given voice.  The banks are:
+//
+// - 0 to 63, which defines single index increments,
+// - 64 to 127 defines fractional index increments by 1/8th,
+// - 128 to 191 defines fractional index increments by 1/64ths, and
+// - 192 to 255 defines fractional index increments by 1/512ths.
+//
+// To ensure the smallest increment (1/512) effects an index change, we
+// normalize all the volume index variables (including this) by multiplying by
+// VOLUME_INC_SCALAR (or 512). Note that "index" qualifies all these variables
+// because they are merely indexes into the vol_scalars[] array. The actual
+// volume scalar value (a floating point fraction between 0.0 and 1.0) is never
+// actually operated on, and is simply looked up from the final index position
+// at the time of sample population.
+void Voice::WriteVolRate(uint16_t val) noexcept
+{
+	vol_ctrl.rate = val;
+	constexpr uint8_t bank_lengths = 63u;
+	const int pos_in_bank = val & bank_lengths;
+	const int decimator = 1 << (3 * (val >> 6));
+	vol_ctrl.inc = ceil_sdivide(pos_in_bank * VOLUME_INC_SCALAR, decimator);
+
+	// Sanity check the bounds of the incrementer
+	assert(vol_ctrl.inc >= 0 && vol_ctrl.inc <= bank_lengths * VOLUME_INC_SCALAR);
+}
+
+void Voice::WriteWaveRate(uint16_t val) noexcept
+{
+	wave_ctrl.rate = val;
+	wave_ctrl.inc = ceil_udivide(val, 2u);
+}
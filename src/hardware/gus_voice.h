@@ -0,0 +1,154 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2020-2021  The DOSBox Staging Team
+ *  Copyright (C) 2002-2021  The DOSBox Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOSBOX_GUS_VOICE_H
+#define DOSBOX_GUS_VOICE_H
+
+/* The voices of the Gravis UltraSound, kept apart from the card's port, DMA
+ * and mixer handling so they can be tested and benchmarked on their own */
+
+#include "dosbox.h"
+
+#include <array>
+#include <cstdint>
+
+#include "mixer.h"
+
+// Amplitude level constants
+constexpr float AUDIO_SAMPLE_MAX = static_cast<float>(MAX_AUDIO);
+constexpr float AUDIO_SAMPLE_MIN = static_cast<float>(MIN_AUDIO);
+
+// Buffer and memory constants
+constexpr int BUFFER_FRAMES = 48;
+constexpr int BUFFER_SAMPLES = BUFFER_FRAMES * 2; // 2 samples/frame (left & right)
+constexpr uint32_t RAM_SIZE = 1024 * 1024;        // 1 MiB
+
+// Voice state constant
+constexpr uint8_t VOICE_DEFAULT_STATE = 3u;
+
+// Pan position constants
+constexpr uint8_t PAN_DEFAULT_POSITION = 7u;
+constexpr uint8_t PAN_POSITIONS = 16u;  // 0: -45-deg, 7: centre, 15: +45-deg
+
+// Volume scaling constants
+constexpr int16_t VOLUME_INC_SCALAR = 512; // Volume index increment scalar
+constexpr uint16_t VOLUME_LEVELS = 4096u;
+
+// Interwave addressing constant
+constexpr int16_t WAVE_WIDTH = 1 << 9; // Wave interpolation width (9 bits)
+
+// A group of parameters defining the Gus's voice IRQ control that's also shared
+// (as a reference) into each instantiated voice.
+struct VoiceIrq {
+	uint32_t vol_state = 0u;
+	uint32_t wave_state = 0u;
+	uint8_t status = 0u;
+};
+
+// A group of parameters used in the Voice class to track the Wave and Volume
+// controls.
+struct VoiceCtrl {
+	uint32_t &irq_state;
+	int32_t start = 0;
+	int32_t end = 0;
+	int32_t pos = 0;
+	int32_t inc = 0;
+	uint16_t rate = 0;
+	uint8_t state = VOICE_DEFAULT_STATE;
+};
+
+// Collection types involving constant quantities
+using accumulator_array_t = std::array<float, BUFFER_SAMPLES>;
+using pan_scalars_array_t = std::array<AudioFrame, PAN_POSITIONS>;
+using ram_array_t = std::array<uint8_t, RAM_SIZE>;
+using vol_scalars_array_t = std::array<float, VOLUME_LEVELS>;
+
+// A Voice is used by the Gus class and instantiates 32 of these.
+// Each voice represents a single "mono" stream of audio having its own
+// characteristics defined by the running program, such as:
+//   - being 8bit or 16bit
+//   - having a "position" along a left-right axis (panned)
+//   - having its volume reduced by some amount (native-level down to 0)
+//   - having start, stop, loop, and loop-backward controls
+//   - informing the GUS DSP as to when an IRQ is needed to keep it playing
+//
+class Voice {
+public:
+	Voice(uint8_t num, VoiceIrq &irq) noexcept;
+	void GenerateSamples(accumulator_array_t &stream,
+	                     const ram_array_t &ram,
+	                     const vol_scalars_array_t &vol_scalars,
+	                     const pan_scalars_array_t &pan_scalars,
+	                     const int requested_frames,
+	                     const bool dac_enabled);
+
+	uint8_t ReadVolState() const noexcept;
+	uint8_t ReadWaveState() const noexcept;
+	void ResetCtrls() noexcept;
+	void WritePanPot(uint8_t pos) noexcept;
+	void WriteVolRate(uint16_t rate) noexcept;
+	void WriteWaveRate(uint16_t rate) noexcept;
+	bool UpdateVolState(uint8_t state) noexcept;
+	bool UpdateWaveState(uint8_t state) noexcept;
+
+	VoiceCtrl vol_ctrl;
+	VoiceCtrl wave_ctrl;
+
+	uint32_t generated_8bit_ms = 0u;
+	uint32_t generated_16bit_ms = 0u;
+
+private:
+	Voice() = delete;
+	Voice(const Voice &) = delete;            // prevent copying
+	Voice &operator=(const Voice &) = delete; // prevent assignment
+	bool CheckWaveRolloverCondition() noexcept;
+	bool Is8Bit() const noexcept;
+	void PopCtrlPositions(VoiceCtrl &ctrl, int32_t *positions,
+	                      const int frames, bool dont_loop_or_restart) noexcept;
+	template <typename SampleReader>
+	void ReadWave(const SampleReader &read_sample,
+	              const int32_t *positions,
+	              float *samples,
+	              const int frames) const noexcept;
+	float Read8BitSample(const ram_array_t &ram, const int32_t addr) const noexcept;
+	float Read16BitSample(const ram_array_t &ram, const int32_t addr) const noexcept;
+	uint8_t ReadCtrlState(const VoiceCtrl &ctrl) const noexcept;
+	void IncrementCtrlPos(VoiceCtrl &ctrl, bool skip_loop) noexcept;
+	bool UpdateCtrlState(VoiceCtrl &ctrl, uint8_t state) noexcept;
+
+	// Control states
+	enum CTRL : uint8_t {
+		RESET = 0x01,
+		STOPPED = 0x02,
+		DISABLED = RESET | STOPPED,
+		BIT16 = 0x04,
+		LOOP = 0x08,
+		BIDIRECTIONAL = 0x10,
+		RAISEIRQ = 0x20,
+		DECREASING = 0x40,
+	};
+
+	uint32_t irq_mask = 0u;
+	uint8_t &shared_irq_status;
+	uint8_t pan_position = PAN_DEFAULT_POSITION;
+};
+
+#endif
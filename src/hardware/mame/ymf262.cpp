@@ -2293,7 +2293,7 @@ static int OPL3_LockTable(device_t *device)
 
 	/* first time */
 
-	if (init_tables()) {
+	if (!init_tables()) {
 		num_lock--;
 		return -1;
 	}
@@ -2357,10 +2357,6 @@ static void OPL3ResetChip(OPL3 *chip)
 /* 'rate'  is sampling rate  */
 static OPL3 *OPL3Create(device_t *device, int clock, int rate, int type)
 {
-	// Guard
-	if (device == nullptr) {
-		return nullptr;
-	}
 	OPL3 *chip;
 
 	if (OPL3_LockTable(device) == -1) {
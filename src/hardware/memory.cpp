@@ -191,6 +191,18 @@ void MEM_BlockWrite(PhysPt pt,void const * const data,Bitu size) {
 	}
 }
 
+HostPt MEM_GetBlockWritePt(PhysPt pt, Bitu *size)
+{
+	const HostPt base = get_tlb_write(pt);
+	Bitu span = MEM_PAGESIZE - (pt & (MEM_PAGESIZE - 1));
+	// Pages mapped to consecutive host memory share the same TLB base
+	while (span < *size && get_tlb_write(pt + span) == base)
+		span += MEM_PAGESIZE;
+	if (span < *size)
+		*size = span;
+	return base ? base + pt : nullptr;
+}
+
 void MEM_BlockCopy(PhysPt dest,PhysPt src,Bitu size) {
 	mem_memcpy(dest,src,size);
 }
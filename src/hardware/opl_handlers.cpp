@@ -0,0 +1,295 @@
+/*
+ *  Copyright (C) 2002-2021  The DOSBox Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/* The OPL emulators behind the Adlib module, kept apart from the port and
+ * mixer handling so the dosbox-oplbench program can run them on their own */
+
+#include "adlib.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <memory>
+#include <vector>
+
+#include "dbopl.h"
+#include "threaded_synth.h"
+#include "../libs/nuked/opl3.h"
+
+#include "mame/emu.h"
+#include "mame/fmopl.h"
+#include "mame/ymf262.h"
+
+#define OPL2_INTERNAL_FREQ    3600000   // The OPL2 operates at 3.6MHz
+#define OPL3_INTERNAL_FREQ    14400000  // The OPL3 operates at 14.4MHz
+
+namespace OPL2 {
+	#include "opl.cpp"
+
+	struct Handler : public Adlib::Handler {
+		virtual void WriteReg( Bit32u reg, Bit8u val ) {
+			adlib_write(reg,val);
+		}
+		virtual Bit32u WriteAddr( Bit32u /*port*/, Bit8u val ) {
+			return val;
+		}
+
+		virtual void Generate( Adlib::SampleSink &sink, Bitu samples ) {
+			Bit16s buf[1024];
+			while( samples > 0 ) {
+				Bitu todo = samples > 1024 ? 1024 : samples;
+				samples -= todo;
+				adlib_getsample(buf, todo);
+				sink.AddSamples_m16( todo, buf );
+			}
+		}
+		virtual void Init( Bitu rate ) {
+			adlib_init(rate);
+		}
+		~Handler() {
+		}
+	};
+}
+
+namespace OPL3 {
+	#define OPLTYPE_IS_OPL3
+	#include "opl.cpp"
+
+	struct Handler : public Adlib::Handler {
+		virtual void WriteReg( Bit32u reg, Bit8u val ) {
+			adlib_write(reg,val);
+		}
+		virtual Bit32u WriteAddr( Bit32u port, Bit8u val ) {
+			adlib_write_index(port, val);
+			return opl_index;
+		}
+		virtual void Generate( Adlib::SampleSink &sink, Bitu samples ) {
+			Bit16s buf[1024*2];
+			while( samples > 0 ) {
+				Bitu todo = samples > 1024 ? 1024 : samples;
+				samples -= todo;
+				adlib_getsample(buf, todo);
+				sink.AddSamples_s16( todo, buf );
+			}
+		}
+		virtual void Init( Bitu rate ) {
+			adlib_init(rate);
+		}
+		~Handler() {
+		}
+	};
+}
+
+namespace MAMEOPL2 {
+
+struct Handler : public Adlib::Handler {
+	void *chip = nullptr;
+
+	virtual void WriteReg(Bit32u reg, Bit8u val) {
+		ym3812_write(chip, 0, reg);
+		ym3812_write(chip, 1, val);
+	}
+	virtual Bit32u WriteAddr(Bit32u /*port*/, Bit8u val) {
+		return val;
+	}
+	virtual void Generate(Adlib::SampleSink &sink, Bitu samples) {
+		Bit16s buf[1024 * 2];
+		while (samples > 0) {
+			Bitu todo = samples > 1024 ? 1024 : samples;
+			samples -= todo;
+			ym3812_update_one(chip, buf, todo);
+			sink.AddSamples_m16(todo, buf);
+		}
+	}
+	virtual void Init(Bitu rate) {
+		chip = ym3812_init(0, OPL2_INTERNAL_FREQ, rate);
+	}
+	~Handler() {
+		ym3812_shutdown(chip);
+	}
+};
+
+}
+
+
+namespace MAMEOPL3 {
+
+struct Handler : public Adlib::Handler {
+	void *chip = nullptr;
+
+	virtual void WriteReg(Bit32u reg, Bit8u val) {
+		ymf262_write(chip, 0, reg);
+		ymf262_write(chip, 1, val);
+	}
+	virtual Bit32u WriteAddr(Bit32u /*port*/, Bit8u val) {
+		return val;
+	}
+	virtual void Generate(Adlib::SampleSink &sink, Bitu samples) {
+		//We generate data for 4 channels, but only the first 2 are connected on a pc
+		Bit16s buf[4][1024];
+		Bit16s result[1024][2];
+		Bit16s* buffers[4] = { buf[0], buf[1], buf[2], buf[3] };
+
+		while (samples > 0) {
+			Bitu todo = samples > 1024 ? 1024 : samples;
+			samples -= todo;
+			ymf262_update_one(chip, buffers, todo);
+			//Interleave the samples before mixing
+			for (Bitu i = 0; i < todo; i++) {
+				result[i][0] = buf[0][i];
+				result[i][1] = buf[1][i];
+			}
+			sink.AddSamples_s16(todo, result[0]);
+		}
+	}
+	virtual void Init(Bitu rate) {
+		chip = ymf262_init(0, OPL3_INTERNAL_FREQ, rate);
+	}
+	~Handler() {
+		ymf262_shutdown(chip);
+	}
+};
+
+}
+
+namespace NukedOPL {
+
+// Both generators take the same register writes and render the same
+// samples; the batched one runs its operator stages as vectorized passes
+inline void reset(opl3_chip *chip, uint32_t rate) { OPL3_Reset(chip, rate); }
+inline void reset(opl3_batch *chip, uint32_t rate) { OPL3_BatchReset(chip, rate); }
+
+inline void write_reg(opl3_chip *chip, uint16_t reg, uint8_t val)
+{
+	OPL3_WriteRegBuffered(chip, reg, val);
+}
+inline void write_reg(opl3_batch *chip, uint16_t reg, uint8_t val)
+{
+	OPL3_BatchWriteRegBuffered(chip, reg, val);
+}
+
+inline void generate(opl3_chip *chip, int16_t *buf, uint32_t samples)
+{
+	OPL3_GenerateStream(chip, buf, samples);
+}
+inline void generate(opl3_batch *chip, int16_t *buf, uint32_t samples)
+{
+	OPL3_BatchGenerateStream(chip, buf, samples);
+}
+
+template <typename Chip>
+struct Handler : public Adlib::Handler {
+	Chip chip = {};
+	Bit8u newm = 0;
+	const bool threaded;
+
+	// Renders on a worker thread, a few milliseconds behind the emulation,
+	// when threaded
+	std::unique_ptr<ThreadedSynth> synth = {};
+	std::vector<int16_t> synth_buffer = {};
+
+	explicit Handler(bool threaded_) : threaded(threaded_) {}
+
+	void WriteReg(Bit32u reg, Bit8u val) override
+	{
+		if (synth)
+			synth->Write(PIC_TickIndex(), (Bit16u)reg, val);
+		else
+			write_reg(&chip, (Bit16u)reg, val);
+		if (reg == 0x105)
+			newm = val & 0x01;
+	}
+
+	Bit32u WriteAddr(Bit32u port, Bit8u val) override
+	{
+		Bit16u addr;
+		addr = val;
+		if ((port & 2) && (addr == 0x05 || newm)) {
+			addr |= 0x100;
+		}
+		return addr;
+	}
+
+	void Generate(Adlib::SampleSink &sink, Bitu samples) override
+	{
+		if (synth) {
+			// Only grows if the mixer asks for more than a buffer's worth
+			if (synth_buffer.size() < samples * 2)
+				synth_buffer.resize(samples * 2);
+			synth->EndTick(static_cast<uint32_t>(samples), synth_buffer.data());
+			sink.AddSamples_s16(samples, synth_buffer.data());
+			return;
+		}
+		int16_t buf[1024 * 2];
+		while (samples > 0) {
+			uint32_t todo = samples > 1024 ? 1024 : samples;
+			generate(&chip, buf, todo);
+			sink.AddSamples_s16(todo, buf);
+			samples -= todo;
+		}
+	}
+
+	void Init(Bitu rate) override
+	{
+		newm = 0;
+		synth.reset();
+		reset(&chip, rate);
+		if (!threaded)
+			return;
+		const auto latency = static_cast<uint32_t>(rate * 2 / 1000);
+		synth = std::make_unique<ThreadedSynth>(
+		        [this](uint16_t reg, uint8_t val) {
+			        write_reg(&chip, reg, val);
+		        },
+		        [this](int16_t *buf, uint32_t frames) {
+			        generate(&chip, buf, frames);
+		        },
+		        latency, MIXER_BUFSIZE);
+		synth_buffer.resize(MIXER_BUFSIZE * 2);
+	}
+};
+
+} // namespace NukedOPL
+
+namespace Adlib {
+
+Handler *make_opl_handler(const std::string &oplemu, OPL_Mode mode, bool threaded)
+{
+	if (oplemu == "fast") {
+		return new DBOPL::Handler();
+	}
+	if (oplemu == "compat") {
+		if (mode == OPL_opl2)
+			return new OPL2::Handler();
+		else
+			return new OPL3::Handler();
+	}
+	if (oplemu == "mame") {
+		if (mode == OPL_opl2)
+			return new MAMEOPL2::Handler();
+		else
+			return new MAMEOPL3::Handler();
+	}
+	if (oplemu == "nukedfast") {
+		return new NukedOPL::Handler<opl3_batch>(threaded);
+	}
+	return new NukedOPL::Handler<opl3_chip>(threaded);
+}
+
+} // namespace Adlib
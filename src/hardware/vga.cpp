@@ -32,6 +32,7 @@ Bit32u CGA_4_Table[256];
 Bit32u CGA_4_HiRes_Table[256];
 Bit32u CGA_16_Table[256];
 Bit32u TXT_Font_Table[16];
+Bit64u TXT_Font_Table16[16];
 Bit32u TXT_FG_Table[16];
 Bit32u TXT_BG_Table[16];
 Bit32u ExpandTable[256];
@@ -221,6 +222,11 @@ void VGA_Init(Section* sec) {
 			((i & 4) ? 0x0000ff00 : 0) |
 			((i & 8) ? 0x000000ff : 0) ;
 #endif
+		// Four 16-bit pixel masks, leftmost pixel at the lowest address
+		Bit16u masks16[4];
+		for (j = 0; j < 4; j++)
+			masks16[j] = (i & (8 >> j)) ? 0xffff : 0;
+		memcpy(&TXT_Font_Table16[i], masks16, sizeof(masks16));
 	}
 	for (j=0;j<4;j++) {
 		for (i=0;i<16;i++) {
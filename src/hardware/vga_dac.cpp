@@ -105,6 +105,7 @@ static Bitu read_p3c8(Bitu /*port*/, Bitu /*iolen*/){
 }
 
 static void write_p3c9(Bitu /*port*/,Bitu val,Bitu /*iolen*/) {
+	VGA_NoteDisplayRegisterWrite();
 	val&=0x3f;
 	switch (vga.dac.pel_index) {
 	case 0:
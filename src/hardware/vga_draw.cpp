@@ -17,9 +17,11 @@
  */
 
 
+#include <algorithm>
 #include <string.h>
 #include <math.h>
 #include "dosbox.h"
+#include "frame_trace.h"
 #include "video.h"
 #include "render.h"
 #include "../gui/render_scalers.h"
@@ -106,30 +108,26 @@ static Bit8u * VGA_Draw_CGA16_Line(Bitu vidstart, Bitu line) {
 #undef CGA16_READER
 }
 
-static Bit8u * VGA_Draw_4BPP_Line(Bitu vidstart, Bitu line) {
+// The pixel doubling variant is selected once in VGA_SetupDrawing, so the
+// inner loop doesn't need to check for it on every byte.
+template <bool double_width>
+static Bit8u *VGA_Draw_4BPP_Line(Bitu vidstart, Bitu line)
+{
 	const Bit8u *base = vga.tandy.draw_base + ((line & vga.tandy.line_mask) << vga.tandy.line_shift);
+	const Bitu addr_mask = vga.tandy.addr_mask;
 	Bit8u* draw=TempLine;
-	Bitu end = vga.draw.blocks*2;
+	Bitu end = double_width ? vga.draw.blocks : vga.draw.blocks * 2;
 	while(end) {
-		Bit8u byte = base[vidstart & vga.tandy.addr_mask];
-		*draw++=vga.attr.palette[byte >> 4];
-		*draw++=vga.attr.palette[byte & 0x0f];
-		vidstart++;
-		end--;
-	}
-	return TempLine;
-}
-
-static Bit8u * VGA_Draw_4BPP_Line_Double(Bitu vidstart, Bitu line) {
-	const Bit8u *base = vga.tandy.draw_base + ((line & vga.tandy.line_mask) << vga.tandy.line_shift);
-	Bit8u* draw=TempLine;
-	Bitu end = vga.draw.blocks;
-	while(end) {
-		Bit8u byte = base[vidstart & vga.tandy.addr_mask];
-		Bit8u data = vga.attr.palette[byte >> 4];
-		*draw++ = data; *draw++ = data;
-		data = vga.attr.palette[byte & 0x0f];
-		*draw++ = data; *draw++ = data;
+		const Bit8u byte = base[vidstart & addr_mask];
+		const Bit8u left = vga.attr.palette[byte >> 4];
+		const Bit8u right = vga.attr.palette[byte & 0x0f];
+		if (double_width) {
+			*draw++ = left; *draw++ = left;
+			*draw++ = right; *draw++ = right;
+		} else {
+			*draw++ = left;
+			*draw++ = right;
+		}
 		vidstart++;
 		end--;
 	}
@@ -523,11 +521,25 @@ static Bit8u* VGA_TEXT_Draw_Line(Bitu vidstart, Bitu line) {
 	return TempLine+16;
 }
 */
-// combined 8/9-dot wide text mode 16bpp line drawing function
-static Bit8u* VGA_TEXT_Xlat16_Draw_Line(Bitu vidstart, Bitu line) {
+// combined 8/9-dot wide text mode 16bpp line drawing function; the font
+// width is a template parameter so each variant gets its own unrolled loop.
+// The first eight pixels of a cell are blended four at a time from the
+// foreground and background colours using the TXT_Font_Table16 masks.
+template <bool char9dot>
+static Bit8u *VGA_TEXT_Xlat16_Draw_Line(Bitu vidstart, Bitu line)
+{
+	constexpr Bitu char_width = char9dot ? 9 : 8;
+	constexpr Bit64u replicate16 = 0x0001000100010001ULL;
 	// keep it aligned:
 	Bit16u* draw = ((Bit16u*)TempLine) + 16 - vga.draw.panning;
 	const Bit8u* vidmem = VGA_Text_Memwrap(vidstart); // pointer to chars+attribs
+	const Bit16u *xlat16 = vga.dac.xlat16;
+	const Bit8u *font_tables[2] = {vga.draw.font_tables[0] + line,
+	                               vga.draw.font_tables[1] + line};
+	const bool blinking = vga.draw.blinking;
+	const bool blink = vga.draw.blink;
+	const bool is_underline_line = (vga.crtc.underline_location & 0x1f) == line;
+	const bool extend_9th_pixel = char9dot && (vga.attr.mode_control & 0x04);
 	Bitu blocks = vga.draw.blocks;
 	if (vga.draw.panning) blocks++; // if the text is panned part of an 
 									// additional character becomes visible
@@ -535,33 +547,36 @@ static Bit8u* VGA_TEXT_Xlat16_Draw_Line(Bitu vidstart, Bitu line) {
 		Bitu chr = *vidmem++;
 		Bitu attr = *vidmem++;
 		// the font pattern
-		Bitu font = vga.draw.font_tables[(attr >> 3)&1][(chr<<5)+line];
-		
+		const Bitu font = font_tables[(attr >> 3) & 1][chr << 5];
+
 		Bitu background = attr >> 4;
 		// if blinking is enabled bit7 is not mapped to attributes
-		if (vga.draw.blinking) background &= ~0x8;
+		if (blinking) background &= ~0x8;
 		// choose foreground color if blinking not set for this cell or blink on
-		Bitu foreground = (vga.draw.blink || (!(attr&0x80)))?
+		Bitu foreground = (blink || (!(attr&0x80)))?
 			(attr&0xf):background;
 		// underline: all foreground [freevga: 0x77, previous 0x7]
-		if (GCC_UNLIKELY(((attr&0x77) == 0x01) &&
-			(vga.crtc.underline_location&0x1f)==line))
-				background = foreground;
-		if (vga.draw.char9dot) {
-			font <<=1; // 9 pixels
-			// extend to the 9th pixel if needed
-			if ((font&0x2) && (vga.attr.mode_control&0x04) &&
-				(chr>=0xc0) && (chr<=0xdf)) font |= 1;
-			for (Bitu n = 0; n < 9; n++) {
-				*draw++ = vga.dac.xlat16[(font&0x100)? foreground:background];
-				font <<= 1;
-			}
-		} else {
-			for (Bitu n = 0; n < 8; n++) {
-				*draw++ = vga.dac.xlat16[(font&0x80)? foreground:background];
-				font <<= 1;
-			}
+		if (GCC_UNLIKELY(((attr & 0x77) == 0x01) && is_underline_line))
+			background = foreground;
+		const Bit16u fg = xlat16[foreground];
+		const Bit16u bg = xlat16[background];
+		const Bit64u fg4 = fg * replicate16;
+		const Bit64u bg4 = bg * replicate16;
+		const Bit64u mask_left = TXT_Font_Table16[font >> 4];
+		const Bit64u mask_right = TXT_Font_Table16[font & 0xf];
+		const Bit64u left = (fg4 & mask_left) | (bg4 & ~mask_left);
+		const Bit64u right = (fg4 & mask_right) | (bg4 & ~mask_right);
+		memcpy(draw, &left, sizeof(left));
+		memcpy(draw + 4, &right, sizeof(right));
+		if (char9dot) {
+			// extend to the 9th pixel if needed, without branching
+			// on the font and character bits
+			const Bitu extend = (font & 0x1) & extend_9th_pixel &
+			                    ((chr & 0xe0) == 0xc0);
+			const Bit16u mask_9th = static_cast<Bit16u>(0 - extend);
+			draw[8] = (fg & mask_9th) | (bg & ~mask_9th);
 		}
+		draw += char_width;
 	}
 	// draw the text mode cursor if needed
 	if ((vga.draw.cursor.count&0x10) && (line >= vga.draw.cursor.sline) &&
@@ -569,12 +584,12 @@ static Bit8u* VGA_TEXT_Xlat16_Draw_Line(Bitu vidstart, Bitu line) {
 		// the adress of the attribute that makes up the cell the cursor is in
 		Bits attr_addr = (vga.draw.cursor.address-vidstart) >> 1;
 		if (attr_addr >= 0 && attr_addr < (Bits)vga.draw.blocks) {
-			Bitu index = attr_addr * (vga.draw.char9dot? 18:16);
+			Bitu index = attr_addr * char_width * 2;
 			draw = (Bit16u*)(&TempLine[index]) + 16 - vga.draw.panning;
 			
 			Bitu foreground = vga.tandy.draw_base[vga.draw.cursor.address+1] & 0xf;
 			for (Bitu i = 0; i < 8; i++) {
-				*draw++ = vga.dac.xlat16[foreground];
+				*draw++ = xlat16[foreground];
 			}
 		}
 	}
@@ -615,8 +630,19 @@ static void VGA_ProcessSplit() {
 	vga.draw.address_line=0;
 }
 
+// Moves the draw position to the next scanline after one has been drawn
+static void VGA_AdvanceLine() {
+	vga.draw.address_line++;
+	if (vga.draw.address_line>=vga.draw.address_line_total) {
+		vga.draw.address_line=0;
+		vga.draw.address+=vga.draw.address_add;
+	}
+	vga.draw.lines_done++;
+	if (vga.draw.split_line==vga.draw.lines_done) VGA_ProcessSplit();
+}
+
 static Bit8u bg_color_index = 0; // screen-off black index
-static void VGA_DrawSingleLine(Bitu /*blah*/) {
+static void VGA_RenderSingleLine() {
 	if (GCC_UNLIKELY(vga.attr.disabled)) {
 		switch(machine) {
 		case MCH_PCJR:
@@ -674,20 +700,17 @@ static void VGA_DrawSingleLine(Bitu /*blah*/) {
 		Bit8u * data=VGA_DrawLine( vga.draw.address, vga.draw.address_line );	
 		RENDER_DrawLine(data);
 	}
+	VGA_AdvanceLine();
+}
 
-	vga.draw.address_line++;
-	if (vga.draw.address_line>=vga.draw.address_line_total) {
-		vga.draw.address_line=0;
-		vga.draw.address+=vga.draw.address_add;
-	}
-	vga.draw.lines_done++;
-	if (vga.draw.split_line==vga.draw.lines_done) VGA_ProcessSplit();
+static void VGA_DrawSingleLine(Bitu /*blah*/) {
+	VGA_RenderSingleLine();
 	if (vga.draw.lines_done < vga.draw.lines_total) {
 		PIC_AddEvent(VGA_DrawSingleLine,(float)vga.draw.delay.htotal);
 	} else RENDER_EndUpdate(false);
 }
 
-static void VGA_DrawEGASingleLine(Bitu /*blah*/) {
+static void VGA_RenderEGASingleLine() {
 	if (GCC_UNLIKELY(vga.attr.disabled)) {
 		memset(TempLine, 0, sizeof(TempLine));
 		RENDER_DrawLine(TempLine);
@@ -697,20 +720,17 @@ static void VGA_DrawEGASingleLine(Bitu /*blah*/) {
 		Bit8u * data=VGA_DrawLine(address, vga.draw.address_line );	
 		RENDER_DrawLine(data);
 	}
+	VGA_AdvanceLine();
+}
 
-	vga.draw.address_line++;
-	if (vga.draw.address_line>=vga.draw.address_line_total) {
-		vga.draw.address_line=0;
-		vga.draw.address+=vga.draw.address_add;
-	}
-	vga.draw.lines_done++;
-	if (vga.draw.split_line==vga.draw.lines_done) VGA_ProcessSplit();
+static void VGA_DrawEGASingleLine(Bitu /*blah*/) {
+	VGA_RenderEGASingleLine();
 	if (vga.draw.lines_done < vga.draw.lines_total) {
 		PIC_AddEvent(VGA_DrawEGASingleLine,(float)vga.draw.delay.htotal);
 	} else RENDER_EndUpdate(false);
 }
 
-static void VGA_DrawPart(Bitu lines) {
+static void VGA_RenderPartLines(Bitu lines) {
 	while (lines--) {
 		Bit8u * data=VGA_DrawLine( vga.draw.address, vga.draw.address_line );
 		RENDER_DrawLine(data);
@@ -730,6 +750,10 @@ static void VGA_DrawPart(Bitu lines) {
 #endif
 		}
 	}
+}
+
+static void VGA_DrawPart(Bitu lines) {
+	VGA_RenderPartLines(lines);
 	if (--vga.draw.parts_left) {
 		PIC_AddEvent(VGA_DrawPart,(float)vga.draw.delay.parts,
 			 (vga.draw.parts_left!=1) ? vga.draw.parts_lines  : (vga.draw.lines_total - vga.draw.lines_done));
@@ -741,6 +765,117 @@ static void VGA_DrawPart(Bitu lines) {
 	}
 }
 
+// Draws all lines of the current frame in one go. Used instead of the
+// per-line or per-part events while no raster effects are detected.
+static void VGA_DrawFrame(Bitu /*val*/) {
+	vga.draw.whole_frame.frame_pending = false;
+	switch (vga.draw.mode) {
+	case PART:
+		VGA_RenderPartLines(vga.draw.lines_total - vga.draw.lines_done);
+		vga.draw.parts_left = 0;
+#ifdef VGA_KEEP_CHANGES
+		VGA_ChangesEnd();
+#endif
+		break;
+	case DRAWLINE:
+		while (vga.draw.lines_done < vga.draw.lines_total)
+			VGA_RenderSingleLine();
+		break;
+	case EGALINE:
+		while (vga.draw.lines_done < vga.draw.lines_total)
+			VGA_RenderEGASingleLine();
+		break;
+	}
+	RENDER_EndUpdate(false);
+}
+
+// Number of consecutive frames without display register writes during the
+// active display period before switching to whole-frame drawing.
+constexpr Bitu WHOLE_FRAME_THRESHOLD = 35;
+
+// Switches a frame that was scheduled to be drawn in one go back to per-line
+// (or per-part) drawing. The lines the beam has already passed are drawn
+// right away with the register state from before the write, and the rest
+// gets the regular events, so the first frame with a raster effect is
+// drawn correctly too.
+static void VGA_FinishFrameLineByLine(double frame_pos) {
+	vga.draw.whole_frame.frame_pending = false;
+	PIC_RemoveEvents(VGA_DrawFrame);
+	const double draw_skip = vga.draw.vblank_skip * vga.draw.delay.htotal;
+	if (vga.draw.mode == PART) {
+		Bitu parts_due = 0;
+		if (frame_pos > draw_skip + vga.draw.delay.parts)
+			parts_due = (Bitu)((frame_pos - draw_skip) / vga.draw.delay.parts);
+		while (parts_due-- && vga.draw.parts_left > 1) {
+			VGA_RenderPartLines(vga.draw.parts_lines);
+			vga.draw.parts_left--;
+		}
+		const Bitu next_part = vga.draw.parts_total - vga.draw.parts_left + 1;
+		const double when = draw_skip + next_part * vga.draw.delay.parts;
+		PIC_AddEvent(VGA_DrawPart, (float)std::max(when - frame_pos, 0.0),
+		             (vga.draw.parts_left != 1) ? vga.draw.parts_lines
+		                                        : (vga.draw.lines_total - vga.draw.lines_done));
+		return;
+	}
+	const double first_line = vga.draw.delay.htotal / 4.0 + draw_skip;
+	Bitu lines_due = 0;
+	if (frame_pos >= first_line)
+		lines_due = (Bitu)((frame_pos - first_line) / vga.draw.delay.htotal) + 1;
+	// keep at least the last line for the event so the frame gets finished
+	lines_due = std::min(lines_due, vga.draw.lines_total - 1);
+	while (vga.draw.lines_done < lines_due) {
+		if (vga.draw.mode == EGALINE)
+			VGA_RenderEGASingleLine();
+		else
+			VGA_RenderSingleLine();
+	}
+	const double when = first_line + vga.draw.lines_done * vga.draw.delay.htotal;
+	PIC_AddEvent((vga.draw.mode == EGALINE) ? VGA_DrawEGASingleLine : VGA_DrawSingleLine,
+	             (float)std::max(when - frame_pos, 0.0));
+}
+
+// Called before a display register write takes effect
+void VGA_NoteDisplayRegisterWrite() {
+	const double frame_pos = PIC_FullIndex() - vga.draw.delay.framestart;
+	const double display_end = vga.draw.delay.vdend +
+		vga.draw.vblank_skip * vga.draw.delay.htotal;
+	if (frame_pos >= display_end)
+		return;
+	vga.draw.whole_frame.raster_write = true;
+	if (vga.draw.whole_frame.frame_pending)
+		VGA_FinishFrameLineByLine(frame_pos);
+}
+
+// Called at the start of each frame, including skipped ones
+static void VGA_CheckRasterWrites() {
+	auto &wf = vga.draw.whole_frame;
+	if (wf.raster_write) {
+		wf.raster_write = false;
+		wf.clean_frames = 0;
+	} else if (wf.clean_frames < WHOLE_FRAME_THRESHOLD) {
+		wf.clean_frames++;
+	}
+}
+
+// Decides how the upcoming frame gets drawn and keeps count of the frames
+// drawn each way.
+static bool VGA_UseWholeFrame() {
+	auto &wf = vga.draw.whole_frame;
+	const bool use_whole_frame = (wf.clean_frames >= WHOLE_FRAME_THRESHOLD);
+	if (use_whole_frame != wf.active) {
+		LOG(LOG_VGAMISC, LOG_NORMAL)("Switching to %s drawing after %" sBitfs(u)
+		                             " whole and %" sBitfs(u) " per-line frames",
+		                             use_whole_frame ? "whole-frame" : "per-line",
+		                             wf.frames_whole, wf.frames_per_line);
+		wf.active = use_whole_frame;
+	}
+	if (use_whole_frame)
+		wf.frames_whole++;
+	else
+		wf.frames_per_line++;
+	return use_whole_frame;
+}
+
 void VGA_SetBlinking(Bitu enabled) {
 	Bitu b;
 	LOG(LOG_VGA,LOG_NORMAL)("Blinking %d",enabled);
@@ -803,6 +938,8 @@ static void VGA_PanningLatch(Bitu /*val*/) {
 static void VGA_VerticalTimer(Bitu /*val*/) {
 	vga.draw.delay.framestart = PIC_FullIndex();
 	PIC_AddEvent( VGA_VerticalTimer, (float)vga.draw.delay.vtotal );
+	FRAMETRACE_Mark(FrameEvent::VerticalRetrace);
+	VGA_CheckRasterWrites();
 	
 	switch(machine) {
 	case MCH_PCJR:
@@ -938,17 +1075,24 @@ static void VGA_VerticalTimer(Bitu /*val*/) {
 		vga.draw.address += vga.draw.address_add * (vga.draw.vblank_skip/(vga.draw.address_line_total));
 	}
 
-	// add the draw event
+	// add the draw event; a whole frame is drawn at the time its last line
+	// or part would have been drawn
+	const bool whole_frame = VGA_UseWholeFrame();
 	switch (vga.draw.mode) {
 	case PART:
 		if (GCC_UNLIKELY(vga.draw.parts_left)) {
 			LOG(LOG_VGAMISC,LOG_NORMAL)( "Parts left: %d", vga.draw.parts_left );
 			PIC_RemoveEvents(VGA_DrawPart);
+			PIC_RemoveEvents(VGA_DrawFrame);
 			RENDER_EndUpdate(true);
 		}
 		vga.draw.lines_done = 0;
 		vga.draw.parts_left = vga.draw.parts_total;
-		PIC_AddEvent(VGA_DrawPart,(float)vga.draw.delay.parts + draw_skip,vga.draw.parts_lines);
+		vga.draw.whole_frame.frame_pending = whole_frame;
+		if (whole_frame)
+			PIC_AddEvent(VGA_DrawFrame, (float)(vga.draw.delay.vdend + draw_skip));
+		else
+			PIC_AddEvent(VGA_DrawPart,(float)vga.draw.delay.parts + draw_skip,vga.draw.parts_lines);
 		break;
 	case DRAWLINE:
 	case EGALINE:
@@ -957,10 +1101,16 @@ static void VGA_VerticalTimer(Bitu /*val*/) {
 				vga.draw.lines_total-vga.draw.lines_done);
 			if (vga.draw.mode==EGALINE) PIC_RemoveEvents(VGA_DrawEGASingleLine);
 			else PIC_RemoveEvents(VGA_DrawSingleLine);
+			PIC_RemoveEvents(VGA_DrawFrame);
 			RENDER_EndUpdate(true);
 		}
 		vga.draw.lines_done = 0;
-		if (vga.draw.mode==EGALINE)
+		vga.draw.whole_frame.frame_pending = whole_frame && vga.draw.lines_total;
+		if (whole_frame) {
+			const double last_line = vga.draw.lines_total ? vga.draw.lines_total - 1 : 0;
+			PIC_AddEvent(VGA_DrawFrame, (float)(vga.draw.delay.htotal/4.0 + draw_skip +
+			                                    last_line * vga.draw.delay.htotal));
+		} else if (vga.draw.mode==EGALINE)
 			PIC_AddEvent(VGA_DrawEGASingleLine,(float)(vga.draw.delay.htotal/4.0 + draw_skip));
 		else PIC_AddEvent(VGA_DrawSingleLine,(float)(vga.draw.delay.htotal/4.0 + draw_skip));
 		break;
@@ -1443,12 +1593,13 @@ void VGA_SetupDrawing(Bitu /*val*/) {
 			if (vga.seq.clocking_mode&0x01) {
 				vga.draw.char9dot = false;
 				width*=8;
+				VGA_DrawLine = VGA_TEXT_Xlat16_Draw_Line<false>;
 			} else {
 				vga.draw.char9dot = true;
 				width*=9;
 				aspect_ratio*=1.125;
+				VGA_DrawLine = VGA_TEXT_Xlat16_Draw_Line<true>;
 			}
-			VGA_DrawLine=VGA_TEXT_Xlat16_Draw_Line;
 			bpp = 16;
 		} else {
 			// not vgaonly: force 8-pixel wide fonts
@@ -1497,11 +1648,11 @@ void VGA_SetupDrawing(Bitu /*val*/) {
 				doublewidth = true;
 				width=vga.draw.blocks*2;
 			}
-			VGA_DrawLine=VGA_Draw_4BPP_Line;
+			VGA_DrawLine = VGA_Draw_4BPP_Line<false>;
 		} else {
 			doublewidth=true;
 			width=vga.draw.blocks*4;
-			VGA_DrawLine=VGA_Draw_4BPP_Line_Double;
+			VGA_DrawLine = VGA_Draw_4BPP_Line<true>;
 		}
 		break;
 	case M_TANDY_TEXT:
@@ -1614,6 +1765,8 @@ void VGA_KillDrawing(void) {
 	PIC_RemoveEvents(VGA_DrawPart);
 	PIC_RemoveEvents(VGA_DrawSingleLine);
 	PIC_RemoveEvents(VGA_DrawEGASingleLine);
+	PIC_RemoveEvents(VGA_DrawFrame);
+	vga.draw.whole_frame.frame_pending = false;
 	vga.draw.parts_left = 0;
 	vga.draw.lines_done = ~0;
 	if (!vga.draw.vga_override) RENDER_EndUpdate(true);
@@ -38,6 +38,7 @@ static Bitu read_crtc_index_other(Bitu /*port*/,Bitu /*iolen*/) {
 }
 
 static void write_crtc_data_other(Bitu /*port*/,Bitu val,Bitu /*iolen*/) {
+	VGA_NoteDisplayRegisterWrite();
 	switch (vga.other.index) {
 	case 0x00:		//Horizontal total
 		if (vga.other.htotal ^ val) VGA_StartResize();
@@ -426,6 +427,7 @@ static void write_cga_color_select(Bitu val) {
 }
 
 static void write_cga(Bitu port,Bitu val,Bitu /*iolen*/) {
+	VGA_NoteDisplayRegisterWrite();
 	switch (port) {
 	case 0x3d8:
 		vga.tandy.mode_control=(Bit8u)val;
@@ -626,6 +628,7 @@ static void write_tandy_reg(Bit8u val) {
 }
 
 static void write_tandy(Bitu port,Bitu val,Bitu /*iolen*/) {
+	VGA_NoteDisplayRegisterWrite();
 	switch (port) {
 	case 0x3d8:
 		val &= 0x3f; // only bits 0-6 are used
@@ -673,6 +676,7 @@ static void write_tandy(Bitu port,Bitu val,Bitu /*iolen*/) {
 }
 
 static void write_pcjr(Bitu port,Bitu val,Bitu /*iolen*/) {
+	VGA_NoteDisplayRegisterWrite();
 	switch (port) {
 	case 0x3da:
 		if (vga.tandy.pcjr_flipflop) write_tandy_reg((Bit8u)val);
@@ -805,6 +809,7 @@ void Herc_Palette()
 }
 
 static void write_hercules(Bitu port,Bitu val,Bitu /*iolen*/) {
+	VGA_NoteDisplayRegisterWrite();
 	switch (port) {
 	case 0x3b8: {
 		// the protected bits can always be cleared but only be set if the 
@@ -0,0 +1,122 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/* Converts raw disk images to and from the block-compressed format that
+ * IMGMOUNT reads directly, see compressed_image.h */
+
+#include "compressed_image.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static void usage()
+{
+	fprintf(stderr,
+	        "Usage:\n"
+	        "  dosbox-imgpack [-c CHUNK_KB] IMAGE PACKED_IMAGE\n"
+	        "  dosbox-imgpack -x PACKED_IMAGE IMAGE\n"
+	        "\n"
+	        "Compresses a raw floppy or hard disk image, or with -x,\n"
+	        "extracts a compressed image. CHUNK_KB is the size of the\n"
+	        "independently compressed chunks, 64 by default.\n");
+}
+
+static bool extract(FILE *src, FILE *dst)
+{
+	CompressedImage image(src);
+	if (!image.IsOpen()) {
+		fprintf(stderr, "Not a compressed image\n");
+		return false;
+	}
+	std::vector<uint8_t> buffer(image.GetChunkSize());
+	for (uint64_t pos = 0; pos < image.GetSize(); pos += buffer.size()) {
+		const auto n = static_cast<size_t>(
+		        std::min<uint64_t>(buffer.size(), image.GetSize() - pos));
+		if (!image.Read(pos, n, buffer.data())) {
+			fprintf(stderr, "Corrupt data at offset %llu\n",
+			        static_cast<unsigned long long>(pos));
+			return false;
+		}
+		if (fwrite(buffer.data(), 1, n, dst) != n) {
+			fprintf(stderr, "Can't write the image: %s\n", strerror(errno));
+			return false;
+		}
+	}
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	bool extracting = false;
+	uint32_t chunk_size = CompressedImage::default_chunk_size;
+	int arg = 1;
+	for (; arg < argc && argv[arg][0] == '-'; ++arg) {
+		if (!strcmp(argv[arg], "-x")) {
+			extracting = true;
+		} else if (!strcmp(argv[arg], "-c") && arg + 1 < argc) {
+			const long kb = strtol(argv[++arg], nullptr, 10);
+			if (kb < 1 || kb > 16 * 1024) {
+				fprintf(stderr, "Chunk size must be 1 to 16384 KB\n");
+				return 1;
+			}
+			chunk_size = static_cast<uint32_t>(kb * 1024);
+		} else {
+			usage();
+			return 1;
+		}
+	}
+	if (argc - arg != 2) {
+		usage();
+		return 1;
+	}
+
+	FILE *src = fopen(argv[arg], "rb");
+	if (!src) {
+		fprintf(stderr, "Can't open '%s': %s\n", argv[arg], strerror(errno));
+		return 1;
+	}
+	FILE *dst = fopen(argv[arg + 1], "wb");
+	if (!dst) {
+		fprintf(stderr, "Can't create '%s': %s\n", argv[arg + 1], strerror(errno));
+		fclose(src);
+		return 1;
+	}
+
+	bool success;
+	if (extracting) {
+		success = extract(src, dst);
+	} else {
+		std::string error;
+		success = CompressedImage::Create(src, dst, chunk_size, error);
+		if (!success)
+			fprintf(stderr, "Compression failed: %s\n", error.c_str());
+	}
+	fclose(src);
+	if (fclose(dst) != 0)
+		success = false;
+	if (!success)
+		remove(argv[arg + 1]);
+	return success ? 0 : 1;
+}
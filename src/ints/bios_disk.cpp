@@ -20,10 +20,22 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cstdint>
 #include <utility>
+#include <vector>
+
+#include <sys/stat.h>
+
+#if defined(WIN32)
+#include <io.h>
+#include <windows.h>
+#elif defined(HAVE_MMAP)
+#include <sys/mman.h>
+#endif
 
 #include "dosbox.h"
 #include "callback.h"
+#include "cross.h"
 #include "regs.h"
 #include "mem.h"
 #include "dos_inc.h" /* for Drives[] */
@@ -54,6 +66,7 @@ RealPt imgDTAPtr;
 DOS_DTA *imgDTA;
 bool killRead;
 static bool swapping_requested;
+static std::vector<Bit8u> transfer_buffer = {};
 
 void CMOS_SetRegister(Bitu regNr, Bit8u val); //For setting equipment word
 
@@ -157,63 +170,265 @@ void swapInNextDisk(bool pressed) {
 
 
 Bit8u imageDisk::Read_Sector(Bit32u head,Bit32u cylinder,Bit32u sector,void * data) {
+	return Read_Sectors(head, cylinder, sector, 1, data);
+}
+
+Bit8u imageDisk::Read_Sectors(Bit32u head,Bit32u cylinder,Bit32u sector,Bit32u count,void * data) {
 	Bit32u sectnum;
 
 	sectnum = ( (cylinder * heads + head) * sectors ) + sector - 1L;
 
-	return Read_AbsoluteSector(sectnum, data);
+	return Read_AbsoluteSectors(sectnum, count, data);
 }
 
 Bit8u imageDisk::Read_AbsoluteSector(Bit32u sectnum, void * data) {
-	Bit32u bytenum;
+	return Read_AbsoluteSectors(sectnum, 1, data);
+}
+
+Bit8u imageDisk::Read_AbsoluteSectors(Bit32u sectnum, Bit32u count, void * data) {
+	Bit8u ret = Read_ImageSectors(sectnum, count, data);
+	if (delta && delta->GetSectorCount()) {
+		/* Replace the sectors that were written since; these can lie
+		 * beyond the end of the image */
+		Bit8u *buffer = static_cast<Bit8u *>(data);
+		bool all_in_delta = true;
+		for (Bit32u i = 0; i < count; i++)
+			all_in_delta &= delta->Read(sectnum + i, buffer + i * sector_size);
+		if (all_in_delta)
+			ret = 0x00;
+	}
+	return ret;
+}
 
-	bytenum = sectnum * sector_size;
+Bit8u imageDisk::Read_ImageSectors(Bit32u sectnum, Bit32u count, void * data) {
+	const size_t length = static_cast<size_t>(count) * sector_size;
+	const uint64_t offset = static_cast<uint64_t>(sectnum) * sector_size;
+	if (compressed)
+		return compressed->Read(offset, length, static_cast<Bit8u *>(data)) ? 0x00 : 0x04;
+	if (offset + length <= mapped_size) {
+		memcpy(data, mapped_image + offset, length);
+		return 0x00;
+	}
 
-	if (last_action==WRITE || bytenum!=current_fpos) fseek(diskimg,bytenum,SEEK_SET);
-	size_t ret=fread(data, 1, sector_size, diskimg);
-	current_fpos=bytenum+ret;
+	if (last_action==WRITE || offset!=current_fpos) cross::fseek64(diskimg,offset,SEEK_SET);
+	size_t ret=fread(data, 1, length, diskimg);
+	current_fpos=offset+ret;
 	last_action=READ;
 
+	/* Past the end of the image or a read error, don't hand out whatever
+	 * the buffer held before. The read still succeeds, as it always has
+	 * for truncated and odd-sized images. */
+	if (ret != length)
+		memset(static_cast<Bit8u *>(data) + ret, 0, length - ret);
 	return 0x00;
 }
 
 Bit8u imageDisk::Write_Sector(Bit32u head,Bit32u cylinder,Bit32u sector,void * data) {
+	return Write_Sectors(head, cylinder, sector, 1, data);
+}
+
+Bit8u imageDisk::Write_Sectors(Bit32u head,Bit32u cylinder,Bit32u sector,Bit32u count,void * data) {
 	Bit32u sectnum;
 
 	sectnum = ( (cylinder * heads + head) * sectors ) + sector - 1L;
 
-	return Write_AbsoluteSector(sectnum, data);
+	return Write_AbsoluteSectors(sectnum, count, data);
 }
 
-
 Bit8u imageDisk::Write_AbsoluteSector(Bit32u sectnum, void *data) {
-	Bit32u bytenum;
+	return Write_AbsoluteSectors(sectnum, 1, data);
+}
 
-	bytenum = sectnum * sector_size;
+Bit8u imageDisk::Write_AbsoluteSectors(Bit32u sectnum, Bit32u count, void *data) {
+	const size_t length = static_cast<size_t>(count) * sector_size;
+	const uint64_t offset = static_cast<uint64_t>(sectnum) * sector_size;
+	++write_count;
+	if (delta) {
+		const Bit8u *buffer = static_cast<const Bit8u *>(data);
+		for (Bit32u i = 0; i < count; i++)
+			if (!delta->Write(sectnum + i, buffer + i * sector_size))
+				return 0x05;
+		/* The guest takes the write as done, so don't leave it in our
+		 * buffers where a crash would lose it */
+		return delta->Flush() ? 0x00 : 0x05;
+	}
+	if (compressed) {
+		/* Compressed images are read-only */
+		if (!write_refused)
+			LOG_MSG("IMAGE: '%s' is compressed, writes need a delta file", diskname);
+		write_refused = true;
+		return 0x03;
+	}
+	if (mapped_writable && offset + length <= mapped_size) {
+		memcpy(mapped_image + offset, data, length);
+		return 0x00;
+	}
 
-	//LOG_MSG("Writing sectors to %ld at bytenum %d", sectnum, bytenum);
+	//LOG_MSG("Writing sectors to %ld at offset %llu", sectnum, offset);
 
-	if (last_action==READ || bytenum!=current_fpos) fseek(diskimg,bytenum,SEEK_SET);
-	size_t ret=fwrite(data, 1, sector_size, diskimg);
-	current_fpos=bytenum+ret;
+	if (last_action==READ || offset!=current_fpos) cross::fseek64(diskimg,offset,SEEK_SET);
+	size_t ret=fwrite(data, 1, length, diskimg);
+	current_fpos=offset+ret;
 	last_action=WRITE;
 
-	return ((ret>0)?0x00:0x05);
+	return ((ret == length)?0x00:0x05);
 
 }
 
+uint64_t get_disk_image_size(FILE *img_file) {
+	if (CompressedImage::IsCompressedImage(img_file)) {
+		const CompressedImage image(img_file, 0);
+		return image.IsOpen() ? image.GetSize() : 0;
+	}
+	cross::fseek64(img_file, 0, SEEK_END);
+	const int64_t size = cross::ftell64(img_file);
+	return size > 0 ? static_cast<uint64_t>(size) : 0;
+}
+
+/* The delta only fits the exact image file it was made for */
+static DiskDelta::BaseImage get_delta_base(FILE *img_file) {
+	DiskDelta::BaseImage base;
+	cross::fseek64(img_file, 0, SEEK_END);
+	const int64_t size = cross::ftell64(img_file);
+	base.size = size > 0 ? static_cast<uint64_t>(size) : 0;
+	struct stat info;
+	if (fstat(cross_fileno(img_file), &info) == 0)
+		base.mtime = static_cast<int64_t>(info.st_mtime);
+	return base;
+}
+
+bool imageDisk::AttachDelta(const std::string &path) {
+	const auto base = get_delta_base(diskimg);
+	last_action = NONE;
+	auto new_delta = std::make_unique<DiskDelta>(path, sector_size, base);
+	if (!new_delta->IsOpen()) {
+		LOG_MSG("IMAGE: Can't use delta file '%s': %s", path.c_str(),
+		        new_delta->GetError().c_str());
+		return false;
+	}
+	LOG_MSG("IMAGE: Writes to '%s' go to delta file '%s' (%zu sectors modified)",
+	        diskname, path.c_str(), new_delta->GetSectorCount());
+	delta = std::move(new_delta);
+	return true;
+}
+
+uint64_t imageDisk::GetSize() {
+	uint64_t size = 0;
+	if (compressed) {
+		size = compressed->GetSize();
+	} else {
+		cross::fseek64(diskimg, 0, SEEK_END);
+		const int64_t file_size = cross::ftell64(diskimg);
+		size = file_size > 0 ? static_cast<uint64_t>(file_size) : 0;
+		last_action = NONE;
+		current_fpos = size;
+	}
+	if (delta)
+		size = std::max(size, delta->GetSectorLimit() * sector_size);
+	return size;
+}
+
+/* Maps the whole image into memory, writable if the image file was opened
+ * for writing. Sectors beyond the mapping, e.g. when the image grows, and
+ * all sectors on hosts without mapping support go through stdio. */
+void imageDisk::MapImage() {
+#if defined(WIN32) || defined(HAVE_MMAP)
+	if (cross::fseek64(diskimg, 0, SEEK_END) != 0)
+		return;
+	const int64_t file_size = cross::ftell64(diskimg);
+	fseek(diskimg, 0, SEEK_SET);
+	current_fpos = 0;
+	/* Images that don't fit the address space go through stdio */
+	if (file_size <= 0 || static_cast<uint64_t>(file_size) > SIZE_MAX)
+		return;
+	const size_t size = static_cast<size_t>(file_size);
+
+#if defined(WIN32)
+	const HANDLE file = reinterpret_cast<HANDLE>(_get_osfhandle(_fileno(diskimg)));
+	if (file == INVALID_HANDLE_VALUE)
+		return;
+	bool writable = true;
+	HANDLE mapping = CreateFileMapping(file, nullptr, PAGE_READWRITE, 0, 0, nullptr);
+	if (!mapping) {
+		writable = false;
+		mapping = CreateFileMapping(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!mapping)
+			return;
+	}
+	void *view = MapViewOfFile(mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, size);
+	if (!view) {
+		CloseHandle(mapping);
+		return;
+	}
+	mapping_handle = mapping;
+#elif defined(HAVE_MMAP)
+	const int fd = fileno(diskimg);
+	bool writable = true;
+	void *view = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (view == MAP_FAILED) {
+		writable = false;
+		view = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+		if (view == MAP_FAILED)
+			return;
+	}
+#endif
+	mapped_image = static_cast<Bit8u *>(view);
+	mapped_size = size;
+	mapped_writable = writable;
+#endif
+}
+
+void imageDisk::UnmapImage() {
+	if (!mapped_image)
+		return;
+#if defined(WIN32)
+	FlushViewOfFile(mapped_image, 0);
+	UnmapViewOfFile(mapped_image);
+	CloseHandle(mapping_handle);
+	mapping_handle = nullptr;
+#elif defined(HAVE_MMAP)
+	munmap(mapped_image, mapped_size);
+#endif
+	mapped_image = nullptr;
+	mapped_size = 0;
+	mapped_writable = false;
+}
+
 imageDisk::imageDisk(FILE *img_file, const char *img_name, uint32_t img_size_k, bool is_hdd)
         : hardDrive(is_hdd),
           active(false),
+          created_successfully(true),
           diskimg(img_file),
           floppytype(0),
           sector_size(512),
           heads(0),
           cylinders(0),
           sectors(0),
+          mapped_image(nullptr),
+          mapped_size(0),
+          mapped_writable(false),
+#if defined(WIN32)
+          mapping_handle(nullptr),
+#endif
+          compressed(nullptr),
+          delta(nullptr),
           current_fpos(0),
+          write_count(0),
+          write_refused(false),
           last_action(NONE)
 {
+	if (CompressedImage::IsCompressedImage(diskimg)) {
+		compressed = std::make_unique<CompressedImage>(diskimg);
+		if (!compressed->IsOpen()) {
+			/* Serving the container as a raw image would hand out
+			 * garbage, so the image can't be used at all */
+			LOG_MSG("IMAGE: Compressed image '%s' is damaged", img_name);
+			compressed.reset();
+			created_successfully = false;
+		}
+	} else {
+		MapImage();
+	}
 	fseek(diskimg,0,SEEK_SET);
 	memset(diskname,0,512);
 	safe_strcpy(diskname, img_name);
@@ -317,9 +532,8 @@ static bool has_image(const std::array<T, N> &arr) {
 
 static Bitu INT13_DiskHandler(void) {
 	Bit16u segat, bufptr;
-	Bit8u sectbuf[512];
 	Bit8u  drivenum;
-	Bitu t;
+	Bitu t, transfer_size;
 	last_drive = reg_dl;
 	drivenum = GetDosDriveNumber(reg_dl);
 	const bool any_images = has_image(imageDiskList);
@@ -398,17 +612,23 @@ static Bitu INT13_DiskHandler(void) {
 
 		segat = SegValue(es);
 		bufptr = reg_bx;
-		for (Bitu i = 0; i < reg_al; i++) {
-			last_status = imageDiskList[drivenum]->Read_Sector((Bit32u)reg_dh, (Bit32u)(reg_ch | ((reg_cl & 0xc0)<< 2)), (Bit32u)((reg_cl & 63)+i), sectbuf);
-			if((last_status != 0x00) || (killRead)) {
-				LOG_MSG("Error in disk read");
-				killRead = false;
-				reg_ah = 0x04;
-				CALLBACK_SCF(true);
-				return CBRET_NONE;
-			}
-			for(t=0;t<512;t++) {
-				real_writeb(segat,bufptr,sectbuf[t]);
+		transfer_size = reg_al * imageDiskList[drivenum]->getSectSize();
+		transfer_buffer.resize(transfer_size);
+		/* Read all requested sectors at once */
+		last_status = killRead ? 0x04 : imageDiskList[drivenum]->Read_Sectors((Bit32u)reg_dh, (Bit32u)(reg_ch | ((reg_cl & 0xc0)<< 2)), (Bit32u)(reg_cl & 63), reg_al, transfer_buffer.data());
+		if (last_status != 0x00) {
+			LOG_MSG("Error in disk read");
+			killRead = false;
+			reg_ah = 0x04;
+			CALLBACK_SCF(true);
+			return CBRET_NONE;
+		}
+		if (bufptr + transfer_size <= 0x10000) {
+			MEM_BlockWrite(PhysMake(segat, bufptr), transfer_buffer.data(), transfer_size);
+		} else {
+			/* The buffer wraps around within the segment */
+			for (t = 0; t < transfer_size; t++) {
+				real_writeb(segat,bufptr,transfer_buffer[t]);
 				bufptr++;
 			}
 		}
@@ -421,17 +641,23 @@ static Bitu INT13_DiskHandler(void) {
 			CALLBACK_SCF(true);
 			return CBRET_NONE;
 		}
+		segat = SegValue(es);
 		bufptr = reg_bx;
-		for (Bitu i = 0; i < reg_al; i++) {
-			for(t=0;t<imageDiskList[drivenum]->getSectSize();t++) {
-				sectbuf[t] = real_readb(SegValue(es),bufptr);
+		transfer_size = reg_al * imageDiskList[drivenum]->getSectSize();
+		transfer_buffer.resize(transfer_size);
+		if (bufptr + transfer_size <= 0x10000) {
+			MEM_BlockRead(PhysMake(segat, bufptr), transfer_buffer.data(), transfer_size);
+		} else {
+			/* The buffer wraps around within the segment */
+			for (t = 0; t < transfer_size; t++) {
+				transfer_buffer[t] = real_readb(segat,bufptr);
 				bufptr++;
 			}
-			last_status = imageDiskList[drivenum]->Write_Sector((Bit32u)reg_dh, (Bit32u)(reg_ch | ((reg_cl & 0xc0) << 2)), (Bit32u)((reg_cl & 63) + i), &sectbuf[0]);
-			if(last_status != 0x00) {
-				CALLBACK_SCF(true);
-				return CBRET_NONE;
-			}
+		}
+		last_status = imageDiskList[drivenum]->Write_Sectors((Bit32u)reg_dh, (Bit32u)(reg_ch | ((reg_cl & 0xc0) << 2)), (Bit32u)(reg_cl & 63), reg_al, transfer_buffer.data());
+		if(last_status != 0x00) {
+			CALLBACK_SCF(true);
+			return CBRET_NONE;
 		}
 		reg_ah = 0x00;
 		CALLBACK_SCF(false);
@@ -340,6 +340,94 @@ int __Sound_strcasecmp(const char *x, const char *y)
 } /* __Sound_strcasecmp */
 
 
+/* Appends a point to a list grown with SDL_realloc(), false if out of memory. */
+static int append_seek_point(Sound_SeekPoint **list, Uint32 *count,
+                             Uint32 *capacity, Uint64 frame, Uint64 offset)
+{
+    if (*count == *capacity)
+    {
+        const Uint32 grown = (*capacity) ? (*capacity) * 2 : 256;
+        Sound_SeekPoint *ptr = (Sound_SeekPoint *)
+            SDL_realloc(*list, grown * sizeof (Sound_SeekPoint));
+        BAIL_IF_MACRO(ptr == NULL, ERR_OUT_OF_MEMORY, 0);
+        *list = ptr;
+        *capacity = grown;
+    } /* if */
+
+    (*list)[*count].frame = frame;
+    (*list)[*count].offset = offset;
+    (*count)++;
+    return(1);
+} /* append_seek_point */
+
+
+Uint32 __Sound_ScanOggPages(SDL_RWops *rw, Uint32 min_spacing,
+                            SDL_atomic_t *cancel, Sound_SeekPoint **points)
+{
+    Uint8 header[27];
+    Uint8 lacing[255];
+    Sound_SeekPoint *list = NULL;
+    Uint32 count = 0;
+    Uint32 capacity = 0;
+    Uint32 serial = 0;
+    Sint64 pos = 0;
+    Sint64 next_listed = 0;
+    int i;
+
+    *points = NULL;
+    if (SDL_RWseek(rw, 0, RW_SEEK_SET) != 0)
+        return(0);
+
+    /* Walk the pages by their headers, without reading the packets. */
+    while (SDL_RWread(rw, header, sizeof (header), 1) == 1)
+    {
+        Uint32 body = 0;
+        Uint32 page_serial;
+        Uint64 granule;
+
+        if (cancel != NULL && SDL_AtomicGet(cancel))
+            goto failed;
+
+        if (SDL_memcmp(header, "OggS", 4) != 0 || header[4] != 0)
+            goto failed;  /* a gap or damage: the list wouldn't be trusted */
+
+        SDL_memcpy(&page_serial, &header[14], sizeof (page_serial));
+        page_serial = SDL_SwapLE32(page_serial);
+        if (pos == 0)
+            serial = page_serial;
+        else if (page_serial != serial)
+            goto failed;  /* chained or multiplexed */
+
+        if (header[26] && SDL_RWread(rw, lacing, header[26], 1) != 1)
+            break;  /* truncated last page */
+        for (i = 0; i < header[26]; i++)
+            body += lacing[i];
+
+        /* Pages ending no packet have a granule position of -1, and the
+         * header pages one of 0; neither can start a seek. */
+        SDL_memcpy(&granule, &header[6], sizeof (granule));
+        granule = SDL_SwapLE64(granule);
+        if (granule != 0 && granule != ~(Uint64) 0 && pos >= next_listed)
+        {
+            if (!append_seek_point(&list, &count, &capacity, granule, (Uint64) pos))
+                goto failed;
+            next_listed = pos + min_spacing;
+        } /* if */
+
+        pos += sizeof (header) + header[26] + body;
+        if (SDL_RWseek(rw, pos, RW_SEEK_SET) != pos)
+            break;
+    } /* while */
+
+    *points = list;
+    return(count);
+
+failed:
+    SDL_free(list);
+    return(0);
+} /* __Sound_ScanOggPages */
+
+
 /*
  * Allocate a Sound_Sample, and fill in most of its fields. Those that need
  *  to be filled in later, by a decoder, will be initialized to zero.
@@ -659,6 +747,47 @@ int Sound_Seek(Sound_Sample *sample, Uint32 ms)
 } /* Sound_Rewind */
 
 
+int Sound_CanScanSeekPoints(const Sound_Sample *sample)
+{
+    const Sound_SampleInternal *internal;
+    BAIL_IF_MACRO(!initialized, ERR_NOT_INITIALIZED, 0);
+    BAIL_IF_MACRO(sample == NULL, ERR_INVALID_ARGUMENT, 0);
+    internal = (const Sound_SampleInternal *) sample->opaque;
+    return(internal->funcs->scan_seek_points != NULL &&
+           (sample->flags & SOUND_SAMPLEFLAG_CANSEEK));
+} /* Sound_CanScanSeekPoints */
+
+
+Uint32 Sound_ScanSeekPoints(const Sound_Sample *sample, SDL_RWops *rw,
+                            SDL_atomic_t *cancel, Sound_SeekPoint **points)
+{
+    const Sound_SampleInternal *internal;
+
+    BAIL_IF_MACRO(points == NULL, ERR_INVALID_ARGUMENT, 0);
+    *points = NULL;
+    BAIL_IF_MACRO(!initialized, ERR_NOT_INITIALIZED, 0);
+    BAIL_IF_MACRO(sample == NULL || rw == NULL, ERR_INVALID_ARGUMENT, 0);
+
+    /* The sample's flags can change under us, so only its decoder is used */
+    internal = (const Sound_SampleInternal *) sample->opaque;
+    BAIL_IF_MACRO(internal->funcs->scan_seek_points == NULL, ERR_NOT_SUPPORTED, 0);
+    return(internal->funcs->scan_seek_points(sample, rw, cancel, points));
+} /* Sound_ScanSeekPoints */
+
+
+int Sound_SetSeekPoints(Sound_Sample *sample, const Sound_SeekPoint *points,
+                        Uint32 count)
+{
+    Sound_SampleInternal *internal;
+
+    BAIL_IF_MACRO(points == NULL || count == 0, ERR_INVALID_ARGUMENT, 0);
+    BAIL_IF_MACRO(!Sound_CanScanSeekPoints(sample), ERR_NOT_SUPPORTED, 0);
+
+    internal = (Sound_SampleInternal *) sample->opaque;
+    return(internal->funcs->set_seek_points(sample, points, count));
+} /* Sound_SetSeekPoints */
+
+
 Sint32 Sound_GetDuration(Sound_Sample *sample)
 {
     Sound_SampleInternal *internal;
@@ -170,6 +170,24 @@ typedef struct
 } Sound_Sample;
 
 
+/**
+ * \struct Sound_SeekPoint
+ * \brief A position in the stream where decoding can start after a seek.
+ *
+ * The frame is the decoder's own time stamp for the position, such as
+ *  the first PCM frame of a FLAC frame or the granule position of an Ogg
+ *  page. Only the decoder that produced the point should interpret it.
+ *
+ * \sa Sound_ScanSeekPoints
+ * \sa Sound_SetSeekPoints
+ */
+typedef struct
+{
+    Uint64 frame;  /**< Decoder-specific time stamp of the position. */
+    Uint64 offset;  /**< Byte offset of the position in the stream. */
+} Sound_SeekPoint;
+
+
 /**
  * \struct Sound_Version
  * \brief Information the version of SDL_sound in use.
@@ -607,6 +625,69 @@ SNDDECLSPEC int SDLCALL Sound_Rewind(Sound_Sample *sample);
 SNDDECLSPEC int SDLCALL Sound_Seek(Sound_Sample *sample, Uint32 ms);
 
 
+/**
+ * \fn int Sound_CanScanSeekPoints(const Sound_Sample *sample)
+ * \brief Tell whether a sample's decoder can list seek points.
+ *
+ *    \param sample The Sound_Sample to query.
+ *   \return nonzero if Sound_ScanSeekPoints() is supported for the sample.
+ *
+ * \sa Sound_ScanSeekPoints
+ */
+SNDDECLSPEC int SDLCALL Sound_CanScanSeekPoints(const Sound_Sample *sample);
+
+
+/**
+ * \fn Uint32 Sound_ScanSeekPoints(const Sound_Sample *sample, SDL_RWops *rw, SDL_atomic_t *cancel, Sound_SeekPoint **points)
+ * \brief List the positions a sample's decoder can start a seek from.
+ *
+ * The scan reads the whole stream, so it is meant to be run ahead of time,
+ *  possibly on another thread. It reads from (rw), which must be a separate
+ *  handle on the sample's stream; the sample itself is left untouched and
+ *  can be used while the scan runs. (rw) is not closed.
+ *
+ * The scan stops early, listing nothing, once (cancel) is set to nonzero.
+ *
+ * The points are returned in increasing order, in an array that the caller
+ *  frees with SDL_free(). Pass them to Sound_SetSeekPoints().
+ *
+ *    \param sample The Sound_Sample whose decoder does the scan.
+ *    \param rw Another handle on the stream the sample decodes.
+ *    \param cancel Flag to stop the scan; can be NULL.
+ *    \param points Receives the array of seek points.
+ *   \return the number of seek points, zero on error or if the decoder
+ *           can't list them.
+ *
+ * \sa Sound_SetSeekPoints
+ */
+SNDDECLSPEC Uint32 SDLCALL Sound_ScanSeekPoints(const Sound_Sample *sample,
+                                                SDL_RWops *rw,
+                                                SDL_atomic_t *cancel,
+                                                Sound_SeekPoint **points);
+
+
+/**
+ * \fn int Sound_SetSeekPoints(Sound_Sample *sample, const Sound_SeekPoint *points, Uint32 count)
+ * \brief Let Sound_Seek() start from known positions.
+ *
+ * Gives the sample's decoder the seek points listed by an earlier
+ *  Sound_ScanSeekPoints() on the same stream, so that seeks go straight
+ *  to the nearest one instead of searching the stream. The points are
+ *  copied. Seeking stays sample-exact.
+ *
+ *    \param sample The Sound_Sample to speed up.
+ *    \param points The seek points, in increasing order.
+ *    \param count The number of seek points.
+ *   \return nonzero if the decoder took the points, zero otherwise.
+ *
+ * \sa Sound_ScanSeekPoints
+ * \sa Sound_Seek
+ */
+SNDDECLSPEC int SDLCALL Sound_SetSeekPoints(Sound_Sample *sample,
+                                            const Sound_SeekPoint *points,
+                                            Uint32 count);
+
+
 #ifdef __cplusplus
 }
 #endif
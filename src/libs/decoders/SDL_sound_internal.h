@@ -214,6 +214,30 @@ typedef struct __SOUND_DECODERFUNCTIONS__
          *  continue as if nothing happened.
          */
     int (*seek)(Sound_Sample *sample, Uint32 ms);
+
+        /*
+         * List the positions in the stream where seeks can start, reading
+         *  from (rw) instead of the sample's own handle, which may be in
+         *  use on another thread. Only read from (sample), never change it.
+         *
+         * Allocate (*points) with SDL_malloc() and return how many there
+         *  are, in increasing order. Return zero, with nothing allocated,
+         *  on error or once SDL_AtomicGet(cancel) is nonzero (if not NULL).
+         *
+         * This method is optional; set it to NULL if you can't support it.
+         */
+    Uint32 (*scan_seek_points)(const Sound_Sample *sample, SDL_RWops *rw,
+                               SDL_atomic_t *cancel, Sound_SeekPoint **points);
+
+        /*
+         * Take a copy of the points listed by scan_seek_points() and use
+         *  them in later calls to seek(). Nonzero on success, zero on
+         *  failure.
+         *
+         * This method is optional; set it to NULL if scan_seek_points() is.
+         */
+    int (*set_seek_points)(Sound_Sample *sample, const Sound_SeekPoint *points,
+                           Uint32 count);
 } Sound_DecoderFunctions;
 
 typedef void (*MixFunc)(float *dst, void *src, Uint32 frames, float *gains);
@@ -269,6 +293,16 @@ Uint32 __Sound_convertMsToBytePos(Sound_AudioInfo *info, Uint32 ms);
  */
 int __Sound_strcasecmp(const char *x, const char *y);
 
+/*
+ * Lists the Ogg pages in (rw), from its start, that end a packet and carry
+ *  a granule position, as seek points holding that granule position and
+ *  the page's offset. Pages closer than (min_spacing) bytes to the last
+ *  listed one are skipped. Fails, returning zero, if the stream has more
+ *  than one logical bitstream. See scan_seek_points() for the rest.
+ */
+Uint32 __Sound_ScanOggPages(SDL_RWops *rw, Uint32 min_spacing,
+                            SDL_atomic_t *cancel, Sound_SeekPoint **points);
+
 
 /* These get used all over for lessening code clutter. */
 #define BAIL_MACRO(e, r) { __Sound_SetError(e); return r; }
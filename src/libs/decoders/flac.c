@@ -29,6 +29,7 @@
  */
 
 #include <math.h> /* for llroundf */
+#include <string.h> /* for memmove */
 
 #include "SDL_sound.h"
 #define __SDL_SOUND_INTERNAL__
@@ -41,6 +42,20 @@
 #define DR_FLAC_BUFFER_SIZE 8192
 #include "dr_flac.h"
 
+/* Seek points closer than this would only save dr_flac a frame or two. */
+#define FLAC_SEEK_POINT_SPACING 16384
+
+/* The longest possible frame header, from the sync code to the CRC-8. */
+#define FLAC_MAX_FRAME_HEADER 16
+
+#define FLAC_SCAN_BUFFER_SIZE 65536
+
+typedef struct
+{
+    drflac *dr;
+    drflac_seekpoint *seek_points; /* from FLAC_set_seek_points, or NULL */
+} flac_t;
+
 static size_t flac_read(void* pUserData, void* pBufferOut, size_t bytesToRead)
 {
     Uint8 *ptr = (Uint8 *) pBufferOut;
@@ -111,7 +126,13 @@ static int FLAC_open(Sound_Sample *sample, const char *ext)
         internal->total_time += ((frames % rate) * 1000) / rate;
     } /* else */
 
-    internal->decoder_private = dr;
+    flac_t *flac = (flac_t *) SDL_calloc(1, sizeof (flac_t));
+    if (!flac) {
+        drflac_close(dr);
+        BAIL_MACRO(ERR_OUT_OF_MEMORY, 0);
+    } /* if */
+    flac->dr = dr;
+    internal->decoder_private = flac;
 
     return 1;
 } /* FLAC_open */
@@ -121,15 +142,17 @@ static int FLAC_open(Sound_Sample *sample, const char *ext)
 static void FLAC_close(Sound_Sample *sample)
 {
     Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
-    drflac *dr = (drflac *) internal->decoder_private;
-    drflac_close(dr);
+    flac_t *flac = (flac_t *) internal->decoder_private;
+    drflac_close(flac->dr);
+    SDL_free(flac->seek_points);
+    SDL_free(flac);
 } /* FLAC_close */
 
 
 static Uint32 FLAC_read(Sound_Sample *sample, void* buffer, Uint32 desired_frames)
 {
     Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
-    drflac *dr = (drflac *) internal->decoder_private;
+    drflac *dr = ((flac_t *) internal->decoder_private)->dr;
     const drflac_uint64 decoded_frames = drflac_read_pcm_frames_s16(dr,
                                                                     desired_frames,
                                                                     (drflac_int16 *) buffer);
@@ -140,20 +163,254 @@ static Uint32 FLAC_read(Sound_Sample *sample, void* buffer, Uint32 desired_frame
 static int FLAC_rewind(Sound_Sample *sample)
 {
     Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
-    drflac *dr = (drflac *) internal->decoder_private;
+    drflac *dr = ((flac_t *) internal->decoder_private)->dr;
     return (drflac_seek_to_pcm_frame(dr, 0) == DRFLAC_TRUE);
 } /* FLAC_rewind */
 
 static int FLAC_seek(Sound_Sample *sample, Uint32 ms)
 {
     Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
-    drflac *dr = (drflac *) internal->decoder_private;
+    drflac *dr = ((flac_t *) internal->decoder_private)->dr;
     const float frames_per_ms = ((float) sample->actual.rate) / 1000.0f;
     const drflac_uint64 frame_offset = llroundf(frames_per_ms * ms);
     return (drflac_seek_to_pcm_frame(dr, frame_offset) == DRFLAC_TRUE);
 } /* FLAC_seek */
 
 
+/* CRC-8 of a frame header, with the polynomial x^8 + x^2 + x + 1 */
+static Uint8 flac_crc8(const Uint8 *data, size_t len)
+{
+    Uint8 crc = 0;
+    int bit;
+    while (len--) {
+        crc ^= *data++;
+        for (bit = 0; bit < 8; ++bit)
+            crc = (Uint8) ((crc & 0x80) ? (crc << 1) ^ 0x07 : (crc << 1));
+    } /* while */
+    return crc;
+} /* flac_crc8 */
+
+/*
+ * Parses the frame header at the start of (data), which holds (len) bytes.
+ *  Returns the header's length, or 0 if it isn't a valid one. The number is
+ *  the frame's first PCM frame in variable-blocksize streams, and the frame's
+ *  index otherwise.
+ */
+static size_t flac_parse_frame_header(const Uint8 *data, size_t len,
+                                      int *variable, Uint64 *number,
+                                      Uint32 *block_size)
+{
+    size_t pos = 4;
+    Uint8 block_code, rate_code;
+    int extra, i;
+
+    if (len < 6 || data[0] != 0xFF || (data[1] & 0xFE) != 0xF8)
+        return 0;
+
+    block_code = data[2] >> 4;
+    rate_code = data[2] & 0x0F;
+    if (block_code == 0 || rate_code == 0x0F)
+        return 0;
+    if ((data[3] >> 4) > 10 || (data[3] & 0x01))
+        return 0; /* reserved channel assignment or bit */
+
+    /* The number is coded like a UTF-8 character, extended to 36 bits */
+    if (!(data[pos] & 0x80)) {
+        *number = data[pos];
+        extra = 0;
+    } else {
+        Uint8 mask;
+        extra = 0;
+        for (mask = 0x40; data[pos] & mask; mask >>= 1)
+            ++extra;
+        if (extra == 0 || extra > 6)
+            return 0; /* a continuation byte, or 0xFF */
+        *number = data[pos] & (0x3F >> extra);
+    } /* else */
+    if (pos + 1 + extra + 2 + 2 + 1 > len)
+        return 0;
+    for (i = 0; i < extra; ++i) {
+        const Uint8 byte = data[pos + 1 + i];
+        if ((byte & 0xC0) != 0x80)
+            return 0;
+        *number = (*number << 6) | (byte & 0x3F);
+    } /* for */
+    pos += 1 + extra;
+
+    if (block_code == 1)
+        *block_size = 192;
+    else if (block_code <= 5)
+        *block_size = 576u << (block_code - 2);
+    else if (block_code == 6)
+        *block_size = data[pos++] + 1u;
+    else if (block_code == 7) {
+        *block_size = ((Uint32) data[pos] << 8 | data[pos + 1]) + 1u;
+        pos += 2;
+    } else
+        *block_size = 256u << (block_code - 8);
+
+    if (rate_code == 12)
+        pos += 1;
+    else if (rate_code == 13 || rate_code == 14)
+        pos += 2;
+
+    if (flac_crc8(data, pos) != data[pos])
+        return 0;
+
+    *variable = data[1] & 0x01;
+    return pos + 1;
+} /* flac_parse_frame_header */
+
+/* Returns the offset of the first frame, after the metadata blocks, or 0 */
+static Sint64 flac_find_first_frame(SDL_RWops *rw)
+{
+    Uint8 header[4];
+    Sint64 pos = 4;
+
+    if (SDL_RWseek(rw, 0, RW_SEEK_SET) != 0
+        || SDL_RWread(rw, header, sizeof (header), 1) != 1
+        || SDL_memcmp(header, "fLaC", 4) != 0)
+        return 0;
+
+    for (;;) {
+        if (SDL_RWseek(rw, pos, RW_SEEK_SET) != pos
+            || SDL_RWread(rw, header, sizeof (header), 1) != 1)
+            return 0;
+        pos += 4 + ((Sint64) header[1] << 16 | header[2] << 8 | header[3]);
+        if (header[0] & 0x80) /* the last metadata block */
+            return pos;
+    } /* for */
+} /* flac_find_first_frame */
+
+/*
+ * Lists the frames by their headers, without decoding them. Each frame must
+ *  carry on from the previous one, so a sync code turning up inside the
+ *  audio data can't be taken for a frame.
+ */
+static Uint32 FLAC_scan_seek_points(const Sound_Sample *sample, SDL_RWops *rw,
+                                    SDL_atomic_t *cancel, Sound_SeekPoint **points)
+{
+    Sound_SeekPoint *list = NULL;
+    Uint32 count = 0, capacity = 0;
+    Uint8 *buffer = NULL;
+    size_t filled = 0, i = 0;
+    int at_end = 0;
+    int stream_variable = -1;
+    Uint32 fixed_block_size = 0;
+    Uint64 expected = 0;
+    Sint64 buffer_pos = flac_find_first_frame(rw);
+    Sint64 next_listed = 0;
+
+    (void) sample; /* deliberately unused, but present for API compliance */
+    *points = NULL;
+    if (buffer_pos == 0 || SDL_RWseek(rw, buffer_pos, RW_SEEK_SET) != buffer_pos)
+        return 0;
+    buffer = (Uint8 *) SDL_malloc(FLAC_SCAN_BUFFER_SIZE);
+    if (!buffer)
+        return 0;
+
+    for (;;) {
+        int variable;
+        Uint64 number;
+        Uint32 block_size;
+        size_t header_len;
+
+        if (i + FLAC_MAX_FRAME_HEADER > filled && !at_end) {
+            size_t got;
+            if (cancel && SDL_AtomicGet(cancel))
+                goto failed;
+            memmove(buffer, buffer + i, filled - i);
+            buffer_pos += (Sint64) i;
+            filled -= i;
+            i = 0;
+            got = SDL_RWread(rw, buffer + filled, 1, FLAC_SCAN_BUFFER_SIZE - filled);
+            filled += got;
+            at_end = (got == 0);
+        } /* if */
+        if (i + 2 > filled)
+            break;
+
+        header_len = flac_parse_frame_header(buffer + i, filled - i,
+                                             &variable, &number, &block_size);
+        if (!header_len || number != expected
+            || (stream_variable >= 0 && variable != stream_variable)) {
+            ++i;
+            continue;
+        } /* if */
+
+        if (stream_variable < 0) {
+            stream_variable = variable;
+            fixed_block_size = block_size;
+        } /* if */
+
+        if (buffer_pos + (Sint64) i >= next_listed) {
+            const Uint64 first_pcm_frame = variable ? number
+                                                    : number * fixed_block_size;
+            Sound_SeekPoint *grown = list;
+            if (count == capacity) {
+                capacity = capacity ? capacity * 2 : 256;
+                grown = (Sound_SeekPoint *) SDL_realloc(list, capacity * sizeof (Sound_SeekPoint));
+                if (!grown)
+                    goto failed;
+                list = grown;
+            } /* if */
+            list[count].frame = first_pcm_frame;
+            list[count].offset = (Uint64) (buffer_pos + (Sint64) i);
+            ++count;
+            next_listed = buffer_pos + (Sint64) i + FLAC_SEEK_POINT_SPACING;
+        } /* if */
+
+        expected = variable ? number + block_size : number + 1;
+        i += header_len;
+    } /* for */
+
+    SDL_free(buffer);
+    *points = list;
+    return count;
+
+failed:
+    SDL_free(buffer);
+    SDL_free(list);
+    return 0;
+} /* FLAC_scan_seek_points */
+
+/*
+ * Hands the points to dr_flac as the stream's seek table, which its seeks
+ *  then use the same way as one stored in the file. A point's frame count
+ *  is only checked against the stream's largest block size, which is what
+ *  we give it, as the scan doesn't keep each frame's.
+ */
+static int FLAC_set_seek_points(Sound_Sample *sample, const Sound_SeekPoint *points, Uint32 count)
+{
+    Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
+    flac_t *flac = (flac_t *) internal->decoder_private;
+    drflac *dr = flac->dr;
+    drflac_seekpoint *seek_points;
+    Uint32 i;
+
+    /* Keep the file's own table if it's the finer one */
+    if (count <= dr->seekpointCount)
+        return 0;
+    if (points[0].offset < dr->firstFLACFramePosInBytes)
+        return 0;
+
+    seek_points = (drflac_seekpoint *) SDL_malloc(count * sizeof (drflac_seekpoint));
+    if (!seek_points)
+        return 0;
+    for (i = 0; i < count; ++i) {
+        seek_points[i].firstPCMFrame = points[i].frame;
+        seek_points[i].flacFrameOffset = points[i].offset - dr->firstFLACFramePosInBytes;
+        seek_points[i].pcmFrameCount = dr->maxBlockSizeInPCMFrames;
+    } /* for */
+
+    SDL_free(flac->seek_points);
+    flac->seek_points = seek_points;
+    dr->pSeekpoints = seek_points;
+    dr->seekpointCount = count;
+    return 1;
+} /* FLAC_set_seek_points */
+
+
 static const char *extensions_flac[] = { "FLAC", "FLA", NULL };
 const Sound_DecoderFunctions __Sound_DecoderFunctions_FLAC =
 {
@@ -169,7 +426,9 @@ const Sound_DecoderFunctions __Sound_DecoderFunctions_FLAC =
     FLAC_close,      /*  close() method */
     FLAC_read,       /*   read() method */
     FLAC_rewind,     /* rewind() method */
-    FLAC_seek        /*   seek() method */
+    FLAC_seek,       /*   seek() method */
+    FLAC_scan_seek_points, /* scan_seek_points() method */
+    FLAC_set_seek_points   /*  set_seek_points() method */
 };
 
 /* end of flac.c ... */
@@ -180,6 +180,8 @@ extern const Sound_DecoderFunctions __Sound_DecoderFunctions_MP3 = {
     MP3_close,      /*  close() method */
     MP3_read,       /*   read() method */
     MP3_rewind,     /* rewind() method */
-    MP3_seek        /*   seek() method */
+    MP3_seek,       /*   seek() method */
+    nullptr, /* scan_seek_points() method, see mp3_seek_table.cpp */
+    nullptr  /*  set_seek_points() method */
 }; }
 /* end of SDL_sound_mp3.c ... */
@@ -73,6 +73,7 @@
  */
 
 #include "mp3_seek_table.h"
+#include "seek_point_table.h"
 
 // System headers
 #include <sys/stat.h>
@@ -83,9 +84,6 @@
 // Local headers
 #include "support.h"
 
-#define XXH_INLINE_ALL
-#include "xxhash.h"
-
 // C++ scope modifiers
 using std::map;
 using std::vector;
@@ -111,72 +109,6 @@ off_t get_file_size(const char* filename) {
 }
 
 
-// Calculates a unique 64-bit hash (integer) from the provided file.
-// This function should not cause side-effects; ie, the current
-// read-position within the file should not be altered.
-//
-// This function tries to files as-close to the middle of the MP3 file as possible,
-// and use that feed the hash function in hopes of the most uniqueness.
-// We're trying to avoid content that might be duplicated across MP3s, like:
-// 1. ID3 tag filler content, which might be boiler plate or all empty
-// 2. Trailing silence or similar zero-PCM content
-//
-Uint64 calculate_stream_hash(struct SDL_RWops* const context) {
-    // Save the current stream position, so we can restore it at the end of the function.
-    const Sint64 original_pos = SDL_RWtell(context);
-
-    // Seek to the end of the file so we can calculate the stream size.
-    SDL_RWseek(context, 0, RW_SEEK_END);
-
-    const Sint64 stream_size = SDL_RWtell(context);
-    if (stream_size <= 0) {
-        // LOG_MSG("MP3: get_stream_size returned %d, but should be positive", stream_size);
-        return 0;
-    }
-
-    // Seek to the middle of the file while taking into account version small files.
-    const Sint64 tail_size = (stream_size > 32768) ? 32768 : stream_size;
-    const Sint64 mid_pos = static_cast<Sint64>(stream_size/2.0) - tail_size;
-    SDL_RWseek(context, mid_pos >= 0 ? mid_pos : 0, RW_SEEK_SET);
-
-    // Prepare our read buffer and counter:
-    vector<char> buffer(1024, 0);
-    size_t total_bytes_read = 0;
-
-    // Initialize xxHash's state using the stream_size as our seed.
-    // Seeding with the stream_size provide a second level of uniqueness
-    // in the unlikely scenario that two files of different length happen to
-    // have the same trailing 32KB of content.  The different seeds will produce
-    // unique hashes.
-    XXH64_state_t* const state = XXH64_createState();
-    if(!state) {
-        return 0;
-    }
-
-    const uint64_t seed = static_cast<uint64_t>(stream_size);
-    XXH64_reset(state, seed);
-
-    while (total_bytes_read < static_cast<size_t>(tail_size)) {
-        // Read a chunk of data.
-        const size_t bytes_read = SDL_RWread(context, buffer.data(), 1, buffer.size());
-
-        if (bytes_read != 0) {
-            // Update our hash if we read data.
-            XXH64_update(state, buffer.data(), bytes_read);
-            total_bytes_read += bytes_read;
-        } else {
-            break;
-        }
-    }
-
-    // restore the stream position
-    SDL_RWseek(context, original_pos, RW_SEEK_SET);
-
-    const Uint64 hash = XXH64_digest(state);
-    XXH64_freeState(state);
-    return hash;
-}
-
 // This function generates a new seek-table for a given mp3 stream and writes
 // the data to the fast-seek file.
 //
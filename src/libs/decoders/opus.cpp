@@ -38,9 +38,11 @@
 
 #include "config.h"
 
+#include <algorithm>
 #include <cassert>
 #include <opusfile.h>
 #include <SDL.h>
+#include <vector>
 
 #include "support.h"
 
@@ -52,6 +54,19 @@
 #define OPUS_SAMPLE_RATE        48000u
 #define OPUS_SAMPLE_RATE_PER_MS    48u
 
+// Decoding needs this much audio before the target to converge after a jump
+#define OPUS_SEEK_PREROLL (80 * OPUS_SAMPLE_RATE_PER_MS)
+
+// Seek points closer than this would save little decoding
+#define OPUS_SEEK_POINT_SPACING 16384u
+
+// Our private-decoder structure where we hold the opusfile instance and the
+// seek points given by opus_set_seek_points, with their frames in PCM samples
+struct opus_t {
+    OggOpusFile *of = nullptr;
+    std::vector<Sound_SeekPoint> seek_points = {};
+};
+
 static int32_t opus_init(void)
 {
     SNDDBG(("Opus init:              done\n"));
@@ -235,11 +250,11 @@ static void opus_close(Sound_Sample * sample)
      * then we are still responsible for freeing the OggOpusFile with op_free().
      */
     auto *internal = static_cast<Sound_SampleInternal*>(sample->opaque);
-    auto *of = static_cast<OggOpusFile*>(internal->decoder_private);
-    if (of != nullptr) {
-        op_free(of);
-        internal->decoder_private = nullptr;
-    }
+    auto *opus = static_cast<opus_t*>(internal->decoder_private);
+    if (opus->of != nullptr)
+        op_free(opus->of);
+    delete opus;
+    internal->decoder_private = nullptr;
     return;
 
 } /* opus_close */
@@ -259,7 +274,9 @@ static int32_t opus_open(Sound_Sample * sample, const char * ext)
     int32_t rcode = 0; // assume failure until determined otherwise
     auto *internal = static_cast<Sound_SampleInternal*>(sample->opaque);
     OggOpusFile *of = op_open_callbacks(internal->rw, &RWops_opus_callbacks, nullptr, 0, &rcode);
-    internal->decoder_private = of;
+    auto *opus = new opus_t;
+    opus->of = of;
+    internal->decoder_private = opus;
 
     // Had a problem during the open
     if (rcode != 0) { // op_open will set rcode to non-zero
@@ -302,7 +319,8 @@ static uint32_t opus_read(Sound_Sample * sample, void * buffer, uint32_t request
         return 0u;
 
     auto *internal = static_cast<Sound_SampleInternal*>(sample->opaque);
-    auto *of = static_cast<OggOpusFile*>(internal->decoder_private);
+    auto *opus = static_cast<opus_t*>(internal->decoder_private);
+    auto *of = opus->of;
     const uint32_t channels = sample->actual.channels;
 
     // Initial state-tracking variables
@@ -336,6 +354,48 @@ static uint32_t opus_read(Sound_Sample * sample, void * buffer, uint32_t request
     return decoded_frames;
 } /* opus_read */
 
+/*
+ * Opus Seek From Points
+ * ---------------------
+ * Jumps to the last seek point at least the pre-roll ahead of the desired
+ * PCM sample, and decodes up to it. Returns false, leaving the stream to
+ * opusfile's own search, if there's no such point.
+ */
+static bool opus_seek_from_points(const opus_t *opus, const ogg_int64_t desired_pcm,
+                                  const uint8_t channels)
+{
+    const auto &points = opus->seek_points;
+    const auto after = std::upper_bound(points.begin(), points.end(),
+                                        desired_pcm - OPUS_SEEK_PREROLL,
+                                        [](const ogg_int64_t pcm, const Sound_SeekPoint &point) {
+                                            return pcm < static_cast<ogg_int64_t>(point.frame);
+                                        });
+    if (after == points.begin())
+        return false;
+    const auto &point = *(after - 1);
+
+    // Decoding resumes with the first packet that starts on the page, so
+    // at or before the page's end
+    if (op_raw_seek(opus->of, static_cast<opus_int64>(point.offset)) != 0)
+        return false;
+    ogg_int64_t pcm = op_pcm_tell(opus->of);
+    if (pcm < 0 || pcm > desired_pcm)
+        return false;
+
+    constexpr int discard_frames = 4096;
+    std::vector<opus_int16> discarded(discard_frames * channels);
+    while (pcm < desired_pcm) {
+        const auto frames = static_cast<int>(std::min<ogg_int64_t>(desired_pcm - pcm, discard_frames));
+        const int result = op_read(opus->of, discarded.data(), frames * channels, nullptr);
+        if (result == OP_HOLE)
+            continue;
+        if (result <= 0)
+            return false;
+        pcm += result;
+    }
+    return true;
+} /* opus_seek_from_points */
+
 /*
  * Opus Seek
  * ---------
@@ -350,7 +410,8 @@ static int32_t opus_seek(Sound_Sample * sample, const uint32_t ms)
     int rcode = -1;
 
     auto *internal = static_cast<Sound_SampleInternal*>(sample->opaque);
-    auto *of = static_cast<OggOpusFile*>(internal->decoder_private);
+    auto *opus = static_cast<opus_t*>(internal->decoder_private);
+    auto *of = opus->of;
 
 #if (defined DEBUG_CHATTER)
     const float total_seconds = ms / 1000.0;
@@ -365,7 +426,10 @@ static int32_t opus_seek(Sound_Sample * sample, const uint32_t ms)
 
     // convert the desired ms offset into OPUS PCM samples
     const ogg_int64_t desired_pcm = ms * OPUS_SAMPLE_RATE_PER_MS;
-    rcode = op_pcm_seek(of, desired_pcm);
+    if (opus_seek_from_points(opus, desired_pcm, sample->actual.channels))
+        rcode = 0;
+    else
+        rcode = op_pcm_seek(of, desired_pcm);
 
     if (rcode != 0) {
         SNDDBG(("Opus seek problem, see errno:        %d\n", rcode));
@@ -392,6 +456,40 @@ static int32_t opus_rewind(Sound_Sample* sample)
 
 
 
+/*
+ * Opus Scan Seek Points
+ * ---------------------
+ * Lists the Ogg pages' granule positions, which still include the stream's
+ * pre-skip.
+ */
+static uint32_t opus_scan_seek_points(const Sound_Sample *sample, SDL_RWops *rw,
+                                      SDL_atomic_t *cancel, Sound_SeekPoint **points)
+{
+    (void) sample; // deliberately unused, but present for API compliance
+    return __Sound_ScanOggPages(rw, OPUS_SEEK_POINT_SPACING, cancel, points);
+} /* opus_scan_seek_points */
+
+/*
+ * Opus Set Seek Points
+ * --------------------
+ * Keeps the points, turning their granule positions into PCM samples.
+ */
+static int32_t opus_set_seek_points(Sound_Sample *sample, const Sound_SeekPoint *points,
+                                    const uint32_t count)
+{
+    assertm(sample && points, "OPUS: Inputs are not initialized");
+    auto *internal = static_cast<Sound_SampleInternal*>(sample->opaque);
+    auto *opus = static_cast<opus_t*>(internal->decoder_private);
+    const uint64_t pre_skip = op_head(opus->of, -1)->pre_skip;
+
+    opus->seek_points.clear();
+    for (uint32_t i = 0; i < count; ++i)
+        if (points[i].frame >= pre_skip)
+            opus->seek_points.push_back({points[i].frame - pre_skip, points[i].offset});
+    return !opus->seek_points.empty();
+} /* opus_set_seek_points */
+
+
 static const char* extensions_opus[] = { "OPUS", nullptr };
 
 extern const Sound_DecoderFunctions __Sound_DecoderFunctions_OPUS =
@@ -408,6 +506,8 @@ extern const Sound_DecoderFunctions __Sound_DecoderFunctions_OPUS =
     opus_close,  /*  close() method */
     opus_read,   /*   read() method */
     opus_rewind, /* rewind() method */
-    opus_seek    /*   seek() method */
+    opus_seek,   /*   seek() method */
+    opus_scan_seek_points, /* scan_seek_points() method */
+    opus_set_seek_points   /*  set_seek_points() method */
 }; }
 /* end of opus.cpp ... */
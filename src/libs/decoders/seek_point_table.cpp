@@ -0,0 +1,226 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+/*
+ *  DOSBox Seek Point Table Handler
+ *  -------------------------------
+ *
+ * Problem:
+ *          FLAC, Vorbis, and Opus streams can be seeked exactly, but only
+ *          by searching the stream for the right frame or page, which takes
+ *          several reads and some decoding each time. Games that restart or
+ *          jump between music tracks pay that cost on every seek.
+ *
+ * Solution:
+ *          The decoder lists the stream's frames or pages once, ahead of
+ *          time (see Sound_ScanSeekPoints), and its seeks then start from the
+ *          nearest listed position. As with the MP3 seek table, the list is
+ *          kept in a local file, keyed by an xxHash of the stream's content,
+ *          so each stream is only scanned the first time it's seen.
+ *
+ *          The points are stored as-is, in the decoder's own units, so the
+ *          file holds points for streams of any of the supported codecs.
+ *          See mp3_seek_table.cpp for how the hashing and the versioned,
+ *          endian-safe file format deal with changed and colliding files.
+ */
+
+#include "seek_point_table.h"
+
+// System headers
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+
+// Local headers
+#include "archive.h"
+
+#define XXH_INLINE_ALL
+#include "xxhash.h"
+
+// C++ scope modifiers
+using std::map;
+using std::vector;
+using std::string;
+using std::ios_base;
+using std::ifstream;
+using std::ofstream;
+
+// Identifies a valid versioned seek point table
+#define SEEK_POINT_TABLE_IDENTIFIER "sp-v1"
+
+static constexpr char seek_point_filename[] = "seekpoints.lut";
+
+// Serializable form of Sound_SeekPoint
+struct seek_point_serial {
+    Uint64 frame;
+    Uint64 offset;
+    template <class T> void Serialize(T& archive) {
+            archive & frame & offset;
+    }
+};
+
+using seek_point_table_t = map<Uint64, vector<seek_point_serial> >;
+
+// Scans from several tracks can finish at once
+static std::mutex seek_point_file_mutex;
+
+// Calculates a unique 64-bit hash (integer) from the provided file.
+// This function should not cause side-effects; ie, the current
+// read-position within the file should not be altered.
+//
+// This function tries to files as-close to the middle of the audio file as possible,
+// and use that feed the hash function in hopes of the most uniqueness.
+// We're trying to avoid content that might be duplicated across files, like:
+// 1. ID3 tag filler content, which might be boiler plate or all empty
+// 2. Trailing silence or similar zero-PCM content
+//
+Uint64 calculate_stream_hash(struct SDL_RWops* const context) {
+    // Save the current stream position, so we can restore it at the end of the function.
+    const Sint64 original_pos = SDL_RWtell(context);
+
+    // Seek to the end of the file so we can calculate the stream size.
+    SDL_RWseek(context, 0, RW_SEEK_END);
+
+    const Sint64 stream_size = SDL_RWtell(context);
+    if (stream_size <= 0) {
+        // LOG_MSG("SEEK: get_stream_size returned %d, but should be positive", stream_size);
+        return 0;
+    }
+
+    // Seek to the middle of the file while taking into account version small files.
+    const Sint64 tail_size = (stream_size > 32768) ? 32768 : stream_size;
+    const Sint64 mid_pos = static_cast<Sint64>(stream_size/2.0) - tail_size;
+    SDL_RWseek(context, mid_pos >= 0 ? mid_pos : 0, RW_SEEK_SET);
+
+    // Prepare our read buffer and counter:
+    vector<char> buffer(1024, 0);
+    size_t total_bytes_read = 0;
+
+    // Initialize xxHash's state using the stream_size as our seed.
+    // Seeding with the stream_size provide a second level of uniqueness
+    // in the unlikely scenario that two files of different length happen to
+    // have the same trailing 32KB of content.  The different seeds will produce
+    // unique hashes.
+    XXH64_state_t* const state = XXH64_createState();
+    if(!state) {
+        return 0;
+    }
+
+    const uint64_t seed = static_cast<uint64_t>(stream_size);
+    XXH64_reset(state, seed);
+
+    while (total_bytes_read < static_cast<size_t>(tail_size)) {
+        // Read a chunk of data.
+        const size_t bytes_read = SDL_RWread(context, buffer.data(), 1, buffer.size());
+
+        if (bytes_read != 0) {
+            // Update our hash if we read data.
+            XXH64_update(state, buffer.data(), bytes_read);
+            total_bytes_read += bytes_read;
+        } else {
+            break;
+        }
+    }
+
+    // restore the stream position
+    SDL_RWseek(context, original_pos, RW_SEEK_SET);
+
+    const Uint64 hash = XXH64_digest(state);
+    XXH64_freeState(state);
+    return hash;
+}
+
+// Reads the whole seek point file, or leaves the table empty if the file
+// is missing or isn't one of ours.
+static void load_seek_point_table(seek_point_table_t& table) {
+    ifstream infile(seek_point_filename, ios_base::binary);
+    if (!infile.is_open()) {
+        return;
+    }
+    string fetched_identifier;
+    Archive<ifstream> deserialize(infile);
+    deserialize >> fetched_identifier;
+    if (!infile || fetched_identifier != SEEK_POINT_TABLE_IDENTIFIER) {
+        return;
+    }
+    deserialize >> table;
+    if (!infile) {
+        table.clear();
+    }
+}
+
+// Caching the points to file is optional.  If the user is blocked due to
+// security or write-access issues, then the stream is scanned again on
+// the next start of DOSBox.
+static void save_seek_point_table(const seek_point_table_t& table) {
+    ofstream outfile(seek_point_filename, ios_base::trunc | ios_base::binary);
+    if (outfile.is_open()) {
+        Archive<ofstream> serialize(outfile);
+        serialize << SEEK_POINT_TABLE_IDENTIFIER << table;
+    }
+}
+
+vector<Sound_SeekPoint> load_or_scan_seek_points(const Sound_Sample *sample,
+                                                 struct SDL_RWops* const rw,
+                                                 SDL_atomic_t *cancel) {
+    vector<Sound_SeekPoint> points;
+
+    const Uint64 stream_hash = calculate_stream_hash(rw);
+    if (stream_hash == 0) {
+        return points;
+    }
+
+    // Use the stored points, if we have them.
+    {
+        std::lock_guard<std::mutex> lock(seek_point_file_mutex);
+        seek_point_table_t table;
+        load_seek_point_table(table);
+        const auto stored = table.find(stream_hash);
+        if (stored != table.end()) {
+            for (const auto& point : stored->second) {
+                points.push_back({point.frame, point.offset});
+            }
+            return points;
+        }
+    }
+
+    // Otherwise scan the stream, without holding the lock as that's the
+    // slow part.
+    Sound_SeekPoint* scanned = nullptr;
+    const Uint32 count = Sound_ScanSeekPoints(sample, rw, cancel, &scanned);
+    if (count == 0) {
+        return points;
+    }
+    points.assign(scanned, scanned + count);
+    SDL_free(scanned);
+
+    // Add them to the file, which might have gained other streams since.
+    std::lock_guard<std::mutex> lock(seek_point_file_mutex);
+    seek_point_table_t table;
+    load_seek_point_table(table);
+    auto& stored = table[stream_hash];
+    stored.clear();
+    for (const auto& point : points) {
+        stored.push_back({point.frame, point.offset});
+    }
+    save_seek_point_table(table);
+    return points;
+}
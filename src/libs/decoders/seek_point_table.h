@@ -0,0 +1,49 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOSBOX_SEEK_POINT_TABLE_H
+#define DOSBOX_SEEK_POINT_TABLE_H
+
+/* DOSBox Seek Point Table Handler
+ * -------------------------------
+ * See seek_point_table.cpp for more documentation.
+ */
+
+#include "config.h"
+
+#include <vector>         // provides: vector
+#include <SDL.h>          // provides: SDL_RWops, SDL_atomic_t
+#include "SDL_sound.h"    // provides: Sound_Sample, Sound_SeekPoint
+
+// Calculates a 64-bit hash of the stream's content, leaving its read
+// position unchanged; zero on failure.
+Uint64 calculate_stream_hash(struct SDL_RWops* const context);
+
+// Returns the seek points for the stream in rw, which must be a separate
+// handle on the sample's stream. They're loaded from the seek point file if
+// the stream was seen before, and otherwise scanned with the sample's
+// decoder and added to the file. Can be called from any thread.
+//
+// Returns no points if the decoder can't list them or cancel gets set.
+std::vector<Sound_SeekPoint> load_or_scan_seek_points(const Sound_Sample *sample,
+                                                      struct SDL_RWops* const rw,
+                                                      SDL_atomic_t *cancel);
+
+#endif
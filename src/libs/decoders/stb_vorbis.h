@@ -301,6 +301,11 @@ extern int stb_vorbis_seek(stb_vorbis *f, unsigned int sample_number);
 extern int stb_vorbis_seek_start(stb_vorbis *f);
 // this function is equivalent to stb_vorbis_seek(f,0)
 
+extern int stb_vorbis_set_seek_pages(stb_vorbis *f, const unsigned int *page_starts, const unsigned int *page_samples, int count);
+// DOSBox: gives the seek functions a list of known pages to start their
+// search from, with the file offset of each page and its granule position,
+// in increasing order. the list is copied; returns 0 if it can't be.
+
 extern unsigned int stb_vorbis_stream_length_in_samples(stb_vorbis *f);
 extern float        stb_vorbis_stream_length_in_seconds(stb_vorbis *f);
 // these functions return the total length of the vorbis stream
@@ -834,6 +839,10 @@ struct stb_vorbis
    // (but not necessarily the page on which it starts)
    ProbedPage p_first, p_last;
 
+   // known pages given by stb_vorbis_set_seek_pages, may be empty
+   ProbedPage *seek_pages;
+   int seek_page_count;
+
   // memory management
    stb_vorbis_alloc alloc;
    int setup_offset;
@@ -4289,6 +4298,7 @@ static void vorbis_deinit(stb_vorbis *p)
    }
    setup_free(p, p->floor_config);
    setup_free(p, p->residue_config);
+   setup_free(p, p->seek_pages);
    if (p->mapping) {
       for (i=0; i < p->mapping_count; ++i)
          setup_free(p, p->mapping[i].chan);
@@ -4749,6 +4759,38 @@ static int go_to_page_before(stb_vorbis *f, unsigned int limit_offset)
    return 0;
 }
 
+// narrows the search range down to the known pages on either side of the
+// sample, checking that they're still where the list says they are
+static void bracket_with_seek_pages(stb_vorbis *f, uint32 sample_number, ProbedPage *left, ProbedPage *right)
+{
+   ProbedPage page;
+   int lo = 0, hi = f->seek_page_count;
+
+   // find the first known page past the sample
+   while (lo < hi) {
+      int mid = lo + (hi - lo) / 2;
+      if (f->seek_pages[mid].last_decoded_sample <= sample_number)
+         lo = mid + 1;
+      else
+         hi = mid;
+   }
+
+   if (lo > 0) {
+      set_file_offset(f, f->seek_pages[lo-1].page_start);
+      if (get_seek_page_info(f, &page)
+          && page.last_decoded_sample == f->seek_pages[lo-1].last_decoded_sample
+          && page.page_start >= left->page_start && page.page_end <= right->page_start)
+         *left = page;
+   }
+   if (lo < f->seek_page_count) {
+      set_file_offset(f, f->seek_pages[lo].page_start);
+      if (get_seek_page_info(f, &page)
+          && page.last_decoded_sample == f->seek_pages[lo].last_decoded_sample
+          && page.page_start >= left->page_end && page.page_start <= right->page_start)
+         *right = page;
+   }
+}
+
 // implements the search logic for finding a page and starting decoding. if
 // the function succeeds, current_loc_valid will be true and current_loc will
 // be less than or equal to the provided sample number (the closer the
@@ -4795,6 +4837,9 @@ static int seek_to_sample_coarse(stb_vorbis *f, uint32 sample_number)
       return 0;
    }
 
+   if (f->seek_page_count > 0)
+      bracket_with_seek_pages(f, last_sample_limit, &left, &right);
+
    while (left.page_end != right.page_start) {
       assert(left.page_end < right.page_start);
       // search range in bytes
@@ -4989,6 +5034,26 @@ int stb_vorbis_seek(stb_vorbis *f, unsigned int sample_number)
    return 1;
 }
 
+int stb_vorbis_set_seek_pages(stb_vorbis *f, const unsigned int *page_starts, const unsigned int *page_samples, int count)
+{
+   int i;
+   ProbedPage *pages = NULL;
+   if (count > 0) {
+      pages = (ProbedPage *) setup_malloc(f, sizeof(*pages) * count);
+      if (pages == NULL)
+         return error(f, VORBIS_outofmem);
+      for (i=0; i < count; ++i) {
+         pages[i].page_start = page_starts[i];
+         pages[i].page_end = 0; // read from the file when used
+         pages[i].last_decoded_sample = page_samples[i];
+      }
+   }
+   setup_free(f, f->seek_pages);
+   f->seek_pages = pages;
+   f->seek_page_count = count > 0 ? count : 0;
+   return 1;
+}
+
 int stb_vorbis_seek_start(stb_vorbis *f)
 {
    if (IS_PUSH_MODE(f)) { return error(f, VORBIS_invalid_api_mixing); }
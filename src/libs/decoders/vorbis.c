@@ -38,6 +38,7 @@
 
 #include <string.h> /* memcpy */
 #include <math.h> /* lroundf */
+#include <limits.h> /* INT_MAX, UINT_MAX */
 
 #include "SDL_sound.h"
 #define __SDL_SOUND_INTERNAL__
@@ -209,6 +210,45 @@ static int VORBIS_seek(Sound_Sample *sample, Uint32 ms)
 } /* VORBIS_seek */
 
 
+/* Seek points closer than this would only save stb_vorbis a page read or two. */
+#define VORBIS_SEEK_POINT_SPACING 16384
+
+static Uint32 VORBIS_scan_seek_points(const Sound_Sample *sample, SDL_RWops *rw,
+                                      SDL_atomic_t *cancel, Sound_SeekPoint **points)
+{
+    (void) sample; /* deliberately unused, but present for API compliance */
+    return __Sound_ScanOggPages(rw, VORBIS_SEEK_POINT_SPACING, cancel, points);
+} /* VORBIS_scan_seek_points */
+
+
+static int VORBIS_set_seek_points(Sound_Sample *sample, const Sound_SeekPoint *points, Uint32 count)
+{
+    Sound_SampleInternal *internal = (Sound_SampleInternal *) sample->opaque;
+    stb_vorbis *stb = (stb_vorbis *) internal->decoder_private;
+    unsigned int *page_starts = NULL;
+    unsigned int *page_samples = NULL;
+    Uint32 i;
+    int result = 0;
+
+    /* stb_vorbis keeps file offsets and sample numbers in 32 bits */
+    if (count > INT_MAX || points[count - 1].offset > UINT_MAX || points[count - 1].frame > UINT_MAX)
+        return 0;
+
+    page_starts = (unsigned int *) SDL_malloc(count * sizeof (unsigned int));
+    page_samples = (unsigned int *) SDL_malloc(count * sizeof (unsigned int));
+    if (page_starts && page_samples) {
+        for (i = 0; i < count; i++) {
+            page_starts[i] = (unsigned int) points[i].offset;
+            page_samples[i] = (unsigned int) points[i].frame;
+        }
+        result = stb_vorbis_set_seek_pages(stb, page_starts, page_samples, (int) count);
+    }
+    SDL_free(page_starts);
+    SDL_free(page_samples);
+    return result;
+} /* VORBIS_set_seek_points */
+
+
 static const char *extensions_vorbis[] = { "OGG", "OGA", "VORBIS", NULL };
 const Sound_DecoderFunctions __Sound_DecoderFunctions_VORBIS =
 {
@@ -224,7 +264,9 @@ const Sound_DecoderFunctions __Sound_DecoderFunctions_VORBIS =
     VORBIS_close,      /*  close() method */
     VORBIS_read,       /*   read() method */
     VORBIS_rewind,     /* rewind() method */
-    VORBIS_seek        /*   seek() method */
+    VORBIS_seek,       /*   seek() method */
+    VORBIS_scan_seek_points, /* scan_seek_points() method */
+    VORBIS_set_seek_points   /*  set_seek_points() method */
 };
 
 /* end of SDL_sound_vorbis.c ... */
@@ -180,6 +180,8 @@ const Sound_DecoderFunctions __Sound_DecoderFunctions_WAV =
     WAV_close,      /*  close() method */
     WAV_read,       /*   read() method */
     WAV_rewind,     /* rewind() method */
-    WAV_seek        /*   seek() method */
+    WAV_seek,       /*   seek() method */
+    NULL, /* scan_seek_points() method, PCM seeks are direct */
+    NULL  /*  set_seek_points() method */
 };
 /* end of wav.c ... */
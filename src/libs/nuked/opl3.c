@@ -1047,71 +1047,10 @@ static int16_t OPL3_ClipSample(int32_t sample)
     return (int16_t)sample;
 }
 
-void OPL3_Generate(opl3_chip *chip, int16_t *buf)
+static void OPL3_ClockTimers(opl3_chip *chip)
 {
-    uint8_t ii;
-    uint8_t jj;
-    int16_t accm;
     uint8_t shift = 0;
 
-    buf[1] = OPL3_ClipSample(chip->mixbuff[1]);
-
-    for (ii = 0; ii < 15; ii++)
-    {
-        OPL3_SlotCalcFB(&chip->slot[ii]);
-        OPL3_EnvelopeCalc(&chip->slot[ii]);
-        OPL3_PhaseGenerate(&chip->slot[ii]);
-        OPL3_SlotGenerate(&chip->slot[ii]);
-    }
-
-    chip->mixbuff[0] = 0;
-    for (ii = 0; ii < 18; ii++)
-    {
-        accm = 0;
-        for (jj = 0; jj < 4; jj++)
-        {
-            accm += *chip->channel[ii].out[jj];
-        }
-        chip->mixbuff[0] += (int16_t)(accm & chip->channel[ii].cha);
-    }
-
-    for (ii = 15; ii < 18; ii++)
-    {
-        OPL3_SlotCalcFB(&chip->slot[ii]);
-        OPL3_EnvelopeCalc(&chip->slot[ii]);
-        OPL3_PhaseGenerate(&chip->slot[ii]);
-        OPL3_SlotGenerate(&chip->slot[ii]);
-    }
-
-    buf[0] = OPL3_ClipSample(chip->mixbuff[0]);
-
-    for (ii = 18; ii < 33; ii++)
-    {
-        OPL3_SlotCalcFB(&chip->slot[ii]);
-        OPL3_EnvelopeCalc(&chip->slot[ii]);
-        OPL3_PhaseGenerate(&chip->slot[ii]);
-        OPL3_SlotGenerate(&chip->slot[ii]);
-    }
-
-    chip->mixbuff[1] = 0;
-    for (ii = 0; ii < 18; ii++)
-    {
-        accm = 0;
-        for (jj = 0; jj < 4; jj++)
-        {
-            accm += *chip->channel[ii].out[jj];
-        }
-        chip->mixbuff[1] += (int16_t)(accm & chip->channel[ii].chb);
-    }
-
-    for (ii = 33; ii < 36; ii++)
-    {
-        OPL3_SlotCalcFB(&chip->slot[ii]);
-        OPL3_EnvelopeCalc(&chip->slot[ii]);
-        OPL3_PhaseGenerate(&chip->slot[ii]);
-        OPL3_SlotGenerate(&chip->slot[ii]);
-    }
-
     if ((chip->timer & 0x3f) == 0x3f)
     {
         chip->tremolopos = (chip->tremolopos + 1) % 210;
@@ -1164,6 +1103,12 @@ void OPL3_Generate(opl3_chip *chip, int16_t *buf)
     }
 
     chip->eg_state ^= 1;
+}
+
+// Applies the buffered writes that are due, returning the number applied
+static uint32_t OPL3_ProcessWriteBuf(opl3_chip *chip)
+{
+    uint32_t written = 0;
 
     while (chip->writebuf[chip->writebuf_cur].time <= chip->writebuf_samplecnt)
     {
@@ -1175,8 +1120,78 @@ void OPL3_Generate(opl3_chip *chip, int16_t *buf)
         OPL3_WriteReg(chip, chip->writebuf[chip->writebuf_cur].reg,
                       chip->writebuf[chip->writebuf_cur].data);
         chip->writebuf_cur = (chip->writebuf_cur + 1) % OPL_WRITEBUF_SIZE;
+        written++;
     }
     chip->writebuf_samplecnt++;
+    return written;
+}
+
+void OPL3_Generate(opl3_chip *chip, int16_t *buf)
+{
+    uint8_t ii;
+    uint8_t jj;
+    int16_t accm;
+
+    buf[1] = OPL3_ClipSample(chip->mixbuff[1]);
+
+    for (ii = 0; ii < 15; ii++)
+    {
+        OPL3_SlotCalcFB(&chip->slot[ii]);
+        OPL3_EnvelopeCalc(&chip->slot[ii]);
+        OPL3_PhaseGenerate(&chip->slot[ii]);
+        OPL3_SlotGenerate(&chip->slot[ii]);
+    }
+
+    chip->mixbuff[0] = 0;
+    for (ii = 0; ii < 18; ii++)
+    {
+        accm = 0;
+        for (jj = 0; jj < 4; jj++)
+        {
+            accm += *chip->channel[ii].out[jj];
+        }
+        chip->mixbuff[0] += (int16_t)(accm & chip->channel[ii].cha);
+    }
+
+    for (ii = 15; ii < 18; ii++)
+    {
+        OPL3_SlotCalcFB(&chip->slot[ii]);
+        OPL3_EnvelopeCalc(&chip->slot[ii]);
+        OPL3_PhaseGenerate(&chip->slot[ii]);
+        OPL3_SlotGenerate(&chip->slot[ii]);
+    }
+
+    buf[0] = OPL3_ClipSample(chip->mixbuff[0]);
+
+    for (ii = 18; ii < 33; ii++)
+    {
+        OPL3_SlotCalcFB(&chip->slot[ii]);
+        OPL3_EnvelopeCalc(&chip->slot[ii]);
+        OPL3_PhaseGenerate(&chip->slot[ii]);
+        OPL3_SlotGenerate(&chip->slot[ii]);
+    }
+
+    chip->mixbuff[1] = 0;
+    for (ii = 0; ii < 18; ii++)
+    {
+        accm = 0;
+        for (jj = 0; jj < 4; jj++)
+        {
+            accm += *chip->channel[ii].out[jj];
+        }
+        chip->mixbuff[1] += (int16_t)(accm & chip->channel[ii].chb);
+    }
+
+    for (ii = 33; ii < 36; ii++)
+    {
+        OPL3_SlotCalcFB(&chip->slot[ii]);
+        OPL3_EnvelopeCalc(&chip->slot[ii]);
+        OPL3_PhaseGenerate(&chip->slot[ii]);
+        OPL3_SlotGenerate(&chip->slot[ii]);
+    }
+
+    OPL3_ClockTimers(chip);
+    OPL3_ProcessWriteBuf(chip);
 }
 
 void OPL3_GenerateResampled(opl3_chip *chip, int16_t *buf)
@@ -1379,3 +1394,356 @@ void OPL3_GenerateStream(opl3_chip *chip, int16_t *sndptr, uint32_t numsamples)
         sndptr += 2;
     }
 }
+
+//
+// Batched generator
+//
+
+#define BATCH_ZEROMOD   72
+
+static uint8_t OPL3_BatchValIndex(const opl3_chip *chip, const int16_t *ptr)
+{
+    uint8_t slotnum;
+
+    if (ptr == &chip->zeromod)
+    {
+        return BATCH_ZEROMOD;
+    }
+    slotnum = (uint8_t)(((const char *)ptr - (const char *)chip->slot) / sizeof(opl3_slot));
+    return ptr == &chip->slot[slotnum].out ? slotnum : 36 + slotnum;
+}
+
+static void OPL3_BatchUpdateParams(opl3_batch *batch)
+{
+    const opl3_chip *chip = &batch->chip;
+    uint8_t ii;
+    uint8_t jj;
+
+    for (ii = 0; ii < 36; ii++)
+    {
+        const opl3_slot *slot = &chip->slot[ii];
+        const opl3_channel *channel = slot->channel;
+
+        batch->key[ii] = slot->key;
+        batch->reg_ar[ii] = slot->reg_ar;
+        batch->reg_dr[ii] = slot->reg_dr;
+        batch->reg_sl[ii] = slot->reg_sl;
+        batch->reg_rr[ii] = slot->reg_rr;
+        batch->sus_rate[ii] = slot->reg_type ? 0 : slot->reg_rr;
+        batch->ks[ii] = channel->ksv >> ((slot->reg_ksr ^ 1) << 1);
+        batch->eg_base[ii] = (slot->reg_tl << 2)
+                           + (slot->eg_ksl >> kslshift[slot->reg_ksl]);
+        batch->trem_mask[ii] = slot->trem == &chip->tremolo ? 0xff : 0;
+        batch->vib_mask[ii] = slot->reg_vib ? ~0 : 0;
+        batch->f_num[ii] = channel->f_num;
+        batch->block_mul[ii] = 1 << channel->block;
+        batch->mult[ii] = mt[slot->reg_mult];
+        // (x * 2^(fb + 7)) >> 16 is x >> (9 - fb), without a variable shift
+        batch->fb_mul[ii] = channel->fb ? 1 << (channel->fb + 7) : 0;
+        batch->reg_wf[ii] = slot->reg_wf;
+        batch->mod[ii] = OPL3_BatchValIndex(chip, slot->mod);
+    }
+    for (ii = 0; ii < 18; ii++)
+    {
+        for (jj = 0; jj < 4; jj++)
+        {
+            batch->ch_out[ii][jj] = OPL3_BatchValIndex(chip, chip->channel[ii].out[jj]);
+        }
+        batch->cha[ii] = chip->channel[ii].cha;
+        batch->chb[ii] = chip->channel[ii].chb;
+    }
+    batch->dirty = 0;
+}
+
+static void OPL3_BatchCalcFB(opl3_batch *batch)
+{
+    int16_t *out = batch->val;
+    int16_t *fbmod = batch->val + 36;
+    uint8_t ii;
+
+    for (ii = 0; ii < 36; ii++)
+    {
+        fbmod[ii] = (int16_t)(((batch->prout[ii] + out[ii]) * batch->fb_mul[ii]) >> 16);
+        batch->prout[ii] = out[ii];
+    }
+}
+
+// Branch-free cond ? a : b, for a cond of 0 or 1, so that the loops over the
+// operators stay free of control flow
+static inline int32_t OPL3_BatchSelect(int32_t cond, int32_t a, int32_t b)
+{
+    const int32_t mask = -cond;
+    return (a & mask) | (b & ~mask);
+}
+
+// Mirrors OPL3_EnvelopeCalc
+static void OPL3_BatchEnvelopeCalc(opl3_batch *batch)
+{
+    const opl3_chip *chip = &batch->chip;
+    const int32_t eg_add = chip->eg_add;
+    const int32_t eg_state = chip->eg_state;
+    const int32_t tremolo = chip->tremolo;
+    const int32_t step1 = eg_incstep[1][chip->timer & 0x03];
+    const int32_t step2 = eg_incstep[2][chip->timer & 0x03];
+    const int32_t step3 = eg_incstep[3][chip->timer & 0x03];
+    uint8_t ii;
+
+    for (ii = 0; ii < 36; ii++)
+    {
+        const int32_t eg_rout = batch->eg_rout[ii];
+        const int32_t eg_gen = batch->eg_gen[ii];
+        const int32_t key = batch->key[ii] != 0;
+        const int32_t reset = key & (eg_gen == envelope_gen_num_release);
+        const int32_t reg_ar = batch->reg_ar[ii];
+        const int32_t reg_dr = batch->reg_dr[ii];
+        const int32_t sus_rate = batch->sus_rate[ii];
+        const int32_t reg_rr = batch->reg_rr[ii];
+        const int32_t reg_sl = batch->reg_sl[ii];
+        int32_t reg_rate, rate, rate_hi, rate_lo, eg_shift, step;
+        int32_t shift, shift_lo, shift_hi, step_inc, eg_off;
+        int32_t eg_next, eg_inc, att_inc, dec_inc, at_sl, gen_next;
+
+        batch->eg_out[ii] = eg_rout + batch->eg_base[ii]
+                          + (tremolo & batch->trem_mask[ii]);
+
+        reg_rate = OPL3_BatchSelect(eg_gen == envelope_gen_num_attack, reg_ar,
+                   OPL3_BatchSelect(eg_gen == envelope_gen_num_decay, reg_dr,
+                   OPL3_BatchSelect(eg_gen == envelope_gen_num_sustain, sus_rate, reg_rr)));
+        reg_rate = OPL3_BatchSelect(reset, reg_ar, reg_rate);
+        batch->pg_reset[ii] = reset;
+
+        rate = batch->ks[ii] + (reg_rate << 2);
+        rate_hi = rate >> 2;
+        rate_hi = OPL3_BatchSelect(rate_hi > 0x0f, 0x0f, rate_hi);
+        rate_lo = rate & 0x03;
+        eg_shift = rate_hi + eg_add;
+
+        shift_lo = OPL3_BatchSelect(eg_shift == 12, 1,
+                   OPL3_BatchSelect(eg_shift == 13, (rate_lo >> 1) & 0x01,
+                   OPL3_BatchSelect(eg_shift == 14, rate_lo & 0x01, 0))) & -eg_state;
+        step = OPL3_BatchSelect(rate_lo == 0, 0,
+               OPL3_BatchSelect(rate_lo == 1, step1,
+               OPL3_BatchSelect(rate_lo == 2, step2, step3)));
+        shift_hi = (rate_hi & 0x03) + step;
+        shift_hi = OPL3_BatchSelect((shift_hi & 0x04) != 0, 0x03, shift_hi);
+        shift_hi = OPL3_BatchSelect(shift_hi != 0, shift_hi, eg_state);
+        shift = OPL3_BatchSelect(rate_hi < 12, shift_lo, shift_hi);
+        shift = OPL3_BatchSelect(reg_rate != 0, shift, 0);
+        // 1 << (shift - 1) for a shift of 1 to 3
+        step_inc = 1 + (shift > 1) + ((shift > 2) << 1);
+
+        eg_off = (eg_rout & 0x1f8) == 0x1f8;
+        eg_next = OPL3_BatchSelect(reset & (rate_hi == 0x0f), 0x00, eg_rout);
+        eg_next = OPL3_BatchSelect((eg_gen != envelope_gen_num_attack) & (reset == 0) & eg_off,
+                                   0x1ff, eg_next);
+
+        // Attack: (~eg_rout << shift) >> 4, until the level reaches 0
+        att_inc = OPL3_BatchSelect(key & (shift > 0) & (rate_hi != 0x0f) & (eg_rout != 0),
+                                   ((~eg_rout) * (step_inc << 1)) >> 4, 0);
+        dec_inc = OPL3_BatchSelect(((eg_off | reset) == 0) & (shift > 0), step_inc, 0);
+        at_sl = (eg_rout >> 4) == reg_sl;
+        eg_inc = OPL3_BatchSelect(eg_gen == envelope_gen_num_attack, att_inc,
+                 OPL3_BatchSelect((eg_gen == envelope_gen_num_decay) & at_sl, 0, dec_inc));
+        gen_next = OPL3_BatchSelect((eg_gen == envelope_gen_num_attack) & (eg_rout == 0),
+                                    envelope_gen_num_decay,
+                   OPL3_BatchSelect((eg_gen == envelope_gen_num_decay) & at_sl,
+                                    envelope_gen_num_sustain, eg_gen));
+        batch->eg_rout[ii] = (eg_next + eg_inc) & 0x1ff;
+        gen_next = OPL3_BatchSelect(reset, envelope_gen_num_attack, gen_next);
+        batch->eg_gen[ii] = OPL3_BatchSelect(key, gen_next, envelope_gen_num_release);
+    }
+}
+
+// Mirrors OPL3_PhaseGenerate, except for the rhythm mode fix-ups
+static void OPL3_BatchPhaseGenerate(opl3_batch *batch)
+{
+    const opl3_chip *chip = &batch->chip;
+    const int32_t vib_on = (chip->vibpos & 3) ? ~0 : 0;
+    const int32_t vib_shift = chip->vibshift + (chip->vibpos & 1);
+    const int32_t vib_neg = chip->vibpos & 4;
+    uint8_t ii;
+
+    for (ii = 0; ii < 36; ii++)
+    {
+        int32_t f_num = batch->f_num[ii];
+        int32_t range = (((f_num >> 7) & 7) >> vib_shift) & vib_on & batch->vib_mask[ii];
+        uint32_t basefreq;
+        uint32_t pg_phase = batch->pg_phase[ii];
+
+        f_num += vib_neg ? -range : range;
+        basefreq = ((uint32_t)f_num * (uint32_t)batch->block_mul[ii]) >> 1;
+        batch->pg_phase_out[ii] = (int32_t)((pg_phase >> 9) & 0xffff);
+        pg_phase = batch->pg_reset[ii] ? 0 : pg_phase;
+        batch->pg_phase[ii] = pg_phase + ((basefreq * (uint32_t)batch->mult[ii]) >> 1);
+    }
+}
+
+// Steps the noise generator as OPL3_PhaseGenerate does, for up to 9 steps
+// at once: the bits fed back over those steps are all still in the register
+static uint32_t OPL3_BatchNoiseStep(uint32_t noise, uint8_t steps)
+{
+    const uint32_t n_bits = (noise ^ (noise >> 14)) & ((1u << steps) - 1);
+    return (noise >> steps) | (n_bits << (23 - steps));
+}
+
+// Advances the noise generator once per operator and applies the rhythm
+// mode phases, as OPL3_PhaseGenerate does in operator order
+static void OPL3_BatchRhythm(opl3_batch *batch)
+{
+    opl3_chip *chip = &batch->chip;
+    const uint32_t noise_hh = OPL3_BatchNoiseStep(OPL3_BatchNoiseStep(chip->noise, 8), 5);
+    const uint32_t noise_sd = OPL3_BatchNoiseStep(noise_hh, 3);
+    uint32_t noise;
+    uint8_t rm_xor;
+    int32_t phase;
+
+    noise = OPL3_BatchNoiseStep(noise_sd, 8);
+    noise = OPL3_BatchNoiseStep(noise, 8);
+    chip->noise = OPL3_BatchNoiseStep(noise, 4);
+
+    phase = batch->pg_phase_out[13];
+    chip->rm_hh_bit2 = (phase >> 2) & 1;
+    chip->rm_hh_bit3 = (phase >> 3) & 1;
+    chip->rm_hh_bit7 = (phase >> 7) & 1;
+    chip->rm_hh_bit8 = (phase >> 8) & 1;
+    if (!(chip->rhy & 0x20))
+    {
+        return;
+    }
+    // hh
+    rm_xor = (chip->rm_hh_bit2 ^ chip->rm_hh_bit7)
+           | (chip->rm_hh_bit3 ^ chip->rm_tc_bit5)
+           | (chip->rm_tc_bit3 ^ chip->rm_tc_bit5);
+    batch->pg_phase_out[13] = (rm_xor << 9)
+                            | ((rm_xor ^ (noise_hh & 1)) ? 0xd0 : 0x34);
+    // sd
+    batch->pg_phase_out[16] = (chip->rm_hh_bit8 << 9)
+                            | ((chip->rm_hh_bit8 ^ (noise_sd & 1)) << 8);
+    // tc
+    phase = batch->pg_phase_out[17];
+    chip->rm_tc_bit3 = (phase >> 3) & 1;
+    chip->rm_tc_bit5 = (phase >> 5) & 1;
+    rm_xor = (chip->rm_hh_bit2 ^ chip->rm_hh_bit7)
+           | (chip->rm_hh_bit3 ^ chip->rm_tc_bit5)
+           | (chip->rm_tc_bit3 ^ chip->rm_tc_bit5);
+    batch->pg_phase_out[17] = (rm_xor << 9) | 0x80;
+}
+
+// Operators modulate one another in order, so these run one at a time
+static void OPL3_BatchSlotGenerate(opl3_batch *batch, uint8_t first, uint8_t last)
+{
+    int16_t *val = batch->val;
+    uint8_t ii;
+
+    for (ii = first; ii < last; ii++)
+    {
+        val[ii] = envelope_sin[batch->reg_wf[ii]](
+            (uint16_t)(batch->pg_phase_out[ii] + val[batch->mod[ii]]),
+            (uint16_t)batch->eg_out[ii]);
+    }
+}
+
+static int32_t OPL3_BatchMix(const opl3_batch *batch, const uint16_t *mask)
+{
+    const int16_t *val = batch->val;
+    int32_t mix = 0;
+    int16_t accm;
+    uint8_t ii;
+
+    for (ii = 0; ii < 18; ii++)
+    {
+        accm = (int16_t)(val[batch->ch_out[ii][0]] + val[batch->ch_out[ii][1]]
+                       + val[batch->ch_out[ii][2]] + val[batch->ch_out[ii][3]]);
+        mix += (int16_t)(accm & mask[ii]);
+    }
+    return mix;
+}
+
+void OPL3_BatchGenerate(opl3_batch *batch, int16_t *buf)
+{
+    opl3_chip *chip = &batch->chip;
+
+    if (batch->dirty)
+    {
+        OPL3_BatchUpdateParams(batch);
+    }
+
+    buf[1] = OPL3_ClipSample(chip->mixbuff[1]);
+
+    OPL3_BatchCalcFB(batch);
+    OPL3_BatchEnvelopeCalc(batch);
+    OPL3_BatchPhaseGenerate(batch);
+    OPL3_BatchRhythm(batch);
+
+    // Each channel sees the operators generated so far in this sample,
+    // and the previous sample's output of the others
+    OPL3_BatchSlotGenerate(batch, 0, 15);
+    chip->mixbuff[0] = OPL3_BatchMix(batch, batch->cha);
+    OPL3_BatchSlotGenerate(batch, 15, 18);
+    buf[0] = OPL3_ClipSample(chip->mixbuff[0]);
+    OPL3_BatchSlotGenerate(batch, 18, 33);
+    chip->mixbuff[1] = OPL3_BatchMix(batch, batch->chb);
+    OPL3_BatchSlotGenerate(batch, 33, 36);
+
+    OPL3_ClockTimers(chip);
+    if (OPL3_ProcessWriteBuf(chip))
+    {
+        batch->dirty = 1;
+    }
+}
+
+void OPL3_BatchGenerateResampled(opl3_batch *batch, int16_t *buf)
+{
+    opl3_chip *chip = &batch->chip;
+
+    while (chip->samplecnt >= chip->rateratio)
+    {
+        chip->oldsamples[0] = chip->samples[0];
+        chip->oldsamples[1] = chip->samples[1];
+        OPL3_BatchGenerate(batch, chip->samples);
+        chip->samplecnt -= chip->rateratio;
+    }
+    buf[0] = (int16_t)((chip->oldsamples[0] * (chip->rateratio - chip->samplecnt)
+                     + chip->samples[0] * chip->samplecnt) / chip->rateratio);
+    buf[1] = (int16_t)((chip->oldsamples[1] * (chip->rateratio - chip->samplecnt)
+                     + chip->samples[1] * chip->samplecnt) / chip->rateratio);
+    chip->samplecnt += 1 << RSM_FRAC;
+}
+
+void OPL3_BatchReset(opl3_batch *batch, uint32_t samplerate)
+{
+    uint8_t ii;
+
+    memset(batch, 0, sizeof(opl3_batch));
+    OPL3_Reset(&batch->chip, samplerate);
+    for (ii = 0; ii < 36; ii++)
+    {
+        batch->eg_rout[ii] = 0x1ff;
+        batch->eg_out[ii] = 0x1ff;
+        batch->eg_gen[ii] = envelope_gen_num_release;
+    }
+    batch->dirty = 1;
+}
+
+void OPL3_BatchWriteReg(opl3_batch *batch, uint16_t reg, uint8_t v)
+{
+    OPL3_WriteReg(&batch->chip, reg, v);
+    batch->dirty = 1;
+}
+
+void OPL3_BatchWriteRegBuffered(opl3_batch *batch, uint16_t reg, uint8_t v)
+{
+    OPL3_WriteRegBuffered(&batch->chip, reg, v);
+    batch->dirty = 1;
+}
+
+void OPL3_BatchGenerateStream(opl3_batch *batch, int16_t *sndptr, uint32_t numsamples)
+{
+    uint32_t i;
+
+    for (i = 0; i < numsamples; i++)
+    {
+        OPL3_BatchGenerateResampled(batch, sndptr);
+        sndptr += 2;
+    }
+}
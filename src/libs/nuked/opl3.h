@@ -145,6 +145,55 @@ void OPL3_WriteReg(opl3_chip *chip, uint16_t reg, uint8_t v);
 void OPL3_WriteRegBuffered(opl3_chip *chip, uint16_t reg, uint8_t v);
 void OPL3_GenerateStream(opl3_chip *chip, int16_t *sndptr, uint32_t numsamples);
 
+// Batched generator: renders the same samples as OPL3_Generate, but runs
+// the feedback, envelope and phase stages of all 36 operators as single
+// passes over per-operator arrays, which compilers can vectorize. Only the
+// waveform lookups and the channel mixing, which depend on the operators'
+// order, remain sequential. Register writes go to the embedded chip, whose
+// operator parameters are gathered into the arrays before the next sample.
+typedef struct _opl3_batch {
+    opl3_chip chip;
+    uint8_t dirty;
+    // Operator parameters
+    int32_t key[36];
+    int32_t reg_ar[36];
+    int32_t reg_dr[36];
+    int32_t reg_sl[36];
+    int32_t reg_rr[36];
+    int32_t sus_rate[36];
+    int32_t ks[36];
+    int32_t eg_base[36];
+    int32_t trem_mask[36];
+    int32_t vib_mask[36];
+    int32_t f_num[36];
+    int32_t block_mul[36];
+    int32_t mult[36];
+    int32_t fb_mul[36];
+    uint8_t reg_wf[36];
+    uint8_t mod[36];
+    // Channel parameters
+    uint8_t ch_out[18][4];
+    uint16_t cha[18];
+    uint16_t chb[18];
+    // Operator state
+    int32_t eg_rout[36];
+    int32_t eg_gen[36];
+    int32_t eg_out[36];
+    int32_t pg_reset[36];
+    uint32_t pg_phase[36];
+    int32_t pg_phase_out[36];
+    int32_t prout[36];
+    // Operator outputs, then feedback modulations, then a zero modulation
+    int16_t val[36 + 36 + 1];
+} opl3_batch;
+
+void OPL3_BatchGenerate(opl3_batch *batch, int16_t *buf);
+void OPL3_BatchGenerateResampled(opl3_batch *batch, int16_t *buf);
+void OPL3_BatchReset(opl3_batch *batch, uint32_t samplerate);
+void OPL3_BatchWriteReg(opl3_batch *batch, uint16_t reg, uint8_t v);
+void OPL3_BatchWriteRegBuffered(opl3_batch *batch, uint16_t reg, uint8_t v);
+void OPL3_BatchGenerateStream(opl3_batch *batch, int16_t *sndptr, uint32_t numsamples);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,94 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "arena.h"
+
+#include <cassert>
+#include <cstring>
+
+Arena::Arena(size_t size) : block_size(RoundUp(size)) {}
+
+void *Arena::Allocate(size_t size)
+{
+	size = RoundUp(size ? size : 1);
+	used_bytes += size;
+
+	// Reuse a freed allocation of the same size
+	const size_t size_class = size / granularity;
+	if (size_class < free_lists.size() && free_lists[size_class]) {
+		void *ptr = free_lists[size_class];
+		free_lists[size_class] = *static_cast<void **>(ptr);
+		return ptr;
+	}
+
+	if (size > static_cast<size_t>(end - pos)) {
+		// Large allocations get a block of their own, so the space
+		// left in the current block isn't wasted
+		const size_t new_size = (size > block_size / 4) ? size : block_size;
+		blocks.emplace_back(new uint8_t[new_size]);
+		reserved_bytes += new_size;
+		if (new_size == size)
+			return blocks.back().get();
+		pos = blocks.back().get();
+		end = pos + new_size;
+	}
+	void *ptr = pos;
+	pos += size;
+	return ptr;
+}
+
+void Arena::Free(void *ptr, size_t size)
+{
+	if (!ptr)
+		return;
+	size = RoundUp(size ? size : 1);
+	assert(used_bytes >= size);
+	used_bytes -= size;
+
+	const size_t size_class = size / granularity;
+	if (size_class >= free_lists.size())
+		free_lists.resize(size_class + 1, nullptr);
+	*static_cast<void **>(ptr) = free_lists[size_class];
+	free_lists[size_class] = ptr;
+}
+
+char *Arena::CopyString(const char *str)
+{
+	const size_t size = strlen(str) + 1;
+	auto copy = static_cast<char *>(Allocate(size));
+	memcpy(copy, str, size);
+	return copy;
+}
+
+void Arena::FreeString(char *str)
+{
+	if (str)
+		Free(str, strlen(str) + 1);
+}
+
+void Arena::Clear()
+{
+	blocks.clear();
+	free_lists.clear();
+	pos = nullptr;
+	end = nullptr;
+	used_bytes = 0;
+	reserved_bytes = 0;
+}
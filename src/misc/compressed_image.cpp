@@ -0,0 +1,401 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "compressed_image.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include "cross.h"
+#include "mem_host.h"
+
+// LZ4 block format limits: the last 5 bytes are always literals and the
+// last match has to start at least 12 bytes before the end of the block.
+constexpr size_t lz4_min_match = 4;
+constexpr size_t lz4_last_literals = 5;
+constexpr size_t lz4_match_limit = 12;
+constexpr size_t lz4_max_offset = 65535;
+constexpr int lz4_hash_bits = 12;
+
+static inline uint32_t lz4_hash(uint32_t sequence)
+{
+	return (sequence * 2654435761u) >> (32 - lz4_hash_bits);
+}
+
+static uint8_t *lz4_write_length(uint8_t *op, size_t length)
+{
+	for (; length >= 255; length -= 255)
+		*op++ = 255;
+	*op++ = static_cast<uint8_t>(length);
+	return op;
+}
+
+// Worst-case size of a sequence with the given number of literals
+static inline size_t lz4_sequence_bound(size_t literals, size_t match_length)
+{
+	return 1 + literals / 255 + 1 + literals + 2 + match_length / 255 + 1;
+}
+
+size_t lz4_compress_block(const uint8_t *src, size_t src_size, uint8_t *dst,
+                          size_t dst_capacity)
+{
+	const uint8_t *ip = src;
+	const uint8_t *anchor = src;
+	const uint8_t *const end = src + src_size;
+	uint8_t *op = dst;
+	uint8_t *const op_end = dst + dst_capacity;
+
+	if (src_size > lz4_match_limit) {
+		uint32_t table[1 << lz4_hash_bits] = {};
+		const uint8_t *const match_end = end - lz4_last_literals;
+		while (ip + lz4_match_limit <= end) {
+			const uint32_t sequence = read_unaligned_uint32(ip);
+			const uint32_t hash = lz4_hash(sequence);
+			const uint8_t *ref = src + table[hash];
+			table[hash] = static_cast<uint32_t>(ip - src);
+			if (ref >= ip || static_cast<size_t>(ip - ref) > lz4_max_offset ||
+			    read_unaligned_uint32(ref) != sequence) {
+				++ip;
+				continue;
+			}
+
+			const uint8_t *match = ip + lz4_min_match;
+			for (ref += lz4_min_match; match < match_end && *match == *ref; ++ref)
+				++match;
+
+			const size_t literals = static_cast<size_t>(ip - anchor);
+			const size_t length = static_cast<size_t>(match - ip) - lz4_min_match;
+			if (lz4_sequence_bound(literals, length) >
+			    static_cast<size_t>(op_end - op))
+				return 0;
+
+			uint8_t *token = op++;
+			*token = static_cast<uint8_t>(std::min<size_t>(literals, 15) << 4);
+			if (literals >= 15)
+				op = lz4_write_length(op, literals - 15);
+			memcpy(op, anchor, literals);
+			op += literals;
+
+			const uint16_t distance = static_cast<uint16_t>(match - ref);
+			*op++ = static_cast<uint8_t>(distance & 0xff);
+			*op++ = static_cast<uint8_t>(distance >> 8);
+
+			*token |= static_cast<uint8_t>(std::min<size_t>(length, 15));
+			if (length >= 15)
+				op = lz4_write_length(op, length - 15);
+
+			ip = anchor = match;
+		}
+	}
+
+	const size_t literals = static_cast<size_t>(end - anchor);
+	if (lz4_sequence_bound(literals, 0) - 3 > static_cast<size_t>(op_end - op))
+		return 0;
+	*op++ = static_cast<uint8_t>(std::min<size_t>(literals, 15) << 4);
+	if (literals >= 15)
+		op = lz4_write_length(op, literals - 15);
+	memcpy(op, anchor, literals);
+	op += literals;
+	return static_cast<size_t>(op - dst);
+}
+
+static bool lz4_read_length(const uint8_t *&ip, const uint8_t *end, size_t &length)
+{
+	uint8_t byte;
+	do {
+		if (ip >= end)
+			return false;
+		byte = *ip++;
+		length += byte;
+	} while (byte == 255);
+	return true;
+}
+
+int64_t lz4_decompress_block(const uint8_t *src, size_t src_size,
+                             uint8_t *dst, size_t dst_capacity)
+{
+	const uint8_t *ip = src;
+	const uint8_t *const end = src + src_size;
+	uint8_t *op = dst;
+	uint8_t *const op_end = dst + dst_capacity;
+
+	while (ip < end) {
+		const uint8_t token = *ip++;
+
+		size_t literals = token >> 4;
+		if (literals == 15 && !lz4_read_length(ip, end, literals))
+			return -1;
+		if (literals > static_cast<size_t>(end - ip) ||
+		    literals > static_cast<size_t>(op_end - op))
+			return -1;
+		memcpy(op, ip, literals);
+		op += literals;
+		ip += literals;
+		if (ip == end)
+			break; // the last sequence has no match
+
+		if (end - ip < 2)
+			return -1;
+		const size_t distance = host_readw(ip);
+		ip += 2;
+		if (distance == 0 || distance > static_cast<size_t>(op - dst))
+			return -1;
+
+		size_t length = token & 15;
+		if (length == 15 && !lz4_read_length(ip, end, length))
+			return -1;
+		length += lz4_min_match;
+		if (length > static_cast<size_t>(op_end - op))
+			return -1;
+
+		const uint8_t *ref = op - distance;
+		if (distance >= length) {
+			memcpy(op, ref, length);
+			op += length;
+		} else {
+			// Overlapping match repeats the last distance bytes
+			while (length--)
+				*op++ = *ref++;
+		}
+	}
+	return op - dst;
+}
+
+static constexpr char image_magic[] = "DBXCIMG1";
+
+bool CompressedImage::IsCompressedImage(FILE *file)
+{
+	assert(file);
+	uint8_t magic[8];
+	const int64_t pos = cross::ftell64(file);
+	cross::fseek64(file, 0, SEEK_SET);
+	const bool found = fread(magic, 1, sizeof(magic), file) == sizeof(magic) &&
+	                   memcmp(magic, image_magic, sizeof(magic)) == 0;
+	cross::fseek64(file, pos, SEEK_SET);
+	return found;
+}
+
+CompressedImage::CompressedImage(FILE *file_, size_t cache_size) : file(file_)
+{
+	assert(file);
+	uint8_t header[header_size];
+	cross::fseek64(file, 0, SEEK_SET);
+	if (fread(header, 1, header_size, file) != header_size ||
+	    memcmp(header, image_magic, 8) != 0 || host_readd(header + 8) != version)
+		return;
+	chunk_size = host_readd(header + 12);
+	image_size = host_readq(header + 16);
+	const uint32_t chunk_count = host_readd(header + 24);
+	if (chunk_size == 0 || chunk_size > (16 << 20) ||
+	    chunk_count != (image_size + chunk_size - 1) / chunk_size)
+		return;
+
+	std::vector<uint8_t> entries(chunk_count * index_entry_size);
+	if (fread(entries.data(), 1, entries.size(), file) != entries.size())
+		return;
+	index.reserve(chunk_count);
+	for (uint32_t i = 0; i < chunk_count; ++i) {
+		const uint8_t *entry = entries.data() + i * index_entry_size;
+		const Chunk chunk = {host_readq(entry), host_readd(entry + 8),
+		                     (host_readd(entry + 12) & 1) != 0};
+		if (chunk.stored_size > chunk_size * 2)
+			return;
+		index.push_back(chunk);
+	}
+
+	// Always keep room for a chunk and the ones read ahead of it
+	cache_capacity = std::max<size_t>(cache_size / chunk_size, read_ahead + 2);
+	is_open = true;
+}
+
+uint32_t CompressedImage::GetChunkLength(uint32_t chunk) const
+{
+	const uint64_t start = static_cast<uint64_t>(chunk) * chunk_size;
+	return static_cast<uint32_t>(std::min<uint64_t>(chunk_size, image_size - start));
+}
+
+bool CompressedImage::Decompress(uint32_t chunk, const uint8_t *stored)
+{
+	const Chunk &entry = index[chunk];
+	std::vector<uint8_t> data(GetChunkLength(chunk));
+	if (entry.raw) {
+		if (entry.stored_size != data.size())
+			return false;
+		memcpy(data.data(), stored, data.size());
+	} else if (lz4_decompress_block(stored, entry.stored_size, data.data(),
+	                                data.size()) != static_cast<int64_t>(data.size())) {
+		return false;
+	}
+
+	while (cache.size() >= cache_capacity) {
+		cache.erase(lru.back());
+		lru.pop_back();
+	}
+	lru.push_front(chunk);
+	cache[chunk] = {std::move(data), lru.begin()};
+	return true;
+}
+
+bool CompressedImage::FetchChunks(uint32_t first, uint32_t count)
+{
+	// Only chunks stored back to back can be fetched with one read
+	size_t total = index[first].stored_size;
+	uint32_t n = 1;
+	for (; n < count; ++n) {
+		const Chunk &prev = index[first + n - 1];
+		if (index[first + n].offset != prev.offset + prev.stored_size)
+			break;
+		total += index[first + n].stored_size;
+	}
+
+	read_buffer.resize(total);
+	if (cross::fseek64(file, static_cast<int64_t>(index[first].offset), SEEK_SET) != 0 ||
+	    fread(read_buffer.data(), 1, total, file) != total)
+		return false;
+
+	// Decompress the requested chunk last, so it ends up most recently used
+	size_t pos = total;
+	for (uint32_t i = n; i-- > 0;) {
+		pos -= index[first + i].stored_size;
+		if (!Decompress(first + i, read_buffer.data() + pos) && i == 0)
+			return false;
+	}
+	read_ahead_chunks += n - 1;
+	return true;
+}
+
+const std::vector<uint8_t> *CompressedImage::GetChunk(uint32_t chunk)
+{
+	const bool sequential = (chunk == last_chunk + 1);
+	last_chunk = chunk;
+
+	auto cached = cache.find(chunk);
+	if (cached != cache.end()) {
+		++cache_hits;
+		lru.splice(lru.begin(), lru, cached->second.lru_pos);
+		return &cached->second.data;
+	}
+	++cache_misses;
+
+	uint32_t count = 1;
+	if (sequential) {
+		const auto chunks = static_cast<uint32_t>(index.size());
+		while (count <= read_ahead && chunk + count < chunks &&
+		       !cache.count(chunk + count))
+			++count;
+	}
+	if (!FetchChunks(chunk, count))
+		return nullptr;
+	cached = cache.find(chunk);
+	return cached != cache.end() ? &cached->second.data : nullptr;
+}
+
+bool CompressedImage::Read(uint64_t offset, size_t length, uint8_t *data)
+{
+	assert(is_open);
+	bool success = true;
+	while (length) {
+		if (offset >= image_size) {
+			memset(data, 0, length);
+			break;
+		}
+		const auto chunk = static_cast<uint32_t>(offset / chunk_size);
+		const auto chunk_offset = static_cast<size_t>(offset % chunk_size);
+		const size_t n = std::min<size_t>(length, GetChunkLength(chunk) - chunk_offset);
+		const std::vector<uint8_t> *chunk_data = GetChunk(chunk);
+		if (chunk_data) {
+			memcpy(data, chunk_data->data() + chunk_offset, n);
+		} else {
+			memset(data, 0, n);
+			success = false;
+		}
+		data += n;
+		offset += n;
+		length -= n;
+	}
+	return success;
+}
+
+bool CompressedImage::Create(FILE *src, FILE *dst, uint32_t chunk_size,
+                             std::string &error)
+{
+	assert(src && dst && chunk_size);
+	const int64_t src_size = cross::fseek64(src, 0, SEEK_END) == 0
+	                                 ? cross::ftell64(src)
+	                                 : -1;
+	if (src_size < 0) {
+		error = "can't determine the image size";
+		return false;
+	}
+	const auto image_size = static_cast<uint64_t>(src_size);
+	const auto chunk_count = static_cast<uint32_t>((image_size + chunk_size - 1) / chunk_size);
+	cross::fseek64(src, 0, SEEK_SET);
+
+	uint8_t header[header_size] = {};
+	memcpy(header, image_magic, 8);
+	host_writed(header + 8, version);
+	host_writed(header + 12, chunk_size);
+	host_writeq(header + 16, image_size);
+	host_writed(header + 24, chunk_count);
+
+	std::vector<uint8_t> entries(chunk_count * index_entry_size);
+	cross::fseek64(dst, 0, SEEK_SET);
+	if (fwrite(header, 1, header_size, dst) != header_size ||
+	    fwrite(entries.data(), 1, entries.size(), dst) != entries.size()) {
+		error = "can't write the index";
+		return false;
+	}
+
+	std::vector<uint8_t> chunk(chunk_size);
+	std::vector<uint8_t> compressed(chunk_size);
+	uint64_t offset = header_size + entries.size();
+	for (uint32_t i = 0; i < chunk_count; ++i) {
+		const auto length = static_cast<size_t>(
+		        std::min<uint64_t>(chunk_size, image_size - uint64_t{i} * chunk_size));
+		if (fread(chunk.data(), 1, length, src) != length) {
+			error = "can't read the image";
+			return false;
+		}
+		// Store the chunk raw if compressing it doesn't save anything
+		size_t stored_size = lz4_compress_block(chunk.data(), length,
+		                                        compressed.data(), length - 1);
+		const bool raw = (stored_size == 0);
+		if (raw)
+			stored_size = length;
+		if (fwrite(raw ? chunk.data() : compressed.data(), 1, stored_size,
+		           dst) != stored_size) {
+			error = "can't write the compressed image";
+			return false;
+		}
+		uint8_t *entry = entries.data() + i * index_entry_size;
+		host_writeq(entry, offset);
+		host_writed(entry + 8, static_cast<uint32_t>(stored_size));
+		host_writed(entry + 12, raw ? 1 : 0);
+		offset += stored_size;
+	}
+
+	cross::fseek64(dst, static_cast<int64_t>(header_size), SEEK_SET);
+	if (fwrite(entries.data(), 1, entries.size(), dst) != entries.size()) {
+		error = "can't write the index";
+		return false;
+	}
+	return true;
+}
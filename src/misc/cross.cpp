@@ -228,23 +228,26 @@ bool Cross::IsPathAbsolute(std::string const& in) {
 #if defined (WIN32)
 
 dir_information* open_directory(const char* dirname) {
+	static dir_information dir;
+	return open_directory(dirname, &dir);
+}
+
+dir_information* open_directory(const char* dirname, dir_information* dir) {
 	if (dirname == NULL) return NULL;
 
 	size_t len = strlen(dirname);
 	if (len == 0) return NULL;
 
-	static dir_information dir;
-
-	safe_strncpy(dir.base_path,dirname,MAX_PATH);
+	safe_strncpy(dir->base_path,dirname,MAX_PATH);
 
 	if (dirname[len - 1] == '\\')
-		safe_strcat(dir.base_path, "*.*");
+		safe_strcat(dir->base_path, "*.*");
 	else
-		safe_strcat(dir.base_path, "\\*.*");
+		safe_strcat(dir->base_path, "\\*.*");
 
-	dir.handle = INVALID_HANDLE_VALUE;
+	dir->handle = INVALID_HANDLE_VALUE;
 
-	return (path_exists(dirname) ? &dir : nullptr);
+	return (path_exists(dirname) ? dir : nullptr);
 }
 
 bool read_directory_first(dir_information* dirp, char* entry_name, bool& is_directory) {
@@ -286,9 +289,13 @@ void close_directory(dir_information* dirp) {
 
 dir_information* open_directory(const char* dirname) {
 	static dir_information dir;
-	dir.dir=opendir(dirname);
-	safe_strcpy(dir.base_path, dirname);
-	return dir.dir?&dir:NULL;
+	return open_directory(dirname, &dir);
+}
+
+dir_information* open_directory(const char* dirname, dir_information* dir) {
+	dir->dir=opendir(dirname);
+	safe_strcpy(dir->base_path, dirname);
+	return dir->dir?dir:NULL;
 }
 
 bool read_directory_first(dir_information* dirp, char* entry_name, bool& is_directory) {
@@ -322,9 +329,8 @@ bool read_directory_next(dir_information* dirp, char* entry_name, bool& is_direc
 #endif
 
 	// Maybe only for DT_UNKNOWN if HAVE_STRUCT_DIRENT_D_TYPE
-	static char buffer[2 * CROSS_LEN + 1] = { 0 };
-	static char split[2] = { CROSS_FILESPLIT , 0 };
-	buffer[0] = 0;
+	char buffer[2 * CROSS_LEN + 1] = { 0 };
+	const char split[2] = { CROSS_FILESPLIT , 0 };
 	safe_strcpy(buffer, dirp->base_path);
 	size_t buflen = strlen(buffer);
 	if (buflen && buffer[buflen - 1] != CROSS_FILESPLIT)
@@ -409,4 +415,22 @@ struct tm *localtime_r(const time_t *timep, struct tm *result)
 }
 #endif
 
+int fseek64(FILE *stream, int64_t offset, int origin)
+{
+#if defined(WIN32)
+	return _fseeki64(stream, offset, origin);
+#else
+	return fseeko(stream, static_cast<off_t>(offset), origin);
+#endif
+}
+
+int64_t ftell64(FILE *stream)
+{
+#if defined(WIN32)
+	return _ftelli64(stream);
+#else
+	return static_cast<int64_t>(ftello(stream));
+#endif
+}
+
 } // namespace cross
@@ -0,0 +1,98 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "decode_ahead.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+DecodeAhead::DecodeAhead(decode_f decode_, uint8_t channels_,
+                         uint32_t chunk_frames, uint32_t num_chunks)
+        : decode(std::move(decode_)),
+          channels(channels_),
+          chunks(num_chunks),
+          decoded(num_chunks),
+          // one more slot, for the wake-up on destruction
+          emptied(num_chunks + 1)
+{
+	assert(channels > 0 && chunk_frames > 0 && num_chunks > 0);
+	for (auto &chunk : chunks) {
+		chunk.samples.resize(chunk_frames * channels);
+		emptied.try_enqueue(&chunk);
+	}
+	thread = std::thread(&DecodeAhead::Run, this);
+}
+
+DecodeAhead::~DecodeAhead()
+{
+	stopping = true;
+	// Wake the decoder if it's waiting for an emptied chunk
+	emptied.try_enqueue(nullptr);
+	thread.join();
+}
+
+void DecodeAhead::Run()
+{
+	Chunk *chunk = nullptr;
+	while (!stopping) {
+		emptied.wait_dequeue(chunk);
+		if (!chunk)
+			break; // woken up to stop
+		const auto capacity = static_cast<uint32_t>(chunk->samples.size() / channels);
+		chunk->frames = decode(chunk->samples.data(), capacity);
+		if (!chunk->frames)
+			break;
+		decoded.try_enqueue(chunk); // always fits, as chunks only circulate
+	}
+	// Publishes the decoded chunks along with the flag
+	finished = true;
+}
+
+uint32_t DecodeAhead::Read(int16_t *buffer, uint32_t frames)
+{
+	uint32_t done = 0;
+	while (done < frames) {
+		if (!current) {
+			if (!decoded.try_dequeue(current))
+				break;
+			read_pos = 0;
+			started = true;
+		}
+		const uint32_t n = std::min(frames - done, current->frames - read_pos);
+		memcpy(buffer + done * channels,
+		       current->samples.data() + read_pos * channels,
+		       n * channels * sizeof(int16_t));
+		done += n;
+		read_pos += n;
+		if (read_pos == current->frames) {
+			emptied.try_enqueue(current);
+			current = nullptr;
+		}
+	}
+	if (done < frames && started && !finished)
+		++underruns;
+	return done;
+}
+
+bool DecodeAhead::IsAtEnd() const
+{
+	return finished && !current && decoded.size_approx() == 0;
+}
@@ -0,0 +1,101 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "dir_prescan.h"
+
+#include <cstring>
+#include <deque>
+#include <sys/stat.h>
+#include <utility>
+
+#include "cross.h"
+
+DirPrescan::DirPrescan(const std::string &base_dir)
+        : thread(&DirPrescan::Run, this, base_dir)
+{}
+
+DirPrescan::~DirPrescan()
+{
+	stop = true;
+	thread.join();
+}
+
+bool DirPrescan::Contains(const std::string &dir)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return listings.find(dir) != listings.end();
+}
+
+bool DirPrescan::Take(const std::string &dir, Listing &listing)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	claimed.insert(dir);
+	const auto it = listings.find(dir);
+	if (it == listings.end())
+		return false;
+	listing = std::move(it->second);
+	listings.erase(it);
+	return true;
+}
+
+void DirPrescan::Run(std::string base_dir)
+{
+	if (base_dir.empty() || base_dir.back() != CROSS_FILESPLIT)
+		base_dir += CROSS_FILESPLIT;
+
+	std::deque<std::pair<std::string, int>> pending = {{base_dir, 0}};
+	while (!pending.empty() && !stop) {
+		const std::string dir = std::move(pending.front().first);
+		const int depth = pending.front().second;
+		pending.pop_front();
+
+		dir_information storage;
+		dir_information *dirp = open_directory(dir.c_str(), &storage);
+		if (!dirp)
+			continue;
+		Listing listing;
+		char name[CROSS_LEN];
+		bool is_dir = false;
+		bool more = read_directory_first(dirp, name, is_dir);
+		for (; more && !stop; more = read_directory_next(dirp, name, is_dir)) {
+			listing.push_back({name, is_dir});
+			// Brings the file's metadata into the host's caches,
+			// as listing the directory stats every file in it
+			if (!is_dir) {
+				struct stat file_stat;
+				stat((dir + name).c_str(), &file_stat);
+			}
+			const bool dots = !strcmp(name, ".") || !strcmp(name, "..");
+			if (is_dir && !dots && depth < max_depth)
+				pending.emplace_back(dir + name + CROSS_FILESPLIT, depth + 1);
+		}
+		close_directory(dirp);
+
+		scanned_entries += listing.size();
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (!claimed.count(dir))
+				listings.emplace(dir, std::move(listing));
+		}
+		if (scanned_entries >= max_entries)
+			break;
+	}
+	done = true;
+}
@@ -0,0 +1,177 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "disk_delta.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+
+#if defined(WIN32)
+#include <io.h>
+#include <windows.h>
+#else
+#include <sys/file.h>
+#endif
+
+#include "cross.h"
+#include "mem_host.h"
+#include "support.h"
+
+static constexpr char magic[] = "DBXDELTA";
+
+DiskDelta::DiskDelta(const std::string &path, uint32_t sector_size_,
+                     const BaseImage &base)
+        : sector_size(sector_size_)
+{
+	assert(sector_size > 0);
+	file = fopen_wrap(path.c_str(), "rb+");
+	if (!file)
+		file = fopen_wrap(path.c_str(), "wb+");
+	if (!file) {
+		error = safe_strerror(errno);
+		return;
+	}
+	if (!Lock()) {
+		error = "already in use";
+		fclose(file);
+		file = nullptr;
+		return;
+	}
+	if (!LoadIndex(base)) {
+		fclose(file);
+		file = nullptr;
+	}
+}
+
+DiskDelta::~DiskDelta()
+{
+	if (file)
+		fclose(file);
+}
+
+/* Takes an exclusive lock on the whole file, so two mounts can't append
+ * records over each other. The lock goes away with the file handle. */
+bool DiskDelta::Lock()
+{
+#if defined(WIN32)
+	const HANDLE handle = reinterpret_cast<HANDLE>(_get_osfhandle(cross_fileno(file)));
+	OVERLAPPED overlapped = {};
+	return handle != INVALID_HANDLE_VALUE &&
+	       LockFileEx(handle, LOCKFILE_EXCLUSIVE_LOCK | LOCKFILE_FAIL_IMMEDIATELY,
+	                  0, MAXDWORD, MAXDWORD, &overlapped);
+#else
+	return flock(cross_fileno(file), LOCK_EX | LOCK_NB) == 0;
+#endif
+}
+
+bool DiskDelta::LoadIndex(const BaseImage &base)
+{
+	uint8_t header[header_size];
+	cross::fseek64(file, 0, SEEK_END);
+	if (cross::ftell64(file) < header_size) {
+		/* New or empty file */
+		memcpy(header, magic, 8);
+		host_writed(header + 8, version);
+		host_writed(header + 12, sector_size);
+		host_writeq(header + 16, base.size);
+		host_writeq(header + 24, static_cast<uint64_t>(base.mtime));
+		cross::fseek64(file, 0, SEEK_SET);
+		if (fwrite(header, 1, sizeof(header), file) != sizeof(header) || !Flush()) {
+			error = "can't write the header";
+			return false;
+		}
+		end_pos = header_size;
+		return true;
+	}
+
+	cross::fseek64(file, 0, SEEK_SET);
+	if (fread(header, 1, sizeof(header), file) != sizeof(header) ||
+	    memcmp(header, magic, 8) != 0) {
+		error = "not a delta file";
+		return false;
+	}
+	if (host_readd(header + 8) != version) {
+		error = "unsupported delta file version";
+		return false;
+	}
+	if (host_readd(header + 12) != sector_size) {
+		error = "sector size doesn't match the image";
+		return false;
+	}
+	if (host_readq(header + 16) != base.size ||
+	    static_cast<int64_t>(host_readq(header + 24)) != base.mtime) {
+		error = "made for a different or modified image";
+		return false;
+	}
+
+	/* Index all complete records; a partially written last record is
+	 * dropped and overwritten by the next append. */
+	const int64_t record_size = 4 + int64_t{sector_size};
+	std::vector<uint8_t> record(record_size);
+	end_pos = header_size;
+	while (fread(record.data(), 1, record.size(), file) == record.size()) {
+		const uint32_t sector = host_readd(record.data());
+		index[sector] = end_pos + 4;
+		sector_limit = std::max(sector_limit, uint64_t{sector} + 1);
+		end_pos += record_size;
+	}
+	return true;
+}
+
+bool DiskDelta::Read(uint32_t sector, void *data)
+{
+	const auto entry = index.find(sector);
+	if (entry == index.end())
+		return false;
+	cross::fseek64(file, entry->second, SEEK_SET);
+	if (fread(data, 1, sector_size, file) != sector_size)
+		memset(data, 0, sector_size);
+	return true;
+}
+
+bool DiskDelta::Write(uint32_t sector, const void *data)
+{
+	assert(file);
+	const auto entry = index.find(sector);
+	if (entry != index.end()) {
+		cross::fseek64(file, entry->second, SEEK_SET);
+		return fwrite(data, 1, sector_size, file) == sector_size;
+	}
+
+	uint8_t sector_number[4];
+	host_writed(sector_number, sector);
+	cross::fseek64(file, end_pos, SEEK_SET);
+	if (fwrite(sector_number, 1, 4, file) != 4 ||
+	    fwrite(data, 1, sector_size, file) != sector_size)
+		return false;
+	index[sector] = end_pos + 4;
+	sector_limit = std::max(sector_limit, uint64_t{sector} + 1);
+	end_pos += 4 + int64_t{sector_size};
+	return true;
+}
+
+bool DiskDelta::Flush()
+{
+	assert(file);
+	return fflush(file) == 0;
+}
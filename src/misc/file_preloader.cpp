@@ -0,0 +1,98 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "file_preloader.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <new>
+
+#include "cross.h"
+
+FilePreloader::FilePreloader(const char *path, uint64_t limit, uint32_t chunk)
+        : chunk_size(chunk)
+{
+	assert(chunk_size > 0);
+	file = fopen_wrap(path, "rb");
+	if (!file)
+		return;
+	if (cross::fseek64(file, 0, SEEK_END) == 0) {
+		const int64_t size = cross::ftell64(file);
+		// Images can be over 2 GB, and the part loaded has to fit in
+		// the address space
+		if (size > 0)
+			total = std::min({static_cast<uint64_t>(size), limit,
+			                  static_cast<uint64_t>(SIZE_MAX)});
+	}
+	if (total)
+		data.reset(new (std::nothrow) uint8_t[total]);
+	if (!data || cross::fseek64(file, 0, SEEK_SET) != 0) {
+		fclose(file);
+		file = nullptr;
+		data.reset();
+		total = 0;
+		return;
+	}
+	thread = std::thread(&FilePreloader::Run, this);
+}
+
+FilePreloader::~FilePreloader()
+{
+	stopping = true;
+	if (thread.joinable())
+		thread.join();
+	if (file)
+		fclose(file);
+}
+
+void FilePreloader::Run()
+{
+	uint64_t loaded = 0;
+	while (loaded < total && !stopping) {
+		const auto n = static_cast<size_t>(
+		        std::min<uint64_t>(chunk_size, total - loaded));
+		if (fread(data.get() + loaded, 1, n, file) != n)
+			break;
+		loaded += n;
+		resident.store(loaded, std::memory_order_release);
+	}
+	finished.store(true, std::memory_order_release);
+}
+
+bool FilePreloader::Read(uint64_t offset, uint8_t *out, uint32_t size)
+{
+	const uint8_t *resident_data = Lookup(offset, size);
+	if (!resident_data)
+		return false;
+	memcpy(out, resident_data, size);
+	return true;
+}
+
+const uint8_t *FilePreloader::Lookup(uint64_t offset, uint32_t size)
+{
+	const uint64_t loaded = resident.load(std::memory_order_acquire);
+	if (offset > loaded || loaded - offset < size) {
+		++misses;
+		return nullptr;
+	}
+	++hits;
+	return data.get() + offset;
+}
@@ -0,0 +1,229 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "frame_trace.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cinttypes>
+#include <chrono>
+#include <cmath>
+#include <memory>
+
+#include "logging.h"
+#include "support.h"
+
+bool frame_trace_enabled = false;
+
+const char *to_string(FrameEvent event)
+{
+	switch (event) {
+	case FrameEvent::VerticalRetrace: return "vertical_retrace";
+	case FrameEvent::RenderStart: return "render_start";
+	case FrameEvent::RenderEnd: return "render_end";
+	case FrameEvent::Present: return "present";
+	case FrameEvent::Input: return "input";
+	}
+	return "unknown";
+}
+
+void LatencyHistogram::Add(int64_t duration_us)
+{
+	if (duration_us < 0)
+		duration_us = 0;
+	size_t bucket = 0;
+	for (auto d = duration_us >> 1; d && bucket < num_buckets - 1; d >>= 1)
+		++bucket;
+	++buckets[bucket];
+
+	if (!count || duration_us < min)
+		min = duration_us;
+	if (duration_us > max)
+		max = duration_us;
+	sum += duration_us;
+	++count;
+}
+
+double LatencyHistogram::GetMean() const
+{
+	return count ? static_cast<double>(sum) / count : 0.0;
+}
+
+int64_t LatencyHistogram::GetPercentile(double percentile) const
+{
+	if (!count)
+		return 0;
+	const auto wanted = static_cast<uint64_t>(
+	        std::ceil(clamp(percentile, 0.0, 100.0) / 100.0 * count));
+	uint64_t seen = 0;
+	for (size_t i = 0; i < num_buckets; ++i) {
+		seen += buckets[i];
+		if (seen >= wanted && seen > 0)
+			return std::min(max, (int64_t{2} << i) - 1);
+	}
+	return max;
+}
+
+void FrameTracer::Record(FrameEvent event, int64_t timestamp_us)
+{
+	if (samples.size() < max_samples)
+		samples.push_back({timestamp_us, event});
+
+	switch (event) {
+	case FrameEvent::VerticalRetrace:
+		if (last_retrace >= 0)
+			retrace_interval.Add(timestamp_us - last_retrace);
+		last_retrace = timestamp_us;
+		if (pending_retrace < 0)
+			pending_retrace = timestamp_us;
+		break;
+	case FrameEvent::RenderStart:
+		render_start = timestamp_us;
+		break;
+	case FrameEvent::RenderEnd:
+		if (render_start >= 0)
+			render_time.Add(timestamp_us - render_start);
+		render_start = -1;
+		break;
+	case FrameEvent::Present:
+		if (last_present >= 0)
+			present_interval.Add(timestamp_us - last_present);
+		last_present = timestamp_us;
+		if (pending_retrace >= 0)
+			frame_latency.Add(timestamp_us - pending_retrace);
+		pending_retrace = -1;
+		if (pending_input >= 0)
+			input_latency.Add(timestamp_us - pending_input);
+		pending_input = -1;
+		break;
+	case FrameEvent::Input:
+		if (pending_input < 0)
+			pending_input = timestamp_us;
+		break;
+	}
+}
+
+bool FrameTracer::WriteCsv(FILE *file) const
+{
+	assert(file);
+	if (fprintf(file, "event,timestamp_us\n") < 0)
+		return false;
+	for (const auto &s : samples)
+		if (fprintf(file, "%s,%" PRId64 "\n", to_string(s.event),
+		            s.timestamp_us) < 0)
+			return false;
+	return true;
+}
+
+bool FrameTracer::WriteChromeTrace(FILE *file) const
+{
+	assert(file);
+	if (fprintf(file, "{\"traceEvents\":[\n") < 0)
+		return false;
+	const char *separator = "";
+	for (const auto &s : samples) {
+		if (fprintf(file,
+		            "%s{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"g\","
+		            "\"ts\":%" PRId64 ",\"pid\":1,\"tid\":1}",
+		            separator, to_string(s.event), s.timestamp_us) < 0)
+			return false;
+		separator = ",\n";
+	}
+	return fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n") >= 0;
+}
+
+static void log_histogram(const char *name, const LatencyHistogram &histogram)
+{
+	if (!histogram.GetCount())
+		return;
+	LOG_MSG("TRACE: %-16s n=%-8" PRIu64 " min=%-7" PRId64 " mean=%-9.1f "
+	        "p50<=%-7" PRId64 " p99<=%-7" PRId64 " max=%" PRId64 " (us)",
+	        name, histogram.GetCount(), histogram.GetMin(),
+	        histogram.GetMean(), histogram.GetPercentile(50),
+	        histogram.GetPercentile(99), histogram.GetMax());
+}
+
+void FrameTracer::LogSummary() const
+{
+	log_histogram("retrace interval", retrace_interval);
+	log_histogram("present interval", present_interval);
+	log_histogram("render time", render_time);
+	log_histogram("frame latency", frame_latency);
+	log_histogram("input latency", input_latency);
+}
+
+using trace_clock = std::chrono::steady_clock;
+
+static std::unique_ptr<FrameTracer> tracer = {};
+static trace_clock::time_point trace_start = {};
+static std::string trace_path = {};
+
+void FRAMETRACE_Start(const std::string &path)
+{
+	tracer = std::make_unique<FrameTracer>();
+	trace_start = trace_clock::now();
+	trace_path = path;
+	frame_trace_enabled = true;
+	LOG_MSG("TRACE: Frame tracing started%s%s",
+	        trace_path.empty() ? "" : ", writing to ", trace_path.c_str());
+}
+
+void FRAMETRACE_Record(FrameEvent event)
+{
+	assert(tracer);
+	const auto elapsed = trace_clock::now() - trace_start;
+	const auto us = std::chrono::duration_cast<std::chrono::microseconds>(elapsed);
+	tracer->Record(event, us.count());
+}
+
+static bool ends_with(const std::string &str, const std::string &suffix)
+{
+	return str.size() >= suffix.size() &&
+	       str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+void FRAMETRACE_Stop()
+{
+	if (!frame_trace_enabled)
+		return;
+	frame_trace_enabled = false;
+	assert(tracer);
+	tracer->LogSummary();
+
+	if (!trace_path.empty()) {
+		FILE *file = fopen(trace_path.c_str(), "w");
+		if (!file) {
+			LOG_MSG("TRACE: Can't open '%s' for writing: %s",
+			        trace_path.c_str(), safe_strerror(errno).c_str());
+		} else {
+			std::string lower_path = trace_path;
+			lowcase(lower_path);
+			const bool written = ends_with(lower_path, ".json")
+			                             ? tracer->WriteChromeTrace(file)
+			                             : tracer->WriteCsv(file);
+			fclose(file);
+			LOG_MSG("TRACE: %s %zu events to '%s'",
+			        written ? "Wrote" : "Failed writing",
+			        tracer->GetSamples().size(), trace_path.c_str());
+		}
+	}
+	tracer.reset();
+}
@@ -0,0 +1,79 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "image_file.h"
+
+ImageFile::ImageFile(const std::string &path_)
+        : path(path_),
+          data_stream(path_, std::ios::in | std::ios::binary)
+{
+	if (data_stream.fail())
+		return;
+	data_stream.seekg(0, std::ios::end);
+	size = static_cast<int64_t>(data_stream.tellg());
+	data_stream.seekg(0, std::ios::beg);
+}
+
+bool ImageFile::Seek(std::ifstream &stream, const uint64_t offset)
+{
+	// A read reaching the end leaves the stream failed
+	if (!stream.good())
+		stream.clear();
+	else if (static_cast<uint64_t>(stream.tellg()) == offset)
+		return true;
+
+	stream.seekg(static_cast<std::streamoff>(offset), std::ios::beg);
+
+	// If the first seek attempt failed, then try harder
+	if (stream.fail()) {
+		stream.clear();
+		stream.seekg(0, std::ios::beg);
+		stream.seekg(static_cast<std::streamoff>(offset), std::ios::beg);
+	}
+	return !stream.fail();
+}
+
+bool ImageFile::Read(uint8_t *buffer, const uint64_t offset, const uint32_t bytes)
+{
+	if (!IsOpen() || !Seek(data_stream, offset))
+		return false;
+	data_stream.read(reinterpret_cast<char *>(buffer), bytes);
+	return !data_stream.fail();
+}
+
+uint32_t ImageFile::ReadAudio(uint8_t *buffer, const uint64_t offset, const uint32_t bytes)
+{
+	if (!IsOpen())
+		return 0;
+	if (!audio_stream.is_open()) {
+		audio_stream.open(path, std::ios::in | std::ios::binary);
+		if (audio_stream.fail())
+			return 0;
+	}
+	if (!Seek(audio_stream, offset))
+		return 0;
+	audio_stream.read(reinterpret_cast<char *>(buffer), bytes);
+	/**
+	 *  Note: gcount returns a signed type, but according to specification:
+	 *  "Except in the constructors of std::strstreambuf, negative values of
+	 *  std::streamsize are never used."; so we store it as unsigned.
+	 */
+	return static_cast<uint32_t>(audio_stream.gcount());
+}
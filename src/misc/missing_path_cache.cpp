@@ -0,0 +1,101 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "missing_path_cache.h"
+
+#include <ctime>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "cross.h"
+
+namespace {
+
+constexpr int64_t dir_missing = -1;
+
+// Splits the path at its last separator; a path without one is relative
+// to the current directory
+void split_path(const std::string &path, std::string &dir, std::string &name)
+{
+	const auto pos = path.rfind(CROSS_FILESPLIT);
+	if (pos == std::string::npos) {
+		dir = ".";
+		name = path;
+	} else {
+		dir = path.substr(0, pos ? pos : 1);
+		name = path.substr(pos + 1);
+	}
+}
+
+int64_t dir_stamp(const std::string &host_dir)
+{
+	struct stat dir_stat;
+	if (stat(host_dir.c_str(), &dir_stat) != 0)
+		return dir_missing;
+	return static_cast<int64_t>(dir_stat.st_mtime);
+}
+
+} // namespace
+
+bool MissingPathCache::Contains(const std::string &path)
+{
+	if (num_paths == 0)
+		return false;
+	std::string dir, name;
+	split_path(path, dir, name);
+	const auto it = directories.find(dir);
+	if (it == directories.end() || it->second.names.count(name) == 0)
+		return false;
+	if (dir_stamp(it->second.host_dir) != it->second.stamp) {
+		num_paths -= it->second.names.size();
+		directories.erase(it);
+		return false;
+	}
+	return true;
+}
+
+void MissingPathCache::Add(const std::string &path, const std::string &host_path)
+{
+	std::string dir, name, host_dir, host_name;
+	split_path(path, dir, name);
+	split_path(host_path, host_dir, host_name);
+
+	const int64_t stamp = dir_stamp(host_dir);
+	if (stamp != dir_missing && stamp + settle_time > static_cast<int64_t>(time(nullptr)))
+		return;
+
+	if (num_paths >= max_paths)
+		Clear();
+	auto &entry = directories[dir];
+	if (entry.names.empty() || entry.stamp != stamp || entry.host_dir != host_dir) {
+		num_paths -= entry.names.size();
+		entry.names.clear();
+		entry.host_dir = host_dir;
+		entry.stamp = stamp;
+	}
+	if (entry.names.insert(name).second)
+		++num_paths;
+}
+
+void MissingPathCache::Clear()
+{
+	directories.clear();
+	num_paths = 0;
+}
@@ -0,0 +1,193 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "overlay_journal.h"
+
+#include <cerrno>
+#include <cstring>
+
+#if defined(WIN32)
+#include <windows.h>
+#endif
+
+#include "cross.h"
+#include "support.h"
+
+static constexpr char header[] = "DBOVERLAY JOURNAL 1\n";
+
+static const char *operation(OverlayJournal::Kind kind)
+{
+	return kind == OverlayJournal::Kind::File ? "DEL" : "RMD";
+}
+
+OverlayJournal::OverlayJournal(const std::string &path_) : path(path_)
+{
+	Load();
+}
+
+OverlayJournal::~OverlayJournal()
+{
+	if (file)
+		fclose(file);
+}
+
+void OverlayJournal::Load()
+{
+	FILE *f = fopen_wrap(path.c_str(), "rb");
+	// A compaction cut short after the old journal was gone leaves the
+	// complete new one behind
+	if (!f && rename((path + ".NEW").c_str(), path.c_str()) == 0)
+		f = fopen_wrap(path.c_str(), "rb");
+	if (!f)
+		return; // nothing recorded yet
+
+	char line[CROSS_LEN + 8];
+	if (!fgets(line, sizeof(line), f)) {
+		fclose(f);
+		return; // empty
+	}
+	if (strcmp(line, header) != 0) {
+		error = "not an overlay journal";
+		foreign = true;
+		fclose(f);
+		return;
+	}
+	records = 1;
+	while (fgets(line, sizeof(line), f)) {
+		++records;
+		const size_t len = strlen(line);
+		// Skip lines cut short, and anything we don't understand
+		torn = (len == 0 || line[len - 1] != '\n');
+		if (len < 7 || torn || line[4] != ' ')
+			continue;
+		line[len - 1] = '\0';
+		Kind kind;
+		if (!strncmp(line + 1, "DEL", 3))
+			kind = Kind::File;
+		else if (!strncmp(line + 1, "RMD", 3))
+			kind = Kind::Dir;
+		else
+			continue;
+		if (line[0] == '+')
+			Entries(kind).insert(line + 5);
+		else if (line[0] == '-')
+			Entries(kind).erase(line + 5);
+	}
+	fclose(f);
+}
+
+bool OverlayJournal::Open()
+{
+	if (file)
+		return true;
+	if (foreign)
+		return false; // never write to someone else's file
+	// Drop a line cut short rather than appending to it
+	if (torn && !Compact())
+		return false;
+	file = fopen_wrap(path.c_str(), "ab");
+	if (!file) {
+		error = safe_strerror(errno);
+		return false;
+	}
+	if (records == 0) {
+		if (fputs(header, file) == EOF) {
+			error = "can't write the header";
+			return false;
+		}
+		records = 1;
+	}
+	return true;
+}
+
+bool OverlayJournal::Append(char sign, Kind kind, const std::string &name)
+{
+	if (!Open())
+		return false;
+	if (fprintf(file, "%c%s %s\n", sign, operation(kind), name.c_str()) < 0 ||
+	    fflush(file) != 0) {
+		error = safe_strerror(errno);
+		return false;
+	}
+	++records;
+	const size_t live = 1 + files.size() + dirs.size();
+	if (records > min_compact_records && records > 2 * live)
+		return Compact();
+	return true;
+}
+
+bool OverlayJournal::Add(Kind kind, const std::string &name)
+{
+	if (name.empty() || !Entries(kind).insert(name).second)
+		return true;
+	return Append('+', kind, name);
+}
+
+bool OverlayJournal::Remove(Kind kind, const std::string &name)
+{
+	if (!Entries(kind).erase(name))
+		return true;
+	return Append('-', kind, name);
+}
+
+bool OverlayJournal::Compact()
+{
+	if (foreign)
+		return false;
+	const std::string new_path = path + ".NEW";
+	FILE *f = fopen_wrap(new_path.c_str(), "wb");
+	if (!f) {
+		error = safe_strerror(errno);
+		return false;
+	}
+	bool ok = fputs(header, f) != EOF;
+	for (const auto &name : files)
+		ok = ok && fprintf(f, "+DEL %s\n", name.c_str()) >= 0;
+	for (const auto &name : dirs)
+		ok = ok && fprintf(f, "+RMD %s\n", name.c_str()) >= 0;
+	ok = (fclose(f) == 0) && ok;
+	if (!ok) {
+		error = "can't write " + new_path;
+		remove(new_path.c_str());
+		return false;
+	}
+
+	if (file) {
+		fclose(file);
+		file = nullptr;
+	}
+#if defined(WIN32)
+	// rename doesn't replace existing files on Windows, and removing the
+	// old journal first would leave a moment without one
+	if (!MoveFileExA(new_path.c_str(), path.c_str(),
+	                 MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+		error = "can't replace " + path;
+		return false;
+	}
+#else
+	if (rename(new_path.c_str(), path.c_str()) != 0) {
+		error = safe_strerror(errno);
+		return false;
+	}
+#endif
+	records = 1 + files.size() + dirs.size();
+	torn = false;
+	return true;
+}
@@ -0,0 +1,200 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "read_ahead.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include "cross.h"
+
+ReadAheadWorker::ReadAheadWorker() : thread(&ReadAheadWorker::Run, this) {}
+
+ReadAheadWorker::~ReadAheadWorker()
+{
+	Shutdown();
+}
+
+void ReadAheadWorker::Shutdown()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (quit)
+			return;
+		quit = true;
+		for (auto *file : queue)
+			file->queued = false;
+		queue.clear();
+	}
+	work_available.notify_one();
+	thread.join();
+	work_done.notify_all();
+}
+
+bool ReadAheadWorker::Schedule(ReadAhead *file)
+{
+	if (quit)
+		return false;
+	file->queued = true;
+	queue.push_back(file);
+	work_available.notify_one();
+	return true;
+}
+
+void ReadAheadWorker::Unschedule(ReadAhead *file)
+{
+	queue.erase(std::remove(queue.begin(), queue.end(), file), queue.end());
+	file->queued = false;
+}
+
+void ReadAheadWorker::Run()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while (!quit) {
+		if (queue.empty()) {
+			work_available.wait(lock);
+			continue;
+		}
+		ReadAhead *file = queue.front();
+		queue.pop_front();
+		file->queued = false;
+		file->in_flight = true;
+		auto &window = file->pending;
+
+		// Only this thread touches the window and the file while the
+		// read is in flight
+		lock.unlock();
+		const size_t length = file->ReadFile(window.offset, window.data.data(),
+		                                     window.data.size());
+		lock.lock();
+
+		window.length = length;
+		file->in_flight = false;
+		work_done.notify_all();
+	}
+}
+
+ReadAhead::ReadAhead(const char *path, std::shared_ptr<ReadAheadWorker> worker_,
+                     size_t window)
+        : worker(std::move(worker_)),
+          file(fopen_wrap(path, "rb")),
+          window_size(window)
+{
+	assert(worker && window_size > 0);
+	if (!file)
+		return;
+	current.data.resize(window_size);
+	pending.data.resize(window_size);
+}
+
+ReadAhead::~ReadAhead()
+{
+	if (!file)
+		return;
+	{
+		std::unique_lock<std::mutex> lock(worker->mutex);
+		Cancel(lock);
+	}
+	fclose(file);
+}
+
+size_t ReadAhead::ReadFile(uint64_t offset, uint8_t *data, size_t size)
+{
+	if (cross::fseek64(file, static_cast<int64_t>(offset), SEEK_SET) != 0)
+		return 0;
+	return fread(data, 1, size, file);
+}
+
+void ReadAhead::Cancel(std::unique_lock<std::mutex> &lock)
+{
+	if (queued)
+		worker->Unschedule(this);
+	while (in_flight)
+		worker->work_done.wait(lock);
+	pending.length = 0;
+}
+
+void ReadAhead::Invalidate()
+{
+	if (!file)
+		return;
+	std::unique_lock<std::mutex> lock(worker->mutex);
+	Cancel(lock);
+	current.length = 0;
+}
+
+size_t ReadAhead::Read(uint64_t offset, uint8_t *data, size_t size)
+{
+	if (!file)
+		return 0;
+	std::unique_lock<std::mutex> lock(worker->mutex);
+
+	const bool sequential = (offset == next_offset);
+	bool missed = false;
+	size_t done = 0;
+	while (done < size) {
+		const uint64_t pos = offset + done;
+		if (current.Contains(pos)) {
+			const auto start = static_cast<size_t>(pos - current.offset);
+			const size_t n = std::min(size - done, current.length - start);
+			memcpy(data + done, current.data.data() + start, n);
+			done += n;
+			continue;
+		}
+
+		// The prefetch we need may still be on its way
+		const bool wanted = (pending.offset == pos);
+		while (wanted && (queued || in_flight))
+			worker->work_done.wait(lock);
+		if (wanted && pending.length) {
+			std::swap(current, pending);
+			pending.length = 0;
+			continue;
+		}
+
+		// Read synchronously; a whole window for sequential access
+		Cancel(lock);
+		missed = true;
+		const size_t length = sequential ? window_size
+		                                 : std::min(size - done, window_size);
+		lock.unlock();
+		current.offset = pos;
+		current.length = ReadFile(pos, current.data.data(), length);
+		lock.lock();
+		if (!current.length)
+			break; // end of file
+	}
+
+	missed ? ++misses : ++hits;
+	next_offset = offset + done;
+
+	// Fetch the following window in the background, unless we're at
+	// the end of the file
+	const uint64_t next_window = current.offset + current.length;
+	if (sequential && current.length == window_size && !queued &&
+	    !in_flight && !(pending.offset == next_window && pending.length)) {
+		pending.offset = next_window;
+		pending.length = 0;
+		if (worker->Schedule(this))
+			++prefetches;
+	}
+	return done;
+}
@@ -0,0 +1,115 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "sector_cache.h"
+
+#include <cassert>
+#include <cstring>
+
+SectorCache::SectorCache(uint32_t capacity_, uint32_t sector_size_)
+        : capacity(capacity_),
+          sector_size(sector_size_),
+          data(static_cast<size_t>(capacity_) * sector_size_),
+          slots(capacity_)
+{
+	assert(sector_size > 0);
+	index.reserve(capacity);
+}
+
+void SectorCache::Unlink(uint32_t slot)
+{
+	Slot &s = slots[slot];
+	if (s.prev != none)
+		slots[s.prev].next = s.next;
+	else
+		head = s.next;
+	if (s.next != none)
+		slots[s.next].prev = s.prev;
+	else
+		tail = s.prev;
+	s.prev = s.next = none;
+}
+
+void SectorCache::PushFront(uint32_t slot)
+{
+	Slot &s = slots[slot];
+	s.prev = none;
+	s.next = head;
+	if (head != none)
+		slots[head].prev = slot;
+	head = slot;
+	if (tail == none)
+		tail = slot;
+}
+
+bool SectorCache::Read(uint32_t sector, uint8_t *out)
+{
+	const auto it = index.find(sector);
+	if (it == index.end()) {
+		++misses;
+		return false;
+	}
+	const uint32_t slot = it->second;
+	if (slot != head) {
+		Unlink(slot);
+		PushFront(slot);
+	}
+	memcpy(out, &data[static_cast<size_t>(slot) * sector_size], sector_size);
+	++hits;
+	return true;
+}
+
+void SectorCache::Write(uint32_t sector, const uint8_t *in)
+{
+	if (!capacity)
+		return;
+	uint32_t slot;
+	const auto it = index.find(sector);
+	if (it != index.end()) {
+		slot = it->second;
+		Unlink(slot);
+	} else if (used < capacity) {
+		slot = used++;
+		index.emplace(sector, slot);
+	} else {
+		slot = tail;
+		Unlink(slot);
+		index.erase(slots[slot].sector);
+		index.emplace(sector, slot);
+	}
+	slots[slot].sector = sector;
+	PushFront(slot);
+	memcpy(&data[static_cast<size_t>(slot) * sector_size], in, sector_size);
+}
+
+bool SectorCache::Admits(uint32_t sector, uint32_t num)
+{
+	const bool sequential = (sector == next_sector);
+	next_sector = sector + num;
+	return capacity && num <= max_admitted_sectors && !sequential;
+}
+
+void SectorCache::Clear()
+{
+	index.clear();
+	used = 0;
+	head = tail = none;
+	next_sector = none;
+}
@@ -0,0 +1,190 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "threaded_synth.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+// Ticks that can be queued or rendered ahead of the reads
+constexpr uint32_t num_jobs = 8;
+
+// Writes a tick can hold before its job has to grow
+constexpr size_t reserved_writes = 256;
+
+ThreadedSynth::ThreadedSynth(write_f write_, render_f render_,
+                             uint32_t latency_frames, uint32_t max_tick_frames_)
+        : write(std::move(write_)),
+          render(std::move(render_)),
+          max_tick_frames(max_tick_frames_),
+          // The worker can't overwrite frames not read yet while rendering
+          // a tick no longer than this
+          ring_frames(latency_frames + max_tick_frames_),
+          ring(static_cast<size_t>(ring_frames) * 2),
+          jobs(num_jobs),
+          // one more slot, for the wake-up on destruction
+          pending(num_jobs + 1),
+          rendered(num_jobs),
+          silence_left(latency_frames)
+{
+	assert(max_tick_frames > 0);
+	free_jobs.reserve(num_jobs);
+	for (auto &job : jobs) {
+		job.writes.reserve(reserved_writes);
+		free_jobs.push_back(&job);
+	}
+	current = TakeFreeJob();
+	thread = std::thread(&ThreadedSynth::Run, this);
+}
+
+ThreadedSynth::~ThreadedSynth()
+{
+	pending.try_enqueue(nullptr);
+	thread.join();
+}
+
+void ThreadedSynth::Write(float tick_index, uint16_t reg, uint8_t val)
+{
+	current->writes.push_back({tick_index, reg, val});
+}
+
+ThreadedSynth::Job *ThreadedSynth::TakeFreeJob()
+{
+	// Jobs come back once their frames are accounted for; if they're all
+	// out, the worker is the one to wait for
+	while (free_jobs.empty()) {
+		Job *job = nullptr;
+		rendered.wait_dequeue(job);
+		available += job->frames;
+		free_jobs.push_back(job);
+	}
+	Job *job = free_jobs.back();
+	free_jobs.pop_back();
+	job->writes.clear();
+	return job;
+}
+
+// Where a write at the given tick index lands among the tick's frames
+static uint32_t frame_of(float tick_index, uint32_t tick_frames)
+{
+	return std::min(tick_frames, static_cast<uint32_t>(tick_index * tick_frames));
+}
+
+void ThreadedSynth::EndTick(uint32_t frames, int16_t *buffer)
+{
+	// Ticks longer than the ring can take go to the worker in parts, each
+	// with the writes that land within it
+	bool waited = false;
+	uint32_t start = 0;
+	while (frames - start > max_tick_frames) {
+		Job *part = TakeFreeJob();
+		const uint32_t end = start + max_tick_frames;
+		auto &writes = current->writes;
+		const auto later = std::find_if(writes.begin(), writes.end(),
+		                                [=](const RegWrite &w) {
+			                                return frame_of(w.index, frames) >= end;
+		                                });
+		part->writes.assign(writes.begin(), later);
+		writes.erase(writes.begin(), later);
+		part->tick_frames = frames;
+		part->start = start;
+		part->frames = max_tick_frames;
+		waited |= Submit(part, buffer + start * 2);
+		start = end;
+	}
+	current->tick_frames = frames;
+	current->start = start;
+	current->frames = frames - start;
+	waited |= Submit(current, buffer + start * 2);
+	current = nullptr;
+	if (waited)
+		++waits;
+	current = TakeFreeJob();
+}
+
+bool ThreadedSynth::Submit(Job *job, int16_t *buffer)
+{
+	const uint32_t frames = job->frames;
+	assert(frames <= max_tick_frames);
+	pending.try_enqueue(job); // always fits, as jobs only circulate
+
+	uint32_t done = std::min(frames, silence_left);
+	memset(buffer, 0, done * 2 * sizeof(int16_t));
+	silence_left -= done;
+
+	bool waited = false;
+	while (done < frames) {
+		if (!available) {
+			Job *rendered_job = nullptr;
+			if (!rendered.try_dequeue(rendered_job)) {
+				waited = true;
+				rendered.wait_dequeue(rendered_job);
+			}
+			available += rendered_job->frames;
+			free_jobs.push_back(rendered_job);
+			continue;
+		}
+		const uint32_t n = std::min({frames - done, available,
+		                             ring_frames - read_pos});
+		memcpy(buffer + done * 2, ring.data() + read_pos * 2,
+		       n * 2 * sizeof(int16_t));
+		done += n;
+		available -= n;
+		read_pos = (read_pos + n) % ring_frames;
+	}
+	return waited;
+}
+
+void ThreadedSynth::Run()
+{
+	Job *job = nullptr;
+	while (true) {
+		pending.wait_dequeue(job);
+		if (!job)
+			break; // woken up to stop
+		Render(*job);
+		rendered.try_enqueue(job); // always fits, as jobs only circulate
+	}
+}
+
+void ThreadedSynth::Render(const Job &job)
+{
+	uint32_t pos = 0;
+	for (const auto &w : job.writes) {
+		const auto offset = frame_of(w.index, job.tick_frames) - job.start;
+		if (offset > pos) {
+			RenderFrames(offset - pos);
+			pos = offset;
+		}
+		write(w.reg, w.val);
+	}
+	RenderFrames(job.frames - pos);
+}
+
+void ThreadedSynth::RenderFrames(uint32_t frames)
+{
+	while (frames > 0) {
+		const uint32_t n = std::min(frames, ring_frames - write_pos);
+		render(ring.data() + write_pos * 2, n);
+		frames -= n;
+		write_pos = (write_pos + n) % ring_frames;
+	}
+}
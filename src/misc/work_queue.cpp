@@ -0,0 +1,89 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "work_queue.h"
+
+#include <algorithm>
+#include <utility>
+
+WorkQueue::~WorkQueue()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stop = true;
+		jobs.clear();
+	}
+	changed.notify_all();
+	if (thread.joinable())
+		thread.join();
+}
+
+WorkQueue::Id WorkQueue::Add(job_f job)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	const Id id = ++last_id;
+	jobs.push_back({id, std::move(job)});
+	if (!thread.joinable())
+		thread = std::thread(&WorkQueue::Run, this);
+	changed.notify_all();
+	return id;
+}
+
+void WorkQueue::Remove(const Id id)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	const auto queued = std::find_if(jobs.begin(), jobs.end(),
+	                                 [id](const Job &job) { return job.id == id; });
+	if (queued != jobs.end()) {
+		jobs.erase(queued);
+		return;
+	}
+	changed.wait(lock, [this, id]() { return running != id; });
+}
+
+size_t WorkQueue::GetQueued()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return jobs.size();
+}
+
+void WorkQueue::Run()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	for (;;) {
+		changed.wait(lock, [this]() { return stop || !jobs.empty(); });
+		if (stop)
+			return;
+
+		Job job = std::move(jobs.front());
+		jobs.pop_front();
+		running = job.id;
+		lock.unlock();
+
+		job.run();
+
+		// The job's captures can refer to its owner, which may be gone
+		// once Remove returns
+		job.run = nullptr;
+		lock.lock();
+		running = 0;
+		changed.notify_all();
+	}
+}
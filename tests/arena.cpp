@@ -0,0 +1,89 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "arena.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <set>
+
+namespace {
+
+TEST(Arena, AllocationsAreAlignedAndDistinct)
+{
+	Arena arena(1024);
+	std::set<uintptr_t> seen;
+	for (size_t size = 1; size < 300; ++size) {
+		const auto ptr = reinterpret_cast<uintptr_t>(arena.Allocate(size));
+		EXPECT_EQ(ptr % Arena::granularity, 0u);
+		EXPECT_TRUE(seen.insert(ptr).second);
+	}
+	EXPECT_GE(arena.GetReservedBytes(), arena.GetUsedBytes());
+}
+
+TEST(Arena, FreedMemoryIsReused)
+{
+	Arena arena;
+	void *a = arena.Allocate(40);
+	arena.Allocate(40);
+	const size_t reserved = arena.GetReservedBytes();
+	arena.Free(a, 40);
+	EXPECT_EQ(arena.Allocate(33), a); // same rounded size
+	EXPECT_EQ(arena.GetReservedBytes(), reserved);
+}
+
+TEST(Arena, Strings)
+{
+	Arena arena;
+	char *hello = arena.CopyString("Hello, World");
+	char *empty = arena.CopyString("");
+	EXPECT_STREQ(hello, "Hello, World");
+	EXPECT_STREQ(empty, "");
+	const size_t used = arena.GetUsedBytes();
+	arena.FreeString(hello);
+	EXPECT_LT(arena.GetUsedBytes(), used);
+	EXPECT_EQ(arena.CopyString("Goodbye"), hello);
+}
+
+TEST(Arena, LargeAllocation)
+{
+	Arena arena(1024);
+	auto small = static_cast<char *>(arena.Allocate(16));
+	auto large = static_cast<char *>(arena.Allocate(5000));
+	memset(large, 0xff, 5000);
+	// The current block is still used for small allocations
+	EXPECT_EQ(static_cast<char *>(arena.Allocate(16)), small + 16);
+	EXPECT_EQ(arena.GetReservedBytes(), 1024u + 5008u);
+}
+
+TEST(Arena, Clear)
+{
+	Arena arena;
+	for (int i = 0; i < 10000; ++i)
+		arena.CopyString("some directory entry");
+	EXPECT_GT(arena.GetReservedBytes(), 0u);
+	arena.Clear();
+	EXPECT_EQ(arena.GetReservedBytes(), 0u);
+	EXPECT_EQ(arena.GetUsedBytes(), 0u);
+	EXPECT_STREQ(arena.CopyString("again"), "again");
+}
+
+} // namespace
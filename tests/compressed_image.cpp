@@ -0,0 +1,228 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "compressed_image.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "cross.h"
+#include "mem_host.h"
+
+namespace {
+
+std::vector<uint8_t> make_data(size_t size)
+{
+	// Mix of compressible text, zero runs and random noise
+	std::vector<uint8_t> data(size);
+	std::mt19937 rng(1234);
+	const std::string text = "The quick brown fox jumps over the lazy dog. ";
+	for (size_t i = 0; i < size; ++i) {
+		const size_t block = (i / 1000) % 3;
+		if (block == 0)
+			data[i] = static_cast<uint8_t>(text[i % text.size()]);
+		else if (block == 1)
+			data[i] = 0;
+		else
+			data[i] = static_cast<uint8_t>(rng());
+	}
+	return data;
+}
+
+void expect_round_trip(const std::vector<uint8_t> &data)
+{
+	std::vector<uint8_t> compressed(data.size() + data.size() / 255 + 16);
+	const size_t size = lz4_compress_block(data.data(), data.size(),
+	                                       compressed.data(), compressed.size());
+	ASSERT_GT(size, 0u);
+	std::vector<uint8_t> decompressed(data.size());
+	EXPECT_EQ(lz4_decompress_block(compressed.data(), size,
+	                               decompressed.data(), decompressed.size()),
+	          static_cast<int64_t>(data.size()));
+	EXPECT_EQ(decompressed, data);
+}
+
+TEST(Lz4Block, RoundTrip)
+{
+	expect_round_trip(make_data(100000));
+}
+
+TEST(Lz4Block, RoundTripSmall)
+{
+	for (size_t size = 0; size < 40; ++size)
+		expect_round_trip(make_data(size));
+}
+
+TEST(Lz4Block, RoundTripRepeated)
+{
+	expect_round_trip(std::vector<uint8_t>(70000, 0x5a));
+}
+
+TEST(Lz4Block, CompressesZeros)
+{
+	const std::vector<uint8_t> zeros(65536, 0);
+	std::vector<uint8_t> compressed(zeros.size());
+	const size_t size = lz4_compress_block(zeros.data(), zeros.size(),
+	                                       compressed.data(), compressed.size());
+	EXPECT_GT(size, 0u);
+	EXPECT_LT(size, 512u);
+}
+
+TEST(Lz4Block, DoesNotFit)
+{
+	const auto data = make_data(5000);
+	std::vector<uint8_t> compressed(100);
+	EXPECT_EQ(lz4_compress_block(data.data(), data.size(), compressed.data(),
+	                             compressed.size()),
+	          0u);
+}
+
+TEST(Lz4Block, RejectsMalformed)
+{
+	std::vector<uint8_t> out(64);
+	// Match offset pointing before the start of the output
+	const uint8_t bad_offset[] = {0x14, 'a', 0x05, 0x00, 0x00};
+	EXPECT_EQ(lz4_decompress_block(bad_offset, sizeof(bad_offset), out.data(),
+	                               out.size()),
+	          -1);
+	// Literals running past the end of the input
+	const uint8_t truncated[] = {0x50, 'a', 'b'};
+	EXPECT_EQ(lz4_decompress_block(truncated, sizeof(truncated), out.data(),
+	                               out.size()),
+	          -1);
+	// Output larger than the destination
+	const uint8_t too_long[] = {0x1f, 'a', 0x01, 0x00, 0xff, 0xff};
+	EXPECT_EQ(lz4_decompress_block(too_long, sizeof(too_long), out.data(),
+	                               out.size()),
+	          -1);
+}
+
+struct CompressedImageTest : public testing::Test {
+	CompressedImageTest() : data(make_data(300 * 1024 + 300))
+	{
+		raw = tmpfile();
+		packed = tmpfile();
+		fwrite(data.data(), 1, data.size(), raw);
+		std::string error;
+		created = CompressedImage::Create(raw, packed, 32 * 1024, error);
+	}
+
+	~CompressedImageTest()
+	{
+		fclose(raw);
+		fclose(packed);
+	}
+
+	std::vector<uint8_t> data;
+	FILE *raw = nullptr;
+	FILE *packed = nullptr;
+	bool created = false;
+};
+
+TEST_F(CompressedImageTest, Detection)
+{
+	ASSERT_TRUE(created);
+	EXPECT_TRUE(CompressedImage::IsCompressedImage(packed));
+	EXPECT_FALSE(CompressedImage::IsCompressedImage(raw));
+	EXPECT_FALSE(CompressedImage(raw).IsOpen());
+}
+
+TEST_F(CompressedImageTest, SequentialRead)
+{
+	ASSERT_TRUE(created);
+	CompressedImage image(packed);
+	ASSERT_TRUE(image.IsOpen());
+	EXPECT_EQ(image.GetSize(), data.size());
+
+	std::vector<uint8_t> out(data.size());
+	for (size_t pos = 0; pos < out.size(); pos += 512) {
+		const size_t n = std::min<size_t>(512, out.size() - pos);
+		ASSERT_TRUE(image.Read(pos, n, out.data() + pos));
+	}
+	EXPECT_EQ(out, data);
+	EXPECT_GT(image.GetReadAheadChunks(), 0u);
+	EXPECT_GT(image.GetCacheHits(), image.GetCacheMisses());
+}
+
+TEST_F(CompressedImageTest, RandomRead)
+{
+	ASSERT_TRUE(created);
+	CompressedImage image(packed, 64 * 1024);
+	ASSERT_TRUE(image.IsOpen());
+	std::mt19937 rng(42);
+	for (int i = 0; i < 200; ++i) {
+		const size_t pos = rng() % data.size();
+		const size_t n = std::min<size_t>(rng() % 70000, data.size() - pos);
+		std::vector<uint8_t> out(n);
+		ASSERT_TRUE(image.Read(pos, n, out.data()));
+		ASSERT_TRUE(std::equal(out.begin(), out.end(), data.begin() + pos));
+	}
+}
+
+TEST_F(CompressedImageTest, ReadBeyondEnd)
+{
+	ASSERT_TRUE(created);
+	CompressedImage image(packed);
+	std::vector<uint8_t> out(1024, 0xff);
+	EXPECT_TRUE(image.Read(data.size() - 100, out.size(), out.data()));
+	EXPECT_TRUE(std::equal(out.begin(), out.begin() + 100, data.end() - 100));
+	EXPECT_EQ(out[100], 0);
+	EXPECT_EQ(out.back(), 0);
+}
+
+TEST(CompressedImage, ChunkBeyond2GB)
+{
+	// One raw chunk stored past the 2 GB mark, which a 32-bit long file
+	// offset can't reach; the gap before it stays sparse
+	constexpr uint32_t chunk_size = 4096;
+	constexpr uint64_t chunk_offset = (uint64_t{1} << 31) + chunk_size;
+	const std::vector<uint8_t> data = make_data(chunk_size);
+
+	uint8_t header[CompressedImage::header_size + CompressedImage::index_entry_size] = {};
+	memcpy(header, "DBXCIMG1", 8);
+	host_writed(header + 8, CompressedImage::version);
+	host_writed(header + 12, chunk_size);
+	host_writeq(header + 16, chunk_size);
+	host_writed(header + 24, 1);
+	uint8_t *entry = header + CompressedImage::header_size;
+	host_writeq(entry, chunk_offset);
+	host_writed(entry + 8, chunk_size);
+	host_writed(entry + 12, 1);
+
+	FILE *packed = tmpfile();
+	ASSERT_NE(packed, nullptr);
+	ASSERT_EQ(fwrite(header, 1, sizeof(header), packed), sizeof(header));
+	ASSERT_EQ(cross::fseek64(packed, static_cast<int64_t>(chunk_offset), SEEK_SET), 0);
+	ASSERT_EQ(fwrite(data.data(), 1, data.size(), packed), data.size());
+
+	CompressedImage image(packed);
+	ASSERT_TRUE(image.IsOpen());
+	std::vector<uint8_t> out(chunk_size);
+	EXPECT_TRUE(image.Read(0, out.size(), out.data()));
+	EXPECT_EQ(out, data);
+	fclose(packed);
+}
+
+} // namespace
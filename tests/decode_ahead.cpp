@@ -0,0 +1,111 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "decode_ahead.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Stereo stream counting up from 0, with both channels holding the
+// frame number
+struct CountingStream {
+	explicit CountingStream(uint32_t length) : length(length) {}
+
+	uint32_t operator()(int16_t *buffer, uint32_t frames)
+	{
+		// Odd-sized reads, to exercise partial chunks
+		frames = std::min({frames, length - pos, 700u});
+		for (uint32_t i = 0; i < frames; ++i, ++pos) {
+			buffer[i * 2] = static_cast<int16_t>(pos);
+			buffer[i * 2 + 1] = static_cast<int16_t>(pos);
+		}
+		return frames;
+	}
+
+	const uint32_t length;
+	uint32_t pos = 0;
+};
+
+// Reads the whole stereo stream in blocks of the given size
+std::vector<int16_t> read_all(DecodeAhead &decoder, uint32_t block)
+{
+	std::vector<int16_t> out;
+	std::vector<int16_t> buffer(block * 2);
+	while (!decoder.IsAtEnd()) {
+		const uint32_t n = decoder.Read(buffer.data(), block);
+		out.insert(out.end(), buffer.begin(), buffer.begin() + n * 2);
+		if (n < block)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	return out;
+}
+
+TEST(DecodeAhead, ReadsWholeStream)
+{
+	constexpr uint32_t length = 20000;
+	DecodeAhead decoder(CountingStream(length), 2, 1024, 4);
+	const auto out = read_all(decoder, 333);
+	ASSERT_EQ(out.size(), length * 2);
+	for (uint32_t i = 0; i < length; ++i) {
+		ASSERT_EQ(out[i * 2], static_cast<int16_t>(i));
+		ASSERT_EQ(out[i * 2 + 1], static_cast<int16_t>(i));
+	}
+}
+
+TEST(DecodeAhead, EmptyStream)
+{
+	DecodeAhead decoder(CountingStream(0), 2, 1024, 4);
+	EXPECT_TRUE(read_all(decoder, 100).empty());
+	EXPECT_EQ(decoder.GetUnderruns(), 0u);
+}
+
+TEST(DecodeAhead, CountsUnderruns)
+{
+	// A decoder slower than the reader
+	auto slow = [pos = 0u](int16_t *buffer, uint32_t frames) mutable {
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		if (pos >= 10)
+			return 0u;
+		++pos;
+		std::fill(buffer, buffer + frames * 2, 0);
+		return frames;
+	};
+	DecodeAhead decoder(slow, 2, 16, 2);
+	const auto out = read_all(decoder, 64);
+	EXPECT_EQ(out.size(), 10 * 16 * 2u);
+	EXPECT_GT(decoder.GetUnderruns(), 0u);
+}
+
+TEST(DecodeAhead, StopsWhileDecoding)
+{
+	// Destroying it mid-stream, with the chunks full, must not hang
+	DecodeAhead decoder(CountingStream(1000000), 2, 256, 3);
+	int16_t buffer[64 * 2];
+	decoder.Read(buffer, 64);
+	EXPECT_FALSE(decoder.IsAtEnd());
+}
+
+} // namespace
@@ -0,0 +1,86 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "dir_prescan.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "cross.h"
+
+namespace {
+
+const std::string base_dir = std::string("tests") + CROSS_FILESPLIT;
+
+void wait_until_done(const DirPrescan &scan)
+{
+	for (int i = 0; i < 500 && !scan.IsDone(); ++i)
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	ASSERT_TRUE(scan.IsDone());
+}
+
+bool has_entry(const DirPrescan::Listing &listing, const std::string &name, bool is_dir)
+{
+	return std::any_of(listing.begin(), listing.end(), [&](const auto &entry) {
+		return entry.name == name && entry.is_dir == is_dir;
+	});
+}
+
+TEST(DirPrescan, ListsTree)
+{
+	DirPrescan scan(base_dir);
+	wait_until_done(scan);
+	EXPECT_GT(scan.GetScannedEntries(), 0u);
+
+	DirPrescan::Listing listing;
+	ASSERT_TRUE(scan.Take(base_dir, listing));
+	EXPECT_TRUE(has_entry(listing, "dir_prescan.cpp", false));
+	EXPECT_TRUE(has_entry(listing, "files", true));
+
+	const std::string subdir = base_dir + "files" + CROSS_FILESPLIT;
+	ASSERT_TRUE(scan.Take(subdir, listing));
+	EXPECT_TRUE(has_entry(listing, "paths", true));
+	EXPECT_TRUE(scan.Contains(subdir + "paths" + CROSS_FILESPLIT));
+}
+
+TEST(DirPrescan, TakenOnlyOnce)
+{
+	DirPrescan scan(base_dir);
+	wait_until_done(scan);
+	DirPrescan::Listing listing;
+	EXPECT_TRUE(scan.Take(base_dir, listing));
+	EXPECT_FALSE(scan.Contains(base_dir));
+	EXPECT_FALSE(scan.Take(base_dir, listing));
+}
+
+TEST(DirPrescan, MissingDirectory)
+{
+	DirPrescan scan("tests/files/does_not_exist/");
+	wait_until_done(scan);
+	DirPrescan::Listing listing;
+	EXPECT_FALSE(scan.Take("tests/files/does_not_exist/", listing));
+	EXPECT_EQ(scan.GetScannedEntries(), 0u);
+}
+
+} // namespace
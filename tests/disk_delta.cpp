@@ -0,0 +1,203 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "disk_delta.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <vector>
+
+#include "temp_file.h"
+
+namespace {
+
+constexpr uint32_t SECTOR_SIZE = 512;
+const DiskDelta::BaseImage BASE = {1474560, 1600000000};
+
+struct DiskDeltaTest : public testing::Test {
+	std::vector<uint8_t> sector(uint8_t value)
+	{
+		return std::vector<uint8_t>(SECTOR_SIZE, value);
+	}
+
+	TempFile delta_file{"test.delta"};
+};
+
+TEST_F(DiskDeltaTest, MissingSectorIsNotRead)
+{
+	DiskDelta delta(delta_file.Path(), SECTOR_SIZE, BASE);
+	ASSERT_TRUE(delta.IsOpen());
+	auto data = sector(0xaa);
+	EXPECT_FALSE(delta.Read(7, data.data()));
+	EXPECT_EQ(data, sector(0xaa));
+	EXPECT_EQ(delta.GetSectorCount(), 0u);
+}
+
+TEST_F(DiskDeltaTest, WriteAndOverwrite)
+{
+	DiskDelta delta(delta_file.Path(), SECTOR_SIZE, BASE);
+	ASSERT_TRUE(delta.IsOpen());
+	EXPECT_TRUE(delta.Write(7, sector(1).data()));
+	EXPECT_TRUE(delta.Write(3, sector(2).data()));
+	EXPECT_TRUE(delta.Write(7, sector(3).data()));
+	EXPECT_EQ(delta.GetSectorCount(), 2u);
+
+	auto data = sector(0);
+	EXPECT_TRUE(delta.Read(7, data.data()));
+	EXPECT_EQ(data, sector(3));
+	EXPECT_TRUE(delta.Read(3, data.data()));
+	EXPECT_EQ(data, sector(2));
+	EXPECT_FALSE(delta.Contains(4));
+}
+
+TEST_F(DiskDeltaTest, Reopen)
+{
+	{
+		DiskDelta delta(delta_file.Path(), SECTOR_SIZE, BASE);
+		ASSERT_TRUE(delta.Write(100, sector(5).data()));
+		ASSERT_TRUE(delta.Write(0, sector(6).data()));
+	}
+	DiskDelta delta(delta_file.Path(), SECTOR_SIZE, BASE);
+	ASSERT_TRUE(delta.IsOpen());
+	EXPECT_EQ(delta.GetSectorCount(), 2u);
+	auto data = sector(0);
+	EXPECT_TRUE(delta.Read(100, data.data()));
+	EXPECT_EQ(data, sector(5));
+	EXPECT_TRUE(delta.Read(0, data.data()));
+	EXPECT_EQ(data, sector(6));
+
+	// Appending after reopening must not clobber existing records
+	EXPECT_TRUE(delta.Write(1, sector(7).data()));
+	EXPECT_TRUE(delta.Read(0, data.data()));
+	EXPECT_EQ(data, sector(6));
+}
+
+TEST_F(DiskDeltaTest, SectorSizeMismatch)
+{
+	{
+		DiskDelta delta(delta_file.Path(), SECTOR_SIZE, BASE);
+		ASSERT_TRUE(delta.IsOpen());
+	}
+	DiskDelta delta(delta_file.Path(), 2048, BASE);
+	EXPECT_FALSE(delta.IsOpen());
+	EXPECT_FALSE(delta.GetError().empty());
+}
+
+TEST_F(DiskDeltaTest, BaseImageMismatch)
+{
+	{
+		DiskDelta delta(delta_file.Path(), SECTOR_SIZE, BASE);
+		ASSERT_TRUE(delta.IsOpen());
+	}
+	const DiskDelta::BaseImage resized = {BASE.size + SECTOR_SIZE, BASE.mtime};
+	const DiskDelta::BaseImage modified = {BASE.size, BASE.mtime + 1};
+	for (const auto &base : {resized, modified}) {
+		DiskDelta delta(delta_file.Path(), SECTOR_SIZE, base);
+		EXPECT_FALSE(delta.IsOpen());
+		EXPECT_FALSE(delta.GetError().empty());
+	}
+	DiskDelta delta(delta_file.Path(), SECTOR_SIZE, BASE);
+	EXPECT_TRUE(delta.IsOpen());
+}
+
+// A flushed write is in the file, whatever happens to the process next
+TEST_F(DiskDeltaTest, FlushedWriteIsInTheFile)
+{
+	DiskDelta delta(delta_file.Path(), SECTOR_SIZE, BASE);
+	ASSERT_TRUE(delta.Write(12, sector(7).data()));
+	ASSERT_TRUE(delta.Flush());
+
+	FILE *f = fopen(delta_file.Path(), "rb");
+	ASSERT_TRUE(f);
+	std::vector<uint8_t> contents(DiskDelta::header_size + 4 + SECTOR_SIZE + 1);
+	const size_t size = fread(contents.data(), 1, contents.size(), f);
+	fclose(f);
+	ASSERT_EQ(size, contents.size() - 1);
+	EXPECT_EQ(contents[DiskDelta::header_size], 12);
+	EXPECT_EQ(contents[size - 1], 7);
+}
+
+TEST_F(DiskDeltaTest, TruncatedRecordIsDropped)
+{
+	{
+		DiskDelta delta(delta_file.Path(), SECTOR_SIZE, BASE);
+		ASSERT_TRUE(delta.Write(9, sector(1).data()));
+	}
+	FILE *f = fopen(delta_file.Path(), "ab");
+	ASSERT_TRUE(f);
+	const uint8_t partial[10] = {2, 0, 0, 0};
+	fwrite(partial, 1, sizeof(partial), f);
+	fclose(f);
+
+	DiskDelta delta(delta_file.Path(), SECTOR_SIZE, BASE);
+	ASSERT_TRUE(delta.IsOpen());
+	EXPECT_EQ(delta.GetSectorCount(), 1u);
+	EXPECT_FALSE(delta.Contains(2));
+	EXPECT_TRUE(delta.Write(2, sector(4).data()));
+	auto data = sector(0);
+	EXPECT_TRUE(delta.Read(9, data.data()));
+	EXPECT_EQ(data, sector(1));
+	EXPECT_TRUE(delta.Read(2, data.data()));
+	EXPECT_EQ(data, sector(4));
+}
+
+TEST_F(DiskDeltaTest, SectorLimit)
+{
+	{
+		DiskDelta delta(delta_file.Path(), SECTOR_SIZE, BASE);
+		ASSERT_TRUE(delta.IsOpen());
+		EXPECT_EQ(delta.GetSectorLimit(), 0u);
+		ASSERT_TRUE(delta.Write(41, sector(1).data()));
+		ASSERT_TRUE(delta.Write(3, sector(2).data()));
+		EXPECT_EQ(delta.GetSectorLimit(), 42u);
+	}
+	DiskDelta delta(delta_file.Path(), SECTOR_SIZE, BASE);
+	ASSERT_TRUE(delta.IsOpen());
+	EXPECT_EQ(delta.GetSectorLimit(), 42u);
+}
+
+TEST_F(DiskDeltaTest, SecondOpenIsRefused)
+{
+	DiskDelta delta(delta_file.Path(), SECTOR_SIZE, BASE);
+	ASSERT_TRUE(delta.IsOpen());
+	{
+		DiskDelta second(delta_file.Path(), SECTOR_SIZE, BASE);
+		EXPECT_FALSE(second.IsOpen());
+		EXPECT_FALSE(second.GetError().empty());
+	}
+	// The refused open must leave the first one working
+	EXPECT_TRUE(delta.Write(5, sector(9).data()));
+	auto data = sector(0);
+	EXPECT_TRUE(delta.Read(5, data.data()));
+	EXPECT_EQ(data, sector(9));
+}
+
+TEST_F(DiskDeltaTest, ReopenAfterClose)
+{
+	{
+		DiskDelta delta(delta_file.Path(), SECTOR_SIZE, BASE);
+		ASSERT_TRUE(delta.IsOpen());
+	}
+	DiskDelta delta(delta_file.Path(), SECTOR_SIZE, BASE);
+	EXPECT_TRUE(delta.IsOpen());
+}
+
+} // namespace
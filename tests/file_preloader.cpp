@@ -0,0 +1,107 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "file_preloader.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "temp_file.h"
+
+namespace {
+
+constexpr uint32_t CHUNK = 4096;
+
+struct FilePreloaderTest : public testing::Test {
+	FilePreloaderTest() { EXPECT_TRUE(data_file.Write(data)); }
+
+	void WaitFor(const FilePreloader &preloader)
+	{
+		while (!preloader.IsFinished())
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	TempFile data_file{"file_preloader.bin"};
+	std::vector<uint8_t> data = random_bytes(100 * 1000, 11);
+};
+
+TEST_F(FilePreloaderTest, MissingFile)
+{
+	FilePreloader preloader("tests/files/does_not_exist.bin", UINT64_MAX);
+	EXPECT_FALSE(preloader.IsOpen());
+}
+
+TEST_F(FilePreloaderTest, LoadsWholeFile)
+{
+	FilePreloader preloader(data_file.Path(), UINT64_MAX, CHUNK);
+	ASSERT_TRUE(preloader.IsOpen());
+	EXPECT_EQ(preloader.GetTotal(), data.size());
+
+	// Progress is polled, and only ever grows
+	uint64_t last_resident = 0;
+	while (!preloader.IsFinished()) {
+		const uint64_t resident = preloader.GetResident();
+		EXPECT_GE(resident, last_resident);
+		EXPECT_LE(resident, data.size());
+		last_resident = resident;
+	}
+	EXPECT_EQ(preloader.GetResident(), data.size());
+
+	std::vector<uint8_t> buffer(5000);
+	ASSERT_TRUE(preloader.Read(12345, buffer.data(), 5000));
+	EXPECT_TRUE(std::equal(buffer.begin(), buffer.end(), data.begin() + 12345));
+	ASSERT_TRUE(preloader.Read(data.size() - 5000, buffer.data(), 5000));
+	EXPECT_TRUE(std::equal(buffer.begin(), buffer.end(), data.end() - 5000));
+	EXPECT_FALSE(preloader.Read(data.size() - 4999, buffer.data(), 5000));
+	EXPECT_EQ(preloader.GetHits(), 2u);
+	EXPECT_EQ(preloader.GetMisses(), 1u);
+}
+
+TEST_F(FilePreloaderTest, StopsAtLimit)
+{
+	FilePreloader preloader(data_file.Path(), 10000, CHUNK);
+	ASSERT_TRUE(preloader.IsOpen());
+	WaitFor(preloader);
+	EXPECT_EQ(preloader.GetTotal(), 10000u);
+	EXPECT_EQ(preloader.GetResident(), 10000u);
+
+	std::vector<uint8_t> buffer(2048);
+	EXPECT_TRUE(preloader.Read(10000 - 2048, buffer.data(), 2048));
+	EXPECT_TRUE(std::equal(buffer.begin(), buffer.end(), data.begin() + 10000 - 2048));
+	EXPECT_FALSE(preloader.Read(10000 - 2047, buffer.data(), 2048));
+
+	const uint8_t *resident = preloader.Lookup(100, 2048);
+	ASSERT_NE(resident, nullptr);
+	EXPECT_TRUE(std::equal(resident, resident + 2048, data.begin() + 100));
+	EXPECT_EQ(preloader.Lookup(9000, 2048), nullptr);
+}
+
+TEST_F(FilePreloaderTest, StopsWhileLoading)
+{
+	// Destroying it mid-load must not hang
+	FilePreloader preloader(data_file.Path(), UINT64_MAX, 16);
+	ASSERT_TRUE(preloader.IsOpen());
+}
+
+} // namespace
@@ -0,0 +1,105 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "frame_trace.h"
+
+#include <gtest/gtest.h>
+
+namespace {
+
+TEST(LatencyHistogram, Empty)
+{
+	LatencyHistogram h;
+	EXPECT_EQ(h.GetCount(), 0u);
+	EXPECT_EQ(h.GetMin(), 0);
+	EXPECT_EQ(h.GetMax(), 0);
+	EXPECT_EQ(h.GetMean(), 0.0);
+	EXPECT_EQ(h.GetPercentile(50), 0);
+}
+
+TEST(LatencyHistogram, Buckets)
+{
+	LatencyHistogram h;
+	h.Add(0);
+	h.Add(1);
+	h.Add(2);
+	h.Add(3);
+	h.Add(1000);
+	EXPECT_EQ(h.GetBuckets()[0], 2u);
+	EXPECT_EQ(h.GetBuckets()[1], 2u);
+	EXPECT_EQ(h.GetBuckets()[9], 1u); // 512..1023
+	EXPECT_EQ(h.GetCount(), 5u);
+	EXPECT_EQ(h.GetMin(), 0);
+	EXPECT_EQ(h.GetMax(), 1000);
+	EXPECT_DOUBLE_EQ(h.GetMean(), 201.2);
+}
+
+TEST(LatencyHistogram, Percentiles)
+{
+	LatencyHistogram h;
+	for (int i = 0; i < 99; ++i)
+		h.Add(14000); // 8192..16383
+	h.Add(40000); // 32768..65535
+	EXPECT_EQ(h.GetPercentile(50), 16383);
+	EXPECT_EQ(h.GetPercentile(99), 16383);
+	EXPECT_EQ(h.GetPercentile(100), 40000);
+}
+
+TEST(LatencyHistogram, NegativeDurationIsClamped)
+{
+	LatencyHistogram h;
+	h.Add(-5);
+	EXPECT_EQ(h.GetMin(), 0);
+	EXPECT_EQ(h.GetBuckets()[0], 1u);
+}
+
+TEST(FrameTracer, FrameLatencies)
+{
+	FrameTracer t;
+	t.Record(FrameEvent::VerticalRetrace, 0);
+	t.Record(FrameEvent::Input, 100);
+	t.Record(FrameEvent::Input, 200);
+	t.Record(FrameEvent::RenderStart, 1000);
+	t.Record(FrameEvent::RenderEnd, 3000);
+	t.Record(FrameEvent::Present, 5000);
+	t.Record(FrameEvent::VerticalRetrace, 14000);
+	t.Record(FrameEvent::Present, 20000);
+
+	EXPECT_EQ(t.GetSamples().size(), 8u);
+	EXPECT_EQ(t.GetRetraceInterval().GetCount(), 1u);
+	EXPECT_EQ(t.GetRetraceInterval().GetMax(), 14000);
+	EXPECT_EQ(t.GetRenderTime().GetMax(), 2000);
+	EXPECT_EQ(t.GetPresentInterval().GetMax(), 15000);
+	EXPECT_EQ(t.GetFrameLatency().GetCount(), 2u);
+	EXPECT_EQ(t.GetFrameLatency().GetMin(), 5000);
+	EXPECT_EQ(t.GetFrameLatency().GetMax(), 6000);
+	// Measured from the first input event not yet presented
+	EXPECT_EQ(t.GetInputLatency().GetCount(), 1u);
+	EXPECT_EQ(t.GetInputLatency().GetMax(), 4900);
+}
+
+TEST(FrameTracer, RenderEndWithoutStart)
+{
+	FrameTracer t;
+	t.Record(FrameEvent::RenderEnd, 3000);
+	EXPECT_EQ(t.GetRenderTime().GetCount(), 0u);
+}
+
+} // namespace
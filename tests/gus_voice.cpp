@@ -0,0 +1,295 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "../src/hardware/gus_voice.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <random>
+
+namespace {
+
+// Control bits, as the GUS registers take them
+constexpr uint8_t BIT16 = 0x04;
+constexpr uint8_t LOOP = 0x08;
+constexpr uint8_t BIDIRECTIONAL = 0x10;
+constexpr uint8_t RAISEIRQ = 0x20;
+constexpr uint8_t DECREASING = 0x40;
+
+struct Settings {
+	uint8_t wave_state = 0;
+	int32_t wave_start = 0;
+	int32_t wave_end = 0;
+	uint16_t wave_rate = 0;
+	uint8_t vol_state = 0;
+	int32_t vol_start = 0;
+	int32_t vol_end = 0;
+	int32_t vol_pos = 0;
+	uint16_t vol_rate = 0;
+	uint8_t pan = PAN_DEFAULT_POSITION;
+};
+
+// The voice as it was rendered before working in blocks: one frame at a
+// time, reading the wave and volume at their positions and then stepping
+// each control on by a frame
+class ReferenceVoice {
+public:
+	struct Ctrl {
+		int32_t start = 0;
+		int32_t end = 0;
+		int32_t pos = 0;
+		int32_t inc = 0;
+		uint8_t state = 0;
+		bool irq = false;
+	};
+
+	ReferenceVoice(const Settings &s)
+	{
+		wave.state = s.wave_state;
+		wave.start = s.wave_start;
+		wave.end = s.wave_end;
+		wave.pos = (s.wave_state & DECREASING) ? s.wave_end : s.wave_start;
+		wave.inc = (s.wave_rate + 1) / 2;
+		vol.state = s.vol_state;
+		vol.start = s.vol_start;
+		vol.end = s.vol_end;
+		vol.pos = s.vol_pos;
+		const int decimator = 1 << (3 * (s.vol_rate >> 6));
+		vol.inc = ((s.vol_rate & 63) * VOLUME_INC_SCALAR + decimator - 1) /
+		          decimator;
+		pan = std::min<uint8_t>(s.pan, PAN_POSITIONS - 1);
+	}
+
+	AudioFrame Render(const ram_array_t &ram,
+	                  const vol_scalars_array_t &vol_scalars,
+	                  const pan_scalars_array_t &pan_scalars)
+	{
+		const int32_t addr = wave.pos / WAVE_WIDTH;
+		const int32_t fraction = wave.pos & (WAVE_WIDTH - 1);
+		float sample = Read(ram, addr);
+		if (wave.inc < WAVE_WIDTH && fraction) {
+			const float next = Read(ram, addr + 1);
+			sample += (next - sample) * static_cast<float>(fraction) *
+			          (1.0f / WAVE_WIDTH);
+		}
+		// Volume positions are rounded up to the index
+		const int32_t vol_index = vol.pos > 0 ? (vol.pos + VOLUME_INC_SCALAR - 1) /
+		                                                VOLUME_INC_SCALAR
+		                                      : -(-vol.pos / VOLUME_INC_SCALAR);
+		sample *= vol_scalars.at(static_cast<size_t>(vol_index));
+
+		const bool rollover = (vol.state & BIT16) && !(wave.state & LOOP);
+		Step(wave, rollover);
+		Step(vol, false);
+		return {sample * pan_scalars[pan].left, sample * pan_scalars[pan].right};
+	}
+
+	Ctrl wave = {};
+	Ctrl vol = {};
+
+private:
+	float Read(const ram_array_t &ram, const int32_t addr) const
+	{
+		if (!(wave.state & BIT16))
+			return static_cast<int8_t>(ram[addr & 0xfffff]) * 256.0f;
+		const auto i = (addr & 0xc0000) | ((addr & 0x1ffff) << 1);
+		return static_cast<int16_t>(ram[i] | ram[i + 1] << 8);
+	}
+
+	static void Step(Ctrl &ctrl, const bool rollover)
+	{
+		if (ctrl.state & 0x03)
+			return;
+		int32_t remaining = 0;
+		if (ctrl.state & DECREASING) {
+			ctrl.pos -= ctrl.inc;
+			remaining = ctrl.start - ctrl.pos;
+		} else {
+			ctrl.pos += ctrl.inc;
+			remaining = ctrl.pos - ctrl.end;
+		}
+		if (remaining < 0)
+			return;
+		if (ctrl.state & RAISEIRQ)
+			ctrl.irq = true;
+		if (rollover)
+			return;
+		if (ctrl.state & LOOP) {
+			if (ctrl.state & BIDIRECTIONAL)
+				ctrl.state ^= DECREASING;
+			ctrl.pos = (ctrl.state & DECREASING) ? ctrl.end - remaining
+			                                     : ctrl.start + remaining;
+		} else {
+			ctrl.state |= 1;
+			ctrl.pos = (ctrl.state & DECREASING) ? ctrl.start : ctrl.end;
+		}
+	}
+
+	uint8_t pan = PAN_DEFAULT_POSITION;
+};
+
+struct GusVoiceTest : public testing::Test {
+	GusVoiceTest() : ram(new ram_array_t)
+	{
+		std::mt19937 rng(7);
+		for (auto &b : *ram)
+			b = static_cast<uint8_t>(rng());
+
+		// Set up as the Gus class does
+		double scalar = 1.0;
+		for (auto v = vol_scalars.rbegin(); v != vol_scalars.rend(); ++v) {
+			*v = static_cast<float>(scalar);
+			scalar /= 1.002709201;
+		}
+		vol_scalars.front() = 0.0f;
+		for (int i = 0; i < PAN_POSITIONS; ++i) {
+			const auto angle = (i + 1) * M_PI / (2 * (PAN_POSITIONS + 1));
+			pan_scalars[i] = {static_cast<float>(cos(angle)),
+			                  static_cast<float>(sin(angle))};
+		}
+	}
+
+	static void Apply(Voice &voice, const Settings &s)
+	{
+		voice.UpdateWaveState(s.wave_state);
+		voice.wave_ctrl.start = s.wave_start;
+		voice.wave_ctrl.end = s.wave_end;
+		voice.wave_ctrl.pos = (s.wave_state & DECREASING) ? s.wave_end
+		                                                  : s.wave_start;
+		voice.WriteWaveRate(s.wave_rate);
+		voice.UpdateVolState(s.vol_state);
+		voice.vol_ctrl.start = s.vol_start;
+		voice.vol_ctrl.end = s.vol_end;
+		voice.vol_ctrl.pos = s.vol_pos;
+		voice.WriteVolRate(s.vol_rate);
+		voice.WritePanPot(s.pan);
+	}
+
+	// Renders the frames in blocks, as the Gus class does, and one frame
+	// at a time with the reference, checking that both give the same
+	// samples and leave the controls in the same state
+	void ExpectSameRendering(const Settings &settings, const int frames,
+	                         const int block_frames)
+	{
+		VoiceIrq irq;
+		Voice voice(3, irq);
+		Apply(voice, settings);
+		ReferenceVoice reference(settings);
+
+		for (int done = 0; done < frames; done += block_frames) {
+			const int n = std::min(block_frames, frames - done);
+			accumulator_array_t block_out = {};
+			voice.GenerateSamples(block_out, *ram, vol_scalars,
+			                      pan_scalars, n, true);
+
+			accumulator_array_t reference_out = {};
+			for (int i = 0; i < n; ++i) {
+				const auto frame = reference.Render(*ram, vol_scalars,
+				                                    pan_scalars);
+				reference_out[i * 2] = frame.left;
+				reference_out[i * 2 + 1] = frame.right;
+			}
+			ASSERT_EQ(block_out, reference_out) << "in the block at frame " << done;
+			ASSERT_EQ(voice.wave_ctrl.pos, reference.wave.pos);
+			ASSERT_EQ(voice.vol_ctrl.pos, reference.vol.pos);
+			ASSERT_EQ(voice.ReadWaveState(),
+			          reference.wave.state | (reference.wave.irq ? 0x80 : 0));
+			ASSERT_EQ(voice.ReadVolState(),
+			          reference.vol.state | (reference.vol.irq ? 0x80 : 0));
+		}
+	}
+
+	std::unique_ptr<ram_array_t> ram;
+	vol_scalars_array_t vol_scalars = {};
+	pan_scalars_array_t pan_scalars = {};
+};
+
+// A 16-bit wave played slower than the output rate, so it interpolates,
+// looping while the volume ramps up and down
+TEST_F(GusVoiceTest, LoopingRampingVoice)
+{
+	Settings s;
+	s.wave_state = BIT16 | LOOP | RAISEIRQ;
+	s.wave_start = 1000 * WAVE_WIDTH;
+	s.wave_end = s.wave_start + 700 * WAVE_WIDTH + 123;
+	s.wave_rate = 300;
+	s.vol_state = LOOP | BIDIRECTIONAL | RAISEIRQ;
+	s.vol_start = 1000 * VOLUME_INC_SCALAR;
+	s.vol_end = 4000 * VOLUME_INC_SCALAR;
+	s.vol_pos = s.vol_start;
+	s.vol_rate = 40;
+	s.pan = 3;
+	ExpectSameRendering(s, 44100, BUFFER_FRAMES);
+}
+
+// An 8-bit wave looping back and forth faster than the output rate,
+// fading out until the volume stops
+TEST_F(GusVoiceTest, BidirectionalFadingVoice)
+{
+	Settings s;
+	s.wave_state = LOOP | BIDIRECTIONAL;
+	s.wave_start = 5000 * WAVE_WIDTH;
+	s.wave_end = s.wave_start + 97 * WAVE_WIDTH + 7;
+	s.wave_rate = 1500;
+	s.vol_state = DECREASING | RAISEIRQ;
+	s.vol_start = 500 * VOLUME_INC_SCALAR;
+	s.vol_end = 4095 * VOLUME_INC_SCALAR;
+	s.vol_pos = s.vol_end;
+	s.vol_rate = 64 + 20;
+	s.pan = 12;
+	ExpectSameRendering(s, 20000, BUFFER_FRAMES);
+}
+
+// With rollover, the wave raises the IRQ at its end but plays on. It
+// plays at the output rate, so it isn't interpolated despite the fraction,
+// and reaches its end on the last frame of a block.
+TEST_F(GusVoiceTest, RolloverVoice)
+{
+	Settings s;
+	s.wave_state = BIT16 | RAISEIRQ;
+	s.wave_start = 20000 * WAVE_WIDTH + 100;
+	s.wave_end = 20000 * WAVE_WIDTH + 2016 * WAVE_WIDTH;
+	s.wave_rate = 2 * WAVE_WIDTH;
+	s.vol_state = BIT16 | 0x02; // rollover, volume stopped
+	s.vol_pos = 3500 * VOLUME_INC_SCALAR;
+	ExpectSameRendering(s, 5000, BUFFER_FRAMES);
+}
+
+// Blocks of other sizes end in other places along the loops
+TEST_F(GusVoiceTest, OddBlockSizes)
+{
+	Settings s;
+	s.wave_state = BIT16 | LOOP | BIDIRECTIONAL | RAISEIRQ;
+	s.wave_start = 300 * WAVE_WIDTH + 11;
+	s.wave_end = s.wave_start + 50 * WAVE_WIDTH;
+	s.wave_rate = 777;
+	s.vol_state = LOOP | RAISEIRQ;
+	s.vol_start = 2000 * VOLUME_INC_SCALAR;
+	s.vol_end = 2100 * VOLUME_INC_SCALAR;
+	s.vol_pos = s.vol_start;
+	s.vol_rate = 63;
+	for (const int block_frames : {1, 7, 13, 47})
+		ExpectSameRendering(s, 5000, block_frames);
+}
+
+} // namespace
@@ -0,0 +1,154 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "image_file.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "decode_ahead.h"
+#include "temp_file.h"
+
+namespace {
+
+constexpr uint32_t SECTOR_SIZE = 2352;
+constexpr uint32_t NUM_SECTORS = 1000;
+constexpr uint32_t IMAGE_SIZE = SECTOR_SIZE * NUM_SECTORS;
+
+// Every byte depends on its position, so misplaced data shows
+uint8_t pattern_byte(uint32_t pos)
+{
+	return static_cast<uint8_t>(((pos * 2654435761u) >> 24) ^ (pos >> 16));
+}
+
+bool matches_pattern(const uint8_t *data, uint32_t pos, uint32_t bytes)
+{
+	for (uint32_t i = 0; i < bytes; ++i)
+		if (data[i] != pattern_byte(pos + i))
+			return false;
+	return true;
+}
+
+struct ImageFileTest : public testing::Test {
+	ImageFileTest()
+	{
+		std::vector<uint8_t> data(IMAGE_SIZE);
+		for (uint32_t i = 0; i < IMAGE_SIZE; ++i)
+			data[i] = pattern_byte(i);
+		EXPECT_TRUE(image_file.Write(data));
+	}
+
+	TempFile image_file{"test.bin"};
+};
+
+TEST_F(ImageFileTest, ReadsData)
+{
+	ImageFile file(image_file.Path());
+	ASSERT_TRUE(file.IsOpen());
+	EXPECT_EQ(file.GetSize(), IMAGE_SIZE);
+
+	std::vector<uint8_t> sector(SECTOR_SIZE);
+	for (const uint32_t n : {5u, 4u, 999u, 0u}) {
+		ASSERT_TRUE(file.Read(sector.data(), n * SECTOR_SIZE, SECTOR_SIZE));
+		EXPECT_TRUE(matches_pattern(sector.data(), n * SECTOR_SIZE, SECTOR_SIZE));
+	}
+	// Reading past the end fails, and doesn't keep later reads from working
+	EXPECT_FALSE(file.Read(sector.data(), IMAGE_SIZE - 100, SECTOR_SIZE));
+	ASSERT_TRUE(file.Read(sector.data(), SECTOR_SIZE, SECTOR_SIZE));
+	EXPECT_TRUE(matches_pattern(sector.data(), SECTOR_SIZE, SECTOR_SIZE));
+}
+
+TEST_F(ImageFileTest, AudioIsShortAtEnd)
+{
+	ImageFile file(image_file.Path());
+	std::vector<uint8_t> buffer(SECTOR_SIZE);
+	EXPECT_EQ(file.ReadAudio(buffer.data(), IMAGE_SIZE - 100, SECTOR_SIZE), 100u);
+	EXPECT_TRUE(matches_pattern(buffer.data(), IMAGE_SIZE - 100, 100));
+	EXPECT_EQ(file.ReadAudio(buffer.data(), IMAGE_SIZE, SECTOR_SIZE), 0u);
+	EXPECT_EQ(file.ReadAudio(buffer.data(), 0, SECTOR_SIZE), SECTOR_SIZE);
+	EXPECT_TRUE(matches_pattern(buffer.data(), 0, SECTOR_SIZE));
+}
+
+TEST_F(ImageFileTest, MissingFile)
+{
+	ImageFile file("tests/files/does_not_exist.bin");
+	uint8_t buffer[16];
+	EXPECT_FALSE(file.IsOpen());
+	EXPECT_FALSE(file.Read(buffer, 0, sizeof(buffer)));
+	EXPECT_EQ(file.ReadAudio(buffer, 0, sizeof(buffer)), 0u);
+}
+
+// Data sectors get read on the emulation thread while the decoder thread
+// plays audio from the same file, as with mixed-mode CDs
+TEST_F(ImageFileTest, ReadsDataWhileDecodingAudio)
+{
+	ImageFile file(image_file.Path());
+	ASSERT_TRUE(file.IsOpen());
+
+	constexpr uint32_t frame_bytes = 4;
+	constexpr uint32_t block_frames = 256;
+	std::vector<int16_t> block(2 * block_frames);
+	std::vector<uint8_t> sector(SECTOR_SIZE);
+	uint32_t n = 7;
+
+	// The streams only get in each other's way now and then, so play the
+	// image a few times over
+	for (int pass = 0; pass < 8; ++pass) {
+		uint32_t audio_pos = 0;
+		auto decode = [&](int16_t *buffer, uint32_t frames) {
+			const uint32_t bytes = file.ReadAudio(
+			        reinterpret_cast<uint8_t *>(buffer), audio_pos,
+			        frames * frame_bytes);
+			audio_pos += bytes;
+			return bytes / frame_bytes;
+		};
+		// Small chunks keep the decoder busy while sectors are read
+		DecodeAhead decoder(decode, 2, 16, 64);
+
+		std::vector<uint8_t> audio;
+		uint32_t data_reads = 0;
+		while (!decoder.IsAtEnd()) {
+			const uint32_t frames = decoder.Read(block.data(), block_frames);
+			const auto bytes = reinterpret_cast<const uint8_t *>(block.data());
+			audio.insert(audio.end(), bytes, bytes + frames * frame_bytes);
+
+			// Sectors all over the image, between the audio blocks
+			for (int i = 0; i < 4; ++i, ++data_reads) {
+				n = (n * 37 + 11) % NUM_SECTORS;
+				ASSERT_TRUE(file.Read(sector.data(), n * SECTOR_SIZE,
+				                      SECTOR_SIZE));
+				ASSERT_TRUE(matches_pattern(sector.data(), n * SECTOR_SIZE,
+				                            SECTOR_SIZE));
+			}
+			if (frames < block_frames)
+				std::this_thread::sleep_for(std::chrono::microseconds(100));
+		}
+		EXPECT_GT(data_reads, 0u);
+		ASSERT_EQ(audio.size(), IMAGE_SIZE);
+		ASSERT_TRUE(matches_pattern(audio.data(), 0, IMAGE_SIZE));
+	}
+}
+
+} // namespace
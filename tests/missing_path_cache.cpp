@@ -0,0 +1,127 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "missing_path_cache.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <ctime>
+#include <string>
+
+#ifdef _MSC_VER
+#include <sys/utime.h>
+#else
+#include <utime.h>
+#endif
+
+#include "cross.h"
+#include "fs_utils.h"
+
+namespace {
+
+const std::string test_dir = std::string("tests") + CROSS_FILESPLIT + "files" +
+                             CROSS_FILESPLIT + "missing_path_cache";
+const std::string missing_file = test_dir + CROSS_FILESPLIT + "NEWFILE.TXT";
+
+// Dates the directory back, as if it had been left alone for a while
+void age_dir(const std::string &dir)
+{
+	const time_t past = time(nullptr) - 60;
+	struct utimbuf times = {past, past};
+	ASSERT_EQ(utime(dir.c_str(), &times), 0);
+}
+
+struct MissingPathCacheTest : public testing::Test {
+	MissingPathCacheTest()
+	{
+		remove(missing_file.c_str());
+		rmdir(test_dir.c_str());
+		create_dir(test_dir.c_str(), 0700);
+	}
+	~MissingPathCacheTest()
+	{
+		remove(missing_file.c_str());
+		rmdir(test_dir.c_str());
+	}
+};
+
+TEST_F(MissingPathCacheTest, RemembersMissingPath)
+{
+	age_dir(test_dir);
+	MissingPathCache cache;
+	EXPECT_FALSE(cache.Contains(missing_file));
+	cache.Add(missing_file, missing_file);
+	EXPECT_TRUE(cache.Contains(missing_file));
+	EXPECT_EQ(cache.GetSize(), 1u);
+	cache.Clear();
+	EXPECT_FALSE(cache.Contains(missing_file));
+	EXPECT_TRUE(cache.IsEmpty());
+}
+
+TEST_F(MissingPathCacheTest, ForgetsExternallyCreatedFile)
+{
+	age_dir(test_dir);
+	MissingPathCache cache;
+	cache.Add(missing_file, missing_file);
+	ASSERT_TRUE(cache.Contains(missing_file));
+
+	// Another program creates the file behind the cache's back
+	FILE *f = fopen(missing_file.c_str(), "wb");
+	ASSERT_NE(f, nullptr);
+	fclose(f);
+
+	EXPECT_FALSE(cache.Contains(missing_file));
+	EXPECT_TRUE(cache.IsEmpty());
+}
+
+TEST_F(MissingPathCacheTest, IgnoresRecentlyChangedDirectory)
+{
+	// The directory was just created, a file could still appear in it
+	// within the same second
+	MissingPathCache cache;
+	cache.Add(missing_file, missing_file);
+	EXPECT_FALSE(cache.Contains(missing_file));
+}
+
+TEST_F(MissingPathCacheTest, ForgetsCreatedDirectory)
+{
+	const std::string subdir = test_dir + CROSS_FILESPLIT + "SUBDIR";
+	const std::string path = subdir + CROSS_FILESPLIT + "FILE.TXT";
+	MissingPathCache cache;
+	cache.Add(path, path);
+	EXPECT_TRUE(cache.Contains(path));
+
+	create_dir(subdir.c_str(), 0700);
+	EXPECT_FALSE(cache.Contains(path));
+	rmdir(subdir.c_str());
+}
+
+TEST_F(MissingPathCacheTest, KeyedByGuestPath)
+{
+	age_dir(test_dir);
+	const std::string guest_path = test_dir + CROSS_FILESPLIT + "newfile.txt";
+	MissingPathCache cache;
+	cache.Add(guest_path, missing_file);
+	EXPECT_TRUE(cache.Contains(guest_path));
+	EXPECT_FALSE(cache.Contains(missing_file));
+}
+
+} // namespace
@@ -0,0 +1,180 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "../src/libs/nuked/opl3.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr uint32_t NATIVE_RATE = 49716;
+
+struct RegWrite {
+	uint32_t frame = 0; // applied before rendering this frame
+	uint16_t reg = 0;
+	uint8_t val = 0;
+};
+
+enum class Mode { Opl2, Opl3, Opl3Rhythm };
+
+// Plays random instruments on random channels, keying notes on and off,
+// with the 4-op connections, waveforms and rhythm mode changing now and then
+std::vector<RegWrite> make_writes(const Mode mode, const uint32_t frames,
+                                  const unsigned seed)
+{
+	static constexpr uint8_t op_offsets[18] = {0,  1,  2,  3,  4,  5,
+	                                           8,  9,  10, 11, 12, 13,
+	                                           16, 17, 18, 19, 20, 21};
+	std::mt19937 rng(seed);
+	std::vector<RegWrite> writes;
+	auto write = [&](uint32_t frame, uint16_t reg, uint32_t val) {
+		writes.push_back({frame, reg, static_cast<uint8_t>(val)});
+	};
+	const bool opl3 = mode != Mode::Opl2;
+	const int halves = opl3 ? 2 : 1;
+	write(0, 0x105, opl3 ? 1 : 0);
+	if (opl3)
+		write(0, 0x104, rng() & 0x3f);
+	write(0, 0x01, 0x20); // waveform select
+	auto write_operator = [&](uint32_t frame, uint16_t op) {
+		write(frame, op + 0x20, rng());
+		write(frame, op + 0x40, rng());
+		write(frame, op + 0x60, rng() | 0x40);
+		write(frame, op + 0x80, rng());
+		write(frame, op + 0xe0, rng() & 7);
+	};
+	for (int half = 0; half < halves; ++half)
+		for (const auto offset : op_offsets)
+			write_operator(0, static_cast<uint16_t>(half * 0x100 + offset));
+	for (int ch = 0; ch < 9 * halves; ++ch)
+		write(0, static_cast<uint16_t>((ch / 9) * 0x100 + 0xc0 + ch % 9),
+		      (rng() & 0x0f) | 0x30);
+
+	for (uint32_t frame = 100; frame < frames; frame += 200 + rng() % 2000) {
+		const int ch = static_cast<int>(rng() % (9 * halves));
+		const auto channel = static_cast<uint16_t>((ch / 9) * 0x100 + ch % 9);
+		if (rng() % 4 == 0) {
+			const auto half = static_cast<uint16_t>(ch / 9 * 0x100);
+			write_operator(frame, half + op_offsets[rng() % 18]);
+			write(frame, channel + 0xc0, rng());
+		}
+		write(frame, channel + 0xb0, 0); // key off
+		write(frame + 1, channel + 0xa0, rng());
+		write(frame + 1, channel + 0xb0, 0x20 | (rng() & 0x1f));
+		if (mode == Mode::Opl3Rhythm) {
+			// Keeps a drum loud, on a wave that its few phases sound in
+			const uint16_t drum = 0x10 + rng() % 6;
+			write(frame + 2, drum + 0x40, rng() & 0x0f);
+			write(frame + 2, drum + 0xe0, rng() % 3);
+			write(frame + 2, 0xbd, 0x20 | (rng() & 0xdf));
+		}
+		if (opl3 && rng() % 50 == 0)
+			write(frame + 2, 0x104, rng() & 0x3f);
+		if (rng() % 30 == 0)
+			write(frame + 2, 0x08, rng() & 0x40);
+	}
+	return writes;
+}
+
+// Renders the writes one frame at a time with OPL3_Generate and with
+// OPL3_BatchGenerate, writing the registers straight away
+void expect_same_frames(const Mode mode, const unsigned seed)
+{
+	constexpr uint32_t frames = NATIVE_RATE * 2;
+	const auto writes = make_writes(mode, frames, seed);
+
+	auto chip = std::make_unique<opl3_chip>();
+	auto batch = std::make_unique<opl3_batch>();
+	OPL3_Reset(chip.get(), NATIVE_RATE);
+	OPL3_BatchReset(batch.get(), NATIVE_RATE);
+
+	size_t next = 0;
+	for (uint32_t frame = 0; frame < frames; ++frame) {
+		for (; next < writes.size() && writes[next].frame <= frame; ++next) {
+			OPL3_WriteReg(chip.get(), writes[next].reg, writes[next].val);
+			OPL3_BatchWriteReg(batch.get(), writes[next].reg, writes[next].val);
+		}
+		int16_t expected[2];
+		int16_t actual[2];
+		OPL3_Generate(chip.get(), expected);
+		OPL3_BatchGenerate(batch.get(), actual);
+		ASSERT_EQ(expected[0], actual[0]) << "at frame " << frame;
+		ASSERT_EQ(expected[1], actual[1]) << "at frame " << frame;
+	}
+}
+
+// Renders the writes in blocks resampled to 48 kHz, as the Adlib module
+// does, with the writes going through the chips' write buffers
+void expect_same_stream(const Mode mode, const unsigned seed)
+{
+	constexpr uint32_t rate = 48000;
+	constexpr uint32_t frames = rate * 2;
+	constexpr uint32_t block = 512;
+	const auto writes = make_writes(mode, frames, seed);
+
+	auto chip = std::make_unique<opl3_chip>();
+	auto batch = std::make_unique<opl3_batch>();
+	OPL3_Reset(chip.get(), rate);
+	OPL3_BatchReset(batch.get(), rate);
+
+	std::vector<int16_t> expected(block * 2);
+	std::vector<int16_t> actual(block * 2);
+	size_t next = 0;
+	for (uint32_t frame = 0; frame < frames; frame += block) {
+		for (; next < writes.size() && writes[next].frame < frame + block; ++next) {
+			OPL3_WriteRegBuffered(chip.get(), writes[next].reg,
+			                      writes[next].val);
+			OPL3_BatchWriteRegBuffered(batch.get(), writes[next].reg,
+			                           writes[next].val);
+		}
+		OPL3_GenerateStream(chip.get(), expected.data(), block);
+		OPL3_BatchGenerateStream(batch.get(), actual.data(), block);
+		ASSERT_EQ(expected, actual) << "in the block at frame " << frame;
+	}
+}
+
+TEST(NukedOpl3Batch, MatchesGenerateInOpl2Mode)
+{
+	expect_same_frames(Mode::Opl2, 1);
+}
+
+TEST(NukedOpl3Batch, MatchesGenerateInOpl3Mode)
+{
+	expect_same_frames(Mode::Opl3, 2);
+	expect_same_frames(Mode::Opl3, 3);
+}
+
+TEST(NukedOpl3Batch, MatchesGenerateWithRhythm)
+{
+	expect_same_frames(Mode::Opl3Rhythm, 4);
+	expect_same_frames(Mode::Opl3Rhythm, 5);
+}
+
+TEST(NukedOpl3Batch, MatchesGenerateStreamResampled)
+{
+	expect_same_stream(Mode::Opl2, 6);
+	expect_same_stream(Mode::Opl3Rhythm, 7);
+}
+
+} // namespace
@@ -0,0 +1,67 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "../src/hardware/adlib.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+
+// The threaded nuked handler positions its writes within the emulated tick
+// using the CPU core's cycle counts; the core isn't linked in here, and the
+// handlers never run threaded
+Bit32s CPU_Cycles = 0;
+Bit32s CPU_CycleLeft = 0;
+Bit32s CPU_CycleMax = 1;
+
+namespace {
+
+// The second register bank's address port
+constexpr Bit32u HIGH_ADDR_PORT = 0x38a;
+
+// Writes to the second bank only reach it while OPL3 mode is on; register
+// 0x105 itself is always reachable
+void expect_opl3_mode_follows_0x105(const char *oplemu)
+{
+	std::unique_ptr<Adlib::Handler> handler(
+	        Adlib::make_opl_handler(oplemu, OPL_opl3, false));
+	handler->Init(49716);
+	EXPECT_EQ(handler->WriteAddr(HIGH_ADDR_PORT, 0xb0), 0xb0u);
+
+	ASSERT_EQ(handler->WriteAddr(HIGH_ADDR_PORT, 0x05), 0x105u);
+	handler->WriteReg(0x105, 0x01);
+	EXPECT_EQ(handler->WriteAddr(HIGH_ADDR_PORT, 0xb0), 0x1b0u);
+
+	ASSERT_EQ(handler->WriteAddr(HIGH_ADDR_PORT, 0x05), 0x105u);
+	handler->WriteReg(0x105, 0x00);
+	EXPECT_EQ(handler->WriteAddr(HIGH_ADDR_PORT, 0xb0), 0xb0u);
+}
+
+TEST(OplHandlers, NukedSwitchesOpl3ModeOff)
+{
+	expect_opl3_mode_follows_0x105("nuked");
+}
+
+TEST(OplHandlers, NukedFastSwitchesOpl3ModeOff)
+{
+	expect_opl3_mode_follows_0x105("nukedfast");
+}
+
+} // namespace
@@ -0,0 +1,130 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "overlay_journal.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <string>
+
+#include "temp_file.h"
+
+namespace {
+
+using Kind = OverlayJournal::Kind;
+
+struct OverlayJournalTest : public testing::Test {
+	TempFile journal_file{"DBOVERLAY_JOURNAL"};
+	// Where Compact() writes the journal before replacing the old one
+	TempFile new_journal_file{"DBOVERLAY_JOURNAL.NEW"};
+};
+
+TEST_F(OverlayJournalTest, NothingWrittenUntilChanged)
+{
+	{
+		OverlayJournal journal(journal_file.Path());
+		EXPECT_TRUE(journal.GetError().empty());
+		EXPECT_TRUE(journal.GetFiles().empty());
+	}
+	EXPECT_EQ(fopen(journal_file.Path(), "rb"), nullptr);
+}
+
+TEST_F(OverlayJournalTest, Reopen)
+{
+	{
+		OverlayJournal journal(journal_file.Path());
+		EXPECT_TRUE(journal.Add(Kind::File, "GAME\\SAVE1.DAT"));
+		EXPECT_TRUE(journal.Add(Kind::File, "README.TXT"));
+		EXPECT_TRUE(journal.Add(Kind::Dir, "TEMP"));
+		EXPECT_TRUE(journal.Remove(Kind::File, "README.TXT"));
+	}
+	OverlayJournal journal(journal_file.Path());
+	EXPECT_TRUE(journal.GetError().empty());
+	EXPECT_TRUE(journal.Contains(Kind::File, "GAME\\SAVE1.DAT"));
+	EXPECT_FALSE(journal.Contains(Kind::File, "README.TXT"));
+	EXPECT_TRUE(journal.Contains(Kind::Dir, "TEMP"));
+	EXPECT_FALSE(journal.Contains(Kind::File, "TEMP"));
+	EXPECT_EQ(journal.GetRecordCount(), 5u);
+}
+
+TEST_F(OverlayJournalTest, RepeatedChangesAreNotRecorded)
+{
+	OverlayJournal journal(journal_file.Path());
+	EXPECT_TRUE(journal.Add(Kind::File, "A.TXT"));
+	EXPECT_TRUE(journal.Add(Kind::File, "A.TXT"));
+	EXPECT_TRUE(journal.Remove(Kind::File, "B.TXT"));
+	EXPECT_EQ(journal.GetRecordCount(), 2u);
+}
+
+TEST_F(OverlayJournalTest, CompactsOutdatedRecords)
+{
+	{
+		OverlayJournal journal(journal_file.Path());
+		EXPECT_TRUE(journal.Add(Kind::Dir, "KEEP"));
+		for (int i = 0; i < 1000; ++i) {
+			const std::string name = "FILE" + std::to_string(i);
+			EXPECT_TRUE(journal.Add(Kind::File, name));
+			EXPECT_TRUE(journal.Remove(Kind::File, name));
+		}
+		EXPECT_LE(journal.GetRecordCount(), OverlayJournal::min_compact_records + 1);
+	}
+	OverlayJournal journal(journal_file.Path());
+	EXPECT_TRUE(journal.Contains(Kind::Dir, "KEEP"));
+	EXPECT_TRUE(journal.GetFiles().empty());
+}
+
+TEST_F(OverlayJournalTest, IgnoresLineCutShort)
+{
+	ASSERT_TRUE(journal_file.Write("DBOVERLAY JOURNAL 1\n+DEL A.TXT\n+DEL B.T"));
+	{
+		OverlayJournal journal(journal_file.Path());
+		EXPECT_TRUE(journal.Contains(Kind::File, "A.TXT"));
+		EXPECT_FALSE(journal.Contains(Kind::File, "B.T"));
+		EXPECT_TRUE(journal.Add(Kind::File, "C.TXT"));
+	}
+	OverlayJournal journal(journal_file.Path());
+	EXPECT_TRUE(journal.Contains(Kind::File, "C.TXT"));
+	EXPECT_EQ(journal.GetFiles().size(), 2u);
+}
+
+TEST_F(OverlayJournalTest, RecoversInterruptedCompaction)
+{
+	// The new journal was written but the old one is already gone
+	ASSERT_TRUE(new_journal_file.Write("DBOVERLAY JOURNAL 1\n+DEL A.TXT\n"));
+	{
+		OverlayJournal journal(journal_file.Path());
+		EXPECT_TRUE(journal.GetError().empty());
+		EXPECT_TRUE(journal.Contains(Kind::File, "A.TXT"));
+	}
+	EXPECT_EQ(fopen(new_journal_file.Path(), "rb"), nullptr);
+	OverlayJournal journal(journal_file.Path());
+	EXPECT_TRUE(journal.Contains(Kind::File, "A.TXT"));
+}
+
+TEST_F(OverlayJournalTest, LeavesOtherFilesAlone)
+{
+	ASSERT_TRUE(journal_file.Write("something else\n"));
+	OverlayJournal journal(journal_file.Path());
+	EXPECT_FALSE(journal.GetError().empty());
+	EXPECT_FALSE(journal.Add(Kind::File, "A.TXT"));
+}
+
+} // namespace
@@ -0,0 +1,127 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "read_ahead.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "temp_file.h"
+
+namespace {
+
+constexpr size_t WINDOW = 4096;
+
+struct ReadAheadTest : public testing::Test {
+	ReadAheadTest() { EXPECT_TRUE(data_file.Write(data)); }
+
+	TempFile data_file{"read_ahead.bin"};
+	std::vector<uint8_t> data = random_bytes(100 * 1000, 7);
+	std::shared_ptr<ReadAheadWorker> worker = std::make_shared<ReadAheadWorker>();
+};
+
+TEST_F(ReadAheadTest, MissingFile)
+{
+	ReadAhead file("tests/files/does_not_exist.bin", worker);
+	EXPECT_FALSE(file.IsOpen());
+	uint8_t byte;
+	EXPECT_EQ(file.Read(0, &byte, 1), 0u);
+}
+
+TEST_F(ReadAheadTest, SequentialRead)
+{
+	ReadAhead file(data_file.Path(), worker, WINDOW);
+	ASSERT_TRUE(file.IsOpen());
+	std::vector<uint8_t> out(data.size());
+	size_t pos = 0;
+	for (size_t n = 1; pos < out.size(); n = n * 7 % 3000 + 1) {
+		const size_t wanted = std::min(n, out.size() - pos);
+		ASSERT_EQ(file.Read(pos, out.data() + pos, wanted), wanted);
+		pos += wanted;
+	}
+	EXPECT_EQ(out, data);
+	EXPECT_GT(file.GetPrefetches(), 0u);
+	EXPECT_GT(file.GetHits(), file.GetMisses());
+
+	// At the end of the file
+	uint8_t tail[10];
+	EXPECT_EQ(file.Read(data.size() - 4, tail, sizeof(tail)), 4u);
+	EXPECT_EQ(file.Read(data.size(), tail, sizeof(tail)), 0u);
+}
+
+TEST_F(ReadAheadTest, RandomRead)
+{
+	ReadAhead file(data_file.Path(), worker, WINDOW);
+	std::mt19937 rng(42);
+	for (int i = 0; i < 500; ++i) {
+		const size_t pos = rng() % data.size();
+		const size_t n = std::min<size_t>(rng() % 10000, data.size() - pos);
+		std::vector<uint8_t> out(n);
+		ASSERT_EQ(file.Read(pos, out.data(), n), n);
+		ASSERT_TRUE(std::equal(out.begin(), out.end(), data.begin() + pos));
+	}
+}
+
+TEST_F(ReadAheadTest, Invalidate)
+{
+	ReadAhead file(data_file.Path(), worker, WINDOW);
+	uint8_t byte = 0;
+	ASSERT_EQ(file.Read(0, &byte, 1), 1u);
+	EXPECT_EQ(byte, data[0]);
+
+	data[1] = static_cast<uint8_t>(data[1] + 1);
+	ASSERT_TRUE(data_file.Write(data));
+	file.Invalidate();
+	ASSERT_EQ(file.Read(1, &byte, 1), 1u);
+	EXPECT_EQ(byte, data[1]);
+}
+
+TEST_F(ReadAheadTest, ReadsAfterShutdown)
+{
+	ReadAhead file(data_file.Path(), worker, WINDOW);
+	std::vector<uint8_t> out(data.size());
+	ASSERT_EQ(file.Read(0, out.data(), WINDOW), WINDOW);
+
+	worker->Shutdown();
+	worker->Shutdown();
+	ASSERT_EQ(file.Read(WINDOW, out.data() + WINDOW, out.size() - WINDOW),
+	          out.size() - WINDOW);
+	EXPECT_EQ(out, data);
+}
+
+TEST_F(ReadAheadTest, FilesShareWorker)
+{
+	ReadAhead first(data_file.Path(), worker, WINDOW);
+	ReadAhead second(data_file.Path(), worker, WINDOW);
+	std::vector<uint8_t> out_first(data.size());
+	std::vector<uint8_t> out_second(data.size());
+	for (size_t pos = 0; pos < data.size(); pos += 1000) {
+		ASSERT_EQ(first.Read(pos, out_first.data() + pos, 1000), 1000u);
+		ASSERT_EQ(second.Read(pos, out_second.data() + pos, 1000), 1000u);
+	}
+	EXPECT_EQ(out_first, data);
+	EXPECT_EQ(out_second, data);
+}
+
+} // namespace
@@ -0,0 +1,121 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "sector_cache.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace {
+
+constexpr uint32_t SECTOR_SIZE = 2048;
+
+std::vector<uint8_t> sector(uint8_t value)
+{
+	return std::vector<uint8_t>(SECTOR_SIZE, value);
+}
+
+TEST(SectorCache, ReadBack)
+{
+	SectorCache cache(4, SECTOR_SIZE);
+	auto data = sector(0);
+	EXPECT_FALSE(cache.Read(10, data.data()));
+	cache.Write(10, sector(1).data());
+	cache.Write(11, sector(2).data());
+	EXPECT_TRUE(cache.Read(10, data.data()));
+	EXPECT_EQ(data, sector(1));
+	EXPECT_TRUE(cache.Read(11, data.data()));
+	EXPECT_EQ(data, sector(2));
+	EXPECT_EQ(cache.GetHits(), 2u);
+	EXPECT_EQ(cache.GetMisses(), 1u);
+}
+
+TEST(SectorCache, EvictsLeastRecentlyUsed)
+{
+	SectorCache cache(3, SECTOR_SIZE);
+	auto data = sector(0);
+	for (uint8_t i = 0; i < 3; ++i)
+		cache.Write(i, sector(i).data());
+	EXPECT_TRUE(cache.Read(0, data.data())); // 1 is now the oldest
+	cache.Write(3, sector(3).data());
+	EXPECT_FALSE(cache.Read(1, data.data()));
+	EXPECT_TRUE(cache.Read(0, data.data()));
+	EXPECT_TRUE(cache.Read(2, data.data()));
+	EXPECT_TRUE(cache.Read(3, data.data()));
+	EXPECT_EQ(data, sector(3));
+}
+
+TEST(SectorCache, Overwrite)
+{
+	SectorCache cache(2, SECTOR_SIZE);
+	auto data = sector(0);
+	cache.Write(5, sector(1).data());
+	cache.Write(6, sector(2).data());
+	cache.Write(5, sector(3).data()); // 6 is now the oldest
+	cache.Write(7, sector(4).data());
+	EXPECT_TRUE(cache.Read(5, data.data()));
+	EXPECT_EQ(data, sector(3));
+	EXPECT_FALSE(cache.Read(6, data.data()));
+}
+
+TEST(SectorCache, Disabled)
+{
+	SectorCache cache(0, SECTOR_SIZE);
+	auto data = sector(0);
+	cache.Write(1, sector(1).data());
+	EXPECT_FALSE(cache.Read(1, data.data()));
+	EXPECT_FALSE(cache.Admits(1, 1));
+}
+
+TEST(SectorCache, AdmitsShortRandomReads)
+{
+	SectorCache cache(16, SECTOR_SIZE);
+	EXPECT_TRUE(cache.Admits(100, 1));
+	EXPECT_TRUE(cache.Admits(16, SectorCache::max_admitted_sectors));
+	EXPECT_FALSE(cache.Admits(200, SectorCache::max_admitted_sectors + 1));
+
+	// Reads carrying on from the previous one are streaming
+	EXPECT_TRUE(cache.Admits(300, 1));
+	EXPECT_FALSE(cache.Admits(301, 2));
+	EXPECT_FALSE(cache.Admits(303, 1));
+	EXPECT_TRUE(cache.Admits(301, 2)); // read again
+	EXPECT_TRUE(cache.Admits(16, 1));
+	EXPECT_FALSE(cache.Admits(17, 1));
+
+	cache.Admits(16, 1);
+	cache.Clear();
+	EXPECT_TRUE(cache.Admits(17, 1));
+}
+
+TEST(SectorCache, Clear)
+{
+	SectorCache cache(2, SECTOR_SIZE);
+	auto data = sector(0);
+	cache.Write(1, sector(1).data());
+	cache.Clear();
+	EXPECT_FALSE(cache.Read(1, data.data()));
+	cache.Write(2, sector(2).data());
+	cache.Write(3, sector(3).data());
+	EXPECT_TRUE(cache.Read(2, data.data()));
+	EXPECT_TRUE(cache.Read(3, data.data()));
+}
+
+} // namespace
@@ -0,0 +1,701 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "../src/libs/decoders/SDL_sound.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "temp_file.h"
+
+namespace {
+
+constexpr uint32_t RATE = 44100;
+constexpr uint32_t BLOCK_FRAMES = 4096;
+constexpr uint32_t NUM_BLOCKS = 60;
+constexpr uint32_t LAST_BLOCK_FRAMES = 1000;
+constexpr uint32_t NUM_FRAMES = (NUM_BLOCKS - 1) * BLOCK_FRAMES + LAST_BLOCK_FRAMES;
+
+// Seek points are listed at most every 16 KB of stream
+constexpr uint64_t POINT_SPACING = 16384;
+
+constexpr uint32_t VORBIS_BLOCK_SIZE = 2048;
+constexpr uint32_t VORBIS_PACKETS = 1500;
+constexpr uint32_t VORBIS_PACKETS_PER_PAGE = 30;
+// The first packet only starts the overlap, each later one completes a
+// half block
+constexpr uint32_t VORBIS_FRAMES = (VORBIS_PACKETS - 1) * (VORBIS_BLOCK_SIZE / 2);
+
+constexpr uint32_t OPUS_PACKET_FRAMES = 960; // 20 ms at 48 kHz
+constexpr uint32_t OPUS_PACKET_SIZE = 200;
+constexpr uint32_t OPUS_PACKETS = 3000;
+constexpr uint32_t OPUS_PACKETS_PER_PAGE = 100;
+constexpr uint16_t OPUS_PRE_SKIP = 312;
+constexpr uint32_t OPUS_FRAMES = OPUS_PACKETS * OPUS_PACKET_FRAMES - OPUS_PRE_SKIP;
+
+// A ramp on the left and noise on the right, with the start of a FLAC
+// frame header, 0xFFF8, turning up in the audio data now and then
+int16_t sample_value(uint32_t frame, int channel)
+{
+	if (frame % 777 == 0)
+		return static_cast<int16_t>(0xfff8);
+	if (channel == 0)
+		return static_cast<int16_t>(frame * 3);
+	return static_cast<int16_t>((frame * 2654435761u) >> 16);
+}
+
+// Writes a stereo, 16-bit FLAC stream of verbatim subframes, the simplest
+// valid coding, which needs no encoder
+class FlacWriter {
+public:
+	std::vector<uint8_t> data = {};
+	std::vector<uint64_t> frame_offsets = {};
+
+	void Write()
+	{
+		Bits(0x664c6143, 32); // "fLaC"
+
+		// The last metadata block, STREAMINFO
+		Bits(1, 1);
+		Bits(0, 7);
+		Bits(34, 24);
+		Bits(BLOCK_FRAMES, 16);
+		Bits(BLOCK_FRAMES, 16);
+		Bits(0, 24); // frame sizes unknown
+		Bits(0, 24);
+		Bits(RATE, 20);
+		Bits(2 - 1, 3);
+		Bits(16 - 1, 5);
+		Bits(NUM_FRAMES, 36);
+		for (int i = 0; i < 16; ++i)
+			Bits(0, 8); // no MD5 signature
+
+		for (uint32_t block = 0; block < NUM_BLOCKS; ++block)
+			Frame(block);
+	}
+
+private:
+	void Frame(uint32_t block)
+	{
+		const size_t start = data.size();
+		frame_offsets.push_back(start);
+		const bool last = block == NUM_BLOCKS - 1;
+		const uint32_t frames = last ? LAST_BLOCK_FRAMES : BLOCK_FRAMES;
+
+		Bits(0x3ffe, 14); // sync code
+		Bits(0, 1);
+		Bits(0, 1); // fixed block size
+		Bits(last ? 7 : 12, 4); // 16-bit size at the end, or 4096
+		Bits(9, 4);             // 44.1 kHz
+		Bits(1, 4);             // left and right
+		Bits(4, 3);             // 16 bits per sample
+		Bits(0, 1);
+		FrameNumber(block);
+		if (last)
+			Bits(frames - 1, 16);
+		Bits(Crc8(data.data() + start, data.size() - start), 8);
+
+		for (int channel = 0; channel < 2; ++channel) {
+			Bits(0, 1);
+			Bits(1, 6); // verbatim
+			Bits(0, 1);
+			const uint32_t first = block * BLOCK_FRAMES;
+			for (uint32_t i = 0; i < frames; ++i)
+				Bits(static_cast<uint16_t>(sample_value(first + i, channel)), 16);
+		}
+		Bits(Crc16(data.data() + start, data.size() - start), 16);
+	}
+
+	// Coded like a UTF-8 character
+	void FrameNumber(uint32_t n)
+	{
+		if (n < 0x80) {
+			Bits(n, 8);
+		} else {
+			Bits(0xc0 | (n >> 6), 8);
+			Bits(0x80 | (n & 0x3f), 8);
+		}
+	}
+
+	void Bits(uint64_t value, int count)
+	{
+		while (count--) {
+			if (bit_pos == 0)
+				data.push_back(0);
+			data.back() |= static_cast<uint8_t>(((value >> count) & 1) << (7 - bit_pos));
+			bit_pos = (bit_pos + 1) % 8;
+		}
+	}
+
+	static uint8_t Crc8(const uint8_t *bytes, size_t len)
+	{
+		uint8_t crc = 0;
+		while (len--) {
+			crc ^= *bytes++;
+			for (int i = 0; i < 8; ++i)
+				crc = static_cast<uint8_t>((crc & 0x80) ? (crc << 1) ^ 0x07
+				                                        : (crc << 1));
+		}
+		return crc;
+	}
+
+	static uint16_t Crc16(const uint8_t *bytes, size_t len)
+	{
+		uint16_t crc = 0;
+		while (len--) {
+			crc ^= static_cast<uint16_t>(*bytes++ << 8);
+			for (int i = 0; i < 8; ++i)
+				crc = static_cast<uint16_t>((crc & 0x8000) ? (crc << 1) ^ 0x8005
+				                                           : (crc << 1));
+		}
+		return crc;
+	}
+
+	int bit_pos = 0;
+};
+
+// Writes the pages of a single Ogg stream, each packet ending on the page
+// it starts on
+class OggWriter {
+public:
+	struct Page {
+		uint64_t offset;
+		uint64_t granule;
+	};
+
+	std::vector<uint8_t> data = {};
+	std::vector<Page> pages = {};
+
+	void WritePage(const std::vector<std::vector<uint8_t>> &packets,
+	               uint64_t granule, bool last = false)
+	{
+		const size_t start = data.size();
+		std::vector<uint8_t> lacing = {};
+		for (const auto &packet : packets) {
+			for (size_t i = 0; i < packet.size() / 255; ++i)
+				lacing.push_back(255);
+			lacing.push_back(static_cast<uint8_t>(packet.size() % 255));
+		}
+		assert(lacing.size() <= 255);
+
+		Le(0x5367674f, 4); // "OggS"
+		data.push_back(0);
+		data.push_back(pages.empty() ? 0x02 : last ? 0x04 : 0x00);
+		Le(granule, 8);
+		Le(0x0d05b0c5, 4); // serial number
+		Le(pages.size(), 4);
+		Le(0, 4); // CRC, filled in below
+		data.push_back(static_cast<uint8_t>(lacing.size()));
+		data.insert(data.end(), lacing.begin(), lacing.end());
+		for (const auto &packet : packets)
+			data.insert(data.end(), packet.begin(), packet.end());
+
+		const uint32_t crc = Crc32(data.data() + start, data.size() - start);
+		for (int i = 0; i < 4; ++i)
+			data[start + 22 + i] = static_cast<uint8_t>(crc >> (i * 8));
+		pages.push_back({start, granule});
+	}
+
+	// The points the Ogg page scan should list: pages ending a packet,
+	// past the header pages, at least the spacing apart
+	std::vector<Page> ExpectedPoints() const
+	{
+		std::vector<Page> points = {};
+		uint64_t next_listed = 0;
+		for (const auto &page : pages) {
+			if (page.granule == 0 || page.offset < next_listed)
+				continue;
+			points.push_back(page);
+			next_listed = page.offset + POINT_SPACING;
+		}
+		return points;
+	}
+
+private:
+	void Le(uint64_t value, int bytes)
+	{
+		for (int i = 0; i < bytes; ++i)
+			data.push_back(static_cast<uint8_t>(value >> (i * 8)));
+	}
+
+	static uint32_t Crc32(const uint8_t *bytes, size_t len)
+	{
+		uint32_t crc = 0;
+		while (len--) {
+			crc ^= static_cast<uint32_t>(*bytes++) << 24;
+			for (int i = 0; i < 8; ++i)
+				crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : (crc << 1);
+		}
+		return crc;
+	}
+};
+
+// Vorbis packets are packed from the least significant bit up
+class VorbisPacket {
+public:
+	std::vector<uint8_t> data = {};
+
+	void Bits(uint64_t value, int count)
+	{
+		for (int i = 0; i < count; ++i) {
+			if (bit_pos == 0)
+				data.push_back(0);
+			data.back() |= static_cast<uint8_t>(((value >> i) & 1) << bit_pos);
+			bit_pos = (bit_pos + 1) % 8;
+		}
+	}
+
+	void Header(uint8_t type)
+	{
+		Bits(type, 8);
+		for (const char *c = "vorbis"; *c; ++c)
+			Bits(static_cast<uint8_t>(*c), 8);
+	}
+
+private:
+	int bit_pos = 0;
+};
+
+// Writes a mono Vorbis stream simple enough to need no encoder. Its floor
+// is a straight line between two points, over a residue of +1s and -1s
+// coded a bit each, so every packet has the same length and its own sound.
+class VorbisWriter {
+public:
+	OggWriter ogg = {};
+
+	void Write()
+	{
+		ogg.WritePage({IdHeader()}, 0);
+		ogg.WritePage({CommentHeader(), SetupHeader()}, 0);
+		for (uint32_t first = 0; first < VORBIS_PACKETS;
+		     first += VORBIS_PACKETS_PER_PAGE) {
+			const uint32_t end = std::min(first + VORBIS_PACKETS_PER_PAGE,
+			                              VORBIS_PACKETS);
+			std::vector<std::vector<uint8_t>> packets = {};
+			for (uint32_t i = first; i < end; ++i)
+				packets.push_back(AudioPacket(i));
+			ogg.WritePage(packets, uint64_t{end - 1} * (VORBIS_BLOCK_SIZE / 2),
+			              end == VORBIS_PACKETS);
+		}
+	}
+
+private:
+	static std::vector<uint8_t> IdHeader()
+	{
+		VorbisPacket p;
+		p.Header(1);
+		p.Bits(0, 32); // version
+		p.Bits(1, 8);  // channels
+		p.Bits(RATE, 32);
+		p.Bits(0, 32); // no bitrates
+		p.Bits(0, 32);
+		p.Bits(0, 32);
+		p.Bits(11, 4); // short and long blocks both 2048 samples
+		p.Bits(11, 4);
+		p.Bits(1, 8); // framing
+		return p.data;
+	}
+
+	static std::vector<uint8_t> CommentHeader()
+	{
+		VorbisPacket p;
+		p.Header(3);
+		p.Bits(0, 32); // no vendor
+		p.Bits(0, 32); // no comments
+		p.Bits(1, 8);  // framing
+		return p.data;
+	}
+
+	static std::vector<uint8_t> SetupHeader()
+	{
+		VorbisPacket p;
+		p.Header(5);
+
+		p.Bits(2 - 1, 8); // codebooks
+		// 0: the residue classes, one per partition, all 0
+		Codebook(p);
+		p.Bits(0, 4); // no lookup
+		// 1: the residue values, -1 and +1
+		Codebook(p);
+		p.Bits(1, 4);              // lookup type 1
+		p.Bits(Float(-1, 0), 32);  // minimum -1
+		p.Bits(Float(2, 0), 32);   // delta 2
+		p.Bits(1 - 1, 4);          // 1-bit multiplicands
+		p.Bits(0, 1);              // not a sequence
+		p.Bits(0, 1);              // 0 and 1
+		p.Bits(1, 1);
+
+		p.Bits(1 - 1, 6); // time domain transforms, unused
+		p.Bits(0, 16);
+
+		p.Bits(1 - 1, 6); // floors
+		p.Bits(1, 16);    // floor 1
+		p.Bits(0, 5);     // no partitions, so only the two end points
+		p.Bits(1 - 1, 2); // multiplier 1
+		p.Bits(10, 4);    // the end point at 1 << 10, half a block
+
+		p.Bits(1 - 1, 6); // residues
+		p.Bits(1, 16);    // residue 1
+		p.Bits(0, 24);    // begin
+		p.Bits(VORBIS_BLOCK_SIZE / 2, 24); // end
+		p.Bits(64 - 1, 24); // partition size
+		p.Bits(1 - 1, 6);   // classifications
+		p.Bits(0, 8);       // class book
+		p.Bits(1, 3);       // class 0 codes pass 0
+		p.Bits(0, 1);
+		p.Bits(1, 8); // with book 1
+
+		p.Bits(1 - 1, 6); // mappings
+		p.Bits(0, 16);
+		p.Bits(0, 1); // one submap
+		p.Bits(0, 1); // no coupling
+		p.Bits(0, 2);
+		p.Bits(0, 8);
+		p.Bits(0, 8); // floor 0
+		p.Bits(0, 8); // residue 0
+
+		p.Bits(1 - 1, 6); // modes
+		p.Bits(0, 1);     // short blocks
+		p.Bits(0, 16);
+		p.Bits(0, 16);
+		p.Bits(0, 8); // mapping 0
+
+		p.Bits(1, 1); // framing
+		return p.data;
+	}
+
+	// Two entries of one dimension, with 1-bit codes
+	static void Codebook(VorbisPacket &p)
+	{
+		p.Bits(0x564342, 24);
+		p.Bits(1, 16); // dimensions
+		p.Bits(2, 24); // entries
+		p.Bits(0, 1);  // not ordered
+		p.Bits(0, 1);  // not sparse
+		p.Bits(1 - 1, 5);
+		p.Bits(1 - 1, 5);
+	}
+
+	static uint32_t Float(int mantissa, int exponent)
+	{
+		const uint32_t sign = mantissa < 0 ? 0x80000000u : 0;
+		return sign | static_cast<uint32_t>(exponent + 788) << 21 |
+		       static_cast<uint32_t>(std::abs(mantissa));
+	}
+
+	std::vector<uint8_t> AudioPacket(uint32_t n)
+	{
+		VorbisPacket p;
+		p.Bits(0, 1); // audio
+		p.Bits(1, 1); // floor used
+		p.Bits(150 + n % 40, 8);
+		p.Bits(120 + (n * 7) % 50, 8);
+		for (uint32_t part = 0; part < (VORBIS_BLOCK_SIZE / 2) / 64; ++part) {
+			p.Bits(0, 1); // class 0
+			p.Bits(rng(), 32);
+			p.Bits(rng(), 32);
+		}
+		return p.data;
+	}
+
+	std::mt19937 rng{4321};
+};
+
+// Writes a mono Opus stream of CELT frames with random contents, which
+// decode to noise
+class OpusWriter {
+public:
+	OggWriter ogg = {};
+
+	void Write()
+	{
+		std::vector<uint8_t> head = {'O', 'p', 'u', 's', 'H', 'e', 'a', 'd',
+		                             1, 1}; // version 1, mono
+		head.push_back(OPUS_PRE_SKIP & 0xff);
+		head.push_back(OPUS_PRE_SKIP >> 8);
+		head.insert(head.end(), {0x80, 0xbb, 0, 0}); // 48 kHz
+		head.insert(head.end(), {0, 0, 0});          // no gain, mapping 0
+		const std::vector<uint8_t> tags = {'O', 'p', 'u', 's', 'T', 'a',
+		                                   'g', 's', 0, 0, 0, 0, 0, 0, 0, 0};
+		ogg.WritePage({head}, 0);
+		ogg.WritePage({tags}, 0);
+
+		for (uint32_t first = 0; first < OPUS_PACKETS; first += OPUS_PACKETS_PER_PAGE) {
+			const uint32_t end = std::min(first + OPUS_PACKETS_PER_PAGE, OPUS_PACKETS);
+			std::vector<std::vector<uint8_t>> packets = {};
+			for (uint32_t i = first; i < end; ++i) {
+				// CELT only, fullband, 20 ms, one frame
+				std::vector<uint8_t> packet = {0xf8};
+				while (packet.size() < OPUS_PACKET_SIZE)
+					packet.push_back(static_cast<uint8_t>(rng()));
+				packets.push_back(packet);
+			}
+			ogg.WritePage(packets, uint64_t{end} * OPUS_PACKET_FRAMES,
+			              end == OPUS_PACKETS);
+		}
+	}
+
+private:
+	std::mt19937 rng{8765};
+};
+
+Sound_Sample *open_sample(const char *path)
+{
+	Sound_AudioInfo desired = {AUDIO_S16, 0, 0};
+	return Sound_NewSampleFromFile(path, &desired);
+}
+
+std::vector<int16_t> decode(Sound_Sample *sample, uint32_t frames)
+{
+	const uint32_t channels = sample->actual.channels;
+	std::vector<int16_t> pcm(frames * channels);
+	const uint32_t decoded = Sound_Decode_Direct(sample, pcm.data(), frames);
+	pcm.resize(decoded * channels);
+	return pcm;
+}
+
+// Scans the file the sample was opened from, as the CD-DA code does
+std::vector<Sound_SeekPoint> scan(Sound_Sample *sample, const char *path,
+                                  SDL_atomic_t *cancel = nullptr)
+{
+	std::vector<Sound_SeekPoint> list = {};
+	SDL_RWops *rw = SDL_RWFromFile(path, "rb");
+	if (!rw)
+		return list;
+	Sound_SeekPoint *points = nullptr;
+	const Uint32 count = Sound_ScanSeekPoints(sample, rw, cancel, &points);
+	SDL_RWclose(rw);
+	list.assign(points, points + count);
+	SDL_free(points);
+	return list;
+}
+
+// Seeks starting from the scanned points land on the same frames as a
+// linear decode of the whole stream
+void expect_seeks_match_linear_decode(const char *path, uint32_t rate,
+                                      uint32_t total_frames)
+{
+	Sound_Sample *linear = open_sample(path);
+	ASSERT_NE(linear, nullptr);
+	const uint32_t channels = linear->actual.channels;
+	const auto reference = decode(linear, total_frames);
+	ASSERT_EQ(reference.size(), total_frames * channels);
+	Sound_FreeSample(linear);
+
+	Sound_Sample *sample = open_sample(path);
+	ASSERT_NE(sample, nullptr);
+	const auto points = scan(sample, path);
+	ASSERT_FALSE(points.empty());
+	EXPECT_TRUE(Sound_SetSeekPoints(sample, points.data(),
+	                                static_cast<Uint32>(points.size())));
+
+	// Back and forth, on and off frame boundaries, and into the last frame
+	const Uint32 duration_ms = static_cast<Uint32>(uint64_t{total_frames} * 1000 / rate);
+	for (const Uint32 ms : {1000u, 0u, 93u, 2000u, 1u, 500u, 5405u, duration_ms - 10}) {
+		ASSERT_TRUE(Sound_Seek(sample, ms));
+		const auto frame = static_cast<uint32_t>(
+		        std::lround(static_cast<float>(rate) / 1000.0f * ms));
+		const uint32_t frames = std::min(3000u, total_frames - frame);
+		const auto pcm = decode(sample, frames);
+		ASSERT_EQ(pcm.size(), frames * channels) << "at " << ms << " ms";
+		EXPECT_TRUE(std::equal(pcm.begin(), pcm.end(),
+		                       reference.begin() + frame * channels))
+		        << "at " << ms << " ms";
+	}
+	Sound_FreeSample(sample);
+}
+
+struct SeekPointsTest : public testing::Test {
+	SeekPointsTest()
+	{
+		writer.Write();
+		EXPECT_TRUE(file.Write(writer.data));
+		Sound_Init();
+	}
+
+	~SeekPointsTest() { Sound_Quit(); }
+
+	TempFile file{"seek_points.flac"};
+	FlacWriter writer = {};
+};
+
+TEST_F(SeekPointsTest, DecodesFixture)
+{
+	Sound_Sample *sample = open_sample(file.Path());
+	ASSERT_NE(sample, nullptr);
+	const auto pcm = decode(sample, NUM_FRAMES + 100);
+	ASSERT_EQ(pcm.size(), NUM_FRAMES * 2);
+	for (uint32_t i = 0; i < NUM_FRAMES; ++i) {
+		ASSERT_EQ(pcm[i * 2], sample_value(i, 0));
+		ASSERT_EQ(pcm[i * 2 + 1], sample_value(i, 1));
+	}
+	Sound_FreeSample(sample);
+}
+
+// Every point is a real frame, despite the sync codes in the audio data
+TEST_F(SeekPointsTest, ListsFrames)
+{
+	Sound_Sample *sample = open_sample(file.Path());
+	ASSERT_NE(sample, nullptr);
+	ASSERT_TRUE(Sound_CanScanSeekPoints(sample));
+	const auto points = scan(sample, file.Path());
+
+	// A frame is 16 KB, the spacing of the points, so each gets listed
+	ASSERT_EQ(points.size(), NUM_BLOCKS);
+	for (Uint32 i = 0; i < NUM_BLOCKS; ++i) {
+		EXPECT_EQ(points[i].frame, i * BLOCK_FRAMES);
+		EXPECT_EQ(points[i].offset, writer.frame_offsets[i]);
+	}
+	Sound_FreeSample(sample);
+}
+
+TEST_F(SeekPointsTest, CancelledScanListsNothing)
+{
+	Sound_Sample *sample = open_sample(file.Path());
+	ASSERT_NE(sample, nullptr);
+	SDL_atomic_t cancel = {1};
+	EXPECT_TRUE(scan(sample, file.Path(), &cancel).empty());
+	Sound_FreeSample(sample);
+}
+
+TEST_F(SeekPointsTest, SeeksMatchLinearDecode)
+{
+	expect_seeks_match_linear_decode(file.Path(), RATE, NUM_FRAMES);
+}
+
+struct VorbisSeekPointsTest : public testing::Test {
+	VorbisSeekPointsTest()
+	{
+		writer.Write();
+		EXPECT_TRUE(file.Write(writer.ogg.data));
+		Sound_Init();
+	}
+
+	~VorbisSeekPointsTest() { Sound_Quit(); }
+
+	TempFile file{"seek_points.ogg"};
+	VorbisWriter writer = {};
+};
+
+TEST_F(VorbisSeekPointsTest, DecodesFixture)
+{
+	Sound_Sample *sample = open_sample(file.Path());
+	ASSERT_NE(sample, nullptr);
+	const auto pcm = decode(sample, VORBIS_FRAMES + 100);
+	EXPECT_EQ(pcm.size(), VORBIS_FRAMES);
+	EXPECT_TRUE(std::any_of(pcm.begin(), pcm.end(),
+	                        [](int16_t value) { return value != 0; }));
+	Sound_FreeSample(sample);
+}
+
+TEST_F(VorbisSeekPointsTest, ListsPages)
+{
+	Sound_Sample *sample = open_sample(file.Path());
+	ASSERT_NE(sample, nullptr);
+	ASSERT_TRUE(Sound_CanScanSeekPoints(sample));
+	const auto points = scan(sample, file.Path());
+
+	const auto expected = writer.ogg.ExpectedPoints();
+	ASSERT_GT(expected.size(), 5u);
+	ASSERT_EQ(points.size(), expected.size());
+	for (size_t i = 0; i < points.size(); ++i) {
+		EXPECT_EQ(points[i].frame, expected[i].granule);
+		EXPECT_EQ(points[i].offset, expected[i].offset);
+	}
+	Sound_FreeSample(sample);
+}
+
+TEST_F(VorbisSeekPointsTest, CancelledScanListsNothing)
+{
+	Sound_Sample *sample = open_sample(file.Path());
+	ASSERT_NE(sample, nullptr);
+	SDL_atomic_t cancel = {1};
+	EXPECT_TRUE(scan(sample, file.Path(), &cancel).empty());
+	Sound_FreeSample(sample);
+}
+
+TEST_F(VorbisSeekPointsTest, SeeksMatchLinearDecode)
+{
+	expect_seeks_match_linear_decode(file.Path(), RATE, VORBIS_FRAMES);
+}
+
+#if defined(USE_OPUS)
+
+struct OpusSeekPointsTest : public testing::Test {
+	OpusSeekPointsTest()
+	{
+		writer.Write();
+		EXPECT_TRUE(file.Write(writer.ogg.data));
+		Sound_Init();
+	}
+
+	~OpusSeekPointsTest() { Sound_Quit(); }
+
+	TempFile file{"seek_points.opus"};
+	OpusWriter writer = {};
+};
+
+TEST_F(OpusSeekPointsTest, ListsPages)
+{
+	Sound_Sample *sample = open_sample(file.Path());
+	ASSERT_NE(sample, nullptr);
+	ASSERT_TRUE(Sound_CanScanSeekPoints(sample));
+	const auto points = scan(sample, file.Path());
+
+	// Every page is longer than the spacing
+	const auto expected = writer.ogg.ExpectedPoints();
+	ASSERT_EQ(expected.size(), OPUS_PACKETS / OPUS_PACKETS_PER_PAGE);
+	ASSERT_EQ(points.size(), expected.size());
+	for (size_t i = 0; i < points.size(); ++i) {
+		EXPECT_EQ(points[i].frame, expected[i].granule);
+		EXPECT_EQ(points[i].offset, expected[i].offset);
+	}
+	Sound_FreeSample(sample);
+}
+
+// Decoding after a jump only converges on what a linear decode gives, so
+// check that seeks from the points leave the right number of frames
+TEST_F(OpusSeekPointsTest, SeeksFromPointsLandOnTarget)
+{
+	Sound_Sample *sample = open_sample(file.Path());
+	ASSERT_NE(sample, nullptr);
+	const auto points = scan(sample, file.Path());
+	ASSERT_FALSE(points.empty());
+	EXPECT_TRUE(Sound_SetSeekPoints(sample, points.data(),
+	                                static_cast<Uint32>(points.size())));
+
+	for (const Uint32 ms : {30000u, 0u, 2013u, 59000u, 45020u, 100u}) {
+		ASSERT_TRUE(Sound_Seek(sample, ms));
+		const uint32_t frame = ms * 48;
+		const auto pcm = decode(sample, OPUS_FRAMES);
+		EXPECT_EQ(pcm.size(), OPUS_FRAMES - frame) << "at " << ms << " ms";
+	}
+	Sound_FreeSample(sample);
+}
+
+#endif // USE_OPUS
+
+} // namespace
@@ -0,0 +1,79 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOSBOX_TESTS_TEMP_FILE_H
+#define DOSBOX_TESTS_TEMP_FILE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+// A file under tests/files/ for a test to write, removed before and after
+// the test so a failed run leaves nothing behind for the next one
+class TempFile {
+public:
+	explicit TempFile(const std::string &name) : path("tests/files/" + name)
+	{
+		Remove();
+	}
+	~TempFile() { Remove(); }
+
+	TempFile(const TempFile &) = delete;            // prevent copying
+	TempFile &operator=(const TempFile &) = delete; // prevent assignment
+
+	const char *Path() const { return path.c_str(); }
+
+	// Replaces the file's contents; false if it couldn't be written
+	bool Write(const void *data, size_t size) const
+	{
+		FILE *f = fopen(path.c_str(), "wb");
+		if (!f)
+			return false;
+		const bool written = fwrite(data, 1, size, f) == size;
+		return fclose(f) == 0 && written;
+	}
+	bool Write(const std::vector<uint8_t> &data) const
+	{
+		return Write(data.data(), data.size());
+	}
+	bool Write(const std::string &text) const
+	{
+		return Write(text.data(), text.size());
+	}
+
+	void Remove() const { remove(path.c_str()); }
+
+private:
+	const std::string path;
+};
+
+// The same bytes for the same seed, so failures reproduce
+inline std::vector<uint8_t> random_bytes(size_t size, uint32_t seed)
+{
+	std::mt19937 rng(seed);
+	std::vector<uint8_t> data(size);
+	for (auto &b : data)
+		b = static_cast<uint8_t>(rng());
+	return data;
+}
+
+#endif
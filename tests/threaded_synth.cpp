@@ -0,0 +1,176 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "threaded_synth.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// A chip whose left channel holds the last value written to register 1,
+// and whose right channel counts the frames rendered
+struct CountingChip {
+	void Write(uint16_t reg, uint8_t val)
+	{
+		if (reg == 1)
+			level = val;
+	}
+
+	void Render(int16_t *buffer, uint32_t frames)
+	{
+		for (uint32_t i = 0; i < frames; ++i, ++pos) {
+			buffer[i * 2] = level;
+			buffer[i * 2 + 1] = static_cast<int16_t>(pos);
+		}
+	}
+
+	int16_t level = 0;
+	uint32_t pos = 0;
+};
+
+TEST(ThreadedSynth, AppliesWritesAtTheirPositions)
+{
+	CountingChip chip;
+	ThreadedSynth synth(
+	        [&chip](uint16_t reg, uint8_t val) { chip.Write(reg, val); },
+	        [&chip](int16_t *buffer, uint32_t frames) {
+		        chip.Render(buffer, frames);
+	        },
+	        10, 100);
+	std::vector<int16_t> out(100 * 2);
+
+	synth.Write(0.5f, 1, 7);
+	synth.Write(0.75f, 2, 9); // not the level register
+	synth.EndTick(40, out.data());
+	for (uint32_t i = 0; i < 10; ++i)
+		ASSERT_EQ(out[i * 2], 0) << i; // the latency's silence
+	for (uint32_t i = 10; i < 40; ++i) {
+		ASSERT_EQ(out[i * 2], i - 10 < 20 ? 0 : 7) << i;
+		ASSERT_EQ(out[i * 2 + 1], static_cast<int16_t>(i - 10)) << i;
+	}
+
+	synth.Write(0.0f, 1, 3);
+	synth.EndTick(40, out.data());
+	for (uint32_t i = 0; i < 40; ++i) {
+		// The rest of the first tick, then the second one
+		ASSERT_EQ(out[i * 2], i < 10 ? 7 : 3) << i;
+		ASSERT_EQ(out[i * 2 + 1], static_cast<int16_t>(i + 30)) << i;
+	}
+}
+
+// Renders random ticks, up to the given length, with writes at random
+// positions, and checks the output against rendering them on this thread
+void expect_same_as_inline(const uint32_t longest_tick)
+{
+	constexpr uint32_t latency = 96;
+	constexpr uint32_t max_tick = 200;
+	CountingChip chip;
+	ThreadedSynth synth(
+	        [&chip](uint16_t reg, uint8_t val) { chip.Write(reg, val); },
+	        [&chip](int16_t *buffer, uint32_t frames) {
+		        chip.Render(buffer, frames);
+	        },
+	        latency, max_tick);
+
+	// Renders the same ticks on this thread, to compare with
+	CountingChip inline_chip;
+	std::vector<int16_t> expected(latency * 2, 0);
+	std::vector<int16_t> out;
+
+	std::mt19937 rng(1);
+	std::vector<int16_t> buffer;
+	for (int tick = 0; tick < 2000; ++tick) {
+		const uint32_t frames = 1 + rng() % longest_tick;
+		const auto num_writes = rng() % 8;
+		std::vector<float> indexes(num_writes);
+		for (auto &index : indexes)
+			index = (rng() % 1000) / 1000.0f;
+		std::sort(indexes.begin(), indexes.end());
+
+		uint32_t pos = 0;
+		for (const auto index : indexes) {
+			const auto val = static_cast<uint8_t>(rng());
+			synth.Write(index, 1, val);
+			const auto offset = static_cast<uint32_t>(index * frames);
+			buffer.resize((offset - pos) * 2);
+			inline_chip.Render(buffer.data(), offset - pos);
+			expected.insert(expected.end(), buffer.begin(), buffer.end());
+			inline_chip.Write(1, val);
+			pos = offset;
+		}
+		buffer.resize((frames - pos) * 2);
+		inline_chip.Render(buffer.data(), frames - pos);
+		expected.insert(expected.end(), buffer.begin(), buffer.end());
+
+		buffer.resize(frames * 2);
+		synth.EndTick(frames, buffer.data());
+		out.insert(out.end(), buffer.begin(), buffer.end());
+	}
+	expected.resize(out.size());
+	EXPECT_EQ(out, expected);
+}
+
+TEST(ThreadedSynth, MatchesRenderingInline)
+{
+	expect_same_as_inline(200);
+}
+
+// Ticks longer than the synth takes at once go out in parts, with each
+// write still landing on its frame
+TEST(ThreadedSynth, RendersLongTicksInParts)
+{
+	expect_same_as_inline(700);
+}
+
+TEST(ThreadedSynth, CountsWaits)
+{
+	// A chip slower than the ticks
+	auto slow = [](int16_t *buffer, uint32_t frames) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(2));
+		std::fill(buffer, buffer + frames * 2, 0);
+	};
+	ThreadedSynth synth([](uint16_t, uint8_t) {}, slow, 8, 16);
+	int16_t buffer[16 * 2];
+	for (int tick = 0; tick < 10; ++tick)
+		synth.EndTick(16, buffer);
+	EXPECT_GT(synth.GetWaits(), 0u);
+}
+
+TEST(ThreadedSynth, StopsWhileRendering)
+{
+	// Destroying it with ticks still queued must not hang
+	auto slow = [](int16_t *buffer, uint32_t frames) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		std::fill(buffer, buffer + frames * 2, 0);
+	};
+	ThreadedSynth synth([](uint16_t, uint8_t) {}, slow, 1000, 100);
+	int16_t buffer[100 * 2];
+	for (int tick = 0; tick < 5; ++tick)
+		synth.EndTick(100, buffer);
+	EXPECT_EQ(synth.GetWaits(), 0u);
+}
+
+} // namespace
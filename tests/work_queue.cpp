@@ -0,0 +1,138 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "work_queue.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+void wait_for(const std::atomic<bool> &flag)
+{
+	while (!flag)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+
+TEST(WorkQueue, RunsJobsOneAtATimeInOrder)
+{
+	std::mutex mutex;
+	std::vector<int> order;
+	std::atomic<int> running{0};
+	std::atomic<int> most_running{0};
+	std::atomic<int> finished{0};
+	{
+		WorkQueue queue;
+		for (int i = 0; i < 8; ++i)
+			queue.Add([&, i]() {
+				const int now = ++running;
+				if (now > most_running)
+					most_running = now;
+				std::this_thread::sleep_for(std::chrono::milliseconds(2));
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					order.push_back(i);
+				}
+				--running;
+				++finished;
+			});
+		while (finished < 8)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	EXPECT_EQ(most_running, 1);
+	EXPECT_EQ(order, std::vector<int>({0, 1, 2, 3, 4, 5, 6, 7}));
+}
+
+TEST(WorkQueue, RemovedJobDoesNotRun)
+{
+	WorkQueue queue;
+	std::atomic<bool> started{false};
+	std::atomic<bool> release{false};
+	std::atomic<bool> second_ran{false};
+	const auto first = queue.Add([&]() {
+		started = true;
+		wait_for(release);
+	});
+	const auto second = queue.Add([&]() { second_ran = true; });
+	EXPECT_NE(first, second);
+
+	wait_for(started);
+	EXPECT_EQ(queue.GetQueued(), 1u);
+	queue.Remove(second);
+	EXPECT_EQ(queue.GetQueued(), 0u);
+	release = true;
+	queue.Remove(first);
+	EXPECT_FALSE(second_ran);
+}
+
+TEST(WorkQueue, RemoveWaitsForRunningJob)
+{
+	WorkQueue queue;
+	std::atomic<bool> started{false};
+	std::atomic<bool> cancel{false};
+	std::atomic<bool> finished{false};
+	const auto id = queue.Add([&]() {
+		started = true;
+		wait_for(cancel);
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		finished = true;
+	});
+	wait_for(started);
+	cancel = true;
+	queue.Remove(id);
+	EXPECT_TRUE(finished);
+
+	// A finished job is gone already
+	queue.Remove(id);
+}
+
+TEST(WorkQueue, DropsWaitingJobsWhenDestroyed)
+{
+	std::atomic<bool> started{false};
+	std::atomic<bool> release{false};
+	std::atomic<int> ran{0};
+	std::thread releaser;
+	{
+		WorkQueue queue;
+		queue.Add([&]() {
+			started = true;
+			wait_for(release);
+			++ran;
+		});
+		for (int i = 0; i < 4; ++i)
+			queue.Add([&]() { ++ran; });
+		wait_for(started);
+
+		// Lets the running job finish while the queue is being destroyed
+		releaser = std::thread([&]() {
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+			release = true;
+		});
+	}
+	releaser.join();
+	EXPECT_EQ(ran, 1);
+}
+
+} // namespace